@@ -0,0 +1,16 @@
+#ifndef __BENCH_ALLOC_COUNTER_HPP__
+#define __BENCH_ALLOC_COUNTER_HPP__
+
+#include <cstdint>
+
+namespace VMPilot::Bench {
+/**
+ * @brief Get the number of global operator new calls so far.
+ *
+ * The benchmark binary replaces the global operator new/delete, so the
+ * difference of two calls is the number of heap allocations in between.
+ */
+uint64_t AllocationCount() noexcept;
+}  // namespace VMPilot::Bench
+
+#endif  // __BENCH_ALLOC_COUNTER_HPP__
@@ -0,0 +1,105 @@
+#include <block_cache.hpp>
+#include <bytecode_fixture.hpp>
+#include <decoder.hpp>
+#include <instruction_t.hpp>
+#include <opcode_enum.hpp>
+#include <vm.hpp>
+#include <vm_operand.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace VMPilot::Common::Opcode::Enum;
+using VMPilot::Bench::BENCH_KEY;
+using VMPilot::Bench::BENCH_REGION;
+using VMPilot::Common::Instruction_t;
+using VMPilot::Common::Operand::Immediate;
+using VMPilot::Common::Operand::Register;
+
+namespace {
+template <typename Enum>
+Instruction_t make(Enum opcode, uint64_t lhs = 0, uint64_t rhs = 0) {
+    Instruction_t inst{};
+    inst.opcode = static_cast<uint16_t>(opcode);
+    inst.left_operand = lhs;
+    inst.right_operand = rhs;
+    return inst;
+}
+
+// A region with a 16 iteration hot loop, then a jump over cold instructions
+// that never run
+std::vector<uint8_t> make_region(size_t cold) {
+    const auto end = static_cast<int64_t>(4 + cold);
+    std::vector<Instruction_t> insts = {
+        make(DataMovement::MOV, Register(1), Immediate(16)),
+        make(ArithmeticLogic::SUB, Register(1), Immediate(1)),  // 1: loop
+        make(ControlTransfer::JNZ, Immediate(1)),
+        make(ControlTransfer::JMP, Immediate(end)),
+    };
+    for (size_t i = 0; i < cold; ++i)
+        insts.push_back(make(ArithmeticLogic::ADD, Register(2), Immediate(1)));
+    insts.push_back(make(ControlTransfer::RET));
+    return VMPilot::Bench::EncodeRegion(insts);
+}
+}  // namespace
+
+// Decode the whole region up front, then run it
+static void BM_RunRegion_Eager(benchmark::State& state) {
+    const auto region = make_region(static_cast<size_t>(state.range(0)));
+    auto& decoder = VMPilot::Runtime::Decoder::GetInstance();
+    decoder.Init(BENCH_KEY);
+    VMPilot::Runtime::VM vm;
+    std::vector<uint8_t> decoded;
+
+    for (auto _ : state) {
+        decoder.DecodeInto(region, BENCH_REGION, decoded);
+        const VMPilot::Runtime::Program program(
+            reinterpret_cast<const Instruction_t*>(decoded.data()),
+            decoded.size() / sizeof(Instruction_t));
+        vm.Reset();
+        auto result = vm.Run(program);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_RunRegion_Eager)->ArgName("cold")->Arg(1 << 10)->Arg(1 << 16);
+
+// A new block cache per run, only the executed blocks are decoded
+static void BM_RunRegion_BlockCacheCold(benchmark::State& state) {
+    const auto region = make_region(static_cast<size_t>(state.range(0)));
+    auto& decoder = VMPilot::Runtime::Decoder::GetInstance();
+    decoder.Init(BENCH_KEY);
+    VMPilot::Runtime::VM vm;
+
+    for (auto _ : state) {
+        VMPilot::Runtime::BlockCache cache(decoder, region, BENCH_REGION);
+        vm.Reset();
+        auto result = cache.Run(vm);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_RunRegion_BlockCacheCold)
+    ->ArgName("cold")
+    ->Arg(1 << 10)
+    ->Arg(1 << 16);
+
+// The steady state, every block is already decoded
+static void BM_RunRegion_BlockCacheWarm(benchmark::State& state) {
+    const auto region = make_region(static_cast<size_t>(state.range(0)));
+    auto& decoder = VMPilot::Runtime::Decoder::GetInstance();
+    decoder.Init(BENCH_KEY);
+    VMPilot::Runtime::VM vm;
+    VMPilot::Runtime::BlockCache cache(decoder, region, BENCH_REGION);
+
+    for (auto _ : state) {
+        vm.Reset();
+        auto result = cache.Run(vm);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["blocks"] = static_cast<double>(cache.Size());
+}
+BENCHMARK(BM_RunRegion_BlockCacheWarm)
+    ->ArgName("cold")
+    ->Arg(1 << 10)
+    ->Arg(1 << 16);
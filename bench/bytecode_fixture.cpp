@@ -0,0 +1,41 @@
+#include <bytecode_fixture.hpp>
+#include <instruction_cipher.hpp>
+#include <opcode_table.hpp>
+
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
+using VMPilot::Common::Instruction_t;
+
+namespace {
+// Write the packed big-endian encoding, the inverse of detail::Fetch
+void encode(const Instruction_t& inst, uint8_t* out) {
+    const auto put = [&out](uint64_t value, size_t size) {
+        for (size_t i = size; i > 0; --i)
+            *out++ = static_cast<uint8_t>(value >> (8 * (i - 1)));
+    };
+    put(inst.opcode, sizeof(inst.opcode));
+    put(inst.left_operand, sizeof(inst.left_operand));
+    put(inst.right_operand, sizeof(inst.right_operand));
+    put(inst.nounce, sizeof(inst.nounce));
+    put(inst.checksum, sizeof(inst.checksum));
+}
+}  // namespace
+
+std::vector<uint8_t> VMPilot::Bench::EncodeRegion(
+    const std::vector<Instruction_t>& insts, const std::string& key,
+    uint64_t region) {
+    const auto oid_table =
+        VMPilot::Common::Opcode_table_generator(key).Get_RealOp_to_OID();
+    const VMPilot::Common::InstructionCipher cipher(key);
+    VMPilot::Common::Instruction helper;
+
+    std::vector<uint8_t> result(insts.size() * ENCODED_INSTRUCTION_SIZE);
+    for (size_t i = 0; i < insts.size(); ++i) {
+        auto inst = insts[i];
+        inst.opcode = oid_table.at(inst.opcode);
+        inst.nounce = static_cast<uint32_t>(i * 0x9E3779B9u);
+        cipher.Encrypt(&inst, 1, region, i);
+        helper.update_checksum(inst);
+        encode(inst, result.data() + i * ENCODED_INSTRUCTION_SIZE);
+    }
+    return result;
+}
@@ -0,0 +1,31 @@
+#ifndef __BENCH_BYTECODE_FIXTURE_HPP__
+#define __BENCH_BYTECODE_FIXTURE_HPP__
+
+#include <instruction_t.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VMPilot::Bench {
+
+// The key of all the benchmark bytecode
+inline const std::string BENCH_KEY = "VMPilot benchmark key, 32 bytes!";
+
+// The address of the benchmark regions, in the cipher counter
+constexpr uint64_t BENCH_REGION = 0x140001000;
+
+/**
+ * @brief Build an encoded region from instructions with real opcodes.
+ *
+ * It does what the SDK does: the opcodes are replaced by their OIDs, the
+ * instructions are encrypted, checksummed and written in the packed
+ * big-endian encoding that Runtime::detail::Fetch reads.
+ */
+std::vector<uint8_t> EncodeRegion(
+    const std::vector<VMPilot::Common::Instruction_t>& insts,
+    const std::string& key = BENCH_KEY, uint64_t region = BENCH_REGION);
+
+}  // namespace VMPilot::Bench
+
+#endif  // __BENCH_BYTECODE_FIXTURE_HPP__
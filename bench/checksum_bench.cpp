@@ -0,0 +1,54 @@
+#include <alloc_counter.hpp>
+#include <instruction_t.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using VMPilot::Common::ChecksumVersion;
+using VMPilot::Common::Instruction;
+using VMPilot::Common::Instruction_t;
+
+namespace {
+std::vector<Instruction_t> random_instructions(size_t n,
+                                               ChecksumVersion version) {
+    std::mt19937_64 rng(0x564D50696C6F74);  // "VMPilot"
+    std::vector<Instruction_t> result(n);
+    Instruction helper;
+    for (auto& inst : result) {
+        inst.opcode = static_cast<uint16_t>(rng());
+        inst.left_operand = rng();
+        inst.right_operand = rng();
+        inst.nounce = static_cast<uint32_t>(rng());
+        helper.update_checksum(inst, version);
+    }
+    return result;
+}
+}  // namespace
+
+// The per-instruction verify path of the decoder: Instruction::check
+static void BM_InstructionCheck(benchmark::State& state) {
+    const auto version = static_cast<ChecksumVersion>(state.range(0));
+    const auto insts = random_instructions(1024, version);
+    Instruction helper;
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        for (const auto& inst : insts) {
+            bool ok = helper.check(inst, version);
+            benchmark::DoNotOptimize(ok);
+        }
+    }
+    const auto allocs = VMPilot::Bench::AllocationCount() - allocs_before;
+
+    state.SetItemsProcessed(state.iterations() * insts.size());
+    state.counters["allocs_per_inst"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(insts.size()),
+        benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_InstructionCheck)
+    ->ArgName("checksum_version")
+    ->Arg(static_cast<int64_t>(ChecksumVersion::V1))
+    ->Arg(static_cast<int64_t>(ChecksumVersion::V2));
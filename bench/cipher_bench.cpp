@@ -0,0 +1,82 @@
+#include <alloc_counter.hpp>
+#include <bytecode_fixture.hpp>
+#include <instruction_cipher.hpp>
+#include <instruction_t.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using VMPilot::Bench::BENCH_KEY;
+using VMPilot::Bench::BENCH_REGION;
+using VMPilot::Common::Instruction;
+using VMPilot::Common::InstructionCipher;
+using VMPilot::Common::Instruction_t;
+
+// The bulk decryption of a region with each kernel of the instruction cipher.
+// A kernel the CPU does not support falls back, see the impl counter.
+static void BM_InstructionCipher(benchmark::State& state) {
+    const auto impl =
+        static_cast<InstructionCipher::Implementation>(state.range(0));
+    const auto count = static_cast<size_t>(state.range(1));
+
+    std::mt19937_64 rng(0x564D50696C6F74);  // "VMPilot"
+    std::vector<Instruction_t> insts(count);
+    for (auto& inst : insts) {
+        inst.opcode = static_cast<uint16_t>(rng());
+        inst.left_operand = rng();
+        inst.right_operand = rng();
+        inst.nounce = static_cast<uint32_t>(rng());
+    }
+
+    const InstructionCipher cipher(BENCH_KEY, impl);
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        cipher.Decrypt(insts.data(), insts.size(), BENCH_REGION, 0);
+        benchmark::DoNotOptimize(insts.data());
+    }
+    const auto allocs = VMPilot::Bench::AllocationCount() - allocs_before;
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["impl"] = static_cast<double>(cipher.GetImplementation());
+    state.counters["allocs_per_inst"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(count),
+        benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_InstructionCipher)
+    ->ArgNames({"impl", "count"})
+    ->ArgsProduct(
+        {{static_cast<int64_t>(InstructionCipher::Implementation::Portable),
+          static_cast<int64_t>(InstructionCipher::Implementation::AESNI),
+          static_cast<int64_t>(InstructionCipher::Implementation::VAES)},
+         {1 << 10, 1 << 16}});
+
+// The one instruction API, it sets up the cipher on every call
+static void BM_InstructionDecrypt(benchmark::State& state) {
+    std::mt19937_64 rng(0x564D50696C6F74);
+    std::vector<Instruction_t> insts(1 << 10);
+    for (auto& inst : insts) {
+        inst.opcode = static_cast<uint16_t>(rng());
+        inst.left_operand = rng();
+        inst.right_operand = rng();
+        inst.nounce = static_cast<uint32_t>(rng());
+    }
+    Instruction helper;
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        for (auto& inst : insts)
+            helper.decrypt(inst, BENCH_KEY);
+        benchmark::DoNotOptimize(insts.data());
+    }
+    const auto allocs = VMPilot::Bench::AllocationCount() - allocs_before;
+
+    state.SetItemsProcessed(state.iterations() * insts.size());
+    state.counters["allocs_per_inst"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(insts.size()),
+        benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_InstructionDecrypt);
@@ -0,0 +1,107 @@
+#include <alloc_counter.hpp>
+#include <bytecode_fixture.hpp>
+#include <decoder.hpp>
+#include <instruction_t.hpp>
+#include <opcode_table.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
+using VMPilot::Common::Instruction_t;
+
+namespace {
+using VMPilot::Bench::BENCH_KEY;
+using VMPilot::Bench::BENCH_REGION;
+
+std::vector<uint8_t> random_bytes(size_t n) {
+    std::mt19937_64 rng(0x564D50696C6F74);  // "VMPilot"
+    std::vector<uint8_t> result(n);
+    for (auto& b : result)
+        b = static_cast<uint8_t>(rng());
+    return result;
+}
+
+// Build a valid encrypted bytecode stream of count instructions with BENCH_KEY
+std::vector<uint8_t> make_bytecode(size_t count) {
+    const auto oid_table =
+        VMPilot::Common::Opcode_table_generator(BENCH_KEY).Get_RealOp_to_OID();
+    std::vector<uint16_t> opcodes;
+    for (const auto& [opcode, _] : oid_table)
+        opcodes.push_back(opcode);
+
+    std::mt19937_64 rng(0x564D50696C6F74);
+    std::vector<Instruction_t> insts(count);
+    for (size_t i = 0; i < count; ++i) {
+        insts[i].opcode = opcodes[i % opcodes.size()];
+        insts[i].left_operand = rng();
+        insts[i].right_operand = rng();
+    }
+    return VMPilot::Bench::EncodeRegion(insts);
+}
+
+void set_counters(benchmark::State& state, size_t count, uint64_t allocs) {
+    state.SetItemsProcessed(state.iterations() * count);
+    state.SetBytesProcessed(state.iterations() * count *
+                            ENCODED_INSTRUCTION_SIZE);
+    state.counters["allocs_per_inst"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(count),
+        benchmark::Counter::kAvgIterations);
+}
+}  // namespace
+
+static void BM_Fetch(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const auto data = random_bytes(count * ENCODED_INSTRUCTION_SIZE);
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        for (size_t i = 0; i < data.size(); i += ENCODED_INSTRUCTION_SIZE) {
+            auto inst = VMPilot::Runtime::detail::Fetch(data.data() + i);
+            benchmark::DoNotOptimize(inst);
+        }
+    }
+    set_counters(state, count,
+                 VMPilot::Bench::AllocationCount() - allocs_before);
+}
+BENCHMARK(BM_Fetch)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// The vector-returning API, allocates the result on every call
+static void BM_Decode(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const auto data = make_bytecode(count);
+    auto& decoder = VMPilot::Runtime::Decoder::GetInstance();
+    decoder.Init(BENCH_KEY);
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        auto result = decoder.Decode(data, BENCH_REGION);
+        benchmark::DoNotOptimize(result.data());
+    }
+    set_counters(state, count,
+                 VMPilot::Bench::AllocationCount() - allocs_before);
+}
+BENCHMARK(BM_Decode)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// The reusing API, the steady state should not allocate at all
+static void BM_DecodeInto(benchmark::State& state) {
+    const auto count = static_cast<size_t>(state.range(0));
+    const auto data = make_bytecode(count);
+    auto& decoder = VMPilot::Runtime::Decoder::GetInstance();
+    decoder.Init(BENCH_KEY);
+
+    std::vector<uint8_t> reuse;
+    decoder.DecodeInto(data, BENCH_REGION, reuse);
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        decoder.DecodeInto(data, BENCH_REGION, reuse);
+        benchmark::DoNotOptimize(reuse.data());
+    }
+    set_counters(state, count,
+                 VMPilot::Bench::AllocationCount() - allocs_before);
+}
+BENCHMARK(BM_DecodeInto)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
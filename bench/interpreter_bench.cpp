@@ -0,0 +1,136 @@
+#include <alloc_counter.hpp>
+#include <instruction_t.hpp>
+#include <opcode_enum.hpp>
+#include <vm.hpp>
+#include <vm_operand.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace VMPilot::Common::Opcode::Enum;
+using VMPilot::Common::Instruction_t;
+using VMPilot::Common::Operand::Immediate;
+using VMPilot::Common::Operand::Register;
+
+namespace {
+template <typename Enum>
+Instruction_t make(Enum opcode, uint64_t lhs = 0, uint64_t rhs = 0) {
+    Instruction_t inst{};
+    inst.opcode = static_cast<uint16_t>(opcode);
+    inst.left_operand = lhs;
+    inst.right_operand = rhs;
+    return inst;
+}
+
+void set_counters(benchmark::State& state, uint64_t insts_per_run,
+                  uint64_t allocs) {
+    state.SetItemsProcessed(state.iterations() * insts_per_run);
+    state.counters["allocs_per_run"] = benchmark::Counter(
+        static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+}  // namespace
+
+// R0 = N + (N - 1) + ... + 1, three instructions per iteration
+static void BM_Interpreter_ArithmeticLoop(benchmark::State& state) {
+    const auto n = static_cast<int64_t>(state.range(0));
+    const std::vector<Instruction_t> code = {
+        make(DataMovement::MOV, Register(0), Immediate(0)),
+        make(DataMovement::MOV, Register(1), Immediate(n)),
+        make(ArithmeticLogic::ADD, Register(0), Register(1)),  // 2: loop
+        make(ArithmeticLogic::SUB, Register(1), Immediate(1)),
+        make(ControlTransfer::JNZ, Immediate(2)),
+        make(ControlTransfer::RET),
+    };
+    const VMPilot::Runtime::Program program(code.data(), code.size());
+    VMPilot::Runtime::VM vm;
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        vm.Reset();
+        auto result = vm.Run(program);
+        benchmark::DoNotOptimize(result);
+    }
+    set_counters(state, 3 * n + 3,
+                 VMPilot::Bench::AllocationCount() - allocs_before);
+}
+BENCHMARK(BM_Interpreter_ArithmeticLoop)->Arg(1 << 10)->Arg(1 << 20);
+
+// A loop calling a function that increments a counter in the VM memory,
+// nine instructions per iteration
+static void BM_Interpreter_CallLoop(benchmark::State& state) {
+    const auto n = static_cast<int64_t>(state.range(0));
+    const std::vector<Instruction_t> code = {
+        make(DataMovement::MOV, Register(1), Immediate(n)),
+        make(ControlTransfer::CALL, Immediate(5)),  // 1: loop
+        make(ArithmeticLogic::SUB, Register(1), Immediate(1)),
+        make(ControlTransfer::JNZ, Immediate(1)),
+        make(ControlTransfer::RET),
+        make(DataMovement::LOAD, Register(0), Immediate(0)),  // 5: function
+        make(ArithmeticLogic::ADD, Register(0), Immediate(1)),
+        make(DataMovement::STORE, Immediate(0), Register(0)),
+        make(DataMovement::PUSH, Register(0)),
+        make(DataMovement::POP, Register(0)),
+        make(ControlTransfer::RET),
+    };
+    const VMPilot::Runtime::Program program(code.data(), code.size());
+    VMPilot::Runtime::VM vm;
+    alignas(8) uint8_t memory[8] = {};
+    vm.SetMemory(memory, sizeof(memory));
+
+    const auto allocs_before = VMPilot::Bench::AllocationCount();
+    for (auto _ : state) {
+        vm.Reset();
+        auto result = vm.Run(program);
+        benchmark::DoNotOptimize(result);
+    }
+    set_counters(state, 9 * n + 2,
+                 VMPilot::Bench::AllocationCount() - allocs_before);
+}
+BENCHMARK(BM_Interpreter_CallLoop)->Arg(1 << 10)->Arg(1 << 20);
+
+// The same counter loop before and after the peephole pass:
+//   LOAD; ADD; STORE; SUB; CMP; JNZ   (6 dispatches per iteration)
+//   LOAD_ADD_STORE; SUB; CMP_JNZ      (3 dispatches per iteration)
+static void BM_Interpreter_Superinstructions(benchmark::State& state) {
+    const bool fused = state.range(0) != 0;
+    const auto n = static_cast<int64_t>(state.range(1));
+    std::vector<Instruction_t> code;
+    code.push_back(make(DataMovement::MOV, Register(1), Immediate(n)));
+    if (fused) {
+        using VMPilot::Common::Operand::PackedRegister;
+        using VMPilot::Common::Operand::ToPayload;
+        code.push_back(make(DataMovement::LOAD_ADD_STORE,
+                            PackedRegister(0, ToPayload(Immediate(0))),
+                            Register(1)));  // 1: loop
+        code.push_back(make(ArithmeticLogic::SUB, Register(1), Immediate(1)));
+        code.push_back(make(ControlTransfer::CMP_JNZ, PackedRegister(1, 1),
+                            Immediate(0)));
+    } else {
+        code.push_back(make(DataMovement::LOAD, Register(0), Immediate(0)));
+        code.push_back(make(ArithmeticLogic::ADD, Register(0), Register(1)));
+        code.push_back(make(DataMovement::STORE, Immediate(0), Register(0)));
+        code.push_back(make(ArithmeticLogic::SUB, Register(1), Immediate(1)));
+        code.push_back(make(ArithmeticLogic::CMP, Register(1), Immediate(0)));
+        code.push_back(make(ControlTransfer::JNZ, Immediate(1)));
+    }
+    code.push_back(make(ControlTransfer::RET));
+
+    const VMPilot::Runtime::Program program(code.data(), code.size());
+    VMPilot::Runtime::VM vm;
+    alignas(8) uint8_t memory[8] = {};
+    vm.SetMemory(memory, sizeof(memory));
+
+    for (auto _ : state) {
+        vm.Reset();
+        auto result = vm.Run(program);
+        benchmark::DoNotOptimize(result);
+    }
+    // Items are the iterations of the VM loop, comparable across both forms
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_Interpreter_Superinstructions)
+    ->ArgNames({"fused", "n"})
+    ->Args({0, 1 << 16})
+    ->Args({1, 1 << 16});
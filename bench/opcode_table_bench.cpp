@@ -0,0 +1,106 @@
+#include <bytecode_fixture.hpp>
+#include <opcode_table.hpp>
+
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using namespace VMPilot::Common;
+
+namespace {
+using VMPilot::Bench::BENCH_KEY;
+
+// A random stream of valid OIDs, like the opcodes of a decoded region
+std::vector<OID> random_oids(const Opcode_table_generator& gen, size_t n) {
+    std::vector<OID> oids;
+    for (const auto& [_, oid] : gen.Get_RealOp_to_OID())
+        oids.push_back(oid);
+
+    std::mt19937_64 rng(0x564D50696C6F74);  // "VMPilot"
+    std::vector<OID> result(n);
+    for (auto& oid : result)
+        oid = oids[rng() % oids.size()];
+    return result;
+}
+}  // namespace
+
+// The former decoder path: OID -> OI and OI -> RealOpcode in two hash maps
+static void BM_OpcodeLookup_Map(benchmark::State& state) {
+    const Opcode_table_generator gen(BENCH_KEY);
+    const auto oids = random_oids(gen, 1 << 12);
+
+    const auto OI_to_RealOp = gen.Generate();
+    std::unordered_map<OID, OI> OID_to_OI;
+    for (const auto& [oi, opcode] : OI_to_RealOp)
+        OID_to_OI.insert({gen.Get_RealOp_to_OID().at(opcode), oi});
+
+    for (auto _ : state) {
+        for (const auto oid : oids) {
+            auto opcode = OI_to_RealOp.find(OID_to_OI.find(oid)->second);
+            benchmark::DoNotOptimize(opcode);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * oids.size());
+}
+BENCHMARK(BM_OpcodeLookup_Map);
+
+// Two dependent array lookups: GetOpcodeIndex, then Opcode_table::find
+static void BM_OpcodeLookup_TwoStep(benchmark::State& state) {
+    const Opcode_table_generator gen(BENCH_KEY);
+    const auto oids = random_oids(gen, 1 << 12);
+    const Opcode_table table(gen.Generate());
+
+    for (auto _ : state) {
+        for (const auto oid : oids) {
+            auto opcode = table.find(gen.GetOpcodeIndex(oid));
+            benchmark::DoNotOptimize(opcode);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * oids.size());
+}
+BENCHMARK(BM_OpcodeLookup_TwoStep);
+
+// One fused OID -> RealOpcode lookup
+static void BM_OpcodeLookup_Fused(benchmark::State& state) {
+    const Opcode_table_generator gen(BENCH_KEY);
+    const auto oids = random_oids(gen, 1 << 12);
+    const auto table = gen.GenerateFlat();
+
+    for (auto _ : state) {
+        for (const auto oid : oids) {
+            auto opcode = table.find(oid);
+            benchmark::DoNotOptimize(opcode);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * oids.size());
+}
+BENCHMARK(BM_OpcodeLookup_Fused);
+
+// The branch-free lookup the decoder uses, 0 for an unknown OID
+static void BM_OpcodeLookup_Branchless(benchmark::State& state) {
+    const Opcode_table_generator gen(BENCH_KEY);
+    const auto oids = random_oids(gen, 1 << 12);
+    const auto table = gen.GenerateFlat();
+
+    for (auto _ : state) {
+        for (const auto oid : oids) {
+            auto opcode = table.lookup(oid);
+            benchmark::DoNotOptimize(opcode);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * oids.size());
+}
+BENCHMARK(BM_OpcodeLookup_Branchless);
+
+// The per-key setup of the opcode tables, paid once by Decoder::Init
+static void BM_OpcodeTableGenerator(benchmark::State& state) {
+    for (auto _ : state) {
+        const Opcode_table_generator gen(BENCH_KEY);
+        auto table = gen.GenerateFlat();
+        benchmark::DoNotOptimize(table);
+    }
+}
+BENCHMARK(BM_OpcodeTableGenerator);
@@ -0,0 +1,116 @@
+#include <BytecodeCompileRecipe.hpp>
+#include <bytecode_compiler.hpp>
+#include <file_type_parser.hpp>
+#include <segmentator.hpp>
+
+#include <exception>
+#include <iterator>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+// Turn the global log level off for a scope, then restore it for the
+// benchmarks that run next
+class QuietLog {
+   public:
+    QuietLog() : previous_(spdlog::get_level()) {
+        spdlog::set_level(spdlog::level::off);
+    }
+    ~QuietLog() { spdlog::set_level(previous_); }
+
+    QuietLog(const QuietLog&) = delete;
+    QuietLog& operator=(const QuietLog&) = delete;
+
+   private:
+    spdlog::level::level_enum previous_;
+};
+
+// The sample binaries, indexed by the benchmark argument
+const std::string SAMPLES[] = {
+    "basic_binary.Linux.x86_64",
+    "basic_binary.Linux.x86",
+    "basic_binary.Darwin.arm64",
+};
+
+std::string sample_path(benchmark::State& state) {
+    const auto& name = SAMPLES[state.range(0)];
+    state.SetLabel(name);
+    return std::string(VMPILOT_DATA_DIR) + "/basic/bin/" + name;
+}
+
+void apply_samples(benchmark::internal::Benchmark* b) {
+    b->ArgName("sample");
+    for (size_t i = 0; i < std::size(SAMPLES); ++i)
+        b->Arg(static_cast<int64_t>(i));
+}
+}  // namespace
+
+// Open and parse the headers of a sample binary
+static void BM_GetFileMetadata(benchmark::State& state) {
+    const auto path = sample_path(state);
+
+    for (auto _ : state) {
+        auto metadata = VMPilot::Common::get_file_metadata(path);
+        benchmark::DoNotOptimize(metadata);
+    }
+}
+BENCHMARK(BM_GetFileMetadata)->Apply(apply_samples);
+
+// The SDK front end: create the segmentator of a sample and segment it
+static void BM_Segmentation(benchmark::State& state) {
+    const auto path = sample_path(state);
+    // The unsupported parts of a sample are logged on every iteration
+    const QuietLog quiet;
+
+    for (auto _ : state) {
+        auto segmentator = VMPilot::SDK::Segmentator::create_segmentator(path);
+        if (segmentator)
+            segmentator->segmentation();
+        benchmark::DoNotOptimize(segmentator);
+    }
+}
+BENCHMARK(BM_Segmentation)->Apply(apply_samples);
+
+// Compile the regions of an x86 sample, the fusion of the peephole pass is
+// reported as counters: the VM instructions of the regions before and
+// after it, the static dispatch count reduction
+static void BM_CompileRegions(benchmark::State& state) {
+    using VMPilot::SDK::BytecodeCompiler::CompilerBase;
+    using VMPilot::SDK::BytecodeCompiler::CompilerFactory;
+    using VMPilot::SDK::BytecodeCompiler::FusionStats;
+
+    const auto path = sample_path(state);
+    const QuietLog quiet;
+    const VMPilot::SDK::BytecodeCompileRecipe recipe(nlohmann::json{
+        {"master_key", "VMPilot benchmark master key 0123456789"},
+        {"input", path},
+        {"output", path + ".protected"},
+    });
+    const auto compiler = CompilerFactory::CreateCompiler(
+        state.range(0) == 0 ? "x86_64" : "x86");
+
+    FusionStats fusion;
+    try {
+        const auto segmentator =
+            CompilerBase::Segment(VMPilot::Common::get_file_metadata(path));
+        for (auto _ : state) {
+            fusion = FusionStats();
+            for (const auto& region : segmentator->getRegions()) {
+                auto bytecode = compiler->DisassembleAndCompile(
+                    recipe, *segmentator, region, &fusion);
+                benchmark::DoNotOptimize(bytecode);
+            }
+        }
+    } catch (const std::exception& e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    state.counters["vm_before"] =
+        static_cast<double>(fusion.instructions_before);
+    state.counters["vm_after"] = static_cast<double>(fusion.instructions_after);
+    state.counters["fused"] = static_cast<double>(
+        fusion.load_add_store + fusion.cmp_jz + fusion.cmp_jnz);
+}
+BENCHMARK(BM_CompileRegions)->ArgName("sample")->Arg(0)->Arg(1);
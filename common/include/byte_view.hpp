@@ -0,0 +1,54 @@
+#ifndef __COMMON_BYTE_VIEW_HPP__
+#define __COMMON_BYTE_VIEW_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace VMPilot::Common {
+
+/**
+ * @brief A non-owning, read-only view over a contiguous range of bytes.
+ *
+ * We are on C++17, so this is the small subset of std::span<const uint8_t>
+ * we need. The viewed memory must outlive the view.
+ */
+class ByteView {
+   public:
+    constexpr ByteView() noexcept = default;
+    constexpr ByteView(const uint8_t* data, size_t size) noexcept
+        : data_(data), size_(size) {}
+    ByteView(const std::vector<uint8_t>& vec) noexcept
+        : data_(vec.data()), size_(vec.size()) {}
+
+    constexpr const uint8_t* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+
+    constexpr const uint8_t* begin() const noexcept { return data_; }
+    constexpr const uint8_t* end() const noexcept { return data_ + size_; }
+
+    constexpr uint8_t operator[](size_t idx) const noexcept {
+        return data_[idx];
+    }
+
+    /**
+     * @brief Get a view of [offset, offset + count) of this view.
+     *
+     * @throws std::out_of_range if the range is not inside this view.
+     */
+    ByteView subview(size_t offset, size_t count) const {
+        if (offset > size_ || count > size_ - offset)
+            throw std::out_of_range("ByteView::subview out of range");
+        return ByteView(data_ + offset, count);
+    }
+
+   private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace VMPilot::Common
+
+#endif  // __COMMON_BYTE_VIEW_HPP__
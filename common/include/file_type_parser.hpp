@@ -1,7 +1,10 @@
 #ifndef __COMMON_FILE_TYPE_PARSER_HPP__
 #define __COMMON_FILE_TYPE_PARSER_HPP__
 
+#include <mapped_file.hpp>
+
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -120,6 +123,9 @@ enum class Magic : uint32_t {
     PE = 0x00004550,
     MachO32 = 0xFEEDFACE,
     MachO64 = 0xFEEDFACF,
+    // A universal Mach-O file, its big endian magic read in little endian
+    MachOFat = 0xBEBAFECA,
+    MachOFat64 = 0xBFBAFECA,
 };
 
 struct FileMetadata {
@@ -130,6 +136,9 @@ struct FileMetadata {
     ExecutableType execType;
     FileFormat format;
     Magic magic;
+    // The mapping the metadata was parsed from, the file handlers read the
+    // rest of the file from it instead of opening the file again
+    std::shared_ptr<const MappedFile> file;
 };
 
 /**
@@ -137,12 +146,22 @@ struct FileMetadata {
  *
  * This function takes a filename as input and returns the metadata of the file.
  * The metadata includes information such as file size, creation date, and file type.
+ * The file is mapped once and all the headers are parsed from the mapping.
  *
  * @param filename The name of the file for which to retrieve the metadata.
  * @return The metadata of the file.
  * @throws std::runtime_error any error occurred while retrieving the metadata.
  */
 FileMetadata get_file_metadata(const std::string& filename);
+
+/**
+ * Retrieves the metadata of an already mapped file.
+ *
+ * @param file The mapped file, it is kept in the returned metadata.
+ * @return The metadata of the file.
+ * @throws std::runtime_error any error occurred while parsing the headers.
+ */
+FileMetadata get_file_metadata(std::shared_ptr<const MappedFile> file);
 };  // namespace VMPilot::Common
 
 #endif  // __COMMON_FILE_TYPE_PARSER_HPP__
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef __COMMON_INSTRUCTION_CIPHER_HPP__
+#define __COMMON_INSTRUCTION_CIPHER_HPP__
+
+#include <instruction_t.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VMPilot::Common {
+
+/**
+ * @brief The encryption of a bytecode stream.
+ *
+ * Like ChecksumVersion, the version is not stored in the instructions. The
+ * producer records it next to the stream (see the bytecode section written by
+ * the SDK), so existing bytecode keeps being decrypted the way it was built.
+ */
+enum class CipherVersion : uint8_t {
+    // AES-256-CBC of each flattened instruction, see Instruction::decrypt.
+    V1 = 1,
+    // AES-256-CTR of the opcode and the operands, see InstructionCipher.
+    V2 = 2,
+};
+
+constexpr CipherVersion CURRENT_CIPHER_VERSION = CipherVersion::V2;
+
+/**
+ * @brief The decryption context of an instruction stream, CipherVersion::V2.
+ *
+ * The AES-256 key schedule is expanded once when the context is created,
+ * then any number of instructions are decrypted without key setup or heap
+ * allocation.
+ *
+ * Every instruction is encrypted on its own in CTR mode, the counter blocks
+ * of the instruction at index i of the region at address region are:
+ *   region (64 bits) | i (32 bits) | block number (32 bits), little-endian
+ * so a whole region can be decrypted in one call, and any instruction can
+ * also be decrypted alone. The regions of a file have distinct addresses,
+ * so no two instructions encrypted with a key share a counter block. Only
+ * the opcode and the operands are encrypted, the nounce and the checksum
+ * stay in plain text.
+ *
+ * Since the instructions are independent, the x86 kernels pipeline several of
+ * them per iteration. The kernel is selected by CPUID at runtime. Without
+ * AES-NI the portable kernel does no key dependent memory access, so it does
+ * not leak the key through the cache timing.
+ */
+class InstructionCipher {
+   public:
+    // AES-256 has 14 rounds, so 15 round keys of 16 bytes each.
+    static constexpr size_t ROUND_KEYS_SIZE = 15 * 16;
+
+    enum class Implementation : uint8_t {
+        Auto,      // The fastest one the CPU supports
+        Portable,  // Constant-time bitsliced AES, any CPU
+        AESNI,     // x86 AES-NI, 4 instructions per iteration
+        VAES,      // x86 VAES with AVX-512, 8 instructions per iteration
+    };
+
+    /**
+     * @brief Expand the key schedule.
+     *
+     * @param key The key, zero padded or truncated to 32 bytes.
+     * @param impl The implementation to use. If the CPU does not support it,
+     *             the fastest supported one below it is used instead.
+     */
+    explicit InstructionCipher(
+        const std::string& key,
+        Implementation impl = Implementation::Auto) noexcept;
+    ~InstructionCipher();
+
+    InstructionCipher(const InstructionCipher&) = delete;
+    InstructionCipher& operator=(const InstructionCipher&) = delete;
+
+    /**
+     * @brief Decrypt count instructions in place.
+     *
+     * @param insts The instructions to decrypt.
+     * @param count The number of instructions.
+     * @param region The address of their region.
+     * @param first_index The index of insts[0] in its region. The indices
+     *                    are 32-bit in the counter, a region has fewer than
+     *                    2^32 instructions.
+     */
+    void Decrypt(Instruction_t* insts, size_t count, uint64_t region,
+                 uint64_t first_index) const noexcept;
+
+    /**
+     * @brief Encrypt count instructions in place, the inverse of Decrypt.
+     */
+    void Encrypt(Instruction_t* insts, size_t count, uint64_t region,
+                 uint64_t first_index) const noexcept {
+        // CTR mode is its own inverse
+        Decrypt(insts, count, region, first_index);
+    }
+
+    // The bound of the instruction indices, see Decrypt
+    static constexpr uint64_t MAX_INSTRUCTIONS = uint64_t{1} << 32;
+
+    /**
+     * @brief Get the implementation actually in use, never Auto.
+     */
+    Implementation GetImplementation() const noexcept { return impl_; }
+
+   private:
+    Implementation impl_;
+    alignas(16) std::array<uint8_t, ROUND_KEYS_SIZE> round_keys_;
+};
+
+}  // namespace VMPilot::Common
+
+#endif  // __COMMON_INSTRUCTION_CIPHER_HPP__
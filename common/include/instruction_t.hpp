@@ -2,6 +2,7 @@
 #define __COMMON_INSTRUCTION_T_HPP__
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -25,6 +26,30 @@ struct Instruction_t {
     uint16_t checksum;
 };
 
+// Size of one instruction in the encoded bytecode stream, which is the packed
+// (big-endian) layout above. It is smaller than sizeof(Instruction_t) because
+// the in-memory struct is padded.
+constexpr size_t ENCODED_INSTRUCTION_SIZE = 24;
+
+/**
+ * @brief The algorithm used for Instruction_t::checksum.
+ *
+ * The version is not stored in the instruction itself, the producer and the
+ * consumer of a bytecode stream have to agree on it. Older versions are kept
+ * so that existing bytecode stays verifiable.
+ */
+enum class ChecksumVersion : uint8_t {
+    // SHA-256 over the decimal strings of the fields, then std::hash of the
+    // digest truncated to 16 bits. It depends on the std::hash of the platform.
+    V1 = 1,
+    // BLAKE3 over the packed little-endian fields, first 16 bits of the
+    // digest. No formatting and no heap allocation, same on every platform.
+    // Its key is a public constant, it is not a MAC.
+    V2 = 2,
+};
+
+constexpr ChecksumVersion CURRENT_CHECKSUM_VERSION = ChecksumVersion::V2;
+
 struct Instruction {
 
     /**
@@ -34,14 +59,19 @@ struct Instruction {
      * Checksum is the hash of the instruction's opcode, operands and nounce.
      * The nounce is the salt of the hash function here.
      */
-    [[nodiscard]] bool check(const Instruction_t& inst) noexcept;
+    [[nodiscard]] bool check(
+        const Instruction_t& inst,
+        ChecksumVersion version = CURRENT_CHECKSUM_VERSION) noexcept;
 
     /**
      * @brief Decrypt the instruction.
      * 
      * Note: Also need to update the checksum.
+     * This sets up the cipher on every call, to decrypt many instructions with
+     * the same key use InstructionCipher (see instruction_cipher.hpp).
      */
-    void decrypt(Instruction_t& inst, const std::string& key) noexcept;
+    void decrypt(Instruction_t& inst, const std::string& key,
+                 ChecksumVersion version = CURRENT_CHECKSUM_VERSION) noexcept;
 
     /**
      * @brief Update the checksum of the instruction.
@@ -49,7 +79,9 @@ struct Instruction {
      * This function only should be used after decrypting the instruction.
      * ? Should this function be public?
      */
-    void update_checksum(Instruction_t& inst) noexcept;
+    void update_checksum(
+        Instruction_t& inst,
+        ChecksumVersion version = CURRENT_CHECKSUM_VERSION) noexcept;
 
     /**
      * @brief Flatten the instruction into a byte array.
@@ -0,0 +1,67 @@
+#ifndef __COMMON_MAPPED_FILE_HPP__
+#define __COMMON_MAPPED_FILE_HPP__
+
+#include <byte_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace VMPilot::Common {
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The file is opened and mapped once, then every parser reads the headers
+ * and sections it needs straight from the mapping, without any further
+ * syscall. The pages are only read from the disk when they are touched.
+ * It is shared by std::shared_ptr between the metadata and the file
+ * handlers, the views into it are valid as long as one owner is alive.
+ */
+class MappedFile {
+   public:
+    /**
+     * @brief Map the file read-only.
+     *
+     * @param filename The path of the file.
+     * @throws std::runtime_error if the file cannot be opened or mapped.
+     */
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const std::string& filename() const noexcept {
+        return filename_;
+    }
+    [[nodiscard]] const uint8_t* data() const noexcept { return data_; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] ByteView view() const noexcept {
+        return ByteView(data_, size_);
+    }
+
+#ifndef _WIN32
+    /**
+     * @brief The descriptor of the file, open as long as the mapping, so the
+     *        output writers copy the unchanged ranges file to file.
+     */
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+#endif
+
+   private:
+    std::string filename_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    // The HANDLEs of the file and of its mapping, windows.h is not leaked
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+}  // namespace VMPilot::Common
+
+#endif  // __COMMON_MAPPED_FILE_HPP__
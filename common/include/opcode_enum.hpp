@@ -17,6 +17,10 @@
  *   CALL: Call a procedure or function.
  *   RET: Return from a procedure or function call.
  * 
+ * Superinstructions (fused by the SDK peephole pass, see peephole.hpp):
+ *   LOAD_ADD_STORE: LOAD r, [a]; ADD r, b; STORE [a], r.
+ *   CMP_JZ, CMP_JNZ: CMP a, b; JZ/JNZ target.
+ * 
  * Threading and Atomic Instructions:
  *   LOCK: Used as a prefix to certain instructions to make them atomic.
  *   XCHG: Atomic exchange operation.
@@ -51,6 +55,7 @@ enum class DataMovement {
     POP,
     LOAD,
     STORE,
+    LOAD_ADD_STORE,
     __END,
 };
 
@@ -76,6 +81,8 @@ enum class ControlTransfer {
     JNE,
     CALL,
     RET,
+    CMP_JZ,
+    CMP_JNZ,
     __END,
 };
 
@@ -3,6 +3,8 @@
 
 #include <instruction_t.hpp>
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -24,6 +26,10 @@
  *    to the OID to calculate the corresponding Opcode Index (OI).
  * 3. Use the Opcode Index (OI) to locate the real opcode in the opcode table.
  * 
+ * The OIDs of a key are the contiguous range (start number + OI), and the OIs
+ * are 0 to the number of real opcodes, so every table is kept as a small dense
+ * array. The unordered_map types below are only built on request, for
+ * tooling and the build-time side.
  * 
  */
 
@@ -37,17 +43,71 @@ using Runtime_OT = std::unordered_map<OI, RealOpcode>;
 using Buildtime_OT = std::unordered_map<RealOpcode, OID>;
 using OID_to_OI = std::unordered_map<OID, OI>;
 
+// The upper bound of the number of real opcodes in opcode_enum.hpp
+constexpr size_t MAX_OPCODE_COUNT = 64;
+static_assert((MAX_OPCODE_COUNT & (MAX_OPCODE_COUNT - 1)) == 0,
+              "The flat tables are indexed by masking");
+
+using Flat_OT = std::array<RealOpcode, MAX_OPCODE_COUNT>;
+
+/**
+ * @brief The OI -> RealOpcode table
+ *
+ * The OIs are dense, so the table is an array indexed by OI. The entries
+ * without a real opcode are 0, which is never a real opcode.
+ */
 class Opcode_table {
    public:
     Opcode_table() = default;
-    Opcode_table(const std::unordered_map<OI, RealOpcode>& t_) : table(t_){};
-    Opcode_table(std::unordered_map<OI, RealOpcode>&& t_)
-        : table(std::move(t_)){};
+    Opcode_table(const std::unordered_map<OI, RealOpcode>& t_);
 
     [[nodiscard]] RealOpcode find(OI oi) const;
 
    private:
-    std::unordered_map<OI, RealOpcode> table;
+    Flat_OT table{};
+};
+
+/**
+ * @brief The fused OID -> RealOpcode table
+ *
+ * Since the OIDs are (base + OI), the OID -> OI -> RealOpcode chain is one
+ * bounds-checked array lookup at (OID - base), with the OID arithmetic
+ * wrapping like the OIDs themselves do. The table is 128 bytes, so it stays
+ * in the L1 cache for the whole decoding.
+ */
+class Flat_opcode_table {
+   public:
+    Flat_opcode_table() = default;
+    Flat_opcode_table(OID base, const Flat_OT& OI_to_RealOp,
+                      Opcode_t count) noexcept
+        : base_(base), count_(count), table_(OI_to_RealOp){};
+
+    [[nodiscard]] bool contains(OID oid) const noexcept {
+        return static_cast<OI>(oid - base_) < count_;
+    }
+
+    // Throws std::runtime_error if the OID is not in the table
+    [[nodiscard]] RealOpcode find(OID oid) const;
+
+    /**
+     * @brief The branch-free lookup of the decoder hot path.
+     *
+     * @return The real opcode, or 0 if the OID is not in the table.
+     */
+    [[nodiscard]] RealOpcode lookup(OID oid) const noexcept {
+        const auto oi = static_cast<OI>(oid - base_);
+        // All ones if the OI is in range, otherwise 0
+        const auto mask = static_cast<RealOpcode>(-(oi < count_));
+        return table_[oi & (MAX_OPCODE_COUNT - 1)] & mask;
+    }
+
+    [[nodiscard]] OID base() const noexcept { return base_; }
+    [[nodiscard]] Opcode_t size() const noexcept { return count_; }
+
+   private:
+    OID base_ = 0;
+    Opcode_t count_ = 0;
+    Flat_OT table_{};
 };
 
 // Opcode_table_generator is a helper class to generate the decode table
@@ -59,6 +119,9 @@ class Opcode_table_generator {
 
     [[nodiscard]] Runtime_OT Generate() const noexcept;
 
+    // The fused OID -> RealOpcode table of the decoder
+    [[nodiscard]] Flat_opcode_table GenerateFlat() const noexcept;
+
     // A helper function that we will use it in the future (SDK part)
     [[nodiscard]] Buildtime_OT Get_RealOp_to_OID() const noexcept;
 
@@ -71,9 +134,10 @@ class Opcode_table_generator {
 
    private:
     std::string key_;
-    Runtime_OT OI_to_RealOp_;
-    Buildtime_OT RealOp_to_OID_;
-    OID_to_OI OID_to_OI_;
+    // The OID of OI 0, the OID of OI i is (base_OID_ + i)
+    OID base_OID_ = 0;
+    Opcode_t count_ = 0;
+    Flat_OT OI_to_RealOp_{};
 };
 
 }  // namespace VMPilot::Common
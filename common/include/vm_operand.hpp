@@ -0,0 +1,95 @@
+#ifndef __COMMON_VM_OPERAND_HPP__
+#define __COMMON_VM_OPERAND_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief The operand encoding of the VMPilot bytecode
+ *
+ * Instruction_t::left_operand and right_operand are 64 bits each:
+ * | bit 63 | bit 62 .. 0                                        |
+ * |--------|---------------------------------------------------|
+ * | 1      | register index (only the low bits are used)       |
+ * | 0      | immediate, 63 bits sign-extended to 64 bits       |
+ *
+ * Jump and call targets are the index of the target instruction in its
+ * region, either as an immediate or in a register.
+ *
+ * The superinstructions need a third operand, it is carried in the unused
+ * bits 8 to 62 of a register operand, the payload.
+ */
+
+namespace VMPilot::Common::Operand {
+
+// The number of general purpose VM registers, R0 holds the return value
+constexpr size_t REGISTER_COUNT = 16;
+
+constexpr uint64_t REGISTER_FLAG = static_cast<uint64_t>(1) << 63;
+
+[[nodiscard]] constexpr uint64_t Register(size_t index) noexcept {
+    return REGISTER_FLAG | static_cast<uint64_t>(index);
+}
+
+[[nodiscard]] constexpr uint64_t Immediate(int64_t value) noexcept {
+    return static_cast<uint64_t>(value) & ~REGISTER_FLAG;
+}
+
+[[nodiscard]] constexpr bool IsRegister(uint64_t operand) noexcept {
+    return (operand & REGISTER_FLAG) != 0;
+}
+
+[[nodiscard]] constexpr size_t RegisterIndex(uint64_t operand) noexcept {
+    return static_cast<size_t>(operand & (REGISTER_COUNT - 1));
+}
+
+[[nodiscard]] constexpr uint64_t ImmediateValue(uint64_t operand) noexcept {
+    // Sign-extend bit 62
+    return (operand & (REGISTER_FLAG >> 1)) ? (operand | REGISTER_FLAG)
+                                            : (operand & ~REGISTER_FLAG);
+}
+
+constexpr unsigned PAYLOAD_SHIFT = 8;
+constexpr uint64_t MAX_PAYLOAD = (REGISTER_FLAG - 1) >> PAYLOAD_SHIFT;
+
+[[nodiscard]] constexpr uint64_t PackedRegister(size_t index,
+                                                uint64_t payload) noexcept {
+    return Register(index) | payload << PAYLOAD_SHIFT;
+}
+
+[[nodiscard]] constexpr uint64_t Payload(uint64_t operand) noexcept {
+    return (operand & ~REGISTER_FLAG) >> PAYLOAD_SHIFT;
+}
+
+/**
+ * @brief Check if an operand can be stored in a payload.
+ *
+ * A register, or a non-negative immediate up to MAX_PAYLOAD / 2, can be.
+ */
+[[nodiscard]] constexpr bool FitsPayload(uint64_t operand) noexcept {
+    return IsRegister(operand) || ImmediateValue(operand) <= MAX_PAYLOAD >> 1;
+}
+
+// Bit 0 of the payload tells a register from an immediate
+[[nodiscard]] constexpr uint64_t ToPayload(uint64_t operand) noexcept {
+    return IsRegister(operand) ? RegisterIndex(operand) << 1 | 1
+                               : ImmediateValue(operand) << 1;
+}
+
+[[nodiscard]] constexpr uint64_t FromPayload(uint64_t payload) noexcept {
+    return (payload & 1) ? Register(static_cast<size_t>(payload >> 1))
+                         : Immediate(static_cast<int64_t>(payload >> 1));
+}
+
+static_assert((REGISTER_COUNT & (REGISTER_COUNT - 1)) == 0,
+              "The register index is decoded by masking");
+static_assert(ImmediateValue(Immediate(-1)) == static_cast<uint64_t>(-1));
+static_assert(ImmediateValue(Immediate(42)) == 42);
+static_assert(RegisterIndex(PackedRegister(3, MAX_PAYLOAD)) == 3);
+static_assert(Payload(PackedRegister(3, MAX_PAYLOAD)) == MAX_PAYLOAD);
+static_assert(FromPayload(ToPayload(Register(5))) == Register(5));
+static_assert(FromPayload(ToPayload(Immediate(42))) == Immediate(42));
+
+}  // namespace VMPilot::Common::Operand
+
+#endif  // __COMMON_VM_OPERAND_HPP__
@@ -1,8 +1,10 @@
 #include <file_type_parser.hpp>
+#include <mapped_file.hpp>
 
 #include <array>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <unordered_map>
 #include <utility>
@@ -106,13 +108,13 @@ using MetaMode = uint32_t;
     ((static_cast<uint16_t>(arch) << 16) | (endian << 8) | bits)
 
 static const std::unordered_map<MetaMode, FileMode> mode_table = {
-    {MODE(FileArch::ARM, LITTLE_ENDIAN, 32), FileMode::MODE_ARM},
-    {MODE(FileArch::ARM64, LITTLE_ENDIAN, 64), FileMode::MODE_ARM},
-    {MODE(FileArch::X86, LITTLE_ENDIAN, 16), FileMode::MODE_16},
-    {MODE(FileArch::X86, LITTLE_ENDIAN, 32), FileMode::MODE_32},
-    {MODE(FileArch::X86, LITTLE_ENDIAN, 64), FileMode::MODE_64},
-    {MODE(FileArch::RISCV, LITTLE_ENDIAN, 32), FileMode::MODE_RISCV32},
-    {MODE(FileArch::RISCV, LITTLE_ENDIAN, 64), FileMode::MODE_RISCV64},
+    {MODE(FileArch::ARM, LittleEndian, 32), FileMode::MODE_ARM},
+    {MODE(FileArch::ARM64, LittleEndian, 64), FileMode::MODE_ARM},
+    {MODE(FileArch::X86, LittleEndian, 16), FileMode::MODE_16},
+    {MODE(FileArch::X86, LittleEndian, 32), FileMode::MODE_32},
+    {MODE(FileArch::X86, LittleEndian, 64), FileMode::MODE_64},
+    {MODE(FileArch::RISCV, LittleEndian, 32), FileMode::MODE_RISCV32},
+    {MODE(FileArch::RISCV, LittleEndian, 64), FileMode::MODE_RISCV64},
 
     // TODO: complete this table
 };
@@ -125,70 +127,78 @@ MetaMode lookup_mode(FileArch arch, Endian endian, Bits bits) noexcept {
 }  // namespace file_mode_table
 
 namespace detail {
-uint64_t get_file_size(const std::string& filename);
-Magic get_magic_number(const std::string& filename);
+Magic get_magic_number(ByteView data);
 FileFormat get_file_format(Magic magic);
 
-FileArch get_file_arch(const std::string& filename, FileFormat format);
-FileMode get_file_mode(const std::string& filename, FileFormat format);
-ExecutableType get_executable_type(const std::string& filename,
-                                   FileFormat format);
-
-FileArch get_file_arch_elf(const std::string& filename);
-FileMode get_file_mode_elf(const std::string& filename);
-ExecutableType get_executable_type_elf(const std::string& filename);
-
-FileArch get_file_arch_pe(const std::string& filename);
-FileMode get_file_mode_pe(const std::string& filename);
-ExecutableType get_executable_type_pe(const std::string& filename);
-
-FileArch get_file_arch_macho(const std::string& filename);
-FileMode get_file_mode_macho(const std::string& filename);
-ExecutableType get_executable_type_macho(const std::string& filename);
-
-header::ElfHeader get_elf_header(const std::string& filename);
-header::PEHeader get_pe_header(const std::string& filename);
-header::MachOHeader get_macho_header(const std::string& filename);
-
+FileArch get_file_arch(ByteView data, FileFormat format);
+FileMode get_file_mode(ByteView data, FileFormat format);
+ExecutableType get_executable_type(ByteView data, FileFormat format);
+
+FileArch get_file_arch_elf(const header::ElfHeader& elf_header);
+FileMode get_file_mode_elf(const header::ElfHeader& elf_header);
+ExecutableType get_executable_type_elf(ByteView data,
+                                       const header::ElfHeader& elf_header);
+
+FileArch get_file_arch_pe(const header::PEHeader& pe_header);
+FileMode get_file_mode_pe(ByteView data, const header::PEHeader& pe_header);
+ExecutableType get_executable_type_pe(const header::PEHeader& pe_header);
+
+FileArch get_file_arch_macho(const header::MachOHeader& macho_header);
+FileMode get_file_mode_macho(const header::MachOHeader& macho_header);
+ExecutableType get_executable_type_macho(
+    const header::MachOHeader& macho_header);
+
+header::ElfHeader get_elf_header(ByteView data);
+header::PEHeader get_pe_header(ByteView data);
+header::MachOHeader get_macho_header(ByteView data);
+
+// The offset of the "PE\0\0" signature, or 0 if data is not a PE image
+uint32_t get_pe_signature_offset(ByteView data) noexcept;
+
+// Read a T at offset of the mapping, the mapping may not be aligned for T
+template <typename T>
+T read_at(ByteView data, size_t offset, const char* what) {
+    if (offset > data.size() || sizeof(T) > data.size() - offset)
+        throw std::runtime_error(std::string("Failed to read ") + what +
+                                 ": the file is too small");
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
 }  // namespace detail
 }  // namespace
 
 FileMetadata VMPilot::Common::get_file_metadata(const std::string& filename) {
+    return get_file_metadata(std::make_shared<const MappedFile>(filename));
+}
+
+FileMetadata VMPilot::Common::get_file_metadata(
+    std::shared_ptr<const MappedFile> file) {
+    if (file == nullptr)
+        throw std::runtime_error("No file to get the metadata of");
+
+    const auto data = file->view();
+
     FileMetadata metadata;
-    metadata.filename = filename;
-    metadata.size = detail::get_file_size(filename);
-    metadata.magic = detail::get_magic_number(filename);
+    metadata.filename = file->filename();
+    metadata.size = data.size();
+    metadata.magic = detail::get_magic_number(data);
     metadata.format = detail::get_file_format(metadata.magic);
 
-    metadata.arch = detail::get_file_arch(filename, metadata.format);
-    metadata.mode = detail::get_file_mode(filename, metadata.format);
-    metadata.execType = detail::get_executable_type(filename, metadata.format);
+    metadata.arch = detail::get_file_arch(data, metadata.format);
+    metadata.mode = detail::get_file_mode(data, metadata.format);
+    metadata.execType = detail::get_executable_type(data, metadata.format);
 
+    metadata.file = std::move(file);
     return metadata;
 }
 
-uint64_t detail::get_file_size(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file) {
-        throw std::runtime_error("Failed to open file: " + filename);
-    }
+Magic detail::get_magic_number(ByteView data) {
+    // A PE image starts with the MS-DOS stub, its signature is further
+    if (get_pe_signature_offset(data) != 0)
+        return Magic::PE;
 
-    return file.tellg();
-}
-
-Magic detail::get_magic_number(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error(
-            "Failed to open file for magic number reading: " + filename);
-    }
-    uint32_t magic;
-    if (file.read(reinterpret_cast<char*>(&magic), sizeof(magic))) {
-        return static_cast<Magic>(magic);
-    }
-    // Should not reach here
-    throw std::runtime_error("Failed to read magic number from file: " +
-                             filename);
+    return static_cast<Magic>(read_at<uint32_t>(data, 0, "magic number"));
 }
 
 FileFormat detail::get_file_format(Magic magic) {
@@ -201,123 +211,164 @@ FileFormat detail::get_file_format(Magic magic) {
             return FileFormat::MachO;
         case Magic::MachO64:
             return FileFormat::MachO;
+        case Magic::MachOFat:
+            return FileFormat::MachO;
+        case Magic::MachOFat64:
+            return FileFormat::MachO;
         default:
             throw std::runtime_error("Unsupported file format");
     }
 }
 
-FileArch detail::get_file_arch(const std::string& filename, FileFormat format) {
+FileArch detail::get_file_arch(ByteView data, FileFormat format) {
     switch (format) {
         case FileFormat::ELF:
-            return get_file_arch_elf(filename);
+            return get_file_arch_elf(get_elf_header(data));
         case FileFormat::PE:
-            return get_file_arch_pe(filename);
+            return get_file_arch_pe(get_pe_header(data));
         case FileFormat::MachO:
-            return get_file_arch_macho(filename);
+            return get_file_arch_macho(get_macho_header(data));
         default:
             throw std::runtime_error("Unsupported file format");
     }
 }
 
-FileMode detail::get_file_mode(const std::string& filename, FileFormat format) {
+FileMode detail::get_file_mode(ByteView data, FileFormat format) {
     switch (format) {
         case FileFormat::ELF:
-            return get_file_mode_elf(filename);
+            return get_file_mode_elf(get_elf_header(data));
         case FileFormat::PE:
-            return get_file_mode_pe(filename);
+            return get_file_mode_pe(data, get_pe_header(data));
         case FileFormat::MachO:
-            return get_file_mode_macho(filename);
+            return get_file_mode_macho(get_macho_header(data));
         default:
             throw std::runtime_error("Unsupported file format");
     }
 }
 
-ExecutableType detail::get_executable_type(const std::string& filename,
-                                           FileFormat format) {
+ExecutableType detail::get_executable_type(ByteView data, FileFormat format) {
     switch (format) {
         case FileFormat::ELF:
-            return get_executable_type_elf(filename);
+            return get_executable_type_elf(data, get_elf_header(data));
         case FileFormat::PE:
-            return get_executable_type_pe(filename);
+            return get_executable_type_pe(get_pe_header(data));
         case FileFormat::MachO:
-            return get_executable_type_macho(filename);
+            return get_executable_type_macho(get_macho_header(data));
         default:
             throw std::runtime_error("Unsupported file format");
     }
 }
 
-header::ElfHeader detail::get_elf_header(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error(
-            "Failed to open file for ELF header reading: " + filename);
-    }
+uint32_t detail::get_pe_signature_offset(ByteView data) noexcept {
+    // "MZ", then e_lfanew at 0x3C points to "PE\0\0"
+    constexpr size_t E_LFANEW = 0x3C;
+    if (data.size() < E_LFANEW + sizeof(uint32_t) || data[0] != 'M' ||
+        data[1] != 'Z')
+        return 0;
+
+    uint32_t offset;
+    std::memcpy(&offset, data.data() + E_LFANEW, sizeof(offset));
+    if (offset == 0 || offset > data.size() ||
+        data.size() - offset < sizeof(uint32_t))
+        return 0;
+
+    uint32_t signature;
+    std::memcpy(&signature, data.data() + offset, sizeof(signature));
+    return signature == static_cast<uint32_t>(Magic::PE) ? offset : 0;
+}
 
-    header::ElfHeader elf_header;
-    if (!file.read(reinterpret_cast<char*>(&elf_header), sizeof(elf_header))) {
-        throw std::runtime_error("Failed to read ELF header from file: " +
-                                 filename);
+header::ElfHeader detail::get_elf_header(ByteView data) {
+    // A 32-bit file only needs the smaller header
+    const size_t size = data.size() > 4 && data[4] == 2
+                            ? sizeof(header::ELF64_Ehdr)
+                            : sizeof(header::Elf32_Ehdr);
+    if (data.size() < size)
+        throw std::runtime_error("Failed to read ELF header: the file is "
+                                 "too small");
+
+    header::ElfHeader elf_header{};
+    std::memcpy(&elf_header, data.data(), size);
+
+    // The fields we read are the same in both classes, swap them to the host
+    // order for a big endian file
+    if (elf_header.elf32.e_ident[5] == 2) {
+        auto swap16 = [](uint16_t v) {
+            return static_cast<uint16_t>((v >> 8) | (v << 8));
+        };
+        elf_header.elf32.e_type = swap16(elf_header.elf32.e_type);
+        elf_header.elf32.e_machine = swap16(elf_header.elf32.e_machine);
     }
-
     return elf_header;
 }
 
-header::PEHeader detail::get_pe_header(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error("Failed to open file for PE header reading: " +
-                                 filename);
-    }
+header::PEHeader detail::get_pe_header(ByteView data) {
+    const auto offset = get_pe_signature_offset(data);
+    if (offset == 0)
+        throw std::runtime_error("Failed to read PE header: no PE signature");
 
     header::PEHeader pe_header;
-    if (!file.read(reinterpret_cast<char*>(&pe_header), sizeof(pe_header))) {
-        throw std::runtime_error("Failed to read PE header from file: " +
-                                 filename);
-    }
-
+    pe_header.pe32 = read_at<header::PE32_Ehdr>(
+        data, offset + sizeof(uint32_t), "PE header");
     return pe_header;
 }
 
-header::MachOHeader detail::get_macho_header(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        throw std::runtime_error(
-            "Failed to open file for Mach-O header reading: " + filename);
+header::MachOHeader detail::get_macho_header(ByteView data) {
+    // A universal file is described by its first slice, the one the Mach-O
+    // handler parses. Its header is big endian.
+    size_t offset = 0;
+    const auto magic = read_at<uint32_t>(data, 0, "Mach-O header");
+    if (magic == static_cast<uint32_t>(Magic::MachOFat) ||
+        magic == static_cast<uint32_t>(Magic::MachOFat64)) {
+        const auto bytes = [&](size_t at, size_t count) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < count; ++i)
+                value = (value << 8) |
+                        read_at<uint8_t>(data, at + i, "Mach-O fat header");
+            return value;
+        };
+        // A Java class file has the same magic, its version is here instead.
+        // The first major version is 45, so like file(1) a count from 20 on
+        // is not a fat header.
+        const auto count = bytes(4, 4);
+        if (count == 0 || count >= 20)
+            throw std::runtime_error("Invalid Mach-O fat header");
+        // fat_arch.offset, or fat_arch_64.offset. The first slice starts
+        // after the fat_arch table and has a CPU type.
+        const bool is_fat64 = magic == static_cast<uint32_t>(Magic::MachOFat64);
+        const size_t arch_size = is_fat64 ? 32 : 20;
+        offset = is_fat64 ? bytes(16, 8) : bytes(16, 4);
+        if (bytes(8, 4) == 0 || offset < 8 + count * arch_size)
+            throw std::runtime_error("Invalid Mach-O fat header");
     }
 
     header::MachOHeader macho_header;
-    if (!file.read(reinterpret_cast<char*>(&macho_header),
-                   sizeof(macho_header))) {
-        throw std::runtime_error("Failed to read Mach-O header from file: " +
-                                 filename);
-    }
-
+    macho_header.macho =
+        read_at<header::MachO_Ehdr>(data, offset, "Mach-O header");
     return macho_header;
 }
 
-FileArch detail::get_file_arch_elf(const std::string& filename) {
-    const auto& elf_header = get_elf_header(filename);
-
+FileArch detail::get_file_arch_elf(const header::ElfHeader& elf_header) {
     static const std::unordered_map<uint16_t, VMPilot::Common::FileArch>
         arch_table = {
             {0x00, VMPilot::Common::FileArch::ALL},
-            {0x01, VMPilot::Common::FileArch::ARM},
-            {0x02, VMPilot::Common::FileArch::SPARC},
-            {0x03, VMPilot::Common::FileArch::X86},
-            {0x04, VMPilot::Common::FileArch::M68K},
-            {0x08, VMPilot::Common::FileArch::MIPS},
-            {0x14, VMPilot::Common::FileArch::PPC},
-            {0x16, VMPilot::Common::FileArch::SYSZ},
-            {0x28, VMPilot::Common::FileArch::ARM64},
-            {0x2A, VMPilot::Common::FileArch::XCORE},
-            {0x2C, VMPilot::Common::FileArch::SPARC},
-            {0x32, VMPilot::Common::FileArch::TMS320C64X},
-            {0x35, VMPilot::Common::FileArch::M680X},
-            {0x3B, VMPilot::Common::FileArch::EVM},
-            {0x3E, VMPilot::Common::FileArch::MOS65XX},
-            {0xF3, VMPilot::Common::FileArch::RISCV},
-            {0x28, VMPilot::Common::FileArch::SH},
-            {0x2B, VMPilot::Common::FileArch::TRICORE},
+            {0x02, VMPilot::Common::FileArch::SPARC},       // EM_SPARC
+            {0x03, VMPilot::Common::FileArch::X86},         // EM_386
+            {0x04, VMPilot::Common::FileArch::M68K},        // EM_68K
+            {0x08, VMPilot::Common::FileArch::MIPS},        // EM_MIPS
+            {0x14, VMPilot::Common::FileArch::PPC},         // EM_PPC
+            {0x15, VMPilot::Common::FileArch::PPC},         // EM_PPC64
+            {0x16, VMPilot::Common::FileArch::SYSZ},        // EM_S390
+            {0x28, VMPilot::Common::FileArch::ARM},         // EM_ARM
+            {0x2A, VMPilot::Common::FileArch::SH},          // EM_SH
+            {0x2B, VMPilot::Common::FileArch::SPARC},       // EM_SPARCV9
+            {0x2C, VMPilot::Common::FileArch::TRICORE},     // EM_TRICORE
+            {0x3E, VMPilot::Common::FileArch::X86},         // EM_X86_64
+            {0x46, VMPilot::Common::FileArch::M680X},       // EM_68HC11
+            {0x8C, VMPilot::Common::FileArch::TMS320C64X},  // EM_TI_C6000
+            {0xB7, VMPilot::Common::FileArch::ARM64},       // EM_AARCH64
+            {0xCB, VMPilot::Common::FileArch::XCORE},       // EM_XCORE
+            {0xF3, VMPilot::Common::FileArch::RISCV},       // EM_RISCV
+            {0xF7, VMPilot::Common::FileArch::BPF},         // EM_BPF
         };
 
     auto it = arch_table.find(elf_header.elf32.e_machine);
@@ -328,11 +379,10 @@ FileArch detail::get_file_arch_elf(const std::string& filename) {
     return it->second;
 }
 
-FileMode detail::get_file_mode_elf(const std::string& filename) {
-    const auto& elf_header = get_elf_header(filename);
-
+FileMode detail::get_file_mode_elf(const header::ElfHeader& elf_header) {
+    // e_ident[EI_DATA] is 2 for big endian, e_ident[EI_CLASS] 2 for 64-bit
     const auto& key = file_mode_table::lookup_mode(
-        get_file_arch_elf(filename), elf_header.elf32.e_ident[5] == 1,
+        get_file_arch_elf(elf_header), elf_header.elf32.e_ident[5] == 2,
         elf_header.elf32.e_ident[4] == 2 ? 64 : 32);
 
     auto it = file_mode_table::mode_table.find(key);
@@ -343,30 +393,49 @@ FileMode detail::get_file_mode_elf(const std::string& filename) {
     return it->second;
 }
 
-ExecutableType detail::get_executable_type_elf(const std::string& filename) {
-    const auto& elf_header = get_elf_header(filename);
+ExecutableType detail::get_executable_type_elf(
+    ByteView data, const header::ElfHeader& elf_header) {
+    switch (elf_header.elf32.e_type) {
+        case 1:  // ET_REL
+            return ExecutableType::OBJECT_FILE;
+        case 2:  // ET_EXEC
+            return ExecutableType::EXECUTABLE;
+        case 3:  // ET_DYN
+            break;
+        default:
+            return ExecutableType::UNKNOWN;
+    }
 
-    if (elf_header.elf32.e_type == 2) {
+    // A PIE is ET_DYN too, but it has an interpreter (PT_INTERP). The program
+    // headers of a big endian file are not swapped, it is taken as a library.
+    if (elf_header.elf32.e_ident[5] == 2)
         return ExecutableType::DYNAMIC_LIBRARY;
-    } else if (elf_header.elf32.e_type == 3) {
-        return ExecutableType::STATIC_LIBRARY;
-    } else if (elf_header.elf32.e_type == 1) {
-        return ExecutableType::EXECUTABLE;
-    } else if (elf_header.elf32.e_type == 0) {
-        return ExecutableType::OBJECT_FILE;
-    } else {
-        return ExecutableType::UNKNOWN;
+
+    const bool is_64 = elf_header.elf32.e_ident[4] == 2;
+    const uint64_t phoff =
+        is_64 ? elf_header.elf64.e_phoff : elf_header.elf32.e_phoff;
+    const uint16_t phentsize =
+        is_64 ? elf_header.elf64.e_phentsize : elf_header.elf32.e_phentsize;
+    const uint16_t phnum =
+        is_64 ? elf_header.elf64.e_phnum : elf_header.elf32.e_phnum;
+
+    // p_type is the first field of a program header in both classes
+    constexpr uint32_t PT_INTERP = 3;
+    for (uint16_t i = 0; i < phnum && phentsize >= sizeof(uint32_t); ++i) {
+        const uint64_t offset = phoff + uint64_t{i} * phentsize;
+        if (read_at<uint32_t>(data, offset, "ELF program header") == PT_INTERP)
+            return ExecutableType::EXECUTABLE;
     }
+    return ExecutableType::DYNAMIC_LIBRARY;
 }
 
-FileArch detail::get_file_arch_pe(const std::string& filename) {
-    const auto& pe_header = get_pe_header(filename);
-
+FileArch detail::get_file_arch_pe(const header::PEHeader& pe_header) {
     static const std::unordered_map<uint16_t, VMPilot::Common::FileArch>
         arch_table = {
             {0x014C, VMPilot::Common::FileArch::X86},
             {0x8664, VMPilot::Common::FileArch::X86},
             {0x01C0, VMPilot::Common::FileArch::ARM},
+            {0x01C4, VMPilot::Common::FileArch::ARM},
             {0xaa64, VMPilot::Common::FileArch::ARM64},
         };
 
@@ -378,11 +447,19 @@ FileArch detail::get_file_arch_pe(const std::string& filename) {
     return it->second;
 }
 
-FileMode detail::get_file_mode_pe(const std::string& filename) {
-    const auto& pe_header = get_pe_header(filename);
+FileMode detail::get_file_mode_pe(ByteView data,
+                                  const header::PEHeader& pe_header) {
+    // The magic of the optional header: 0x10B for PE32, 0x20B for PE32+
+    const auto optional_offset = get_pe_signature_offset(data) +
+                                 sizeof(uint32_t) + sizeof(header::PE32_Ehdr);
+    const auto optional_magic = pe_header.pe32.SizeOfOptionalHeader != 0
+                                    ? read_at<uint16_t>(data, optional_offset,
+                                                        "PE optional header")
+                                    : 0;
 
-    const auto& key = file_mode_table::lookup_mode(
-        get_file_arch_pe(filename), false, pe_header.pe32.SizeOfOptionalHeader);
+    const auto& key =
+        file_mode_table::lookup_mode(get_file_arch_pe(pe_header), false,
+                                     optional_magic == 0x20B ? 64 : 32);
 
     auto it = file_mode_table::mode_table.find(key);
     if (it == file_mode_table::mode_table.end()) {
@@ -392,31 +469,27 @@ FileMode detail::get_file_mode_pe(const std::string& filename) {
     return it->second;
 }
 
-ExecutableType detail::get_executable_type_pe(const std::string& filename) {
-    const auto& pe_header = get_pe_header(filename);
-
-    if (pe_header.pe32.Characteristics & 0x2000) {
+ExecutableType detail::get_executable_type_pe(
+    const header::PEHeader& pe_header) {
+    if (pe_header.pe32.Characteristics & 0x2000) {  // IMAGE_FILE_DLL
         return ExecutableType::DYNAMIC_LIBRARY;
-    } else if (pe_header.pe32.Characteristics & 0x0002) {
-        return ExecutableType::STATIC_LIBRARY;
-    } else if (pe_header.pe32.Characteristics & 0x0001) {
+    } else if (pe_header.pe32.Characteristics &
+               0x0002) {  // IMAGE_FILE_EXECUTABLE_IMAGE
         return ExecutableType::EXECUTABLE;
     } else {
-        return ExecutableType::UNKNOWN;
+        return ExecutableType::OBJECT_FILE;
     }
 }
 
-FileArch detail::get_file_arch_macho(const std::string& filename) {
-    const auto& macho_header = get_macho_header(filename);
-
+FileArch detail::get_file_arch_macho(const header::MachOHeader& macho_header) {
     static const std::unordered_map<uint32_t, VMPilot::Common::FileArch>
         arch_table = {
-            {0x00000007, VMPilot::Common::FileArch::X86},
-            {0x01000007, VMPilot::Common::FileArch::X86},
-            {0x0000000C, VMPilot::Common::FileArch::ARM},
-            {0x0100000C, VMPilot::Common::FileArch::ARM},
-            {0x0000000E, VMPilot::Common::FileArch::ARM64},
-            {0x0100000E, VMPilot::Common::FileArch::ARM64},
+            {0x00000007, VMPilot::Common::FileArch::X86},    // CPU_TYPE_X86
+            {0x01000007, VMPilot::Common::FileArch::X86},    // CPU_TYPE_X86_64
+            {0x0000000C, VMPilot::Common::FileArch::ARM},    // CPU_TYPE_ARM
+            {0x0100000C, VMPilot::Common::FileArch::ARM64},  // CPU_TYPE_ARM64
+            {0x00000012, VMPilot::Common::FileArch::PPC},    // CPU_TYPE_POWERPC
+            {0x01000012, VMPilot::Common::FileArch::PPC},
         };
 
     auto it = arch_table.find(macho_header.macho.cputype);
@@ -427,13 +500,12 @@ FileArch detail::get_file_arch_macho(const std::string& filename) {
     return it->second;
 }
 
-FileMode detail::get_file_mode_macho(const std::string& filename) {
-    const auto& macho_header = get_macho_header(filename);
+FileMode detail::get_file_mode_macho(const header::MachOHeader& macho_header) {
     const auto& is_64_bit =
         macho_header.macho.magic == static_cast<uint32_t>(Magic::MachO64);
 
     const auto& key = file_mode_table::lookup_mode(
-        get_file_arch_macho(filename), false, is_64_bit ? 64 : 32);
+        get_file_arch_macho(macho_header), false, is_64_bit ? 64 : 32);
 
     auto it = file_mode_table::mode_table.find(key);
     if (it == file_mode_table::mode_table.end()) {
@@ -443,16 +515,17 @@ FileMode detail::get_file_mode_macho(const std::string& filename) {
     return it->second;
 }
 
-ExecutableType detail::get_executable_type_macho(const std::string& filename) {
-    const auto& macho_header = get_macho_header(filename);
-
-    if (macho_header.macho.filetype == 0x02) {
-        return ExecutableType::DYNAMIC_LIBRARY;
-    } else if (macho_header.macho.filetype == 0x08) {
-        return ExecutableType::STATIC_LIBRARY;
-    } else if (macho_header.macho.filetype == 0x01) {
-        return ExecutableType::EXECUTABLE;
-    } else {
-        return ExecutableType::UNKNOWN;
+ExecutableType detail::get_executable_type_macho(
+    const header::MachOHeader& macho_header) {
+    switch (macho_header.macho.filetype) {
+        case 0x1:  // MH_OBJECT
+            return ExecutableType::OBJECT_FILE;
+        case 0x2:  // MH_EXECUTE
+            return ExecutableType::EXECUTABLE;
+        case 0x6:  // MH_DYLIB
+        case 0x8:  // MH_BUNDLE
+            return ExecutableType::DYNAMIC_LIBRARY;
+        default:
+            return ExecutableType::UNKNOWN;
     }
 }
@@ -0,0 +1,289 @@
+#include <instruction_cipher.hpp>
+#include "instruction_cipher_kernels.hpp"
+
+#include <cstring>
+
+using Instruction_t = VMPilot::Common::Instruction_t;
+using InstructionCipher = VMPilot::Common::InstructionCipher;
+
+namespace {
+namespace aes {
+// The portable AES has no secret dependent table lookup or branch, so the
+// key does not leak through the cache timing. SubBytes is the Boyar-Peralta
+// circuit of the S-box evaluated on bit planes: bit j of plane b is bit b of
+// byte j, so one pass substitutes up to 32 bytes. ShiftRows, MixColumns and
+// AddRoundKey only use fixed indices.
+
+// The number of blocks encrypted together, the bytes of PARALLEL_BLOCKS
+// blocks fill the 32 bits of a plane
+constexpr size_t PARALLEL_BLOCKS = 2;
+
+void sbox_planes(uint32_t q[8]) noexcept {
+    const uint32_t x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+    const uint32_t x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // Top linear transformation
+    const uint32_t y14 = x3 ^ x5, y13 = x0 ^ x6, y9 = x0 ^ x3, y8 = x0 ^ x5;
+    const uint32_t t0 = x1 ^ x2, y1 = t0 ^ x7, y4 = y1 ^ x3;
+    const uint32_t y12 = y13 ^ y14, y2 = y1 ^ x0, y5 = y1 ^ x6, y3 = y5 ^ y8;
+    const uint32_t t1 = x4 ^ y12, y15 = t1 ^ x5, y20 = t1 ^ x1;
+    const uint32_t y6 = y15 ^ x7, y10 = y15 ^ t0, y11 = y20 ^ y9;
+    const uint32_t y7 = x7 ^ y11, y17 = y10 ^ y11, y19 = y10 ^ y8;
+    const uint32_t y16 = t0 ^ y11, y21 = y13 ^ y16, y18 = x0 ^ y16;
+
+    // Non-linear section, the inversion in GF(2^8)
+    const uint32_t t2 = y12 & y15, t3 = y3 & y6, t4 = t3 ^ t2;
+    const uint32_t t5 = y4 & x7, t6 = t5 ^ t2, t7 = y13 & y16;
+    const uint32_t t8 = y5 & y1, t9 = t8 ^ t7, t10 = y2 & y7;
+    const uint32_t t11 = t10 ^ t7, t12 = y9 & y11, t13 = y14 & y17;
+    const uint32_t t14 = t13 ^ t12, t15 = y8 & y10, t16 = t15 ^ t12;
+    const uint32_t t17 = t4 ^ t14, t18 = t6 ^ t16, t19 = t9 ^ t14;
+    const uint32_t t20 = t11 ^ t16, t21 = t17 ^ y20, t22 = t18 ^ y19;
+    const uint32_t t23 = t19 ^ y21, t24 = t20 ^ y18;
+
+    const uint32_t t25 = t21 ^ t22, t26 = t21 & t23, t27 = t24 ^ t26;
+    const uint32_t t28 = t25 & t27, t29 = t28 ^ t22, t30 = t23 ^ t24;
+    const uint32_t t31 = t22 ^ t26, t32 = t31 & t30, t33 = t32 ^ t24;
+    const uint32_t t34 = t23 ^ t33, t35 = t27 ^ t33, t36 = t24 & t35;
+    const uint32_t t37 = t36 ^ t34, t38 = t27 ^ t36, t39 = t29 & t38;
+    const uint32_t t40 = t25 ^ t39;
+
+    const uint32_t t41 = t40 ^ t37, t42 = t29 ^ t33, t43 = t29 ^ t40;
+    const uint32_t t44 = t33 ^ t37, t45 = t42 ^ t41;
+    const uint32_t z0 = t44 & y15, z1 = t37 & y6, z2 = t33 & x7;
+    const uint32_t z3 = t43 & y16, z4 = t40 & y1, z5 = t29 & y7;
+    const uint32_t z6 = t42 & y11, z7 = t45 & y17, z8 = t41 & y10;
+    const uint32_t z9 = t44 & y12, z10 = t37 & y3, z11 = t33 & y4;
+    const uint32_t z12 = t43 & y13, z13 = t40 & y5, z14 = t29 & y2;
+    const uint32_t z15 = t42 & y9, z16 = t45 & y14, z17 = t41 & y8;
+
+    // Bottom linear transformation, with the affine constant 0x63
+    const uint32_t t46 = z15 ^ z16, t47 = z10 ^ z11, t48 = z5 ^ z13;
+    const uint32_t t49 = z9 ^ z10, t50 = z2 ^ z12, t51 = z2 ^ z5;
+    const uint32_t t52 = z7 ^ z8, t53 = z0 ^ z3, t54 = z6 ^ z7;
+    const uint32_t t55 = z16 ^ z17, t56 = z12 ^ t48, t57 = t50 ^ t53;
+    const uint32_t t58 = z4 ^ t46, t59 = z3 ^ t54, t60 = t46 ^ t57;
+    const uint32_t t61 = z14 ^ t57, t62 = t52 ^ t58, t63 = t49 ^ t58;
+    const uint32_t t64 = z4 ^ t59, t65 = t61 ^ t62, t66 = z1 ^ t63;
+    const uint32_t s0 = t59 ^ t63, s6 = t56 ^ ~t62, s7 = t48 ^ ~t60;
+    const uint32_t t67 = t64 ^ t65, s3 = t53 ^ t66, s4 = t51 ^ t66;
+    const uint32_t s5 = t47 ^ t65, s1 = t64 ^ ~s3, s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+// SubBytes of count <= 32 bytes
+void sub_bytes(uint8_t* bytes, size_t count) noexcept {
+    uint32_t q[8] = {};
+    for (size_t j = 0; j < count; ++j)
+        for (int b = 0; b < 8; ++b)
+            q[b] |= static_cast<uint32_t>((bytes[j] >> b) & 1) << j;
+    sbox_planes(q);
+    for (size_t j = 0; j < count; ++j) {
+        uint8_t v = 0;
+        for (int b = 0; b < 8; ++b)
+            v |= static_cast<uint8_t>(((q[b] >> j) & 1) << b);
+        bytes[j] = v;
+    }
+}
+
+constexpr uint8_t xtime(uint8_t x) noexcept {
+    // The reduction is masked rather than branched on the top bit
+    return static_cast<uint8_t>((x << 1) ^ (0x1b & -(x >> 7)));
+}
+
+// The state is in the FIPS-197 byte order, s[r + 4c] is row r of column c
+void shift_rows(uint8_t s[16]) noexcept {
+    uint8_t t[16];
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            t[r + 4 * c] = s[r + 4 * ((c + r) % 4)];
+    ::memcpy(s, t, sizeof(t));
+}
+
+void mix_columns(uint8_t s[16]) noexcept {
+    for (int c = 0; c < 4; ++c) {
+        uint8_t* col = s + 4 * c;
+        const uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        const uint8_t all = static_cast<uint8_t>(a0 ^ a1 ^ a2 ^ a3);
+        col[0] = static_cast<uint8_t>(a0 ^ all ^ xtime(a0 ^ a1));
+        col[1] = static_cast<uint8_t>(a1 ^ all ^ xtime(a1 ^ a2));
+        col[2] = static_cast<uint8_t>(a2 ^ all ^ xtime(a2 ^ a3));
+        col[3] = static_cast<uint8_t>(a3 ^ all ^ xtime(a3 ^ a0));
+    }
+}
+
+void add_round_key(uint8_t s[16], const uint8_t* rk) noexcept {
+    for (int i = 0; i < 16; ++i)
+        s[i] ^= rk[i];
+}
+
+// FIPS-197 key expansion, the round keys are stored in byte order
+void expand_key(const uint8_t key[32], uint8_t* round_keys) noexcept {
+    constexpr uint8_t RCON[7] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+    ::memcpy(round_keys, key, 32);
+
+    for (size_t i = 8; i < 60; ++i) {
+        uint8_t temp[4];
+        ::memcpy(temp, round_keys + 4 * (i - 1), 4);
+        if (i % 8 == 0) {
+            const uint8_t first = temp[0];
+            temp[0] = temp[1];
+            temp[1] = temp[2];
+            temp[2] = temp[3];
+            temp[3] = first;
+            sub_bytes(temp, 4);
+            temp[0] ^= RCON[i / 8 - 1];
+        } else if (i % 8 == 4) {
+            sub_bytes(temp, 4);
+        }
+        for (size_t j = 0; j < 4; ++j)
+            round_keys[4 * i + j] =
+                static_cast<uint8_t>(round_keys[4 * (i - 8) + j] ^ temp[j]);
+    }
+}
+
+// Encrypt count <= PARALLEL_BLOCKS blocks, in and out may alias
+void encrypt_blocks(const uint8_t* round_keys, const uint8_t* in,
+                    uint8_t* out, size_t count) noexcept {
+    uint8_t state[PARALLEL_BLOCKS * 16];
+    ::memcpy(state, in, count * 16);
+    for (size_t b = 0; b < count; ++b)
+        add_round_key(state + 16 * b, round_keys);
+
+    for (int round = 1; round <= 14; ++round) {
+        sub_bytes(state, count * 16);
+        for (size_t b = 0; b < count; ++b) {
+            uint8_t* s = state + 16 * b;
+            shift_rows(s);
+            // The last round has no MixColumns
+            if (round != 14)
+                mix_columns(s);
+            add_round_key(s, round_keys + 16 * round);
+        }
+    }
+    ::memcpy(out, state, count * 16);
+}
+}  // namespace aes
+
+// CTR mode over independent instructions
+namespace ctr {
+using VMPilot::Common::detail::BLOCKS_PER_INSTRUCTION;
+using Implementation = InstructionCipher::Implementation;
+static_assert(BLOCKS_PER_INSTRUCTION <= aes::PARALLEL_BLOCKS,
+              "The portable kernel encrypts an instruction in one pass");
+
+void counter_block(uint8_t block[16], uint64_t region, uint32_t index,
+                   uint32_t block_number) noexcept {
+    for (int i = 0; i < 8; ++i)
+        block[i] = static_cast<uint8_t>(region >> (8 * i));
+    for (int i = 0; i < 4; ++i)
+        block[8 + i] = static_cast<uint8_t>(index >> (8 * i));
+    for (int i = 0; i < 4; ++i)
+        block[12 + i] = static_cast<uint8_t>(block_number >> (8 * i));
+}
+
+uint64_t load_le(const uint8_t* p, size_t size) noexcept {
+    uint64_t v = 0;
+    for (size_t i = 0; i < size; ++i)
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+void apply_keystream(Instruction_t& inst, const uint8_t* ks) noexcept {
+    using Opcode_t = decltype(Instruction_t::opcode);
+    inst.opcode ^= static_cast<Opcode_t>(load_le(ks, 2));
+    inst.left_operand ^= load_le(ks + 2, 8);
+    inst.right_operand ^= load_le(ks + 10, 8);
+}
+
+void decrypt_portable(const uint8_t* round_keys, Instruction_t* insts,
+                      size_t count, uint64_t region,
+                      uint64_t first_index) noexcept {
+    for (size_t i = 0; i < count; ++i) {
+        // The counter blocks of an instruction are encrypted together
+        uint8_t keystream[BLOCKS_PER_INSTRUCTION * 16];
+        for (size_t b = 0; b < BLOCKS_PER_INSTRUCTION; ++b)
+            counter_block(keystream + 16 * b, region,
+                          static_cast<uint32_t>(first_index + i),
+                          static_cast<uint32_t>(b));
+        aes::encrypt_blocks(round_keys, keystream, keystream,
+                            BLOCKS_PER_INSTRUCTION);
+        apply_keystream(insts[i], keystream);
+    }
+}
+
+// The fastest implementation the CPU supports, at most the requested one
+Implementation select_implementation(Implementation requested) noexcept {
+#ifdef VMPILOT_X86_AES
+    static const bool has_vaes = VMPilot::Common::detail::CPUHasVAES();
+    static const bool has_aesni = VMPilot::Common::detail::CPUHasAESNI();
+
+    if ((requested == Implementation::Auto ||
+         requested == Implementation::VAES) &&
+        has_vaes)
+        return Implementation::VAES;
+    if (requested != Implementation::Portable && has_aesni)
+        return Implementation::AESNI;
+#else
+    (void)requested;
+#endif
+    return Implementation::Portable;
+}
+}  // namespace ctr
+}  // namespace
+
+void VMPilot::Common::detail::ExpandKey(const uint8_t key[32],
+                                        uint8_t* round_keys) noexcept {
+    aes::expand_key(key, round_keys);
+}
+
+void VMPilot::Common::detail::EncryptBlockPortable(const uint8_t* round_keys,
+                                                   const uint8_t in[16],
+                                                   uint8_t out[16]) noexcept {
+    aes::encrypt_blocks(round_keys, in, out, 1);
+}
+
+InstructionCipher::InstructionCipher(const std::string& key,
+                                     Implementation impl) noexcept
+    : impl_(ctr::select_implementation(impl)) {
+    uint8_t padded_key[32] = {};
+    ::memcpy(padded_key, key.data(), key.size() < 32 ? key.size() : 32);
+    aes::expand_key(padded_key, round_keys_.data());
+    ::memset(padded_key, 0, sizeof(padded_key));
+}
+
+InstructionCipher::~InstructionCipher() {
+    // Do not leave the key schedule in freed memory
+    volatile uint8_t* p = round_keys_.data();
+    for (size_t i = 0; i < round_keys_.size(); ++i)
+        p[i] = 0;
+}
+
+void InstructionCipher::Decrypt(Instruction_t* insts, size_t count,
+                                uint64_t region,
+                                uint64_t first_index) const noexcept {
+    switch (impl_) {
+#ifdef VMPILOT_X86_AES
+        case Implementation::VAES:
+            detail::DecryptVAES(round_keys_.data(), insts, count, region,
+                                first_index);
+            return;
+        case Implementation::AESNI:
+            detail::DecryptAESNI(round_keys_.data(), insts, count, region,
+                                 first_index);
+            return;
+#endif
+        default:
+            ctr::decrypt_portable(round_keys_.data(), insts, count, region,
+                                  first_index);
+            return;
+    }
+}
@@ -0,0 +1,146 @@
+#include "instruction_cipher_kernels.hpp"
+
+#include <cstring>
+
+#include <immintrin.h>
+#include <wmmintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+using Instruction_t = VMPilot::Common::Instruction_t;
+namespace detail = VMPilot::Common::detail;
+
+namespace {
+// Counter block: region | index | block number, all little-endian
+inline __m128i counter_block(uint64_t region, uint64_t index,
+                             uint32_t block_number) noexcept {
+    return _mm_set_epi32(static_cast<int>(block_number),
+                         static_cast<int>(index),
+                         static_cast<int>(region >> 32),
+                         static_cast<int>(region));
+}
+
+// x86 is little-endian, so the keystream can be read with memcpy
+inline void apply_keystream(Instruction_t& inst, const uint8_t* ks) noexcept {
+    uint16_t op;
+    uint64_t left, right;
+    ::memcpy(&op, ks, sizeof(op));
+    ::memcpy(&left, ks + 2, sizeof(left));
+    ::memcpy(&right, ks + 10, sizeof(right));
+    inst.opcode ^= op;
+    inst.left_operand ^= left;
+    inst.right_operand ^= right;
+}
+
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) noexcept {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+        regs[i] = static_cast<uint32_t>(r[i]);
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2],
+                           &regs[3]))
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+}
+
+// The register state the OS saves on context switch (XCR0)
+uint64_t xgetbv0() noexcept {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return static_cast<uint64_t>(edx) << 32 | eax;
+#endif
+}
+}  // namespace
+
+bool detail::CPUHasAESNI() noexcept {
+    uint32_t regs[4];
+    cpuid(1, 0, regs);
+    const bool sse41 = regs[2] & (1u << 19);
+    const bool aes = regs[2] & (1u << 25);
+    return sse41 && aes;
+}
+
+bool detail::CPUHasVAES() noexcept {
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7 || !CPUHasAESNI())
+        return false;
+
+    cpuid(1, 0, regs);
+    const bool osxsave = regs[2] & (1u << 27);
+    if (!osxsave)
+        return false;
+    // SSE, AVX, opmask, ZMM0-15 upper halves and ZMM16-31 must be enabled
+    constexpr uint64_t ZMM_STATE = 0xe6;
+    if ((xgetbv0() & ZMM_STATE) != ZMM_STATE)
+        return false;
+
+    cpuid(7, 0, regs);
+    const bool avx512f = regs[1] & (1u << 16);
+    const bool vaes = regs[2] & (1u << 9);
+    return avx512f && vaes;
+}
+
+void detail::DecryptAESNI(const uint8_t* round_keys, Instruction_t* insts,
+                          size_t count, uint64_t region,
+                          uint64_t first_index) noexcept {
+    static_assert(BLOCKS_PER_INSTRUCTION == 2,
+                  "The kernel assumes two blocks per instruction");
+
+    __m128i rk[15];
+    for (int r = 0; r < 15; ++r)
+        rk[r] = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(round_keys + 16 * r));
+
+    // 4 instructions per iteration, the 8 independent blocks hide the
+    // latency of aesenc
+    constexpr size_t LANES = 4;
+    constexpr size_t BLOCKS = LANES * BLOCKS_PER_INSTRUCTION;
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        __m128i x[BLOCKS];
+        for (size_t l = 0; l < LANES; ++l) {
+            const auto index = first_index + i + l;
+            x[2 * l] = _mm_xor_si128(counter_block(region, index, 0), rk[0]);
+            x[2 * l + 1] = _mm_xor_si128(counter_block(region, index, 1), rk[0]);
+        }
+        for (int r = 1; r < 14; ++r)
+            for (size_t b = 0; b < BLOCKS; ++b)
+                x[b] = _mm_aesenc_si128(x[b], rk[r]);
+        for (size_t b = 0; b < BLOCKS; ++b)
+            x[b] = _mm_aesenclast_si128(x[b], rk[14]);
+
+        alignas(16) uint8_t ks[BLOCKS * 16];
+        for (size_t b = 0; b < BLOCKS; ++b)
+            _mm_store_si128(reinterpret_cast<__m128i*>(ks + 16 * b), x[b]);
+        for (size_t l = 0; l < LANES; ++l)
+            apply_keystream(insts[i + l], ks + 32 * l);
+    }
+
+    // The tail, one instruction at a time
+    for (; i < count; ++i) {
+        const auto index = first_index + i;
+        __m128i x0 = _mm_xor_si128(counter_block(region, index, 0), rk[0]);
+        __m128i x1 = _mm_xor_si128(counter_block(region, index, 1), rk[0]);
+        for (int r = 1; r < 14; ++r) {
+            x0 = _mm_aesenc_si128(x0, rk[r]);
+            x1 = _mm_aesenc_si128(x1, rk[r]);
+        }
+        x0 = _mm_aesenclast_si128(x0, rk[14]);
+        x1 = _mm_aesenclast_si128(x1, rk[14]);
+
+        alignas(16) uint8_t ks[32];
+        _mm_store_si128(reinterpret_cast<__m128i*>(ks), x0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(ks + 16), x1);
+        apply_keystream(insts[i], ks);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __COMMON_INSTRUCTION_CIPHER_KERNELS_HPP__
+#define __COMMON_INSTRUCTION_CIPHER_KERNELS_HPP__
+
+// Private to the opcode_table library (and its tests): the kernels of
+// InstructionCipher, the accelerated ones live in their own translation units
+// since they are built with different instruction set flags.
+
+#include <instruction_t.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VMPilot::Common::detail {
+// The keystream layout shared by every kernel, see InstructionCipher.
+constexpr size_t KEYSTREAM_SIZE = sizeof(Instruction_t::opcode) +
+                                  sizeof(Instruction_t::left_operand) +
+                                  sizeof(Instruction_t::right_operand);
+constexpr size_t BLOCKS_PER_INSTRUCTION = (KEYSTREAM_SIZE + 15) / 16;
+
+/**
+ * @brief The FIPS-197 AES-256 key expansion shared by every kernel, the round
+ *        keys are in byte order.
+ */
+void ExpandKey(const uint8_t key[32], uint8_t* round_keys) noexcept;
+
+/**
+ * @brief Encrypt one block with the constant-time portable AES, the block
+ *        function of the portable kernel.
+ */
+void EncryptBlockPortable(const uint8_t* round_keys, const uint8_t in[16],
+                          uint8_t out[16]) noexcept;
+
+#ifdef VMPILOT_X86_AES
+/**
+ * @brief CTR decryption with AES-NI, 4 instructions (8 blocks) in flight.
+ */
+void DecryptAESNI(const uint8_t* round_keys, Instruction_t* insts,
+                  size_t count, uint64_t region,
+                  uint64_t first_index) noexcept;
+
+/**
+ * @brief CTR decryption with VAES/AVX-512, 8 instructions (16 blocks) in
+ *        flight.
+ */
+void DecryptVAES(const uint8_t* round_keys, Instruction_t* insts,
+                 size_t count, uint64_t region,
+                 uint64_t first_index) noexcept;
+
+bool CPUHasAESNI() noexcept;
+bool CPUHasVAES() noexcept;
+#endif
+}  // namespace VMPilot::Common::detail
+
+#endif  // __COMMON_INSTRUCTION_CIPHER_KERNELS_HPP__
@@ -0,0 +1,70 @@
+#include "instruction_cipher_kernels.hpp"
+
+#include <cstring>
+
+#include <immintrin.h>
+
+using Instruction_t = VMPilot::Common::Instruction_t;
+namespace detail = VMPilot::Common::detail;
+
+void detail::DecryptVAES(const uint8_t* round_keys, Instruction_t* insts,
+                         size_t count, uint64_t region,
+                         uint64_t first_index) noexcept {
+    static_assert(BLOCKS_PER_INSTRUCTION == 2,
+                  "The kernel assumes two blocks per instruction");
+
+    // The zero-masked broadcast, since the unmasked one trips
+    // -Wuninitialized inside the GCC headers
+    __m512i rk[15];
+    for (int r = 0; r < 15; ++r)
+        rk[r] = _mm512_maskz_broadcast_i32x4(
+            static_cast<__mmask16>(0xffff),
+            _mm_load_si128(
+                reinterpret_cast<const __m128i*>(round_keys + 16 * r)));
+
+    // 8 instructions per iteration: 16 blocks in 4 ZMM registers, the
+    // blocks of instruction l are the 128-bit lanes 2l and 2l + 1
+    constexpr size_t LANES = 8;
+    constexpr size_t VECTORS = LANES * BLOCKS_PER_INSTRUCTION / 4;
+    const auto region_hi = static_cast<int>(region >> 32);
+    const auto region_lo = static_cast<int>(region);
+    size_t i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        __m512i x[VECTORS];
+        for (size_t v = 0; v < VECTORS; ++v) {
+            const auto ia = static_cast<int>(first_index + i + 2 * v);
+            const auto ib = static_cast<int>(first_index + i + 2 * v + 1);
+            // counter blocks: region | index | block number, little-endian
+            x[v] = _mm512_set_epi32(1, ib, region_hi, region_lo,  //
+                                    0, ib, region_hi, region_lo,  //
+                                    1, ia, region_hi, region_lo,  //
+                                    0, ia, region_hi, region_lo);
+            x[v] = _mm512_xor_si512(x[v], rk[0]);
+        }
+        for (int r = 1; r < 14; ++r)
+            for (size_t v = 0; v < VECTORS; ++v)
+                x[v] = _mm512_aesenc_epi128(x[v], rk[r]);
+        for (size_t v = 0; v < VECTORS; ++v)
+            x[v] = _mm512_aesenclast_epi128(x[v], rk[14]);
+
+        alignas(64) uint8_t ks[VECTORS * 64];
+        for (size_t v = 0; v < VECTORS; ++v)
+            _mm512_store_si512(reinterpret_cast<__m512i*>(ks + 64 * v), x[v]);
+
+        // x86 is little-endian, so the keystream can be read with memcpy
+        for (size_t l = 0; l < LANES; ++l) {
+            uint16_t op;
+            uint64_t left, right;
+            ::memcpy(&op, ks + 32 * l, sizeof(op));
+            ::memcpy(&left, ks + 32 * l + 2, sizeof(left));
+            ::memcpy(&right, ks + 32 * l + 10, sizeof(right));
+            insts[i + l].opcode ^= op;
+            insts[i + l].left_operand ^= left;
+            insts[i + l].right_operand ^= right;
+        }
+    }
+
+    if (i < count)
+        DecryptAESNI(round_keys, insts + i, count - i, region,
+                     first_index + i);
+}
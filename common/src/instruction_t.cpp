@@ -2,10 +2,12 @@
 #include <functional>
 
 #include <VMPilot_crypto.hpp>
+#include <blake3.h>
 #include <instruction_t.hpp>
 
 using Instruction_t = VMPilot::Common::Instruction_t;
 using Hash_val_t = decltype(Instruction_t::checksum);
+using ChecksumVersion = VMPilot::Common::ChecksumVersion;
 
 namespace detail {
 
@@ -17,38 +19,60 @@ namespace detail {
  * Salt: nounce field
  */
 Hash_val_t Hash(const Instruction_t& inst) noexcept;
+
+/**
+ * @brief Hash the instruction, version 2
+ *
+ * We use BLAKE3 over the packed little-endian fields.
+ * Inputs: opcode, left_operand, right_operand, nounce (as the salt)
+ * Key: a public constant, derived once from a fixed context string (BLAKE3
+ * derive_key mode). It only separates this hash from the other BLAKE3 uses,
+ * the checksum detects corruption but authenticates nothing.
+ */
+Hash_val_t Hash_V2(const Instruction_t& inst) noexcept;
+
+Hash_val_t Hash(const Instruction_t& inst, ChecksumVersion version) noexcept {
+    if (version == ChecksumVersion::V1)
+        return Hash(inst);
+    return Hash_V2(inst);
+}
 }  // namespace detail
 
-bool VMPilot::Common::Instruction::check(const Instruction_t& inst) noexcept {
-    return detail::Hash(inst) == inst.checksum;
+bool VMPilot::Common::Instruction::check(const Instruction_t& inst,
+                                         ChecksumVersion version) noexcept {
+    return detail::Hash(inst, version) == inst.checksum;
 }
 
 void VMPilot::Common::Instruction::decrypt(Instruction_t& inst,
-                                           const std::string& key) noexcept {
+                                           const std::string& key,
+                                           ChecksumVersion version) noexcept {
     // Decrypt the instruction using the key
     // We use AES-256-CBC from the OpenSSL library to decrypt the instruction.
     const auto data = flatten(inst);
 
-    // If key is too short, we pad it with 0
-    std::string padded_key = key;
-    if (key.size() < 32)
+    // If key is not 32 bytes, we pad it with 0 or truncate it.
+    // Callers on the hot path (the Decoder) pass an already padded key, so we
+    // only pay for the copy otherwise.
+    std::string padded_key;
+    const std::string* aes_key = &key;
+    if (key.size() != 32) {
+        padded_key = key;
         padded_key.resize(32, 0);
-    else if (key.size() > 32)
-        padded_key.resize(32);
+        aes_key = &padded_key;
+    }
 
     // Decrypt the instruction
-    const auto decrypted_data =
-        VMPilot::Crypto::Decrypt_AES_256_CBC_PKCS7(
-            std::vector<uint8_t>(data.begin(), data.end()), padded_key);
+    const auto decrypted_data = VMPilot::Crypto::Decrypt_AES_256_CBC_PKCS7(
+        std::vector<uint8_t>(data.begin(), data.end()), *aes_key);
     ::memcpy(&inst, decrypted_data.data(), sizeof(Instruction_t));
 
     // Update the checksum
-    update_checksum(inst);
+    update_checksum(inst, version);
 }
 
 void VMPilot::Common::Instruction::update_checksum(
-    Instruction_t& inst) noexcept {
-    inst.checksum = detail::Hash(inst);
+    Instruction_t& inst, ChecksumVersion version) noexcept {
+    inst.checksum = detail::Hash(inst, version);
 }
 
 auto VMPilot::Common::Instruction::flatten(const Instruction_t& inst) noexcept
@@ -78,3 +102,38 @@ Hash_val_t detail::Hash(const Instruction_t& inst) noexcept {
     return std::hash<std::string>{}(
         std::string(hash_str.begin(), hash_str.end()));
 }
+
+Hash_val_t detail::Hash_V2(const Instruction_t& inst) noexcept {
+    // derive_key mode keeps this key apart from every other BLAKE3 usage,
+    // e.g. the opcode table.
+    static const auto checksum_key = []() noexcept {
+        std::array<uint8_t, BLAKE3_KEY_LEN> key;
+        blake3_hasher hasher;
+        blake3_hasher_init_derive_key(&hasher,
+                                      "VMPilot instruction checksum v2");
+        blake3_hasher_finalize(&hasher, key.data(), key.size());
+        return key;
+    }();
+
+    // Pack the fields in little-endian, independent of the host byte order
+    // and of the struct padding.
+    uint8_t packed[sizeof(inst.opcode) + sizeof(inst.left_operand) +
+                   sizeof(inst.right_operand) + sizeof(inst.nounce)];
+    size_t pos = 0;
+    const auto put = [&packed, &pos](uint64_t value, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i)
+            packed[pos++] = static_cast<uint8_t>(value >> (i * 8));
+    };
+    put(inst.opcode, sizeof(inst.opcode));
+    put(inst.left_operand, sizeof(inst.left_operand));
+    put(inst.right_operand, sizeof(inst.right_operand));
+    put(inst.nounce, sizeof(inst.nounce));
+
+    blake3_hasher hasher;
+    blake3_hasher_init_keyed(&hasher, checksum_key.data());
+    blake3_hasher_update(&hasher, packed, sizeof(packed));
+
+    uint8_t digest[sizeof(Hash_val_t)];
+    blake3_hasher_finalize(&hasher, digest, sizeof(digest));
+    return static_cast<Hash_val_t>(digest[0] | digest[1] << 8);
+}
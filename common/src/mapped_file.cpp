@@ -0,0 +1,103 @@
+#include <mapped_file.hpp>
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+VMPilot::Common::MappedFile::MappedFile(const std::string& filename)
+    : filename_(filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open file: " + filename);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to get the size of file: " +
+                                 filename);
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+
+    // A zero-length file cannot be mapped, it is an empty view
+    if (size_ == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + filename);
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map file: " + filename);
+    }
+
+    data_ = static_cast<const uint8_t*>(data);
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+}
+
+VMPilot::Common::MappedFile::~MappedFile() {
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_handle_ != nullptr)
+        CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_ != nullptr)
+        CloseHandle(static_cast<HANDLE>(file_handle_));
+}
+
+#else
+
+VMPilot::Common::MappedFile::MappedFile(const std::string& filename)
+    : filename_(filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open file: " + filename);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to get the size of file: " +
+                                 filename);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+
+    // A zero-length file cannot be mapped, it is an empty view
+    if (size_ != 0) {
+        void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file: " + filename);
+        }
+        data_ = static_cast<const uint8_t*>(data);
+    }
+    fd_ = fd;
+}
+
+VMPilot::Common::MappedFile::~MappedFile() {
+    if (data_ != nullptr)
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+#endif
@@ -20,13 +20,41 @@ using OID_to_OI = std::unordered_map<OID, OI>;
 namespace detail {
 std::string get_Opcode_BLAKE3(Opcode_t opcode,
                               const std::string& salt) noexcept;
+
+// The number of real opcodes in opcode_enum.hpp
+constexpr size_t opcode_count() noexcept {
+    using namespace VMPilot::Common::Opcode::Enum;
+    const auto size = [](auto begin, auto end) {
+        return static_cast<size_t>(end) - static_cast<size_t>(begin);
+    };
+    return size(DataMovement::__BEGIN, DataMovement::__END) +
+           size(ArithmeticLogic::__BEGIN, ArithmeticLogic::__END) +
+           size(ControlTransfer::__BEGIN, ControlTransfer::__END) +
+           size(ThreadingAtomic::__BEGIN, ThreadingAtomic::__END);
+}
+static_assert(opcode_count() <= VMPilot::Common::MAX_OPCODE_COUNT,
+              "MAX_OPCODE_COUNT is too small for opcode_enum.hpp");
 }  // namespace detail
 
+VMPilot::Common::Opcode_table::Opcode_table(
+    const std::unordered_map<OI, RealOpcode>& t_) {
+    for (const auto& [oi, opcode] : t_) {
+        if (oi >= table.size())
+            throw std::runtime_error("Invalid opcode index");
+        table[oi] = opcode;
+    }
+}
+
 RealOpcode VMPilot::Common::Opcode_table::find(OI oi) const {
-    const auto& opcode_entry = table.find(oi);
-    if (opcode_entry == table.end())
+    if (oi >= table.size() || table[oi] == 0)
         throw std::runtime_error("Invalid instruction");
-    return opcode_entry->second;
+    return table[oi];
+}
+
+RealOpcode VMPilot::Common::Flat_opcode_table::find(OID oid) const {
+    if (!contains(oid))
+        throw std::runtime_error("Invalid instruction");
+    return table_[static_cast<OI>(oid - base_)];
 }
 
 VMPilot::Common::Opcode_table_generator::Opcode_table_generator(
@@ -37,25 +65,40 @@ VMPilot::Common::Opcode_table_generator::Opcode_table_generator(
 
 Opcode_t VMPilot::Common::Opcode_table_generator::GetOpcodeIndex(
     Opcode_t OID) const {
-    OID_to_OI::const_iterator it = OID_to_OI_.find(OID);
-    if (it == OID_to_OI_.end())
+    const auto oi = static_cast<OI>(OID - base_OID_);
+    if (oi >= count_)
         throw std::runtime_error("Invalid instruction");
-    return it->second;
+    return oi;
 }
 
 Runtime_OT VMPilot::Common::Opcode_table_generator::Generate() const noexcept {
-    return OI_to_RealOp_;
+    Runtime_OT result;
+    for (OI oi = 0; oi < count_; ++oi)
+        result.insert(std::make_pair(oi, OI_to_RealOp_[oi]));
+    return result;
+}
+
+VMPilot::Common::Flat_opcode_table
+VMPilot::Common::Opcode_table_generator::GenerateFlat() const noexcept {
+    return Flat_opcode_table(base_OID_, OI_to_RealOp_, count_);
 }
 
 Buildtime_OT VMPilot::Common::Opcode_table_generator::Get_RealOp_to_OID()
     const noexcept {
-    return RealOp_to_OID_;
+    Buildtime_OT result;
+    for (OI oi = 0; oi < count_; ++oi)
+        result.insert(std::make_pair(OI_to_RealOp_[oi],
+                                     static_cast<OID>(base_OID_ + oi)));
+    return result;
 }
 
 #ifdef DEBUG
 OID_to_OI VMPilot::Common::Opcode_table_generator::GetOID_to_OI()
     const noexcept {
-    return OID_to_OI_;
+    OID_to_OI result;
+    for (OI oi = 0; oi < count_; ++oi)
+        result.insert(std::make_pair(static_cast<OID>(base_OID_ + oi), oi));
+    return result;
 }
 #endif
 
@@ -67,7 +110,8 @@ void VMPilot::Common::Opcode_table_generator::three_way_table_init() {
     // 4. For loop over the list and assign the index to the hash
     // 5. Assign for all OID = (start number) + array index
     //    The start number is the first element BLAKE3 last byte of the list
-    // 6. Generate the OID_to_OI table
+    // 6. Keep the OI -> RealOpcode array and the OID of OI 0, all the other
+    //    tables are derived from them
     std::map<std::string, Opcode_t> list;
 
     // Step 1 to 3
@@ -93,16 +137,12 @@ void VMPilot::Common::Opcode_table_generator::three_way_table_init() {
     // Get the start number
     const auto& start_number = list.begin()->first.back();
 
-    // Generate the RealOp_to_OI table and OID_to_OI table
-    Opcode_t index = 0;
-    for (const auto& [_, opcode] : list) {
-        const auto OID = start_number + index;
-        OI_to_RealOp_.insert(std::make_pair(index, opcode));
-        RealOp_to_OID_.insert(std::make_pair(opcode, OID));
-        OID_to_OI_.insert(std::make_pair(OID, index));
+    // The OIDs are (start_number + index) truncated to Opcode_t
+    base_OID_ = static_cast<OID>(start_number);
 
-        ++index;
-    }
+    // Step 5 and 6
+    for (const auto& [_, opcode] : list)
+        OI_to_RealOp_[count_++] = opcode;
 }
 
 std::string detail::get_Opcode_BLAKE3(Opcode_t opcode,
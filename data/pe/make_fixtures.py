@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Write the minimal PE32 and PE32+ images of the PE handler tests.
+
+Each image has a .text section calling the import thunks of VMPilot_Begin
+and VMPilot_End around a few instructions, and an .idata section importing
+both from mock_VMPilot.dll. The layout is fixed, so the tests know the
+addresses:
+
+    .text   RVA 0x1000   the protected function, then the thunks
+            RVA 0x1040   jmp [VMPilot_Begin slot]
+            RVA 0x1046   jmp [VMPilot_End slot]
+    .idata  RVA 0x2000   the import directory, ILT, IAT and names
+
+Run it from this directory to regenerate the images.
+"""
+
+import struct
+
+FILE_ALIGNMENT = 0x200
+SECTION_ALIGNMENT = 0x1000
+TEXT_RVA, TEXT_OFFSET = 0x1000, 0x200
+IDATA_RVA, IDATA_OFFSET = 0x2000, 0x400
+BEGIN_THUNK, END_THUNK = 0x1040, 0x1046
+
+ILT, IAT, DLL_NAME, BEGIN_NAME, END_NAME = 0x2040, 0x2060, 0x2080, 0x20A0, 0x20D0
+
+
+def text(is_64, image_base):
+    def call(at, target):
+        return b"\xE8" + struct.pack("<i", target - (at + 5))
+
+    code = bytearray()
+    code += b"\x48\x83\xEC\x28" if is_64 else b"\x83\xEC\x1C"  # sub sp
+    code += call(TEXT_RVA + len(code), BEGIN_THUNK)
+    code += b"\xB8\x01\x00\x00\x00"  # mov eax, 1
+    code += b"\x83\xC0\x02"  # add eax, 2
+    code += call(TEXT_RVA + len(code), END_THUNK)
+    code += b"\x48\x83\xC4\x28" if is_64 else b"\x83\xC4\x1C"  # add sp
+    code += b"\xC3"  # ret
+    code += b"\xCC" * (BEGIN_THUNK - TEXT_RVA - len(code))
+
+    for thunk, slot in ((BEGIN_THUNK, IAT), (END_THUNK, IAT + (8 if is_64 else 4))):
+        # x64 addresses the slot relative to the next instruction, x86 by
+        # its absolute address
+        disp = slot - (thunk + 6) if is_64 else image_base + slot
+        code += b"\xFF\x25" + struct.pack("<I", disp & 0xFFFFFFFF)
+    return bytes(code)
+
+
+def idata(is_64):
+    begin, end = (
+        ("?VMPilot_Begin@@YAXPEBD@Z", "?VMPilot_End@@YAXPEBD@Z")
+        if is_64
+        else ("?VMPilot_Begin@@YAXPBD@Z", "?VMPilot_End@@YAXPBD@Z")
+    )
+    data = bytearray(0x100)
+
+    def put(rva, blob):
+        data[rva - IDATA_RVA : rva - IDATA_RVA + len(blob)] = blob
+
+    # One descriptor, then the null one
+    put(IDATA_RVA, struct.pack("<IIIII", ILT, 0, 0, DLL_NAME, IAT))
+    thunk = "<QQQ" if is_64 else "<III"
+    put(ILT, struct.pack(thunk, BEGIN_NAME, END_NAME, 0))
+    put(IAT, struct.pack(thunk, BEGIN_NAME, END_NAME, 0))
+    put(DLL_NAME, b"mock_VMPilot.dll\0")
+    put(BEGIN_NAME, struct.pack("<H", 0) + begin.encode() + b"\0")
+    put(END_NAME, struct.pack("<H", 1) + end.encode() + b"\0")
+    return bytes(data)
+
+
+def section(name, virtual_size, rva, raw_offset, characteristics):
+    return struct.pack(
+        "<8sIIIIIIHHI",
+        name,
+        virtual_size,
+        rva,
+        FILE_ALIGNMENT,
+        raw_offset,
+        0,
+        0,
+        0,
+        0,
+        characteristics,
+    )
+
+
+def image(is_64):
+    image_base = 0x140000000 if is_64 else 0x400000
+    code = text(is_64, image_base)
+    imports = idata(is_64)
+
+    optional_size = 240 if is_64 else 224
+    file_header = struct.pack(
+        "<HHIIIHH",
+        0x8664 if is_64 else 0x14C,
+        2,
+        0,
+        0,
+        0,
+        optional_size,
+        0x22 if is_64 else 0x102,
+    )
+
+    optional = struct.pack("<HBBIIIII", 0x20B if is_64 else 0x10B, 14, 0,
+                           FILE_ALIGNMENT, 2 * FILE_ALIGNMENT, 0, TEXT_RVA,
+                           TEXT_RVA)
+    if is_64:
+        optional += struct.pack("<Q", image_base)
+    else:
+        optional += struct.pack("<II", IDATA_RVA, image_base)
+    optional += struct.pack("<IIHHHHHHIIIIHH", SECTION_ALIGNMENT,
+                            FILE_ALIGNMENT, 6, 0, 0, 0, 6, 0, 0, 0x3000,
+                            0x200, 0, 3, 0x8160 if is_64 else 0x8140)
+    sizes = "<QQQQ" if is_64 else "<IIII"
+    optional += struct.pack(sizes, 0x100000, 0x1000, 0x100000, 0x1000)
+    optional += struct.pack("<II", 0, 16)
+    directories = [(0, 0)] * 16
+    directories[1] = (IDATA_RVA, 40)  # The import directory
+    directories[12] = (IAT, 24 if is_64 else 12)  # The IAT
+    for rva, size in directories:
+        optional += struct.pack("<II", rva, size)
+    assert len(optional) == optional_size
+
+    headers = bytearray(0x40)
+    headers[0:2] = b"MZ"
+    headers[0x3C:0x40] = struct.pack("<I", 0x40)
+    headers += b"PE\0\0" + file_header + optional
+    headers += section(b".text", len(code), TEXT_RVA, TEXT_OFFSET, 0x60000020)
+    headers += section(b".idata", len(imports), IDATA_RVA, IDATA_OFFSET,
+                       0xC0000040)
+
+    def pad(blob):
+        return blob + b"\0" * (-len(blob) % FILE_ALIGNMENT)
+
+    return pad(bytes(headers)) + pad(code) + pad(imports)
+
+
+if __name__ == "__main__":
+    with open("stubs.Windows.x86_64.exe", "wb") as f:
+        f.write(image(True))
+    with open("stubs.Windows.x86.exe", "wb") as f:
+        f.write(image(False))
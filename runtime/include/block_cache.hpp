@@ -0,0 +1,125 @@
+#ifndef __RUNTIME_BLOCK_CACHE_HPP__
+#define __RUNTIME_BLOCK_CACHE_HPP__
+
+#include <byte_view.hpp>
+#include <decoder.hpp>
+#include <instruction_t.hpp>
+#include <vm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace VMPilot::Runtime {
+
+/**
+ * @brief A cache of decoded basic blocks of one bytecode region.
+ *
+ * A block is decoded the first time the control reaches its offset, it runs
+ * until the first control transfer instruction (or max_block_size
+ * instructions). The decoded blocks are kept as prepared Programs in an LRU
+ * order, the least recently used ones are evicted over the memory cap. So a
+ * large region with a small hot path only pays for decoding the hot path.
+ */
+class BlockCache {
+   public:
+    struct Options {
+        // The upper bound of the memory held by the cache, in bytes: the
+        // prepared blocks, their bookkeeping and the decoding buffer of
+        // max_block_size instructions. The most recently used block is
+        // always kept.
+        size_t memory_cap = 1 << 20;
+        // The maximum number of instructions of a block
+        size_t max_block_size = 256;
+        // Overwrite the decrypted instructions of evicted blocks, so they do
+        // not stay in freed memory
+        bool wipe_evicted = false;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+    };
+
+    /**
+     * @brief Create the cache of a region.
+     *
+     * @param decoder The decoder initialized with the key of the region.
+     * @param region The encoded bytecode, it must outlive the cache.
+     * @param region_addr The address of the region, see Decoder::Decode.
+     * @param options The cache options.
+     */
+    BlockCache(Decoder& decoder, VMPilot::Common::ByteView region,
+               uint64_t region_addr, Options options);
+    BlockCache(Decoder& decoder, VMPilot::Common::ByteView region,
+               uint64_t region_addr)
+        : BlockCache(decoder, region, region_addr, Options()) {}
+    ~BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    /**
+     * @brief Get the block starting at offset, decode it on a miss.
+     *
+     * The reference is valid until the next call to Get, Run or Clear.
+     *
+     * @param offset The byte offset of the block in the region, a multiple
+     *               of ENCODED_INSTRUCTION_SIZE.
+     * @throws std::runtime_error if the offset is invalid, or from decoding.
+     */
+    const Program& Get(size_t offset);
+
+    /**
+     * @brief Run the region on vm block by block.
+     *
+     * @param vm The VM, its state is used as is.
+     * @param entry_offset The byte offset of the first instruction to run, a
+     *                     multiple of ENCODED_INSTRUCTION_SIZE.
+     * @return The value of R0.
+     * @throws std::runtime_error if the offset is invalid, on a VM fault, a
+     *         branch out of the region, or from decoding.
+     */
+    uint64_t Run(VM& vm, size_t entry_offset = 0);
+
+    /**
+     * @brief Evict all the blocks.
+     */
+    void Clear() noexcept;
+
+    [[nodiscard]] size_t Size() const noexcept { return blocks_.size(); }
+    [[nodiscard]] size_t MemoryUsage() const noexcept { return memory_; }
+    [[nodiscard]] const Stats& GetStats() const noexcept { return stats_; }
+
+   private:
+    struct Block {
+        size_t offset;
+        Program program;
+    };
+
+    Program decode_block(size_t offset);
+    void evict_one() noexcept;
+    // The memory of a cached block counted against the cap
+    static size_t block_memory(const Program& program) noexcept;
+
+    Decoder& decoder_;
+    VMPilot::Common::ByteView region_;
+    uint64_t region_addr_;
+    Options options_;
+
+    // The most recently used block is at the front
+    std::list<Block> blocks_;
+    std::unordered_map<size_t, std::list<Block>::iterator> index_;
+    size_t memory_ = 0;
+    Stats stats_;
+
+    // The decoded instructions of the block being prepared
+    std::vector<VMPilot::Common::Instruction_t> scratch_;
+};
+
+}  // namespace VMPilot::Runtime
+
+#endif
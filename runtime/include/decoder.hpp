@@ -1,8 +1,12 @@
 #ifndef __RUNTIME_DECODER_HPP__
 #define __RUNTIME_DECODER_HPP__
 
+#include <byte_view.hpp>
+#include <instruction_cipher.hpp>
+#include <instruction_t.hpp>
 #include <opcode_table.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -12,17 +16,89 @@ namespace VMPilot::Runtime {
 class Decoder {
    public:
     [[nodiscard]] static Decoder& GetInstance() noexcept;
-    void Init(const std::string& key);
 
-    [[nodiscard]] std::vector<uint8_t> Decode(const std::vector<uint8_t>& data);
+    /**
+     * @brief Initialize the decoder with the key of the bytecode.
+     *
+     * @param key The key of the bytecode.
+     * @param checksum_version The checksum algorithm the bytecode was built
+     *        with. Bytecode built before V2 should pass ChecksumVersion::V1.
+     * @param cipher_version The encryption of the bytecode, as recorded in
+     *        its bytecode section. Bytecode built before V2 should pass
+     *        CipherVersion::V1.
+     */
+    void Init(const std::string& key,
+              VMPilot::Common::ChecksumVersion checksum_version =
+                  VMPilot::Common::CURRENT_CHECKSUM_VERSION,
+              VMPilot::Common::CipherVersion cipher_version =
+                  VMPilot::Common::CURRENT_CIPHER_VERSION);
+
+    /**
+     * @brief Decode a whole region, see the buffer overload.
+     */
+    [[nodiscard]] std::vector<uint8_t> Decode(const std::vector<uint8_t>& data,
+                                              uint64_t region);
+
+    /**
+     * @brief Decode a bytecode stream into a caller-provided buffer.
+     *
+     * Each encoded instruction (ENCODED_INSTRUCTION_SIZE bytes) is decoded
+     * into one flattened Instruction_t (sizeof(Instruction_t) bytes) in out.
+     * No heap allocation is done by the decoder itself.
+     *
+     * @param data The encoded bytecode.
+     * @param size The size of data, must be a multiple of
+     *             ENCODED_INSTRUCTION_SIZE.
+     * @param out The output buffer, must hold at least DecodedSize(size) bytes.
+     *            It is partially written if an exception is thrown.
+     * @param region The address of the region, as the SDK encrypted it, see
+     *               InstructionCipher.
+     * @param first_index The index of the first instruction of data in its
+     *                    region, 0 unless decoding a part of a region.
+     * @throws std::runtime_error if the size or any instruction is invalid.
+     */
+    void Decode(const uint8_t* data, size_t size, uint8_t* out,
+                uint64_t region, uint64_t first_index = 0);
+
+    /**
+     * @brief Decode a bytecode stream into a reusable output vector.
+     *
+     * The vector is resized to DecodedSize(data.size()), its capacity is kept,
+     * so decoding the same region again does not allocate.
+     */
+    void DecodeInto(VMPilot::Common::ByteView data, uint64_t region,
+                    std::vector<uint8_t>& reuse);
+
+    /**
+     * @brief Get the size of the decoded output of an encoded stream.
+     */
+    [[nodiscard]] static size_t DecodedSize(size_t encoded_size) noexcept;
 
    private:
     Decoder() = default;
     Decoder(const Decoder&) = delete;
     Decoder& operator=(const Decoder&) = delete;
-    std::string key_;
-    std::unique_ptr<VMPilot::Common::Opcode_table> decode_table_;
+    std::unique_ptr<VMPilot::Common::InstructionCipher> cipher_;
+    VMPilot::Common::ChecksumVersion checksum_version_ =
+        VMPilot::Common::CURRENT_CHECKSUM_VERSION;
+    VMPilot::Common::CipherVersion cipher_version_ =
+        VMPilot::Common::CURRENT_CIPHER_VERSION;
+    // The key of CipherVersion::V1, which decrypts one instruction at a time
+    // with Instruction::decrypt. Empty for the later versions.
+    std::string legacy_key_;
+    // The composed OID -> RealOpcode table, the generator is only needed
+    // during Init
+    VMPilot::Common::Flat_opcode_table opcode_table_;
 };
+
+namespace detail {
+/**
+ * @brief Fetch one instruction from its packed big-endian encoding.
+ *
+ * @param data Points to ENCODED_INSTRUCTION_SIZE readable bytes.
+ */
+VMPilot::Common::Instruction_t Fetch(const uint8_t* data) noexcept;
+}  // namespace detail
 }  // namespace VMPilot::Runtime
 
-#endif
\ No newline at end of file
+#endif
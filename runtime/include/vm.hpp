@@ -0,0 +1,164 @@
+#ifndef __RUNTIME_VM_HPP__
+#define __RUNTIME_VM_HPP__
+
+#include <instruction_t.hpp>
+#include <vm_operand.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VMPilot::Runtime {
+
+namespace detail {
+/**
+ * @brief One prepared instruction of a Program.
+ *
+ * The real opcode is translated to the index of its handler, and each
+ * operand is split into a register flag and a register index or immediate,
+ * so the dispatch loop does not decode anything.
+ */
+struct Op {
+    uint64_t lhs;  // The register index or the sign-extended immediate
+    uint64_t rhs;
+    uint64_t aux;  // The third operand of a superinstruction
+    uint8_t handler;
+    bool lhs_is_reg;
+    bool rhs_is_reg;
+    bool aux_is_reg;
+};
+}  // namespace detail
+
+/**
+ * @brief A decoded instruction stream prepared for the VM.
+ *
+ * A Program covers the instructions [base, base + size) of a region, the
+ * jump targets are indices in the region. Leaving the program, by a branch
+ * or by running past its last instruction, returns to the caller of
+ * VM::Execute with the index of the next instruction.
+ */
+class Program {
+   public:
+    /**
+     * @brief Prepare count decoded instructions.
+     *
+     * @param insts The decoded instructions, with their real opcodes.
+     * @param count The number of instructions.
+     * @param base The index of insts[0] in its region.
+     * @throws std::runtime_error if an opcode or an operand is invalid.
+     */
+    Program(const VMPilot::Common::Instruction_t* insts, size_t count,
+            uint64_t base = 0);
+
+    [[nodiscard]] uint64_t base() const noexcept { return base_; }
+    [[nodiscard]] size_t size() const noexcept { return code_.size() - 1; }
+
+    // The heap memory held by the prepared instructions
+    [[nodiscard]] size_t MemoryUsage() const noexcept {
+        return code_.capacity() * sizeof(detail::Op);
+    }
+
+    /**
+     * @brief Overwrite the prepared instructions, which hold the decrypted
+     *        operands, with zeros. The program must not be executed again.
+     */
+    void Wipe() noexcept;
+
+   private:
+    friend class VM;
+
+    uint64_t base_;
+    // One more Op than the instructions, the last one leaves the program
+    std::vector<detail::Op> code_;
+};
+
+/**
+ * @brief The VMPilot virtual machine.
+ *
+ * It has REGISTER_COUNT 64-bit registers, a VM stack shared by PUSH/POP and
+ * CALL/RET, a zero flag, and an optional caller-provided data memory for
+ * LOAD/STORE and the atomic instructions. The dispatch uses computed goto on
+ * GCC and Clang, and a switch elsewhere or with VMPILOT_SWITCH_DISPATCH.
+ */
+class VM {
+   public:
+    // The size of the VM stack, in 64-bit slots
+    static constexpr size_t STACK_SIZE = 1 << 16;
+
+    struct Exit {
+        enum class Reason : uint8_t {
+            Halt,    // RET from the outermost frame
+            Branch,  // Left the program, target is the next instruction
+        };
+        Reason reason;
+        uint64_t target;
+    };
+
+    VM();
+
+    /**
+     * @brief Set the data memory of LOAD/STORE, addresses are offsets in it.
+     *
+     * This is the only address space of the VM. The lifted x86 code keeps
+     * offsets in its base registers, so the caller seeds those registers
+     * with offsets in this memory, never with native pointers.
+     *
+     * The memory is not owned and must outlive the execution.
+     */
+    void SetMemory(uint8_t* data, size_t size) noexcept {
+        memory_ = data;
+        memory_size_ = size;
+    }
+
+    [[nodiscard]] uint64_t GetRegister(size_t index) const noexcept {
+        return regs_[VMPilot::Common::Operand::RegisterIndex(index)];
+    }
+
+    void SetRegister(size_t index, uint64_t value) noexcept {
+        regs_[VMPilot::Common::Operand::RegisterIndex(index)] = value;
+    }
+
+    /**
+     * @brief Clear the registers, the flags and the stack.
+     */
+    void Reset() noexcept;
+
+    /**
+     * @brief Execute a program from entry until it leaves the program.
+     *
+     * The registers, the stack and the flags are kept between calls, so a
+     * region split into several programs runs by chaining the exits. They
+     * are also kept when a fault is thrown, as they were at the faulting
+     * instruction.
+     *
+     * @param program The program to execute.
+     * @param entry The index of the first instruction, inside the program.
+     * @throws std::runtime_error on a VM fault (stack overflow, division by
+     *         zero, memory access out of range, ...).
+     */
+    Exit Execute(const Program& program, uint64_t entry);
+
+    /**
+     * @brief Run a whole region program from its first instruction.
+     *
+     * It stops at the outermost RET or past the last instruction.
+     *
+     * @return The value of R0.
+     * @throws std::runtime_error on a VM fault, or a branch out of the program.
+     */
+    uint64_t Run(const Program& program);
+
+   private:
+    std::array<uint64_t, VMPilot::Common::Operand::REGISTER_COUNT> regs_{};
+    std::vector<uint64_t> stack_;
+    size_t sp_ = 0;
+    size_t call_depth_ = 0;
+    bool zf_ = false;
+    uint8_t* memory_ = nullptr;
+    size_t memory_size_ = 0;
+};
+
+}  // namespace VMPilot::Runtime
+
+#endif
@@ -0,0 +1,159 @@
+#include <block_cache.hpp>
+#include <opcode_enum.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using Instruction_t = VMPilot::Common::Instruction_t;
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
+
+namespace {
+// The number of instructions decoded at once while looking for the end of a
+// block. A few instructions past the end may be decoded for nothing.
+constexpr size_t DECODE_STEP = 8;
+
+bool ends_block(uint16_t opcode) noexcept {
+    using VMPilot::Common::Opcode::Enum::ControlTransfer;
+    return opcode >= static_cast<uint16_t>(ControlTransfer::__BEGIN) &&
+           opcode < static_cast<uint16_t>(ControlTransfer::__END);
+}
+
+void wipe(Instruction_t* insts, size_t count) noexcept {
+    volatile uint8_t* p = reinterpret_cast<volatile uint8_t*>(insts);
+    for (size_t i = 0; i < count * sizeof(Instruction_t); ++i)
+        p[i] = 0;
+}
+
+// Wipe the first count decoded instructions however the decoding ends, a
+// throwing Decode may have written plain text before the faulty instruction
+struct WipeGuard {
+    Instruction_t* insts;
+    size_t count = 0;
+    ~WipeGuard() { wipe(insts, count); }
+};
+}  // namespace
+
+VMPilot::Runtime::BlockCache::BlockCache(Decoder& decoder,
+                                         VMPilot::Common::ByteView region,
+                                         uint64_t region_addr, Options options)
+    : decoder_(decoder),
+      region_(region),
+      region_addr_(region_addr),
+      options_(options),
+      scratch_(std::max<size_t>(options.max_block_size, 1)) {
+    if (region.size() % ENCODED_INSTRUCTION_SIZE != 0)
+        throw std::runtime_error("Invalid data size");
+    options_.max_block_size = scratch_.size();
+    // The decoding buffer is held as long as the cache
+    memory_ = scratch_.capacity() * sizeof(Instruction_t);
+}
+
+VMPilot::Runtime::BlockCache::~BlockCache() {
+    Clear();
+}
+
+const VMPilot::Runtime::Program& VMPilot::Runtime::BlockCache::Get(
+    size_t offset) {
+    const auto it = index_.find(offset);
+    if (it != index_.end()) {
+        ++stats_.hits;
+        blocks_.splice(blocks_.begin(), blocks_, it->second);
+        return it->second->program;
+    }
+
+    ++stats_.misses;
+    blocks_.push_front(Block{offset, decode_block(offset)});
+    index_.emplace(offset, blocks_.begin());
+    memory_ += block_memory(blocks_.front().program);
+
+    while (memory_ > options_.memory_cap && blocks_.size() > 1)
+        evict_one();
+
+    return blocks_.front().program;
+}
+
+uint64_t VMPilot::Runtime::BlockCache::Run(VM& vm, size_t entry_offset) {
+    if (entry_offset % ENCODED_INSTRUCTION_SIZE != 0)
+        throw std::runtime_error("Invalid block offset");
+
+    const uint64_t end = region_.size() / ENCODED_INSTRUCTION_SIZE;
+    uint64_t next = entry_offset / ENCODED_INSTRUCTION_SIZE;
+
+    while (next != end) {
+        if (next > end)
+            throw std::runtime_error("Branch out of the region");
+
+        const auto& program = Get(next * ENCODED_INSTRUCTION_SIZE);
+        const auto exit = vm.Execute(program, next);
+        if (exit.reason == VM::Exit::Reason::Halt)
+            break;
+        next = exit.target;
+    }
+    return vm.GetRegister(0);
+}
+
+void VMPilot::Runtime::BlockCache::Clear() noexcept {
+    while (!blocks_.empty())
+        evict_one();
+}
+
+VMPilot::Runtime::Program VMPilot::Runtime::BlockCache::decode_block(
+    size_t offset) {
+    if (offset % ENCODED_INSTRUCTION_SIZE != 0 || offset >= region_.size())
+        throw std::runtime_error("Invalid block offset");
+
+    const uint64_t first_index = offset / ENCODED_INSTRUCTION_SIZE;
+    const size_t limit =
+        std::min(options_.max_block_size,
+                 (region_.size() - offset) / ENCODED_INSTRUCTION_SIZE);
+
+    // The Program holds everything it needs, the plain text copy is dropped
+    // when it is prepared, or when decoding or preparing it fails
+    WipeGuard guard{scratch_.data()};
+
+    // Decode a few instructions at a time until the first control transfer
+    size_t decoded = 0;
+    size_t count = 0;
+    while (count == 0 && decoded < limit) {
+        const size_t n = std::min(DECODE_STEP, limit - decoded);
+        const auto* data =
+            region_.data() + offset + decoded * ENCODED_INSTRUCTION_SIZE;
+        auto* out = reinterpret_cast<uint8_t*>(scratch_.data() + decoded);
+        guard.count = decoded + n;
+        decoder_.Decode(data, n * ENCODED_INSTRUCTION_SIZE, out,
+                        region_addr_, first_index + decoded);
+
+        for (size_t i = decoded; i < decoded + n; ++i) {
+            if (ends_block(scratch_[i].opcode)) {
+                count = i + 1;
+                break;
+            }
+        }
+        decoded += n;
+    }
+    if (count == 0)
+        count = decoded;
+
+    return Program(scratch_.data(), count, first_index);
+}
+
+size_t VMPilot::Runtime::BlockCache::block_memory(
+    const Program& program) noexcept {
+    // The LRU list node (the Block and two links), and the index node (the
+    // offset, the list iterator, a link and the cached hash) with its bucket
+    constexpr size_t OVERHEAD =
+        sizeof(Block) + 2 * sizeof(void*) + sizeof(size_t) +
+        sizeof(std::list<Block>::iterator) + 2 * sizeof(void*) +
+        sizeof(size_t);
+    return program.MemoryUsage() + OVERHEAD;
+}
+
+void VMPilot::Runtime::BlockCache::evict_one() noexcept {
+    auto& block = blocks_.back();
+    if (options_.wipe_evicted)
+        block.program.Wipe();
+    memory_ -= block_memory(block.program);
+    index_.erase(block.offset);
+    blocks_.pop_back();
+    ++stats_.evictions;
+}
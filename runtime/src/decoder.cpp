@@ -2,71 +2,116 @@
 #include <instruction_t.hpp>
 #include <opcode_table.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <exception>
 #include <stdexcept>
-#include <unordered_map>
 
 using Instruction_t = VMPilot::Common::Instruction_t;
-using Opcode_table_t = VMPilot::Common::Opcode_table;
-
-namespace detail {
-Instruction_t Fetch(const std::vector<uint8_t>& data, size_t offset) noexcept;
-
-std::unique_ptr<VMPilot::Common::Opcode_table_generator> OTgen_(nullptr);
-}  // namespace detail
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
 
 VMPilot::Runtime::Decoder& VMPilot::Runtime::Decoder::GetInstance() noexcept {
     static Decoder instance;
     return instance;
 }
 
-void VMPilot::Runtime::Decoder::Init(const std::string& key) {
-    key_ = key;
+void VMPilot::Runtime::Decoder::Init(
+    const std::string& key, VMPilot::Common::ChecksumVersion checksum_version,
+    VMPilot::Common::CipherVersion cipher_version) {
+    // Compose OID -> OI -> RealOpcode once, the generator is released here
+    opcode_table_ = VMPilot::Common::Opcode_table_generator(key).GenerateFlat();
+
+    // Expand the AES-256 key schedule once here, rather than per instruction
+    cipher_ = std::make_unique<VMPilot::Common::InstructionCipher>(key);
 
-    // Initialize the opcode table generator
-    detail::OTgen_ =
-        std::make_unique<VMPilot::Common::Opcode_table_generator>(key_);
-    decode_table_ = std::make_unique<VMPilot::Common::Opcode_table>(
-        detail::OTgen_->Generate());
+    checksum_version_ = checksum_version;
+    cipher_version_ = cipher_version;
+
+    // Pad the key once, Instruction::decrypt only copies other sizes
+    legacy_key_.clear();
+    if (cipher_version == VMPilot::Common::CipherVersion::V1) {
+        legacy_key_ = key;
+        legacy_key_.resize(32, 0);
+    }
 }
 
 std::vector<uint8_t> VMPilot::Runtime::Decoder::Decode(
-    const std::vector<uint8_t>& data) {
-    if (data.size() % sizeof(Instruction_t) != 0)
-        throw std::runtime_error("Invalid data size");
-
+    const std::vector<uint8_t>& data, uint64_t region) {
     std::vector<uint8_t> result;
+    DecodeInto(data, region, result);
+    return result;
+}
 
-    // Loop over the data, each iteration decode one instruction
-    for (size_t i = 0; i < data.size(); i += sizeof(Instruction_t)) {
-        Instruction_t inst = detail::Fetch(data, i);
-        VMPilot::Common::Instruction inst_helper;
-
-        // Check if the instruction is valid
-        if (!inst_helper.check(inst))
-            throw std::runtime_error("Invalid instruction");
+void VMPilot::Runtime::Decoder::DecodeInto(VMPilot::Common::ByteView data,
+                                           uint64_t region,
+                                           std::vector<uint8_t>& reuse) {
+    if (data.size() % ENCODED_INSTRUCTION_SIZE != 0)
+        throw std::runtime_error("Invalid data size");
 
-        // Decrypt the instruction
-        inst_helper.decrypt(inst, key_);
+    reuse.resize(DecodedSize(data.size()));
+    Decode(data.data(), data.size(), reuse.data(), region);
+}
 
-        // Find the real opcode
-        const auto& OID = inst.opcode;
-        const auto& OI = detail::OTgen_->GetOpcodeIndex(OID);
-        inst.opcode = decode_table_->find(OI);
+void VMPilot::Runtime::Decoder::Decode(const uint8_t* data, size_t size,
+                                       uint8_t* out, uint64_t region,
+                                       uint64_t first_index) {
+    if (size % ENCODED_INSTRUCTION_SIZE != 0)
+        throw std::runtime_error("Invalid data size");
+    if (cipher_ == nullptr)
+        throw std::runtime_error("Decoder is not initialized");
+
+    VMPilot::Common::Instruction inst_helper;
+
+    // Decode in batches, so the cipher works on many independent
+    // instructions per call and the batch stays in the L1 cache.
+    constexpr size_t BATCH_SIZE = 64;
+    Instruction_t batch[BATCH_SIZE];
+
+    const size_t count = size / ENCODED_INSTRUCTION_SIZE;
+    for (size_t base = 0; base < count; base += BATCH_SIZE) {
+        const size_t n = std::min(BATCH_SIZE, count - base);
+
+        // Fetch and check if the instructions are valid
+        for (size_t i = 0; i < n; ++i) {
+            const auto* encoded = data + (base + i) * ENCODED_INSTRUCTION_SIZE;
+            batch[i] = detail::Fetch(encoded);
+            if (!inst_helper.check(batch[i], checksum_version_))
+                throw std::runtime_error("Invalid instruction");
+        }
+
+        // Decrypt the whole batch
+        if (cipher_version_ == VMPilot::Common::CipherVersion::V1) {
+            for (size_t i = 0; i < n; ++i)
+                inst_helper.decrypt(batch[i], legacy_key_, checksum_version_);
+        } else {
+            cipher_->Decrypt(batch, n, region, first_index + base);
+        }
+
+        // Find the real opcodes, an unknown OID yields 0 and is reported
+        // once for the whole batch
+        bool invalid = false;
+        for (size_t i = 0; i < n; ++i) {
+            auto& inst = batch[i];
+            inst.opcode = opcode_table_.lookup(inst.opcode);
+            invalid |= inst.opcode == 0;
+        }
+        if (invalid)
+            throw std::runtime_error("Invalid instruction");
 
-        inst_helper.update_checksum(inst);
+        for (size_t i = 0; i < n; ++i)
+            inst_helper.update_checksum(batch[i], checksum_version_);
 
-        // Append the decrypted instruction to the result
-        const auto flattened_inst = inst_helper.flatten(inst);
-        result.insert(result.end(), flattened_inst.begin(),
-                      flattened_inst.end());
+        // Write the decrypted instructions in place
+        ::memcpy(out + base * sizeof(Instruction_t), batch,
+                 n * sizeof(Instruction_t));
     }
+}
 
-    return result;
+size_t VMPilot::Runtime::Decoder::DecodedSize(size_t encoded_size) noexcept {
+    return encoded_size / ENCODED_INSTRUCTION_SIZE * sizeof(Instruction_t);
 }
 
-Instruction_t detail::Fetch(const std::vector<uint8_t>& data,
-                            size_t offset) noexcept {
+Instruction_t VMPilot::Runtime::detail::Fetch(const uint8_t* data) noexcept {
 
     // Using alias of the type of the instruction's members
     using Opcode_t = decltype(Instruction_t::opcode);
@@ -75,30 +120,29 @@ Instruction_t detail::Fetch(const std::vector<uint8_t>& data,
     using Nounce_t = decltype(Instruction_t::nounce);
     using Checksum_t = decltype(Instruction_t::checksum);
 
-    Instruction_t inst;
-    inst.opcode =
-        static_cast<Opcode_t>(data[offset + 0] << 8 | data[offset + 1]);
-    inst.left_operand = static_cast<Left_operand_t>(data[offset + 2]) << 56 |
-                        static_cast<Left_operand_t>(data[offset + 3]) << 48 |
-                        static_cast<Left_operand_t>(data[offset + 4]) << 40 |
-                        static_cast<Left_operand_t>(data[offset + 5]) << 32 |
-                        static_cast<Left_operand_t>(data[offset + 6]) << 24 |
-                        static_cast<Left_operand_t>(data[offset + 7]) << 16 |
-                        static_cast<Left_operand_t>(data[offset + 8]) << 8 |
-                        static_cast<Left_operand_t>(data[offset + 9]);
-    inst.right_operand = static_cast<Right_operand_t>(data[offset + 10]) << 56 |
-                         static_cast<Right_operand_t>(data[offset + 11]) << 48 |
-                         static_cast<Right_operand_t>(data[offset + 12]) << 40 |
-                         static_cast<Right_operand_t>(data[offset + 13]) << 32 |
-                         static_cast<Right_operand_t>(data[offset + 14]) << 24 |
-                         static_cast<Right_operand_t>(data[offset + 15]) << 16 |
-                         static_cast<Right_operand_t>(data[offset + 16]) << 8 |
-                         static_cast<Right_operand_t>(data[offset + 17]);
-    inst.nounce = static_cast<Nounce_t>(data[offset + 18]) << 24 |
-                  static_cast<Nounce_t>(data[offset + 19]) << 16 |
-                  static_cast<Nounce_t>(data[offset + 20]) << 8 |
-                  static_cast<Nounce_t>(data[offset + 21]);
-    inst.checksum = static_cast<Checksum_t>(data[offset + 22]) << 8 |
-                    static_cast<Checksum_t>(data[offset + 23]);
+    Instruction_t inst{};
+    inst.opcode = static_cast<Opcode_t>(data[0] << 8 | data[1]);
+    inst.left_operand = static_cast<Left_operand_t>(data[2]) << 56 |
+                        static_cast<Left_operand_t>(data[3]) << 48 |
+                        static_cast<Left_operand_t>(data[4]) << 40 |
+                        static_cast<Left_operand_t>(data[5]) << 32 |
+                        static_cast<Left_operand_t>(data[6]) << 24 |
+                        static_cast<Left_operand_t>(data[7]) << 16 |
+                        static_cast<Left_operand_t>(data[8]) << 8 |
+                        static_cast<Left_operand_t>(data[9]);
+    inst.right_operand = static_cast<Right_operand_t>(data[10]) << 56 |
+                         static_cast<Right_operand_t>(data[11]) << 48 |
+                         static_cast<Right_operand_t>(data[12]) << 40 |
+                         static_cast<Right_operand_t>(data[13]) << 32 |
+                         static_cast<Right_operand_t>(data[14]) << 24 |
+                         static_cast<Right_operand_t>(data[15]) << 16 |
+                         static_cast<Right_operand_t>(data[16]) << 8 |
+                         static_cast<Right_operand_t>(data[17]);
+    inst.nounce = static_cast<Nounce_t>(data[18]) << 24 |
+                  static_cast<Nounce_t>(data[19]) << 16 |
+                  static_cast<Nounce_t>(data[20]) << 8 |
+                  static_cast<Nounce_t>(data[21]);
+    inst.checksum = static_cast<Checksum_t>(data[22]) << 8 |
+                    static_cast<Checksum_t>(data[23]);
     return inst;
-}
\ No newline at end of file
+}
@@ -0,0 +1,465 @@
+#include <opcode_enum.hpp>
+#include <vm.hpp>
+#include <vm_operand.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+using Instruction_t = VMPilot::Common::Instruction_t;
+using Op = VMPilot::Runtime::detail::Op;
+namespace Operand = VMPilot::Common::Operand;
+
+namespace {
+// The handlers of the dispatch loop, in the order of its label table
+enum Handler : uint8_t {
+    H_MOV,
+    H_PUSH,
+    H_POP,
+    H_LOAD,
+    H_STORE,
+    H_LOAD_ADD_STORE,
+    H_ADD,
+    H_SUB,
+    H_MUL,
+    H_DIV,
+    H_AND,
+    H_OR,
+    H_XOR,
+    H_CMP,
+    H_JMP,
+    H_JZ,
+    H_JNZ,
+    H_CALL,
+    H_RET,
+    H_CMP_JZ,
+    H_CMP_JNZ,
+    H_LOCK,
+    H_XCHG,
+    H_CMPXCHG,
+    H_LOCK_ADD,
+    H_LOCK_SUB,
+    H_FENCE,
+    H_END,  // Past the last instruction of the program
+};
+
+// What the payload of the left operand of a superinstruction holds
+enum class Payload : uint8_t {
+    None,
+    Operand,  // An operand, see Operand::ToPayload
+    Target,   // A jump target
+};
+
+struct HandlerInfo {
+    uint16_t opcode;
+    Handler handler;
+    bool lhs_must_be_reg;  // The left operand is written or packed
+    Payload payload;
+};
+
+template <typename Enum>
+constexpr HandlerInfo info(Enum opcode, Handler handler, bool lhs_must_be_reg,
+                           Payload payload = Payload::None) {
+    return {static_cast<uint16_t>(opcode), handler, lhs_must_be_reg, payload};
+}
+
+using namespace VMPilot::Common::Opcode::Enum;
+
+// JE/JNE are the same as JZ/JNZ, CMP sets the zero flag on equality
+constexpr HandlerInfo HANDLERS[] = {
+    info(DataMovement::MOV, H_MOV, true),
+    info(DataMovement::PUSH, H_PUSH, false),
+    info(DataMovement::POP, H_POP, true),
+    info(DataMovement::LOAD, H_LOAD, true),
+    info(DataMovement::STORE, H_STORE, false),
+    info(DataMovement::LOAD_ADD_STORE, H_LOAD_ADD_STORE, true,
+         Payload::Operand),
+    info(ArithmeticLogic::ADD, H_ADD, true),
+    info(ArithmeticLogic::SUB, H_SUB, true),
+    info(ArithmeticLogic::MUL, H_MUL, true),
+    info(ArithmeticLogic::DIV, H_DIV, true),
+    info(ArithmeticLogic::AND, H_AND, true),
+    info(ArithmeticLogic::OR, H_OR, true),
+    info(ArithmeticLogic::XOR, H_XOR, true),
+    info(ArithmeticLogic::CMP, H_CMP, false),
+    info(ControlTransfer::JMP, H_JMP, false),
+    info(ControlTransfer::JZ, H_JZ, false),
+    info(ControlTransfer::JNZ, H_JNZ, false),
+    info(ControlTransfer::JE, H_JZ, false),
+    info(ControlTransfer::JNE, H_JNZ, false),
+    info(ControlTransfer::CALL, H_CALL, false),
+    info(ControlTransfer::RET, H_RET, false),
+    info(ControlTransfer::CMP_JZ, H_CMP_JZ, true, Payload::Target),
+    info(ControlTransfer::CMP_JNZ, H_CMP_JNZ, true, Payload::Target),
+    info(ThreadingAtomic::LOCK, H_LOCK, false),
+    info(ThreadingAtomic::XCHG, H_XCHG, true),
+    info(ThreadingAtomic::CMPXCHG, H_CMPXCHG, false),
+    info(ThreadingAtomic::LOCK_ADD, H_LOCK_ADD, false),
+    info(ThreadingAtomic::LOCK_SUB, H_LOCK_SUB, false),
+    info(ThreadingAtomic::FENCE, H_FENCE, false),
+};
+
+const HandlerInfo& get_handler(uint16_t opcode) {
+    for (const auto& handler : HANDLERS) {
+        if (handler.opcode == opcode)
+            return handler;
+    }
+    throw std::runtime_error("Invalid opcode");
+}
+
+uint8_t* memory_at(uint8_t* memory, size_t size, uint64_t addr) {
+    if (size < sizeof(uint64_t) || addr > size - sizeof(uint64_t))
+        throw std::runtime_error("Memory access out of range");
+    return memory + addr;
+}
+
+std::atomic<uint64_t>* atomic_at(uint8_t* memory, size_t size,
+                                 uint64_t addr) {
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) &&
+                      std::atomic<uint64_t>::is_always_lock_free,
+                  "The atomic instructions need a lock-free 64-bit atomic");
+    auto* ptr = memory_at(memory, size, addr);
+    if (reinterpret_cast<uintptr_t>(ptr) % alignof(std::atomic<uint64_t>))
+        throw std::runtime_error("Misaligned atomic memory access");
+    return reinterpret_cast<std::atomic<uint64_t>*>(ptr);
+}
+}  // namespace
+
+VMPilot::Runtime::Program::Program(const Instruction_t* insts, size_t count,
+                                   uint64_t base)
+    : base_(base) {
+    code_.reserve(count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& inst = insts[i];
+        const auto& info = get_handler(inst.opcode);
+
+        Op op{};
+        op.handler = info.handler;
+        op.lhs_is_reg = Operand::IsRegister(inst.left_operand);
+        op.rhs_is_reg = Operand::IsRegister(inst.right_operand);
+        op.lhs = op.lhs_is_reg ? Operand::RegisterIndex(inst.left_operand)
+                               : Operand::ImmediateValue(inst.left_operand);
+        op.rhs = op.rhs_is_reg ? Operand::RegisterIndex(inst.right_operand)
+                               : Operand::ImmediateValue(inst.right_operand);
+
+        if (info.lhs_must_be_reg && !op.lhs_is_reg)
+            throw std::runtime_error("Invalid operand");
+
+        if (info.payload == Payload::Operand) {
+            const auto aux =
+                Operand::FromPayload(Operand::Payload(inst.left_operand));
+            op.aux_is_reg = Operand::IsRegister(aux);
+            op.aux = op.aux_is_reg ? Operand::RegisterIndex(aux)
+                                   : Operand::ImmediateValue(aux);
+        } else if (info.payload == Payload::Target) {
+            op.aux = Operand::Payload(inst.left_operand);
+        }
+
+        code_.push_back(op);
+    }
+
+    Op end{};
+    end.handler = H_END;
+    code_.push_back(end);
+}
+
+void VMPilot::Runtime::Program::Wipe() noexcept {
+    // Through a volatile pointer, so the stores are not elided
+    volatile uint8_t* p = reinterpret_cast<volatile uint8_t*>(code_.data());
+    for (size_t i = 0; i < code_.size() * sizeof(Op); ++i)
+        p[i] = 0;
+}
+
+VMPilot::Runtime::VM::VM() : stack_(STACK_SIZE) {}
+
+void VMPilot::Runtime::VM::Reset() noexcept {
+    regs_.fill(0);
+    sp_ = 0;
+    call_depth_ = 0;
+    zf_ = false;
+}
+
+uint64_t VMPilot::Runtime::VM::Run(const Program& program) {
+    if (program.size() == 0)
+        return regs_[0];
+
+    const auto exit = Execute(program, program.base());
+    if (exit.reason == Exit::Reason::Branch &&
+        exit.target != program.base() + program.size())
+        throw std::runtime_error("Branch out of the program");
+    return regs_[0];
+}
+
+// VMPILOT_SWITCH_DISPATCH forces the portable switch, so that both
+// dispatches can be tested with one compiler
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(VMPILOT_SWITCH_DISPATCH)
+#define VMPILOT_COMPUTED_GOTO
+// Labels as values are a GNU extension
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wgnu-label-as-value"
+#endif
+#endif
+
+VMPilot::Runtime::VM::Exit VMPilot::Runtime::VM::Execute(
+    const Program& program, uint64_t entry) {
+    const Op* const code = program.code_.data();
+    const uint64_t base = program.base_;
+    const uint64_t size = program.size();
+
+    if (entry - base >= size)
+        throw std::runtime_error("Entry is out of the program");
+
+    const Op* op = code + (entry - base);
+    uint64_t* const regs = regs_.data();
+    uint64_t* const stack = stack_.data();
+    size_t sp = sp_;
+    bool zf = zf_;
+
+// The value of an operand, and the register written by the left one
+#define LHS (op->lhs_is_reg ? regs[op->lhs] : op->lhs)
+#define RHS (op->rhs_is_reg ? regs[op->rhs] : op->rhs)
+#define AUX (op->aux_is_reg ? regs[op->aux] : op->aux)
+#define DST regs[op->lhs]
+
+#define LEAVE(why, where)                        \
+    do {                                         \
+        sp_ = sp;                                \
+        zf_ = zf;                                \
+        return Exit{Exit::Reason::why, (where)}; \
+    } while (0)
+
+#ifdef VMPILOT_COMPUTED_GOTO
+#define HANDLER(name) L_##name:
+#define DISPATCH() goto* labels[op->handler]
+#else
+#define HANDLER(name) case H_##name:
+#define DISPATCH() continue
+#endif
+
+// NEXT and BRANCH are plain blocks rather than do/while(0), so that the
+// continue of the switch dispatch reaches the loop
+#define NEXT()      \
+    {               \
+        ++op;       \
+        DISPATCH(); \
+    }
+
+// Go to the instruction at index target of the region, or leave the program
+#define BRANCH(target)                     \
+    {                                      \
+        const uint64_t target_ = (target); \
+        if (target_ - base >= size)        \
+            LEAVE(Branch, target_);        \
+        op = code + (target_ - base);      \
+        DISPATCH();                        \
+    }
+
+#define PUSH(value)                                        \
+    do {                                                   \
+        if (sp == STACK_SIZE)                              \
+            throw std::runtime_error("VM stack overflow"); \
+        stack[sp++] = (value);                             \
+    } while (0)
+
+#define POP(into)                                           \
+    do {                                                    \
+        if (sp == 0)                                        \
+            throw std::runtime_error("VM stack underflow"); \
+        (into) = stack[--sp];                               \
+    } while (0)
+
+    // The state is kept in locals while running, and written back when the
+    // program is left, by LEAVE or by a fault below
+    try {
+#ifdef VMPILOT_COMPUTED_GOTO
+        static const void* const labels[] = {
+            &&L_MOV, &&L_PUSH, &&L_POP, &&L_LOAD, &&L_STORE, &&L_LOAD_ADD_STORE,
+            &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV, &&L_AND, &&L_OR, &&L_XOR,
+            &&L_CMP, &&L_JMP, &&L_JZ, &&L_JNZ, &&L_CALL, &&L_RET, &&L_CMP_JZ,
+            &&L_CMP_JNZ, &&L_LOCK, &&L_XCHG, &&L_CMPXCHG, &&L_LOCK_ADD,
+            &&L_LOCK_SUB, &&L_FENCE, &&L_END,
+        };
+        static_assert(sizeof(labels) / sizeof(labels[0]) == H_END + 1);
+
+        DISPATCH();
+#else
+        for (;;) {
+            switch (op->handler) {
+#endif
+
+        // Data movement
+        HANDLER(MOV) {
+            DST = RHS;
+            NEXT();
+        }
+        HANDLER(PUSH) {
+            PUSH(LHS);
+            NEXT();
+        }
+        HANDLER(POP) {
+            POP(DST);
+            NEXT();
+        }
+        HANDLER(LOAD) {
+            ::memcpy(&DST, memory_at(memory_, memory_size_, RHS),
+                     sizeof(uint64_t));
+            NEXT();
+        }
+        HANDLER(STORE) {
+            const uint64_t value = RHS;
+            ::memcpy(memory_at(memory_, memory_size_, LHS), &value,
+                     sizeof(uint64_t));
+            NEXT();
+        }
+
+        HANDLER(LOAD_ADD_STORE) {
+            // The address is read once, the peephole pass does not fuse when
+            // the loaded register is also the address register
+            auto* slot = memory_at(memory_, memory_size_, AUX);
+            ::memcpy(&DST, slot, sizeof(uint64_t));
+            zf = (DST += RHS) == 0;
+            ::memcpy(slot, &DST, sizeof(uint64_t));
+            NEXT();
+        }
+
+        // Arithmetic and logic, the zero flag follows the result
+        HANDLER(ADD) {
+            zf = (DST += RHS) == 0;
+            NEXT();
+        }
+        HANDLER(SUB) {
+            zf = (DST -= RHS) == 0;
+            NEXT();
+        }
+        HANDLER(MUL) {
+            zf = (DST *= RHS) == 0;
+            NEXT();
+        }
+        HANDLER(DIV) {
+            const uint64_t divisor = RHS;
+            if (divisor == 0)
+                throw std::runtime_error("VM division by zero");
+            zf = (DST /= divisor) == 0;
+            NEXT();
+        }
+        HANDLER(AND) {
+            zf = (DST &= RHS) == 0;
+            NEXT();
+        }
+        HANDLER(OR) {
+            zf = (DST |= RHS) == 0;
+            NEXT();
+        }
+        HANDLER(XOR) {
+            zf = (DST ^= RHS) == 0;
+            NEXT();
+        }
+        HANDLER(CMP) {
+            zf = LHS == RHS;
+            NEXT();
+        }
+
+        // Control transfer
+        HANDLER(JMP) {
+            BRANCH(LHS);
+        }
+        HANDLER(JZ) {
+            if (zf)
+                BRANCH(LHS)
+            NEXT();
+        }
+        HANDLER(JNZ) {
+            if (!zf)
+                BRANCH(LHS)
+            NEXT();
+        }
+        HANDLER(CALL) {
+            PUSH(base + static_cast<uint64_t>(op - code) + 1);
+            ++call_depth_;
+            BRANCH(LHS);
+        }
+        HANDLER(RET) {
+            if (call_depth_ == 0)
+                LEAVE(Halt, 0);
+            --call_depth_;
+            uint64_t target;
+            POP(target);
+            BRANCH(target);
+        }
+
+        HANDLER(CMP_JZ) {
+            zf = LHS == RHS;
+            if (zf)
+                BRANCH(op->aux)
+            NEXT();
+        }
+        HANDLER(CMP_JNZ) {
+            zf = LHS == RHS;
+            if (!zf)
+                BRANCH(op->aux)
+            NEXT();
+        }
+
+        // Threading and atomic. Every VM memory access that has to be atomic
+        // already is, so LOCK only keeps the lifted code one-to-one.
+        HANDLER(LOCK) {
+            NEXT();
+        }
+        HANDLER(XCHG) {
+            DST = atomic_at(memory_, memory_size_, RHS)->exchange(DST);
+            NEXT();
+        }
+        HANDLER(CMPXCHG) {
+            // The expected value is in R0 and gets the old value, like x86
+            zf = atomic_at(memory_, memory_size_, LHS)
+                     ->compare_exchange_strong(regs[0], RHS);
+            NEXT();
+        }
+        HANDLER(LOCK_ADD) {
+            atomic_at(memory_, memory_size_, LHS)->fetch_add(RHS);
+            NEXT();
+        }
+        HANDLER(LOCK_SUB) {
+            atomic_at(memory_, memory_size_, LHS)->fetch_sub(RHS);
+            NEXT();
+        }
+        HANDLER(FENCE) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            NEXT();
+        }
+
+        HANDLER(END) {
+            LEAVE(Branch, base + size);
+        }
+
+#ifndef VMPILOT_COMPUTED_GOTO
+                default:
+                    throw std::runtime_error("Invalid handler");
+            }
+        }
+#endif
+    } catch (...) {
+        sp_ = sp;
+        zf_ = zf;
+        throw;
+    }
+
+#undef LHS
+#undef RHS
+#undef AUX
+#undef DST
+#undef LEAVE
+#undef HANDLER
+#undef DISPATCH
+#undef NEXT
+#undef BRANCH
+#undef PUSH
+#undef POP
+}
+
+#ifdef VMPILOT_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,111 @@
+#ifndef __SDK_BATCH_DRIVER_HPP__
+#define __SDK_BATCH_DRIVER_HPP__
+
+#include <BytecodeCompileRecipe.hpp>
+#include <RegionCache.hpp>
+#include <ThreadPool.hpp>
+#include <peephole.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace VMPilot::SDK {
+
+struct BatchOptions {
+    // The worker threads, 0 for the hardware concurrency
+    size_t threads = 0;
+    // The inputs mapped at the same time, 0 for the number of threads. It
+    // bounds the memory of a batch of large binaries.
+    size_t max_inflight_inputs = 0;
+    // The directory of the region cache shared by the batch, empty to
+    // compile every region
+    std::string cache_dir;
+};
+
+struct ProtectStats {
+    size_t regions = 0;
+    // The regions whose bytecode came from the cache
+    size_t cached_regions = 0;
+    // The superinstruction fusion of the compiled regions, the cached ones
+    // are not compiled so they are not counted
+    BytecodeCompiler::FusionStats fusion;
+};
+
+struct BatchResult {
+    std::string input;
+    std::string output;
+    bool success = false;
+    std::string error;  // Empty on success
+    ProtectStats stats;
+};
+
+/**
+ * @brief Protect one binary: parse its metadata, segment it, compile the
+ *        protected regions and write the output.
+ *
+ * The regions are disassembled and compiled on the pool, and their bytecode
+ * is put together in address order, so the output is the same whatever the
+ * number of threads. With a cache, a region whose inputs did not change
+ * since it was stored is neither disassembled nor compiled.
+ *
+ * The output is the input rewritten by Rewriter::ELFRewriter: the code of
+ * every region jumps to its VMPilot_End call, and the bytecode is loaded in
+ * a new .vmpilot section. Only ELF files are supported yet.
+ *
+ * @param recipe The recipe of the binary.
+ * @param pool The pool of the regions, it may be the pool running this
+ *             call. nullptr runs them on the calling thread.
+ * @param cache The region cache, nullptr to compile every region.
+ * @return The number of regions, of those read from the cache, and the
+ *         fusion of the compiled ones.
+ * @throws std::runtime_error if any step fails.
+ */
+ProtectStats Protect(const BytecodeCompileRecipe& recipe,
+                     ThreadPool* pool = nullptr,
+                     const RegionCache* cache = nullptr);
+
+/**
+ * @brief Protect many binaries concurrently on a work-stealing pool.
+ *
+ * Each recipe is an independent job running Protect, whose regions go to
+ * the same pool, so a single large binary also uses every worker. A job maps its input
+ * only once it holds one of the max_inflight_inputs slots, and releases the
+ * slot when it is done, so at most that many inputs are in memory at once.
+ *
+ * @param recipes The recipes, one per binary.
+ * @param options The batch options.
+ * @return The results, in the order of the recipes.
+ * @throws std::runtime_error if the cache directory cannot be created.
+ */
+std::vector<BatchResult> ProtectBatch(
+    const std::vector<BytecodeCompileRecipe>& recipes,
+    const BatchOptions& options = BatchOptions());
+
+/**
+ * @brief The job of a recipe, with the signature of Protect.
+ */
+using BatchJob = std::function<ProtectStats(
+    const BytecodeCompileRecipe&, ThreadPool*, const RegionCache*)>;
+
+/**
+ * @brief ProtectBatch with another job than Protect, scheduled the same
+ *        way: the job of a recipe only runs while it holds an in-flight
+ *        slot. The tests check the scheduling with it.
+ */
+std::vector<BatchResult> ProtectBatch(
+    const std::vector<BytecodeCompileRecipe>& recipes,
+    const BatchOptions& options, const BatchJob& job);
+
+/**
+ * @brief Load the recipes of a JSON file, holding one recipe or an array.
+ *
+ * @throws std::runtime_error if the file cannot be read or a recipe is
+ *         invalid.
+ */
+std::vector<BytecodeCompileRecipe> LoadRecipes(const std::string& filename);
+
+}  // namespace VMPilot::SDK
+
+#endif  // __SDK_BATCH_DRIVER_HPP__
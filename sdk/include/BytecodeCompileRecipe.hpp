@@ -1,6 +1,8 @@
 #ifndef __SDK_BytecodeCompileRecipe_HPP__
 #define __SDK_BytecodeCompileRecipe_HPP__
 
+#include <string>
+
 #include <nlohmann/json.hpp>
 
 namespace VMPilot::SDK {
@@ -23,6 +25,26 @@ class BytecodeCompileRecipe {
      * @param script The script to compile.
      */
     BytecodeCompileRecipe(nlohmann::json script) : script(script) { check(); }
+
+    /**
+     * @brief Get the master key of the protection.
+     */
+    std::string GetMasterKey() const { return script["master_key"]; }
+
+    /**
+     * @brief Get the filename of the binary to protect.
+     */
+    std::string GetInput() const { return script["input"]; }
+
+    /**
+     * @brief Get the filename of the protected binary.
+     */
+    std::string GetOutput() const { return script["output"]; }
+
+    /**
+     * @brief Get the whole script, for the optional settings.
+     */
+    const nlohmann::json& GetScript() const noexcept { return script; }
 };
 }  // namespace VMPilot::SDK
 
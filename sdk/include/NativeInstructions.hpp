@@ -0,0 +1,157 @@
+#ifndef __SDK_NATIVE_INSTRUCTIONS_HPP__
+#define __SDK_NATIVE_INSTRUCTIONS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VMPilot::SDK {
+
+enum class OperandKind : uint8_t {
+    Invalid = 0,
+    Register,
+    Immediate,
+    Memory,
+};
+
+/**
+ * @brief One operand of a NativeInstructions entry, in 16 bytes.
+ *
+ * The register ids are the ones of the disassembler (capstone), 0 is no
+ * register.
+ */
+struct NativeOperand {
+    // The immediate, or the displacement of a memory operand
+    int64_t value = 0;
+    // The register, or the base register of a memory operand
+    uint16_t reg = 0;
+    // The index and the segment registers of a memory operand
+    uint16_t index = 0;
+    uint16_t segment = 0;
+    // The size of the access, in bytes
+    uint8_t size = 0;
+    // kind: OperandKind, access: READ | WRITE, scale: of the index (1 to 8)
+    uint8_t kind : 2;
+    uint8_t access : 2;
+    uint8_t scale : 4;
+
+    static constexpr uint8_t READ = 1;
+    static constexpr uint8_t WRITE = 2;
+
+    NativeOperand() : kind(0), access(0), scale(0) {}
+
+    [[nodiscard]] OperandKind Kind() const noexcept {
+        return static_cast<OperandKind>(kind);
+    }
+};
+static_assert(sizeof(NativeOperand) == 16, "NativeOperand must stay compact");
+
+/**
+ * @brief The disassembled instructions of a region, as a struct of arrays.
+ *
+ * Only what the compiler needs is kept: the address, the length, the
+ * disassembler's instruction id, a few group flags and the operands, about
+ * 16 bytes per instruction and 16 per operand. The operands of all the
+ * instructions share one pool. Nothing is allocated per instruction, so a
+ * region of any size is a handful of vectors.
+ */
+class NativeInstructions {
+   public:
+    // The group flags of an instruction
+    static constexpr uint8_t JUMP = 1 << 0;
+    static constexpr uint8_t CALL = 1 << 1;
+    static constexpr uint8_t RET = 1 << 2;
+    static constexpr uint8_t INTERRUPT = 1 << 3;
+    // A jump or a call whose target is relative to the instruction
+    static constexpr uint8_t RELATIVE = 1 << 4;
+
+    /**
+     * @brief A range of the operand pool, valid until the next change.
+     */
+    struct Operands {
+        const NativeOperand* data;
+        size_t count;
+
+        const NativeOperand* begin() const noexcept { return data; }
+        const NativeOperand* end() const noexcept { return data + count; }
+        size_t size() const noexcept { return count; }
+        const NativeOperand& operator[](size_t i) const noexcept {
+            return data[i];
+        }
+    };
+
+    NativeInstructions() { first_operand_.push_back(0); }
+
+    void Reserve(size_t instructions, size_t operands) {
+        addresses_.reserve(instructions);
+        lengths_.reserve(instructions);
+        ids_.reserve(instructions);
+        groups_.reserve(instructions);
+        first_operand_.reserve(instructions + 1);
+        operands_.reserve(operands);
+    }
+
+    void Clear() noexcept {
+        addresses_.clear();
+        lengths_.clear();
+        ids_.clear();
+        groups_.clear();
+        first_operand_.resize(1);
+        operands_.clear();
+    }
+
+    /**
+     * @brief Append an instruction, its operands are copied to the pool.
+     */
+    void Append(uint64_t address, uint8_t length, uint16_t id, uint8_t groups,
+                const NativeOperand* operands, size_t count) {
+        addresses_.push_back(address);
+        lengths_.push_back(length);
+        ids_.push_back(id);
+        groups_.push_back(groups);
+        operands_.insert(operands_.end(), operands, operands + count);
+        first_operand_.push_back(static_cast<uint32_t>(operands_.size()));
+    }
+
+    [[nodiscard]] size_t Size() const noexcept { return addresses_.size(); }
+    [[nodiscard]] bool Empty() const noexcept { return addresses_.empty(); }
+
+    [[nodiscard]] uint64_t Address(size_t i) const noexcept {
+        return addresses_[i];
+    }
+    [[nodiscard]] uint8_t Length(size_t i) const noexcept {
+        return lengths_[i];
+    }
+    [[nodiscard]] uint16_t Id(size_t i) const noexcept { return ids_[i]; }
+    [[nodiscard]] uint8_t Groups(size_t i) const noexcept {
+        return groups_[i];
+    }
+    [[nodiscard]] Operands GetOperands(size_t i) const noexcept {
+        return {operands_.data() + first_operand_[i],
+                first_operand_[i + 1] - first_operand_[i]};
+    }
+
+    // The heap memory held by the arrays
+    [[nodiscard]] size_t MemoryUsage() const noexcept {
+        return addresses_.capacity() * sizeof(uint64_t) +
+               lengths_.capacity() * sizeof(uint8_t) +
+               ids_.capacity() * sizeof(uint16_t) +
+               groups_.capacity() * sizeof(uint8_t) +
+               first_operand_.capacity() * sizeof(uint32_t) +
+               operands_.capacity() * sizeof(NativeOperand);
+    }
+
+   private:
+    std::vector<uint64_t> addresses_;
+    std::vector<uint8_t> lengths_;
+    std::vector<uint16_t> ids_;
+    std::vector<uint8_t> groups_;
+    // The operands of instruction i are [first_operand_[i],
+    // first_operand_[i + 1]) of the pool
+    std::vector<uint32_t> first_operand_;
+    std::vector<NativeOperand> operands_;
+};
+
+}  // namespace VMPilot::SDK
+
+#endif  // __SDK_NATIVE_INSTRUCTIONS_HPP__
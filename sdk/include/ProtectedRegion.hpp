@@ -0,0 +1,35 @@
+#ifndef __SDK_PROTECTED_REGION_HPP__
+#define __SDK_PROTECTED_REGION_HPP__
+
+#include <byte_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VMPilot::SDK {
+
+/**
+ * @brief The code between a VMPilot_Begin call and the matching VMPilot_End
+ *        call, the unit of protection.
+ *
+ * The regions of a file are independent of each other, so they are
+ * disassembled and compiled concurrently, and put back together by index.
+ */
+struct ProtectedRegion {
+    // The position of the region in the file, in address order
+    size_t index = 0;
+    // The first instruction after the VMPilot_Begin call
+    uint64_t begin_addr = 0;
+    // The VMPilot_End call, not part of the region
+    uint64_t end_addr = 0;
+    // The bytes of [begin_addr, end_addr) in the mapped file
+    VMPilot::Common::ByteView code;
+    // The function containing the region, from the symbol table. The size
+    // is 0 if no symbol covers the region, e.g. in a stripped binary.
+    uint64_t function_addr = 0;
+    uint64_t function_size = 0;
+};
+
+}  // namespace VMPilot::SDK
+
+#endif  // __SDK_PROTECTED_REGION_HPP__
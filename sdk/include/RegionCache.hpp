@@ -0,0 +1,90 @@
+#ifndef __SDK_REGION_CACHE_HPP__
+#define __SDK_REGION_CACHE_HPP__
+
+#include <BytecodeCompileRecipe.hpp>
+#include <ProtectedRegion.hpp>
+#include <bytecode_compiler.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace VMPilot::SDK {
+
+/**
+ * @brief An on-disk cache of the bytecode of the protected regions.
+ *
+ * An entry is addressed by the BLAKE3 hash of everything its bytecode
+ * depends on: the compiler and its version, the cipher and checksum versions
+ * of the encoder, the recipe settings (with the master key the region keys
+ * are derived from) and the region itself, its addresses and its bytes. So an entry is never stale, a change of any input
+ * is a different key, and re-protecting a binary only compiles the regions
+ * that changed.
+ *
+ * An entry is written to a temporary file and renamed, so concurrent jobs,
+ * and concurrent processes sharing the directory, see a whole entry or none.
+ * A damaged entry is a miss. The entries are as sensitive as the protected
+ * binaries: they hold the bytecode of the regions.
+ */
+class RegionCache {
+   public:
+    using Key = std::array<uint8_t, 32>;
+
+    /**
+     * @brief Open the cache in directory, created if it does not exist.
+     *
+     * @throws std::runtime_error if the directory cannot be created.
+     */
+    explicit RegionCache(std::filesystem::path directory);
+
+    /**
+     * @brief Hash what the keys of all the regions of a binary share: the
+     *        compiler, its version, the cipher and checksum versions and the
+     *        recipe settings. The input and output filenames are left out,
+     *        they do not change the bytecode.
+     */
+    static Key MakeContext(const BytecodeCompiler::CompilerBase& compiler,
+                           const BytecodeCompileRecipe& recipe);
+
+    /**
+     * @brief The key of a region, under the context of its binary.
+     *
+     * The index of the region is left out, inserting a region does not move
+     * the others. So are the bounds of its enclosing function, which do not
+     * change the bytecode: editing the function around a region does not
+     * invalidate it.
+     */
+    static Key MakeKey(const Key& context, const ProtectedRegion& region);
+
+    /**
+     * @brief Read the bytecode of an entry.
+     *
+     * @return The bytecode, or std::nullopt if there is no valid entry.
+     */
+    std::optional<std::vector<uint8_t>> Load(const Key& key) const noexcept;
+
+    /**
+     * @brief Write the bytecode of an entry. A failure is logged and only
+     *        costs a later recompilation.
+     *
+     * @return true if the entry was written.
+     */
+    bool Store(const Key& key,
+               const std::vector<uint8_t>& bytecode) const noexcept;
+
+    const std::filesystem::path& Directory() const noexcept {
+        return directory_;
+    }
+
+   private:
+    // directory/ab/cdef..., so no directory holds too many entries
+    std::filesystem::path EntryPath(const Key& key) const;
+
+    std::filesystem::path directory_;
+};
+
+}  // namespace VMPilot::SDK
+
+#endif  // __SDK_REGION_CACHE_HPP__
@@ -0,0 +1,135 @@
+#ifndef __SDK_THREAD_POOL_HPP__
+#define __SDK_THREAD_POOL_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VMPilot::SDK {
+
+/**
+ * @brief A work-stealing thread pool.
+ *
+ * Every worker has its own task deque: it runs its own tasks newest first,
+ * and when it runs out it steals the oldest task of another worker. The
+ * tasks submitted by a worker go to its own deque, the others are spread
+ * round-robin. So short and long jobs (a small tool and a 200 MB binary) are
+ * balanced without a single contended queue.
+ */
+class ThreadPool {
+   public:
+    /**
+     * @brief Start the workers.
+     *
+     * @param threads The number of workers, 0 for the hardware concurrency.
+     */
+    explicit ThreadPool(size_t threads = 0);
+
+    /**
+     * @brief Run the tasks still queued, then join the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queue a task.
+     *
+     * An exception escaping the task is logged and dropped.
+     */
+    void Submit(std::function<void()> task);
+
+    /**
+     * @brief Block until every submitted task has finished.
+     *
+     * It must not be called from a task, use RunPendingTask to wait there.
+     */
+    void Wait();
+
+    /**
+     * @brief Run one queued task on the calling thread, if there is one.
+     *
+     * A task waiting for the tasks it submitted calls it in a loop, so the
+     * worker helps instead of blocking.
+     *
+     * @return true if a task was run.
+     */
+    bool RunPendingTask();
+
+    /**
+     * @brief Run body(0) .. body(count - 1) on the pool and wait for them.
+     *
+     * The calling thread runs queued tasks while it waits, so it may be
+     * called from a task: a job of the pool can split its own work without
+     * tying up its worker. The calls may run in any order and concurrently.
+     *
+     * @param count The number of calls.
+     * @param body The function to call, with the index.
+     * @throws The exception of the lowest index that threw, after all the
+     *         calls have finished.
+     */
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    [[nodiscard]] size_t Size() const noexcept { return threads_.size(); }
+
+   private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void worker_loop(size_t index);
+    // Pop from the own deque of index, else steal from the others
+    bool pop_or_steal(size_t index, std::function<void()>& task);
+    void run(std::function<void()>& task) noexcept;
+    // The index of the calling worker of this pool, or Size()
+    size_t current_worker() const noexcept;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;  // A task is queued or the pool stops
+    std::condition_variable idle_;  // pending_ dropped to 0
+    size_t queued_ = 0;             // In the deques
+    size_t pending_ = 0;            // Queued or running
+    size_t next_queue_ = 0;         // Round-robin of the external submits
+    bool stop_ = false;
+};
+
+/**
+ * @brief A counting semaphore, std::counting_semaphore is C++20.
+ */
+class Semaphore {
+   public:
+    explicit Semaphore(size_t count) : count_(count) {}
+
+    void Acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        released_.wait(lock, [this] { return count_ > 0; });
+        --count_;
+    }
+
+    void Release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++count_;
+        }
+        released_.notify_one();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable released_;
+    size_t count_;
+};
+
+}  // namespace VMPilot::SDK
+
+#endif  // __SDK_THREAD_POOL_HPP__
@@ -6,7 +6,13 @@
  */
 
 #include <BytecodeCompileRecipe.hpp>
+#include <NativeInstructions.hpp>
+#include <ProtectedRegion.hpp>
+#include <file_type_parser.hpp>
+#include <peephole.hpp>
+#include <segmentator.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,12 +31,69 @@ class CompilerBase {
      */
     virtual std::vector<uint8_t> Compile(const BytecodeCompileRecipe& script) = 0;
 
+    /**
+     * @brief Compile one protected region into bytecode.
+     *
+     * The regions of a file are compiled concurrently with the same
+     * compiler, so it must not modify the compiler.
+     *
+     * @param script The recipe of the file.
+     * @param region The region.
+     * @param instructions The instructions of the region, disassembled by
+     *                     the segmentator.
+     * @param fusion The superinstruction fusion of the region is added to it.
+     * @return std::vector<uint8_t> The compiled bytecode of the region.
+     */
+    virtual std::vector<uint8_t> CompileRegion(
+        const BytecodeCompileRecipe& script,
+        const VMPilot::SDK::ProtectedRegion& region,
+        const VMPilot::SDK::NativeInstructions& instructions,
+        FusionStats& fusion) const = 0;
+
+    /**
+     * @brief Find the protected regions of a file.
+     *
+     * The first step of CompileRegions and of SDK::Protect.
+     *
+     * @param metadata The metadata of the file, its mapping is reused.
+     * @return The segmentator of the file, after segmentation.
+     * @throws std::runtime_error if the file cannot be segmented.
+     */
+    static std::unique_ptr<VMPilot::SDK::Segmentator::Segmentator> Segment(
+        VMPilot::Common::FileMetadata metadata);
+
+    /**
+     * @brief Disassemble one region of a segmented file, then compile it
+     *        with CompileRegion.
+     *
+     * The step of CompileRegions and of SDK::Protect for each region, the
+     * regions may be compiled concurrently.
+     *
+     * @param fusion The superinstruction fusion of the region is added to
+     *               it, nullptr to drop it.
+     * @throws std::runtime_error if the region cannot be disassembled or
+     *         compiled.
+     */
+    std::vector<uint8_t> DisassembleAndCompile(
+        const BytecodeCompileRecipe& script,
+        VMPilot::SDK::Segmentator::Segmentator& segmentator,
+        const VMPilot::SDK::ProtectedRegion& region,
+        FusionStats* fusion = nullptr) const;
+
     /**
      * @brief Get the name of the compiler.
      *  This is used to identify the compiler in the configuration file.
      */
     inline std::string GetName() const noexcept { return name; }
 
+    /**
+     * @brief Get the version of the bytecode the compiler emits.
+     *  It is part of the key of the cached regions, so it must be bumped
+     *  whenever the same region would compile to different bytecode.
+     *  2: the region address is in the cipher counter.
+     */
+    virtual uint32_t GetVersion() const noexcept { return 2; }
+
     /**
      * @brief Construct a new Compiler Base object
      * 
@@ -38,6 +101,23 @@ class CompilerBase {
      */
     CompilerBase(std::string name) : name(name) {}
 
+   protected:
+    /**
+     * @brief Compile every region of the recipe input, in order on the
+     *        calling thread, with Segment and DisassembleAndCompile.
+     *
+     * The fusion of the whole file is logged at the debug level.
+     *
+     * @param script The recipe of the file.
+     * @return The bytecode of the regions, merged in address order.
+     * @throws std::runtime_error if the input cannot be segmented, or a
+     *         region cannot be disassembled or compiled.
+     */
+    std::vector<uint8_t> CompileRegions(
+        const BytecodeCompileRecipe& script) const;
+
+   public:
+
     /**
      * @brief Destroy the Compiler Base object
      */
@@ -67,6 +147,17 @@ class _NotImplementedYet : public CompilerBase {
      */
     std::vector<uint8_t> Compile(const BytecodeCompileRecipe& script) override;
 
+    /**
+     * @brief Compile one protected region into bytecode.
+     *
+     * @throws std::runtime_error always.
+     */
+    std::vector<uint8_t> CompileRegion(
+        const BytecodeCompileRecipe& script,
+        const VMPilot::SDK::ProtectedRegion& region,
+        const VMPilot::SDK::NativeInstructions& instructions,
+        FusionStats& fusion) const override;
+
     /**
      * @brief Construct a new _NotImplementedYet object
      */
@@ -0,0 +1,69 @@
+#ifndef __SDK_BYTECODE_ENCODER_HPP__
+#define __SDK_BYTECODE_ENCODER_HPP__
+
+#include <instruction_cipher.hpp>
+#include <instruction_t.hpp>
+#include <opcode_table.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VMPilot::SDK::BytecodeCompiler {
+
+/**
+ * @brief The build-time side of Runtime::Decoder.
+ *
+ * The opcodes of a region are replaced by their OIDs, the instructions are
+ * encrypted, checksummed and written in the packed big-endian encoding that
+ * Runtime::detail::Fetch reads.
+ *
+ * The Buildtime_OT of the key and the cipher key schedule are set up once
+ * here, so encoding a region is a few table lookups and one cipher call.
+ * An encoder is immutable, the regions may be encoded concurrently.
+ */
+class BytecodeEncoder {
+   public:
+    /**
+     * @brief Build the opcode table and expand the key schedule of a key.
+     */
+    explicit BytecodeEncoder(const std::string& key);
+
+    /**
+     * @brief Encode the instructions of one region.
+     *
+     * @param insts The instructions, with their real opcodes and plain
+     *              operands. They are encrypted in place.
+     * @param region_addr The address of the region, it is in the cipher
+     *                    counter so no two regions of a file share one.
+     * @return The encoded region, ENCODED_INSTRUCTION_SIZE bytes each.
+     * @throws std::runtime_error if an opcode is not a real opcode, or the
+     *         region has InstructionCipher::MAX_INSTRUCTIONS or more.
+     */
+    std::vector<uint8_t> Encode(
+        std::vector<VMPilot::Common::Instruction_t>& insts,
+        uint64_t region_addr) const;
+
+    /**
+     * @brief The encoder of a key, cached per thread.
+     *
+     * The regions of a file share the key, so a worker sets up the tables
+     * once per file rather than once per region.
+     */
+    static const BytecodeEncoder& ForThread(const std::string& key);
+
+    const std::string& GetKey() const noexcept { return key_; }
+
+   private:
+    std::string key_;
+    // The OIDs by the dense index of their real opcode, see oid_index
+    std::array<VMPilot::Common::OID, VMPilot::Common::MAX_OPCODE_COUNT>
+        oids_{};
+    std::array<bool, VMPilot::Common::MAX_OPCODE_COUNT> valid_{};
+    VMPilot::Common::InstructionCipher cipher_;
+};
+
+}  // namespace VMPilot::SDK::BytecodeCompiler
+
+#endif  // __SDK_BYTECODE_ENCODER_HPP__
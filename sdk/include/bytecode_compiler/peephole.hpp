@@ -0,0 +1,53 @@
+#ifndef __SDK_PEEPHOLE_HPP__
+#define __SDK_PEEPHOLE_HPP__
+
+#include <instruction_t.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace VMPilot::SDK::BytecodeCompiler {
+
+/**
+ * @brief The result of the superinstruction fusion of a region.
+ *
+ * Every fused instruction saves one dispatch, one decryption and one
+ * checksum per execution.
+ */
+struct FusionStats {
+    size_t instructions_before = 0;
+    size_t instructions_after = 0;
+    size_t load_add_store = 0;  // LOAD; ADD; STORE -> LOAD_ADD_STORE
+    size_t cmp_jz = 0;          // CMP; JZ/JE -> CMP_JZ
+    size_t cmp_jnz = 0;         // CMP; JNZ/JNE -> CMP_JNZ
+    // Set if the region has an indirect jump or call, then nothing is fused
+    bool skipped = false;
+
+    // The instructions saved, the static dispatch count reduction
+    [[nodiscard]] size_t Saved() const noexcept {
+        return instructions_before - instructions_after;
+    }
+
+    FusionStats& operator+=(const FusionStats& other) noexcept;
+};
+
+/**
+ * @brief Fuse the common instruction sequences of a region into the
+ *        superinstructions of opcode_enum.hpp.
+ *
+ * The instructions have their real opcodes and plain operands, the pass
+ * runs before the encryption. A sequence is only fused when none of its
+ * instructions but the first is a jump target, and the jump targets are
+ * remapped to the new indices. A target held in a register cannot be
+ * remapped, so a region with an indirect jump or call is left as is.
+ *
+ * @param insts The instructions of one region, fused in place.
+ * @return The statistics of the fusion.
+ * @throws std::bad_alloc from the jump target tables.
+ */
+FusionStats FuseSuperinstructions(
+    std::vector<VMPilot::Common::Instruction_t>& insts);
+
+}  // namespace VMPilot::SDK::BytecodeCompiler
+
+#endif  // __SDK_PEEPHOLE_HPP__
@@ -5,7 +5,7 @@
 
 namespace VMPilot::SDK::BytecodeCompiler {
 
-class X86_64Compiler : public _NotImplementedYet {
+class X86_64Compiler : public CompilerBase {
    public:
     /**
          * @brief Compile a script into bytecode.
@@ -15,10 +15,20 @@ class X86_64Compiler : public _NotImplementedYet {
          */
     std::vector<uint8_t> Compile(const BytecodeCompileRecipe& script) override;
 
+    /**
+     * @brief Lift the region (see LiftX86Region), fuse its superinstructions
+     *        and encode it with the master key of the recipe.
+     */
+    std::vector<uint8_t> CompileRegion(
+        const BytecodeCompileRecipe& script,
+        const VMPilot::SDK::ProtectedRegion& region,
+        const VMPilot::SDK::NativeInstructions& instructions,
+        FusionStats& fusion) const override;
+
     /**
          * @brief Construct a new X86_64 Compiler object
          */
-    X86_64Compiler() : _NotImplementedYet("x86_64") {}
+    X86_64Compiler() : CompilerBase("x86_64") {}
 };
 
 }  // namespace VMPilot::SDK::BytecodeCompiler
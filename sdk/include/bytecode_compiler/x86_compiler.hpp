@@ -15,6 +15,19 @@ class X86Compiler : public CompilerBase {
          */
     std::vector<uint8_t> Compile(const BytecodeCompileRecipe& script) override;
 
+    /**
+     * @brief Lift the region (see LiftX86Region), fuse its superinstructions
+     *        and encode it with the master key of the recipe.
+     *
+     * The VM only moves 64-bit words, so a region with a memory access is
+     * rejected here.
+     */
+    std::vector<uint8_t> CompileRegion(
+        const BytecodeCompileRecipe& script,
+        const VMPilot::SDK::ProtectedRegion& region,
+        const VMPilot::SDK::NativeInstructions& instructions,
+        FusionStats& fusion) const override;
+
     /**
          * @brief Construct a new X86 Compiler object
          */
@@ -0,0 +1,56 @@
+#ifndef __SDK_X86_LIFTER_HPP__
+#define __SDK_X86_LIFTER_HPP__
+
+#include <NativeInstructions.hpp>
+#include <ProtectedRegion.hpp>
+#include <instruction_t.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace VMPilot::SDK::BytecodeCompiler {
+
+/**
+ * @brief Lift the x86 instructions of a region to VMPilot instructions.
+ *
+ * The general purpose registers are the VM registers of the same number
+ * (RAX is R0, ..., R15 is R15), the 32-bit registers are their low halves,
+ * kept zero-extended like x86-64 does. Only the zero flag exists in the VM,
+ * so only ZF is modelled.
+ *
+ * Each instruction is selected in constant time from a table built at
+ * compile time from the pattern table of x86_lifter.cpp, so a region is
+ * lifted in one pass. An instruction is only lifted if the VM computes
+ * exactly what the CPU would:
+ * - 8 and 16-bit registers, 32-bit memory accesses, indexed, RIP-relative
+ *   and absolute addresses and segment overrides are rejected. LOAD/STORE
+ *   move 64-bit words, so on x86 (word_size 4) every load and store is
+ *   rejected: x86-32 regions are lifted without memory accesses;
+ * - a lowering that clobbers the zero flag where x86 keeps it is rejected
+ *   if the flag is read afterwards;
+ * - push, pop and call are rejected, RSP is not modelled: the VM stack is
+ *   not the native stack, so RSP would not follow it;
+ * - jumps must stay in the region, or go to its end;
+ * - only JE/JNE read the flags, ret and the other conditions are rejected.
+ *
+ * The lifted code addresses the VM memory (Runtime::VM::SetMemory), not
+ * the native address space: an address is a base register plus a
+ * displacement, and the register holds an offset in that memory. A native
+ * address cannot be translated to such an offset at build time, so
+ * RIP-relative and absolute addresses are rejected.
+ *
+ * @param instructions The instructions of the region, from the segmentator.
+ * @param region The region.
+ * @param word_size 8 for x86-64, 4 for x86.
+ * @return The instructions with their real opcodes and plain operands, the
+ *         jump targets are instruction indices.
+ * @throws std::runtime_error naming the first instruction that cannot be
+ *         lifted.
+ */
+std::vector<VMPilot::Common::Instruction_t> LiftX86Region(
+    const VMPilot::SDK::NativeInstructions& instructions,
+    const VMPilot::SDK::ProtectedRegion& region, unsigned word_size);
+
+}  // namespace VMPilot::SDK::BytecodeCompiler
+
+#endif  // __SDK_X86_LIFTER_HPP__
@@ -0,0 +1,105 @@
+#ifndef __SDK_ELF_REWRITER_HPP__
+#define __SDK_ELF_REWRITER_HPP__
+#pragma once
+
+#include <ELFImage.hpp>
+#include <mapped_file.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VMPilot::SDK::Rewriter {
+
+/**
+ * @brief Write a protected copy of an ELF executable or shared object.
+ *
+ * The output is the input with:
+ * - patches over the code of the protected regions,
+ * - a new section (the bytecode) at the end of the file, loaded read-only by
+ *   a new PT_LOAD segment,
+ * - the section header table and .shstrtab written again after it, to name
+ *   the new section. The old ones are left in place, unused.
+ *
+ * The program header table cannot grow in place, so the new PT_LOAD takes
+ * the entry of a PT_NOTE segment, the notes are only read by debuggers and
+ * the core dumps. The entries are reordered so the PT_LOADs stay sorted by
+ * address, as the loaders require.
+ *
+ * The output is streamed: the unchanged bytes are copied from the input by
+ * OutputFile, only the headers, the patches and the new data are written
+ * from memory.
+ */
+class ELFRewriter {
+   public:
+    /**
+     * @brief Parse the input and lay out the new segment.
+     *
+     * @param file The mapped input, shared with the segmentator.
+     * @throws std::runtime_error if it is not an ELF file, or it has no
+     *         PT_LOAD or no PT_NOTE segment.
+     */
+    explicit ELFRewriter(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
+
+    /**
+     * @brief Replace the bytes at a virtual address.
+     *
+     * @throws std::runtime_error if they are not all in the file part of one
+     *         PT_LOAD segment, or overlap another patch.
+     */
+    void Patch(uint64_t addr, std::vector<uint8_t> bytes);
+
+    /**
+     * @brief Set the new section, SHT_PROGBITS and SHF_ALLOC.
+     *
+     * @param name The name of the section.
+     * @param data The content of the section, at GetSectionAddress().
+     */
+    void SetSection(std::string name, std::vector<uint8_t> data);
+
+    /**
+     * @brief The virtual address the new section is loaded at, past every
+     *        segment of the input. It does not depend on the section.
+     */
+    uint64_t GetSectionAddress() const noexcept { return section_addr; }
+
+    /**
+     * @brief Write the output.
+     *
+     * @param filename The path of the output, it gets the mode of the input.
+     * @throws std::runtime_error if the output cannot be written, or the
+     *         new layout does not fit an ELF32 file.
+     */
+    void Write(const std::string& filename) const;
+
+   private:
+    // Encode a value in the byte order of the file
+    void put(std::vector<uint8_t>& out, uint64_t at, uint64_t value,
+             size_t size) const noexcept;
+
+    std::vector<uint8_t> encodeSegment(
+        const Segmentator::ELFSegment& segment) const;
+    std::vector<uint8_t> programHeaders() const;
+
+    std::shared_ptr<const VMPilot::Common::MappedFile> file;
+    Segmentator::ELFImage image;
+
+    // The PT_NOTE entry turned into the new PT_LOAD
+    size_t note_index = 0;
+    uint64_t alignment = 0;
+    uint64_t section_offset = 0;
+    uint64_t section_addr = 0;
+
+    std::string section_name;
+    std::vector<uint8_t> section_data;
+
+    // The patches by file offset
+    std::map<uint64_t, std::vector<uint8_t>> patches;
+};
+
+}  // namespace VMPilot::SDK::Rewriter
+
+#endif  // __SDK_ELF_REWRITER_HPP__
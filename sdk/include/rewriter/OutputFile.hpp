@@ -0,0 +1,101 @@
+#ifndef __SDK_OUTPUT_FILE_HPP__
+#define __SDK_OUTPUT_FILE_HPP__
+#pragma once
+
+#include <byte_view.hpp>
+#include <mapped_file.hpp>
+
+#include <cstdint>
+#include <string>
+
+namespace VMPilot::SDK::Rewriter {
+
+/**
+ * @brief A sequential writer of an output binary.
+ *
+ * The output is streamed front to back: the unchanged ranges of the input
+ * are copied file to file by the kernel (copy_file_range, then sendfile,
+ * on Linux), and only the modified bytes are written from memory. So the
+ * cost of a large binary is the disk bandwidth, it is never copied into a
+ * buffer of ours.
+ *
+ * It writes to a temporary file next to the output, with a unique name,
+ * renamed by Commit, so a failed job never leaves a partial output behind.
+ */
+class OutputFile {
+   public:
+    /**
+     * @brief Create the temporary file of filename.
+     *
+     * @param filename The path of the output.
+     * @param input The input it is rewritten from, the output gets its
+     *              permissions.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    OutputFile(std::string filename,
+               const VMPilot::Common::MappedFile& input);
+
+    /**
+     * @brief Remove the temporary file if it was not committed.
+     */
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    /**
+     * @brief Append bytes from memory.
+     *
+     * @throws std::runtime_error if the write fails.
+     */
+    void Write(VMPilot::Common::ByteView data);
+
+    /**
+     * @brief Append [offset, offset + size) of the input, without reading it
+     *        into memory where the platform allows it.
+     *
+     * @throws std::runtime_error if the range is out of the input or the
+     *         copy fails.
+     */
+    void Copy(const VMPilot::Common::MappedFile& input, uint64_t offset,
+              uint64_t size);
+
+    /**
+     * @brief Append zeros up to the next multiple of alignment.
+     *
+     * @throws std::runtime_error if the write fails.
+     */
+    void Align(uint64_t alignment);
+
+    /**
+     * @brief The number of bytes written so far, the offset of the next one.
+     */
+    uint64_t Size() const noexcept { return size_; }
+
+    /**
+     * @brief Close the temporary file and rename it to the output.
+     *
+     * @throws std::runtime_error if it cannot be flushed or renamed.
+     */
+    void Commit();
+
+   private:
+    void Close() noexcept;
+
+    std::string filename_;
+    std::string tmp_;
+    uint64_t size_ = 0;
+    bool committed_ = false;
+#ifdef _WIN32
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+    // The kernel copies are given up for the writes after the first failure
+    bool copy_file_range_ = true;
+    bool sendfile_ = true;
+#endif
+};
+
+}  // namespace VMPilot::SDK::Rewriter
+
+#endif  // __SDK_OUTPUT_FILE_HPP__
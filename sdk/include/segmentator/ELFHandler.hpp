@@ -3,6 +3,7 @@
 #pragma once
 
 #include <Strategy.hpp>
+#include <mapped_file.hpp>
 
 #include <cstdint>
 #include <memory>
@@ -17,10 +18,16 @@ class ELFFileHandlerStrategy : public FileHandlerStrategy {
     struct Impl;
     std::unique_ptr<Impl> pImpl;
     // Private method to create an instance of the implementation
-    friend std::unique_ptr<Impl> make_elf_impl(const std::string& filename);
+    friend std::unique_ptr<Impl> make_elf_impl(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
    public:
     explicit ELFFileHandlerStrategy(const std::string& filename);
+    /**
+     * @brief Parse an already mapped file, the handler shares the mapping.
+     */
+    explicit ELFFileHandlerStrategy(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
     virtual ~ELFFileHandlerStrategy();
 
    protected:
@@ -34,12 +41,28 @@ class ELFFileHandlerStrategy : public FileHandlerStrategy {
      */
     virtual std::vector<uint8_t> doGetTextSection() noexcept override;
 
+    /**
+     * @brief Get a view of the .text section in the mapped file.
+     */
+    virtual VMPilot::Common::ByteView doGetTextSectionView() noexcept override;
+
     /**
      * @brief Get the base address of the .text section.
      */
     virtual uint64_t doGetTextBaseAddr() noexcept override;
 
+    /**
+     * @brief Get the symbols defined in the file, from ".symtab", or from
+     *        ".dynsym" if the file is stripped.
+     */
+    virtual NativeSymbolTable doGetNativeSymbolTable() noexcept override;
+
    private:
+    /**
+     * @brief Build the symbol name index of ".dynsym" and the symbol to ".rela.plt" entry index, once per file.
+     */
+    void buildIndices() noexcept;
+
     /**
      * Retrieves the index of an entry in the ".dynsym" section based on its signature.
      *
@@ -75,17 +98,17 @@ class ELFFileHandlerStrategy : public FileHandlerStrategy {
     std::pair<uint64_t, uint64_t> doGetBeginEndAddrIntl() noexcept;
 
     /**
-     * @brief Internal implementation of doGetTextSection.
-     *        This method is used to perform the actual logic of getting the entire chuck of the .text section.
-     *        The caching logic is left in the doGetTextSection method.
+     * @brief Internal implementation of doGetTextSectionView.
+     *        This method is used to perform the actual logic of finding the .text section in the mapped file.
+     *        The error logging is left in the doGetTextSection and doGetTextSectionView methods.
      * 
-     * @return A vector of uint8_t values representing the entire chuck of the .text section.
+     * @return A view of the entire chuck of the .text section, empty if not found.
      */
-    std::vector<uint8_t> doGetTextSectionIntl() noexcept;
+    VMPilot::Common::ByteView doGetTextSectionIntl() noexcept;
 };
 
 std::unique_ptr<ELFFileHandlerStrategy::Impl> make_elf_impl(
-    const std::string& filename);
+    std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
 }  // namespace VMPilot::SDK::Segmentator
 
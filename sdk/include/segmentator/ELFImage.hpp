@@ -0,0 +1,231 @@
+#ifndef __SDK_ELF_IMAGE_HPP__
+#define __SDK_ELF_IMAGE_HPP__
+#pragma once
+
+#include <ELFSectionViewer.hpp>
+#include <byte_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace VMPilot::SDK::Segmentator {
+
+// One entry of a symbol table section (.symtab or .dynsym)
+struct ELFSymbol {
+    std::string_view name;  // Points into the string table of the mapping
+    uint64_t value = 0;
+    uint64_t size = 0;
+    uint8_t info = 0;  // The binding in the high nibble, the type in the low
+    uint8_t other = 0;
+    uint16_t shndx = 0;
+
+    uint8_t getBind() const noexcept { return info >> 4; }
+    uint8_t getType() const noexcept { return info & 0xf; }
+};
+
+// One entry of a relocation section (SHT_REL or SHT_RELA)
+struct ELFRelocation {
+    uint64_t offset = 0;
+    uint32_t symbol = 0;
+    uint32_t type = 0;
+    int64_t addend = 0;  // Always 0 for SHT_REL
+};
+
+// One entry of the program header table, widened to 64 bits for ELF32
+struct ELFSegment {
+    uint32_t type = 0;
+    uint32_t flags = 0;
+    uint64_t offset = 0;
+    uint64_t vaddr = 0;
+    uint64_t paddr = 0;
+    uint64_t filesz = 0;
+    uint64_t memsz = 0;
+    uint64_t align = 0;
+
+    static constexpr uint32_t PT_LOAD = 1;
+    static constexpr uint32_t PT_NOTE = 4;
+    static constexpr uint32_t PF_X = 0x1;
+    static constexpr uint32_t PF_W = 0x2;
+    static constexpr uint32_t PF_R = 0x4;
+};
+
+// Where the header tables are, with the real counts and string table index
+// even when they overflow into the first section header
+struct ELFHeaderTables {
+    uint64_t phoff = 0;
+    uint16_t phentsize = 0;
+    uint64_t phnum = 0;
+    uint64_t shoff = 0;
+    uint16_t shentsize = 0;
+    uint64_t shnum = 0;
+    uint32_t shstrndx = 0;
+};
+
+/**
+ * @brief A parser of an ELF file that is already in memory.
+ *
+ * It only reads the headers it needs from the mapping and copies nothing:
+ * the sections, the symbol names and the section data are views into it, so
+ * the mapping must outlive the image. Both classes and both byte orders are
+ * supported.
+ */
+class ELFImage {
+   public:
+    // Section header types used by the handlers
+    static constexpr uint32_t SHT_SYMTAB = 2;
+    static constexpr uint32_t SHT_RELA = 4;
+    static constexpr uint32_t SHT_HASH = 5;
+    static constexpr uint32_t SHT_DYNSYM = 11;
+    static constexpr uint32_t SHT_GNU_HASH = 0x6ffffff6;
+
+    /**
+     * @brief Parse the ELF header and the section headers.
+     *
+     * @param data The whole file.
+     * @throws std::runtime_error if it is not a valid ELF file.
+     */
+    explicit ELFImage(VMPilot::Common::ByteView data);
+
+    bool is64() const noexcept { return is_64; }
+    bool isBigEndian() const noexcept { return big_endian; }
+    uint16_t getType() const noexcept { return type; }
+    uint16_t getMachine() const noexcept { return machine; }
+
+    const std::vector<ELFSectionViewer>& getSections() const noexcept {
+        return sections;
+    }
+
+    const std::vector<ELFSegment>& getSegments() const noexcept {
+        return segments;
+    }
+
+    const ELFHeaderTables& getHeaderTables() const noexcept { return tables; }
+
+    /**
+     * @brief Find a section by name.
+     *
+     * @return The section, or nullptr if there is none.
+     */
+    const ELFSectionViewer* findSection(std::string_view name) const noexcept;
+
+    /**
+     * @brief The number of entries of a symbol table section.
+     */
+    size_t getSymbolCount(const ELFSectionViewer& symtab) const noexcept;
+
+    /**
+     * @brief Read a symbol, its name is looked up in the linked string table.
+     *
+     * @throws std::runtime_error if the entry is out of the section.
+     */
+    ELFSymbol getSymbol(const ELFSectionViewer& symtab, size_t index) const;
+
+    /**
+     * @brief The number of entries of a relocation section.
+     */
+    size_t getRelocationCount(const ELFSectionViewer& rel) const noexcept;
+
+    /**
+     * @brief Read a relocation of a SHT_REL or SHT_RELA section.
+     *
+     * @throws std::runtime_error if the entry is out of the section.
+     */
+    ELFRelocation getRelocation(const ELFSectionViewer& rel,
+                                size_t index) const;
+
+    /**
+     * @brief The index of a section in the section header table.
+     *
+     * @param section A section of this image.
+     */
+    size_t getSectionIndex(const ELFSectionViewer& section) const noexcept {
+        return static_cast<size_t>(&section - sections.data());
+    }
+
+   private:
+    friend class ELFSymbolIndex;
+
+    // Read a T at offset of the file, swapped to the host byte order
+    template <typename T>
+    T read(uint64_t offset) const;
+
+    // Read the NUL terminated string at offset of a string table section
+    std::string_view readString(uint32_t strtab_index, uint64_t offset) const;
+
+    ELFSectionViewer::Header readSectionHeader(uint64_t offset) const;
+    ELFSegment readProgramHeader(uint64_t offset) const;
+
+    size_t symbolEntrySize(const ELFSectionViewer& symtab) const noexcept;
+    size_t relocationEntrySize(const ELFSectionViewer& rel) const noexcept;
+
+    VMPilot::Common::ByteView data;
+    bool is_64 = false;
+    bool swap = false;
+    bool big_endian = false;
+    uint16_t type = 0;
+    uint16_t machine = 0;
+
+    ELFHeaderTables tables;
+    std::vector<ELFSegment> segments;
+    std::vector<ELFSectionViewer> sections;
+    std::unordered_map<std::string_view, size_t> section_index;
+};
+
+/**
+ * @brief A name to index lookup of one symbol table, built once per file.
+ *
+ * It uses the hash tables the linker already made for the dynamic loader:
+ * - .hash covers every symbol of the table, it is used as is.
+ * - .gnu.hash only covers the defined symbols from its symoffset, the ones
+ *   before it (the undefined imports) go to a small map.
+ * Without any of them, all the names are put in a map in one pass. Either
+ * way a lookup is O(1) instead of a scan of the table.
+ */
+class ELFSymbolIndex {
+   public:
+    static constexpr uint64_t NOT_FOUND = static_cast<uint64_t>(-1);
+
+    /**
+     * @brief Build the index of symtab.
+     *
+     * @param image The image of symtab, it must outlive the index.
+     * @param symtab A symbol table section of image.
+     * @throws std::runtime_error if a symbol cannot be read.
+     */
+    ELFSymbolIndex(const ELFImage& image, const ELFSectionViewer& symtab);
+
+    /**
+     * @brief Find the index of a symbol by name.
+     *
+     * @return The index in the symbol table, or NOT_FOUND.
+     */
+    uint64_t find(std::string_view name) const noexcept;
+
+   private:
+    enum class Kind : uint8_t { Map, SysVHash, GnuHash };
+
+    uint64_t findSysV(std::string_view name) const;
+    uint64_t findGnu(std::string_view name) const;
+    bool matches(uint64_t index, std::string_view name) const;
+
+    const ELFImage& image;
+    const ELFSectionViewer& symtab;
+    const ELFSectionViewer* hash = nullptr;
+    Kind kind = Kind::Map;
+
+    // The names not covered by the hash table, or all of them for Kind::Map
+    std::unordered_map<std::string_view, uint32_t> names;
+
+    // .gnu.hash header, the tables follow it
+    uint32_t nbuckets = 0;
+    uint32_t symoffset = 0;
+    uint64_t buckets_offset = 0;  // In the file
+    uint64_t chains_offset = 0;
+};
+
+}  // namespace VMPilot::SDK::Segmentator
+
+#endif  // __SDK_ELF_IMAGE_HPP__
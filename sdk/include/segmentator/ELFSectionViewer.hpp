@@ -2,38 +2,66 @@
 #define __ELF_SECTION_VIEWER_HPP__
 #pragma once
 
-#include <elfio/elf_types.hpp>
-#include <elfio/elfio.hpp>
+#include <byte_view.hpp>
 
-#include <memory>
-#include <string>
-#include <vector>
+#include <cstdint>
+#include <string_view>
 
 namespace VMPilot::SDK::Segmentator {
 
 /**
- * @brief A viewer class for the ELFIO::section class.
- * 
- * we not take ownership of the section object.
- * This class is used to provide a more convenient way to access the section object.
+ * @brief A view of one section of a mapped ELF file.
+ *
+ * The name and the data point into the mapping, we do not take ownership of
+ * anything, so the mapping must outlive the viewer. It is cheap to copy.
  */
 class ELFSectionViewer {
    public:
+    // The section header fields, in the host byte order and widened to 64
+    // bits for an ELF32 file
+    struct Header {
+        uint32_t name = 0;
+        uint32_t type = 0;
+        uint64_t flags = 0;
+        uint64_t addr = 0;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t link = 0;
+        uint32_t info = 0;
+        uint64_t addralign = 0;
+        uint64_t entsize = 0;
+    };
+
+    // SHT_NOBITS, the section takes no space in the file (.bss)
+    static constexpr uint32_t SHT_NOBITS = 8;
+
     ELFSectionViewer() = default;
-    ELFSectionViewer(ELFIO::section* sec) : section(sec) {}
+    ELFSectionViewer(std::string_view name, const Header& header,
+                     VMPilot::Common::ByteView data) noexcept
+        : name(name), header(header), data(data) {}
 
-    ELFSectionViewer(const ELFSectionViewer&) = delete;
-    ELFSectionViewer& operator=(const ELFSectionViewer&) = delete;
-    ELFSectionViewer(ELFSectionViewer&&) = default;
-    ELFSectionViewer& operator=(ELFSectionViewer&&) = default;
-    ~ELFSectionViewer() = default;
+    std::string_view getName() const noexcept { return name; }
+    uint32_t getType() const noexcept { return header.type; }
+    uint64_t getFlags() const noexcept { return header.flags; }
+    uint64_t getAddress() const noexcept { return header.addr; }
+    uint64_t getOffset() const noexcept { return header.offset; }
+    uint64_t getSize() const noexcept { return header.size; }
+    uint32_t getLink() const noexcept { return header.link; }
+    uint32_t getInfo() const noexcept { return header.info; }
+    uint64_t getAddrAlign() const noexcept { return header.addralign; }
+    uint64_t getEntrySize() const noexcept { return header.entsize; }
 
-    ELFIO::section* getSection() noexcept { return section; }
+    /**
+     * @brief The bytes of the section in the mapping, empty for SHT_NOBITS.
+     */
+    VMPilot::Common::ByteView getData() const noexcept { return data; }
 
    private:
-    ELFIO::section* section = nullptr;
+    std::string_view name;
+    Header header;
+    VMPilot::Common::ByteView data;
 };
 
 }  // namespace VMPilot::SDK::Segmentator
 
-#endif  // __ELF_SECTION_VIEWER_HPP__
\ No newline at end of file
+#endif  // __ELF_SECTION_VIEWER_HPP__
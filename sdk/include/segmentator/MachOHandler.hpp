@@ -3,6 +3,7 @@
 #pragma once
 
 #include <Strategy.hpp>
+#include <mapped_file.hpp>
 
 #include <cstdint>
 #include <memory>
@@ -16,15 +17,23 @@ class MachOFileHandlerStrategy : public FileHandlerStrategy {
     struct Impl;
     std::unique_ptr<Impl> pImpl;
     // Private method to create an instance of the implementation
-    friend std::unique_ptr<Impl> make_macho_impl(const std::string& filename);
+    friend std::unique_ptr<Impl> make_macho_impl(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
    public:
     explicit MachOFileHandlerStrategy(const std::string& filename);
+    /**
+     * @brief Parse an already mapped file, the handler shares the mapping.
+     *        The first slice of a universal file is the one parsed.
+     */
+    explicit MachOFileHandlerStrategy(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
     virtual ~MachOFileHandlerStrategy();
 
    protected:
     /**
-     * @brief Get the begin and end address of the VMPilot signatures.
+     * @brief Get the begin and end address of the VMPilot signatures, the
+     *        addresses of their stubs.
      */
     virtual std::pair<uint64_t, uint64_t> doGetBeginEndAddr() noexcept override;
 
@@ -33,29 +42,44 @@ class MachOFileHandlerStrategy : public FileHandlerStrategy {
      */
     virtual std::vector<uint8_t> doGetTextSection() noexcept override;
 
+    /**
+     * @brief Get a view of the __TEXT,__text section in the mapped file.
+     */
+    virtual VMPilot::Common::ByteView doGetTextSectionView() noexcept override;
+
     /**
      * @brief Get the base address of the executable code section (usually __TEXT,__text).
      */
     virtual uint64_t doGetTextBaseAddr() noexcept override;
 
+    /**
+     * @brief Get the symbols defined in the file, from the symbol table.
+     */
+    virtual NativeSymbolTable doGetNativeSymbolTable() noexcept override;
+
    private:
-    // Internal implementations that perform the actual logic
+    /**
+     * @brief Internal implementation of doGetBeginEndAddr.
+     *        The calls to the imported VMPilot functions go to the stubs of
+     *        __TEXT,__stubs, which the indirect symbol table names.
+     *        The caching logic is left in the doGetBeginEndAddr method.
+     *
+     * @return A pair of uint64_t values representing the begin and end addresses.
+     */
     std::pair<uint64_t, uint64_t> doGetBeginEndAddrIntl() noexcept;
-    std::vector<uint8_t> doGetTextSectionIntl() noexcept;
 
     /**
-     * Parses headers to locate and return specific Mach-O section data.
+     * @brief Internal implementation of doGetTextSectionView.
+     *        The error logging is left in the doGetTextSection and doGetTextSectionView methods.
      *
-     * @param sectionName The name of the section to retrieve (including segment name like __TEXT,__text).
-     * @return The data of the section if found, or an empty vector if not.
+     * @return A view of the __TEXT,__text section, empty if not found.
      */
-    std::vector<uint8_t> getSectionData(
-        const std::string& sectionName) noexcept;
+    VMPilot::Common::ByteView doGetTextSectionIntl() noexcept;
 };
 
 std::unique_ptr<MachOFileHandlerStrategy::Impl> make_macho_impl(
-    const std::string& filename);
+    std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
 }  // namespace VMPilot::SDK::Segmentator
 
-#endif  // __SDK_MACHO_HANDLER_HPP__
\ No newline at end of file
+#endif  // __SDK_MACHO_HANDLER_HPP__
@@ -0,0 +1,169 @@
+#ifndef __SDK_MACHO_IMAGE_HPP__
+#define __SDK_MACHO_IMAGE_HPP__
+#pragma once
+
+#include <byte_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace VMPilot::SDK::Segmentator {
+
+// One section of a segment
+struct MachOSection {
+    std::string_view segment;  // Points into the mapping
+    std::string_view name;     // Points into the mapping
+    uint64_t addr = 0;
+    uint64_t size = 0;
+    uint32_t offset = 0;  // In the slice
+    uint32_t flags = 0;
+    uint32_t reserved1 = 0;  // The first indirect symbol of a stub section
+    uint32_t reserved2 = 0;  // The size of a stub
+    // The bytes of the section in the slice, empty for a zero fill section
+    VMPilot::Common::ByteView data;
+
+    static constexpr uint32_t SECTION_TYPE = 0x000000ff;
+    static constexpr uint32_t S_ZEROFILL = 0x1;
+    static constexpr uint32_t S_SYMBOL_STUBS = 0x8;
+    static constexpr uint32_t S_ATTR_PURE_INSTRUCTIONS = 0x80000000;
+    static constexpr uint32_t S_ATTR_SOME_INSTRUCTIONS = 0x00000400;
+
+    uint32_t getType() const noexcept { return flags & SECTION_TYPE; }
+    bool isCode() const noexcept {
+        return (flags &
+                (S_ATTR_PURE_INSTRUCTIONS | S_ATTR_SOME_INSTRUCTIONS)) != 0;
+    }
+};
+
+// One entry of the symbol table
+struct MachOSymbol {
+    std::string_view name;  // Points into the mapping
+    uint64_t value = 0;
+    uint8_t type = 0;
+    uint8_t sect = 0;  // 1-based over all the sections, 0 for none
+    uint16_t desc = 0;
+
+    static constexpr uint8_t N_STAB = 0xe0;
+    static constexpr uint8_t N_TYPE = 0x0e;
+    static constexpr uint8_t N_EXT = 0x01;
+    static constexpr uint8_t N_SECT = 0x0e;
+
+    bool isDebug() const noexcept { return (type & N_STAB) != 0; }
+    bool isDefined() const noexcept { return (type & N_TYPE) == N_SECT; }
+    bool isExternal() const noexcept { return (type & N_EXT) != 0; }
+};
+
+// One stub of a S_SYMBOL_STUBS section, the trampoline to an import
+struct MachOStub {
+    uint64_t addr = 0;
+    std::string_view name;  // Empty for a local or absolute stub
+};
+
+/**
+ * @brief A parser of a Mach-O file that is already in memory.
+ *
+ * Like ELFImage, it copies nothing: the sections and the names are views
+ * into the mapping, which must outlive the image. A universal (fat) file is
+ * parsed as the view of one of its slices. Both byte orders and both word
+ * sizes are supported.
+ */
+class MachOImage {
+   public:
+    // Select the first slice of a universal file
+    static constexpr uint32_t CPU_TYPE_ANY = static_cast<uint32_t>(-1);
+
+    // The indirect symbols without a symbol table entry
+    static constexpr uint32_t INDIRECT_SYMBOL_LOCAL = 0x80000000;
+    static constexpr uint32_t INDIRECT_SYMBOL_ABS = 0x40000000;
+
+    /**
+     * @brief Parse the Mach-O header and the load commands.
+     *
+     * @param data The whole file.
+     * @param cpu_type The slice to parse if it is a universal file.
+     * @throws std::runtime_error if it is not a valid Mach-O file, or if a
+     *         universal file has no slice of cpu_type.
+     */
+    explicit MachOImage(VMPilot::Common::ByteView data,
+                        uint32_t cpu_type = CPU_TYPE_ANY);
+
+    bool is64() const noexcept { return is_64; }
+    uint32_t getCpuType() const noexcept { return cpu_type; }
+    uint32_t getFileType() const noexcept { return file_type; }
+
+    // The Mach-O file, the slice of a universal file
+    VMPilot::Common::ByteView getSlice() const noexcept { return data; }
+
+    const std::vector<MachOSection>& getSections() const noexcept {
+        return sections;
+    }
+
+    /**
+     * @brief Find a section by segment and section name.
+     *
+     * @return The section, or nullptr if there is none.
+     */
+    const MachOSection* findSection(std::string_view segment,
+                                    std::string_view name) const noexcept;
+
+    size_t getSymbolCount() const noexcept { return symbol_count; }
+
+    /**
+     * @brief Read an entry of the symbol table.
+     *
+     * @throws std::runtime_error if the entry is out of the file.
+     */
+    MachOSymbol getSymbol(size_t index) const;
+
+    size_t getIndirectSymbolCount() const noexcept {
+        return indirect_symbol_count;
+    }
+
+    /**
+     * @brief Read an entry of the indirect symbol table, the index of a
+     *        symbol or INDIRECT_SYMBOL_LOCAL / INDIRECT_SYMBOL_ABS.
+     *
+     * @throws std::runtime_error if the entry is out of the file.
+     */
+    uint32_t getIndirectSymbol(size_t index) const;
+
+    /**
+     * @brief Read the stubs of all the S_SYMBOL_STUBS sections, each one
+     *        named by the indirect symbol table.
+     *
+     * @throws std::runtime_error if a table is out of the file.
+     */
+    std::vector<MachOStub> getStubs() const;
+
+   private:
+    // Read a T at offset of the slice, swapped to the host byte order
+    template <typename T>
+    T read(uint64_t offset) const;
+
+    // A name of at most max bytes at offset, NUL padded
+    std::string_view readName(uint64_t offset, size_t max) const;
+
+    void parseSegment(uint64_t command);
+
+    VMPilot::Common::ByteView data;
+    bool is_64 = false;
+    bool big_endian = false;
+    uint32_t cpu_type = 0;
+    uint32_t file_type = 0;
+
+    std::vector<MachOSection> sections;
+
+    uint64_t symbol_table_offset = 0;
+    size_t symbol_count = 0;
+    uint64_t string_table_offset = 0;
+    uint64_t string_table_size = 0;
+
+    uint64_t indirect_symbol_offset = 0;
+    size_t indirect_symbol_count = 0;
+};
+
+}  // namespace VMPilot::SDK::Segmentator
+
+#endif  // __SDK_MACHO_IMAGE_HPP__
@@ -2,70 +2,64 @@
 #define __SDK_NATIVE_FUNCTION_BASE_HPP__
 #pragma once
 
+#include <StringPool.hpp>
+#include <byte_view.hpp>
+
 #include <cstdint>
-#include <string>
-#include <vector>
+#include <string_view>
 
 namespace VMPilot::SDK::Segmentator {
 /**
- * @brief Base class for native functions in different executable formats.
- * 
- * This class is intended to be inherited by derived classes for different
- * executable formats such as ELF, PE, etc.
+ * @brief A native function of an executable, of any format.
+ *
+ * It is a small value type that owns nothing: the code and the global data
+ * are views into the mapped file, and the name is an id in the string pool
+ * of the handler that found the function. So thousands of functions are
+ * copied and passed around without any allocation, and the accessors never
+ * copy. A function is valid as long as the mapping and the string pool.
  */
 class NativeFunctionBase {
    protected:
-    uint64_t m_addr;
-    uint64_t m_size;
-    std::string m_name;
-    std::vector<uint8_t> m_code;
-    std::vector<uint8_t> globalData;
+    uint64_t m_addr = 0;
+    uint64_t m_size = 0;
+    const StringPool* m_names = nullptr;
+    StringPool::Id m_name = StringPool::EMPTY;
+    VMPilot::Common::ByteView m_code;
+    VMPilot::Common::ByteView m_global_data;
     friend class ArchHandlerStrategy;
 
    public:
-    NativeFunctionBase(uint64_t addr, uint64_t size, std::string name,
-                       std::vector<uint8_t> code)
-        : m_addr(addr), m_size(size), m_name(name), m_code(code) {}
-
-    NativeFunctionBase(const NativeFunctionBase& other)
-        : m_addr(other.m_addr),
-          m_size(other.m_size),
-          m_name(other.m_name),
-          m_code(other.m_code) {}
+    NativeFunctionBase() = default;
 
-    NativeFunctionBase(NativeFunctionBase&& other) noexcept
-        : m_addr(other.m_addr),
-          m_size(other.m_size),
-          m_name(std::move(other.m_name)),
-          m_code(std::move(other.m_code)) {}
+    /**
+     * @param addr The address of the function
+     * @param size The size of the function
+     * @param names The string pool of the name
+     * @param name The id of the name in names
+     * @param code The code of the function in the mapped file
+     * @param global_data The global data of the function in the mapped file
+     */
+    NativeFunctionBase(uint64_t addr, uint64_t size, const StringPool& names,
+                       StringPool::Id name, VMPilot::Common::ByteView code,
+                       VMPilot::Common::ByteView global_data = {})
+        : m_addr(addr),
+          m_size(size),
+          m_names(&names),
+          m_name(name),
+          m_code(code),
+          m_global_data(global_data) {}
 
-    NativeFunctionBase& operator=(const NativeFunctionBase& other) {
-        if (this != &other) {
-            m_addr = other.m_addr;
-            m_size = other.m_size;
-            m_name = other.m_name;
-            m_code = other.m_code;
-        }
-        return *this;
+    uint64_t getAddr() const noexcept { return m_addr; }
+    uint64_t getSize() const noexcept { return m_size; }
+    StringPool::Id getNameId() const noexcept { return m_name; }
+    std::string_view getName() const noexcept {
+        return m_names != nullptr ? m_names->Get(m_name) : std::string_view();
     }
-
-    NativeFunctionBase& operator=(NativeFunctionBase&& other) noexcept {
-        if (this != &other) {
-            m_addr = other.m_addr;
-            m_size = other.m_size;
-            m_name = std::move(other.m_name);
-            m_code = std::move(other.m_code);
-        }
-        return *this;
+    VMPilot::Common::ByteView getCode() const noexcept { return m_code; }
+    VMPilot::Common::ByteView getGlobalData() const noexcept {
+        return m_global_data;
     }
-
-    virtual ~NativeFunctionBase() = default;
-    uint64_t getAddr() const { return m_addr; }
-    uint64_t getSize() const { return m_size; }
-    std::string getName() const { return m_name; }
-    std::vector<uint8_t> getCode() const { return m_code; }
-    std::vector<uint8_t> getGlobalData() const { return globalData; }
 };
 }  // namespace VMPilot::SDK::Segmentator
 
-#endif  // __SDK_NATIVE_FUNCTION_BASE_HPP__
\ No newline at end of file
+#endif  // __SDK_NATIVE_FUNCTION_BASE_HPP__
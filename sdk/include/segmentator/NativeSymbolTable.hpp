@@ -2,15 +2,20 @@
 #define __SDK_SEGMENTATOR_NATIVE_SYMBOL_TABLE_HPP__
 #pragma once
 
+#include <StringPool.hpp>
+
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
 
 namespace VMPilot::SDK::Segmentator {
 // A symbol table entry class for all architectures
-enum class SymbolType {
+enum class SymbolType : uint8_t {
     NOTYPE,          // No type specified
     OBJECT,          // Data object
     FUNC,            // Function or executable code
@@ -22,7 +27,7 @@ enum class SymbolType {
     // Extend with additional COFF-specific types if necessary
 };
 
-// Structure to represent a symbol table entry
+// A symbol table entry, to build a NativeSymbolTable entry by entry
 struct NativeSymbolTableEntry {
     std::string name;  // Symbol name
     uint64_t address;  // Address of the symbol
@@ -87,7 +92,226 @@ struct NativeSymbolTableEntry {
     }
 };
 
-using NativeSymbolTable = std::vector<NativeSymbolTableEntry>;
+/**
+ * @brief The symbols of a file, stored by column.
+ *
+ * The names are interned in a string pool, the address, size, type and bind
+ * of the symbols are parallel arrays, and the format-specific attributes
+ * (the section number, storage class and auxiliary symbol count of PE) are
+ * typed columns that only exist once a symbol sets them. A symbol costs
+ * about 24 bytes, against a string and a hash map per NativeSymbolTableEntry.
+ *
+ * Iterating it, or indexing it, yields Symbol views with the fields of a
+ * NativeSymbolTableEntry, so it reads like the vector of entries it
+ * replaces. It is not thread-safe.
+ */
+class NativeSymbolTable {
+   public:
+    using Index = uint32_t;
+
+    /**
+     * @brief A view of one symbol, valid as long as the table.
+     */
+    struct Symbol {
+        std::string_view name;
+        uint64_t address;
+        uint64_t size;
+        SymbolType type;
+        bool isGlobal;
+
+        const NativeSymbolTable* table;
+        Index index;
+
+        // -1 if undefined
+        int getSectionNumber() const noexcept {
+            return table->section_numbers_.Get(index);
+        }
+        int getStorageClass() const noexcept {
+            return table->storage_classes_.Get(index);
+        }
+        int getNumberOfAuxSymbols() const noexcept {
+            return table->aux_symbols_.Get(index);
+        }
+    };
+
+    class const_iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Symbol;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Symbol;
+
+        const_iterator(const NativeSymbolTable* table, Index index) noexcept
+            : table_(table), index_(index) {}
+
+        Symbol operator*() const noexcept { return (*table_)[index_]; }
+        const_iterator& operator++() noexcept {
+            ++index_;
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            auto old = *this;
+            ++index_;
+            return old;
+        }
+        bool operator==(const const_iterator& other) const noexcept {
+            return index_ == other.index_;
+        }
+        bool operator!=(const const_iterator& other) const noexcept {
+            return index_ != other.index_;
+        }
+
+       private:
+        const NativeSymbolTable* table_;
+        Index index_;
+    };
+
+    /**
+     * @brief The indices of a run of symbols, in address order.
+     */
+    struct IndexRange {
+        const Index* first;
+        const Index* last;
+
+        const Index* begin() const noexcept { return first; }
+        const Index* end() const noexcept { return last; }
+        size_t size() const noexcept { return last - first; }
+        bool empty() const noexcept { return first == last; }
+    };
+
+    NativeSymbolTable() = default;
+    NativeSymbolTable(const NativeSymbolTable&) = delete;
+    NativeSymbolTable& operator=(const NativeSymbolTable&) = delete;
+    NativeSymbolTable(NativeSymbolTable&&) noexcept = default;
+    NativeSymbolTable& operator=(NativeSymbolTable&&) noexcept = default;
+
+    void reserve(size_t count);
+
+    /**
+     * @brief Add a symbol, its name is interned.
+     *
+     * @return The index of the symbol.
+     * @throws std::length_error if the table holds 2^32 symbols.
+     */
+    Index Add(std::string_view name, uint64_t address, uint64_t size,
+              SymbolType type, bool is_global);
+
+    /**
+     * @brief Add an entry, with its PE attributes. The other attributes of
+     *        the entry are not kept.
+     */
+    void push_back(const NativeSymbolTableEntry& entry);
+
+    void SetSectionNumber(Index index, int section_number) {
+        section_numbers_.Set(index, section_number);
+    }
+    void SetStorageClass(Index index, int storage_class) {
+        storage_classes_.Set(index, storage_class);
+    }
+    void SetNumberOfAuxSymbols(Index index, int count) {
+        aux_symbols_.Set(index, count);
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return addresses_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return addresses_.empty(); }
+
+    Symbol operator[](size_t index) const noexcept {
+        return {names_.Get(names_ids_[index]),
+                addresses_[index],
+                sizes_[index],
+                types_[index],
+                globals_[index] != 0,
+                this,
+                static_cast<Index>(index)};
+    }
+    const_iterator begin() const noexcept { return {this, 0}; }
+    const_iterator end() const noexcept {
+        return {this, static_cast<Index>(size())};
+    }
+
+    [[nodiscard]] uint64_t Address(size_t index) const noexcept {
+        return addresses_[index];
+    }
+    [[nodiscard]] uint64_t Size(size_t index) const noexcept {
+        return sizes_[index];
+    }
+    [[nodiscard]] SymbolType Type(size_t index) const noexcept {
+        return types_[index];
+    }
+    [[nodiscard]] StringPool::Id NameId(size_t index) const noexcept {
+        return names_ids_[index];
+    }
+    [[nodiscard]] const StringPool& Names() const noexcept { return names_; }
+
+    /**
+     * @brief Get the symbols whose address is in [begin, end), sorted by
+     *        address, in O(log n).
+     *
+     * The address index is built by the first query after a change, so the
+     * range is valid until the next change.
+     */
+    IndexRange Range(uint64_t begin, uint64_t end) const;
+
+   private:
+    // An optional column, only allocated up to the last symbol setting it
+    template <typename T, T Default>
+    class AttributeColumn {
+       public:
+        T Get(size_t index) const noexcept {
+            return index < values_.size() ? values_[index] : Default;
+        }
+        void Set(size_t index, T value) {
+            if (index >= values_.size())
+                values_.resize(index + 1, Default);
+            values_[index] = value;
+        }
+
+       private:
+        std::vector<T> values_;
+    };
+
+    StringPool names_;
+    std::vector<StringPool::Id> names_ids_;
+    std::vector<uint64_t> addresses_;
+    std::vector<uint64_t> sizes_;
+    std::vector<SymbolType> types_;
+    std::vector<uint8_t> globals_;
+
+    AttributeColumn<int32_t, -1> section_numbers_;
+    AttributeColumn<int32_t, 0> storage_classes_;
+    AttributeColumn<int32_t, 0> aux_symbols_;
+
+    // The indices of the symbols sorted by address, rebuilt when stale
+    mutable std::vector<Index> by_address_;
+    mutable bool by_address_stale_ = false;
+};
+
+
+// A function of a symbol table, covering [address, address + size)
+struct FunctionSymbol {
+    uint64_t address;
+    uint64_t size;
+    size_t entry;  // The index of its entry in the symbol table
+};
+
+/**
+ * @brief Get the FUNC symbols in [begin, end), sorted by address.
+ *
+ * The aliases of a function are merged into its first entry. A symbol
+ * without a size extends to the next function, or to end.
+ */
+std::vector<FunctionSymbol> GetFunctionSymbols(const NativeSymbolTable& table,
+                                               uint64_t begin, uint64_t end);
+
+/**
+ * @brief Find the function containing address, in O(log n).
+ *
+ * @param functions The functions, sorted by address.
+ * @return The function, or nullptr if address is in none of them.
+ */
+const FunctionSymbol* FindFunctionSymbol(
+    const std::vector<FunctionSymbol>& functions, uint64_t address) noexcept;
 
 }  // namespace VMPilot::SDK::Segmentator
 
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <Strategy.hpp>
+#include <mapped_file.hpp>
 
 #include <cstdint>
 #include <memory>
@@ -16,15 +17,22 @@ class PEFileHandlerStrategy : public FileHandlerStrategy {
     struct Impl;
     std::unique_ptr<Impl> pImpl;
     // Private method to create an instance of the implementation
-    friend std::unique_ptr<Impl> make_pe_impl(const std::string& filename);
+    friend std::unique_ptr<Impl> make_pe_impl(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
    public:
     explicit PEFileHandlerStrategy(const std::string& filename);
+    /**
+     * @brief Parse an already mapped file, the handler shares the mapping.
+     */
+    explicit PEFileHandlerStrategy(
+        std::shared_ptr<const VMPilot::Common::MappedFile> file);
     virtual ~PEFileHandlerStrategy();
 
    protected:
     /**
-     * @brief Get the begin and end address of the VMPilot signatures.
+     * @brief Get the begin and end address of the VMPilot signatures, the
+     *        addresses of their import thunks.
      */
     virtual std::pair<uint64_t, uint64_t> doGetBeginEndAddr() noexcept override;
 
@@ -33,28 +41,44 @@ class PEFileHandlerStrategy : public FileHandlerStrategy {
      */
     virtual std::vector<uint8_t> doGetTextSection() noexcept override;
 
+    /**
+     * @brief Get a view of the executable code section in the mapped file.
+     */
+    virtual VMPilot::Common::ByteView doGetTextSectionView() noexcept override;
+
     /**
      * @brief Get the base address of the executable code section (usually .text section).
      */
     virtual uint64_t doGetTextBaseAddr() noexcept override;
 
+    /**
+     * @brief Get the symbols defined in the file, from the COFF symbol
+     *        table, or from the export table if the image has none.
+     */
+    virtual NativeSymbolTable doGetNativeSymbolTable() noexcept override;
+
    private:
-    // Internal implementations that perform the actual logic
+    /**
+     * @brief Internal implementation of doGetBeginEndAddr.
+     *        The VMPilot functions are imported from a DLL, the calls go to
+     *        the "jmp [slot]" thunks of their import address table slots.
+     *        The caching logic is left in the doGetBeginEndAddr method.
+     *
+     * @return A pair of uint64_t values representing the begin and end addresses.
+     */
     std::pair<uint64_t, uint64_t> doGetBeginEndAddrIntl() noexcept;
-    std::vector<uint8_t> doGetTextSectionIntl() noexcept;
 
     /**
-     * Parses headers to locate and return specific PE section data.
+     * @brief Internal implementation of doGetTextSectionView.
+     *        The error logging is left in the doGetTextSection and doGetTextSectionView methods.
      *
-     * @param sectionName The name of the section to retrieve.
-     * @return The data of the section if found, or an empty vector if not.
+     * @return A view of the code section, empty if not found.
      */
-    std::vector<uint8_t> getSectionData(
-        const std::string& sectionName) noexcept;
+    VMPilot::Common::ByteView doGetTextSectionIntl() noexcept;
 };
 
 std::unique_ptr<PEFileHandlerStrategy::Impl> make_pe_impl(
-    const std::string& filename);
+    std::shared_ptr<const VMPilot::Common::MappedFile> file);
 
 }  // namespace VMPilot::SDK::Segmentator
 
@@ -0,0 +1,202 @@
+#ifndef __SDK_PE_IMAGE_HPP__
+#define __SDK_PE_IMAGE_HPP__
+#pragma once
+
+#include <byte_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace VMPilot::SDK::Segmentator {
+
+// One entry of the section table
+struct PESection {
+    std::string_view name;  // Points into the mapping
+    uint32_t virtual_address = 0;
+    uint32_t virtual_size = 0;
+    uint32_t raw_offset = 0;
+    uint32_t raw_size = 0;
+    uint32_t characteristics = 0;
+    // The bytes of the section in the file, the zero fill past them is not
+    // in the file
+    VMPilot::Common::ByteView data;
+
+    static constexpr uint32_t IMAGE_SCN_CNT_CODE = 0x00000020;
+    static constexpr uint32_t IMAGE_SCN_CNT_INITIALIZED_DATA = 0x00000040;
+    static constexpr uint32_t IMAGE_SCN_MEM_EXECUTE = 0x20000000;
+
+    bool isCode() const noexcept {
+        return (characteristics &
+                (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE)) != 0;
+    }
+};
+
+// One imported function, by name or by ordinal
+struct PEImport {
+    std::string_view dll;   // Points into the mapping
+    std::string_view name;  // Empty for an import by ordinal
+    uint16_t ordinal = 0;   // The hint for an import by name
+    uint32_t iat_rva = 0;   // The slot of the import address table
+};
+
+// One record of the COFF symbol table, the auxiliary records are skipped
+struct PESymbol {
+    std::string_view name;  // Points into the mapping
+    uint32_t value = 0;
+    int16_t section_number = 0;  // 1-based, 0 undefined, -1 absolute
+    uint16_t type = 0;
+    uint8_t storage_class = 0;
+    uint8_t aux_symbols = 0;
+
+    static constexpr uint8_t IMAGE_SYM_CLASS_EXTERNAL = 2;
+    static constexpr uint8_t IMAGE_SYM_CLASS_STATIC = 3;
+    static constexpr uint8_t IMAGE_SYM_CLASS_FILE = 103;
+    static constexpr uint8_t IMAGE_SYM_CLASS_WEAK_EXTERNAL = 105;
+
+    bool isFunction() const noexcept { return ((type >> 4) & 0x3) == 2; }
+};
+
+// One exported function, by name or by ordinal only
+struct PEExport {
+    std::string_view name;  // Empty if only exported by ordinal
+    uint32_t rva = 0;
+};
+
+/**
+ * @brief A parser of a PE32 or PE32+ image that is already in memory.
+ *
+ * Like ELFImage, it only reads the headers it needs and copies nothing: the
+ * sections, the names and the section data are views into the mapping,
+ * which must outlive the image. Parsing reads the headers and the section
+ * table only, the other tables are read on demand, so even a huge DLL is
+ * opened in microseconds.
+ */
+class PEImage {
+   public:
+    // The data directories used by the handlers
+    static constexpr size_t IMAGE_DIRECTORY_ENTRY_EXPORT = 0;
+    static constexpr size_t IMAGE_DIRECTORY_ENTRY_IMPORT = 1;
+
+    static constexpr uint32_t NOT_MAPPED = static_cast<uint32_t>(-1);
+    static constexpr uint64_t NOT_FOUND = static_cast<uint64_t>(-1);
+
+    struct DataDirectory {
+        uint32_t rva = 0;
+        uint32_t size = 0;
+    };
+
+    /**
+     * @brief Parse the headers and the section table.
+     *
+     * @param data The whole file.
+     * @throws std::runtime_error if it is not a valid PE image.
+     */
+    explicit PEImage(VMPilot::Common::ByteView data);
+
+    bool is64() const noexcept { return is_64; }
+    uint16_t getMachine() const noexcept { return machine; }
+    uint64_t getImageBase() const noexcept { return image_base; }
+
+    const std::vector<PESection>& getSections() const noexcept {
+        return sections;
+    }
+
+    /**
+     * @brief Find a section by name, the first one of that name.
+     *
+     * @return The section, or nullptr if there is none.
+     */
+    const PESection* findSection(std::string_view name) const noexcept;
+
+    /**
+     * @brief Find the section containing an RVA.
+     *
+     * @return The section, or nullptr if the RVA is in none.
+     */
+    const PESection* findSectionByRva(uint32_t rva) const noexcept;
+
+    /**
+     * @brief The offset in the file of an RVA, or NOT_MAPPED if it is not
+     *        backed by the file.
+     */
+    uint32_t rvaToOffset(uint32_t rva) const noexcept;
+
+    /**
+     * @brief A data directory, all zero if the image does not have it.
+     */
+    DataDirectory getDataDirectory(size_t index) const noexcept;
+
+    /**
+     * @brief Read the import directory, in table order.
+     *
+     * @throws std::runtime_error if a table is out of the file.
+     */
+    std::vector<PEImport> getImports() const;
+
+    /**
+     * @brief Read the export directory, in ordinal order, forwarders are
+     *        skipped.
+     *
+     * @throws std::runtime_error if a table is out of the file.
+     */
+    std::vector<PEExport> getExports() const;
+
+    /**
+     * @brief The number of records of the COFF symbol table, auxiliary
+     *        records included. Images usually do not have one.
+     */
+    size_t getSymbolCount() const noexcept { return symbol_count; }
+
+    /**
+     * @brief Read a record of the COFF symbol table, it must not be an
+     *        auxiliary one.
+     *
+     * @throws std::runtime_error if the record is out of the file.
+     */
+    PESymbol getSymbol(size_t index) const;
+
+    /**
+     * @brief Find the import thunks, the "jmp [slot]" stubs the linker puts
+     *        in the code for the functions not declared dllimport.
+     *
+     * All the code sections are scanned once, whatever the number of slots.
+     *
+     * @param iat_rvas The import address table slots.
+     * @return The address of the first thunk of each slot, in the same
+     *         order, NOT_FOUND if a slot has none.
+     */
+    std::vector<uint64_t> findImportThunks(
+        const std::vector<uint32_t>& iat_rvas) const;
+
+   private:
+    // Read a little endian T at offset of the file
+    template <typename T>
+    T read(uint64_t offset) const;
+    template <typename T>
+    T readAtRva(uint32_t rva) const;
+
+    // Read the NUL terminated string at an RVA, or at an offset of the file
+    std::string_view readStringAtRva(uint32_t rva) const;
+    std::string_view readString(uint64_t offset, uint64_t limit) const;
+
+    VMPilot::Common::ByteView data;
+    bool is_64 = false;
+    uint16_t machine = 0;
+    uint64_t image_base = 0;
+    uint32_t size_of_headers = 0;
+
+    uint64_t directories_offset = 0;
+    uint32_t directory_count = 0;
+
+    uint64_t symbol_table_offset = 0;
+    size_t symbol_count = 0;
+    uint64_t string_table_offset = 0;
+
+    std::vector<PESection> sections;
+};
+
+}  // namespace VMPilot::SDK::Segmentator
+
+#endif  // __SDK_PE_IMAGE_HPP__
@@ -5,7 +5,10 @@
 #include <ArchEnum.hpp>
 #include <ModeEnum.hpp>
 #include <NativeFunctionBase.hpp>
+#include <NativeInstructions.hpp>
 #include <NativeSymbolTable.hpp>
+#include <ProtectedRegion.hpp>
+#include <byte_view.hpp>
 
 #include <cstdint>
 #include <memory>
@@ -26,6 +29,11 @@ class FileHandlerStrategy {
      * @brief Get the entire chuck of the .text section.
      */
     virtual std::vector<uint8_t> doGetTextSection() noexcept;
+    /**
+     * @brief Get a view of the .text section in the mapped file, without
+     *        copying it. The view is valid as long as the handler.
+     */
+    virtual VMPilot::Common::ByteView doGetTextSectionView() noexcept;
 
     virtual uint64_t doGetTextBaseAddr() noexcept;
 
@@ -37,6 +45,9 @@ class FileHandlerStrategy {
         return doGetBeginEndAddr();
     }
     std::vector<uint8_t> getTextSection() { return doGetTextSection(); }
+    VMPilot::Common::ByteView getTextSectionView() {
+        return doGetTextSectionView();
+    }
     uint64_t getTextBaseAddr() { return doGetTextBaseAddr(); }
     NativeSymbolTable getNativeSymbolTable() { return doGetNativeSymbolTable(); }
 };
@@ -51,20 +62,47 @@ class ArchHandlerStrategy {
     /**
     * @brief Load text code to derived pimpl class
     * 
-    * @param code The code to load
+    * @param code The code to load, it is not copied and must outlive the
+    *             handler
     * @param base_addr The base address of the code
     * @return true if the code is loaded successfully, false otherwise
     */
-    virtual bool doLoad(const std::vector<uint8_t>& code,
+    virtual bool doLoad(VMPilot::Common::ByteView code,
                         const uint64_t base_addr);
 
     /**
      * @brief Get the native functions from the derived pimpl class
      * 
-     * @return std::vector<std::unique_ptr<NativeFunctionBase>> The native functions
+     * @param symbols The symbol table of the file, its FUNC entries give the
+     *                functions, the code they do not cover is discovered
+     * @return std::vector<NativeFunctionBase> The native functions
+     */
+    virtual std::vector<NativeFunctionBase>
+    doGetNativeFunctions(const NativeSymbolTable& symbols);
+
+    /**
+     * @brief Find the protected regions of the loaded code.
+     *
+     * @param begin_target The address of VMPilot_Begin, or its stub
+     * @param end_target The address of VMPilot_End, or its stub
+     * @return The regions in address order, indexed from 0
      */
-    virtual std::vector<std::unique_ptr<NativeFunctionBase>>
-    doGetNativeFunctions();
+    virtual std::vector<VMPilot::SDK::ProtectedRegion> doFindRegions(
+        const uint64_t begin_target, const uint64_t end_target);
+
+    /**
+     * @brief Disassemble one region found by doFindRegions
+     *
+     * It is called concurrently for different regions, so it must not share
+     * a disassembler handle between threads.
+     *
+     * @param region The region to disassemble
+     * @param instructions The instructions of the region, replaced
+     * @return true if the whole region is disassembled, false otherwise
+     */
+    virtual bool doDisassembleRegion(
+        const VMPilot::SDK::ProtectedRegion& region,
+        VMPilot::SDK::NativeInstructions& instructions);
 
    public:
     virtual ~ArchHandlerStrategy() = default;
@@ -74,21 +112,48 @@ class ArchHandlerStrategy {
     /**
      * @brief Load text code to derived pimpl class
      * 
-     * @param code The code to load
+     * @param code The code to load, it is not copied and must outlive the
+     *             handler
      * @param base_addr The base address of the code
      * @return true if the code is loaded successfully, false otherwise
      */
-    bool Load(const std::vector<uint8_t>& code, const uint64_t base_addr) {
+    bool Load(VMPilot::Common::ByteView code, const uint64_t base_addr) {
         return doLoad(code, base_addr);
     }
 
     /**
-     * @brief Get the native functions from the derived pimpl class
+     * @brief Get the native functions of the loaded code, in address order
+     * 
+     * The functions are views into the loaded code, they do not own it.
+     * 
+     * @param symbols The symbol table of the file
+     * @return std::vector<NativeFunctionBase> The native functions, valid
+     *         as long as the handler and the loaded code
+     */
+    std::vector<NativeFunctionBase> getNativeFunctions(
+        const NativeSymbolTable& symbols) {
+        return doGetNativeFunctions(symbols);
+    }
+
+    /**
+     * @brief Find the protected regions of the loaded code, by the calls to
+     *        VMPilot_Begin and VMPilot_End
+     * 
+     * @return std::vector<ProtectedRegion> The regions in address order
+     */
+    std::vector<VMPilot::SDK::ProtectedRegion> FindRegions(
+        const uint64_t begin_target, const uint64_t end_target) {
+        return doFindRegions(begin_target, end_target);
+    }
+
+    /**
+     * @brief Disassemble one region, thread-safe between different regions
      * 
-     * @return std::vector<std::unique_ptr<NativeFunctionBase>> The native functions
+     * @return true if the region is disassembled successfully, false otherwise
      */
-    std::vector<std::unique_ptr<NativeFunctionBase>> getNativeFunctions() {
-        return doGetNativeFunctions();
+    bool DisassembleRegion(const VMPilot::SDK::ProtectedRegion& region,
+                           VMPilot::SDK::NativeInstructions& instructions) {
+        return doDisassembleRegion(region, instructions);
     }
 };
 
@@ -0,0 +1,66 @@
+#ifndef __SDK_SEGMENTATOR_STRING_POOL_HPP__
+#define __SDK_SEGMENTATOR_STRING_POOL_HPP__
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace VMPilot::SDK::Segmentator {
+
+/**
+ * @brief A pool of interned strings, each one stored once and named by a
+ *        32-bit id.
+ *
+ * The characters are packed into large chunks that never move, so the
+ * views returned by Get are valid as long as the pool, even after more
+ * strings are added. It is not thread-safe.
+ */
+class StringPool {
+   public:
+    using Id = uint32_t;
+    // The id of the empty string, in every pool
+    static constexpr Id EMPTY = 0;
+
+    StringPool();
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) noexcept = default;
+    StringPool& operator=(StringPool&&) noexcept = default;
+
+    /**
+     * @brief Get the id of a string, adding it on its first use.
+     *
+     * @throws std::length_error if the pool holds 2^32 strings.
+     */
+    Id Intern(std::string_view str);
+
+    /**
+     * @brief Get the string of an id, the empty string for an unknown id.
+     */
+    [[nodiscard]] std::string_view Get(Id id) const noexcept {
+        return id < strings_.size() ? strings_[id] : std::string_view();
+    }
+
+    // The number of different strings, the empty one included
+    [[nodiscard]] size_t Size() const noexcept { return strings_.size(); }
+
+   private:
+    // Copy str into the current chunk, or into a new one
+    std::string_view store(std::string_view str);
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = 0;
+    size_t chunk_size_ = 0;
+
+    std::vector<std::string_view> strings_;
+    std::unordered_map<std::string_view, Id> index_;
+};
+
+}  // namespace VMPilot::SDK::Segmentator
+
+#endif  // __SDK_SEGMENTATOR_STRING_POOL_HPP__
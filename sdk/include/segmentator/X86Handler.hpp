@@ -8,6 +8,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace VMPilot::SDK::Segmentator {
 class X86Handler : public ArchHandlerStrategy {
@@ -21,11 +22,19 @@ class X86Handler : public ArchHandlerStrategy {
     friend std::unique_ptr<Impl> make_x86_handler_impl(Mode mode);
 
    protected:
-    virtual bool doLoad(const std::vector<uint8_t>& code,
+    virtual bool doLoad(VMPilot::Common::ByteView code,
                         const uint64_t base_addr) noexcept override;
 
-    virtual std::vector<std::unique_ptr<NativeFunctionBase>>
-    doGetNativeFunctions() noexcept override;
+    virtual std::vector<NativeFunctionBase>
+    doGetNativeFunctions(const NativeSymbolTable& symbols) noexcept override;
+
+    virtual std::vector<VMPilot::SDK::ProtectedRegion> doFindRegions(
+        const uint64_t begin_target,
+        const uint64_t end_target) noexcept override;
+
+    virtual bool doDisassembleRegion(
+        const VMPilot::SDK::ProtectedRegion& region,
+        VMPilot::SDK::NativeInstructions& instructions) noexcept override;
 };
 
 std::unique_ptr<X86Handler::Impl> make_x86_handler_impl(Mode mode);
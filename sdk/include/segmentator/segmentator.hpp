@@ -1,6 +1,8 @@
 #ifndef __SDK_SEGMENTATOR_HPP__
 #define __SDK_SEGMENTATOR_HPP__
 
+#include <NativeInstructions.hpp>
+#include <ProtectedRegion.hpp>
 #include <Strategy.hpp>
 #include <file_type_parser.hpp>
 
@@ -8,6 +10,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace VMPilot::SDK::Segmentator {
 class Segmentator {
@@ -15,22 +18,68 @@ class Segmentator {
     VMPilot::Common::FileMetadata m_metadata;
     std::unique_ptr<FileHandlerStrategy> m_file_handler;
     std::unique_ptr<ArchHandlerStrategy> m_arch_handler;
+    std::vector<VMPilot::SDK::ProtectedRegion> m_regions;
 
     friend std::unique_ptr<Segmentator> create_segmentator(
-        const std::string& filename) noexcept;
+        VMPilot::Common::FileMetadata metadata) noexcept;
 
-   protected:
-    virtual void segmentation() noexcept;
+    // not allowed to construct outside, please use create_segmentator
+    Segmentator() = default;
 
    public:
-    // not allowed to default construct, please use create_segmentator
-    Segmentator() = delete;
     virtual ~Segmentator() = default;
+
+    /**
+     * @brief Find the protected regions of the file.
+     *
+     * The regions are only located here, they are disassembled one by one
+     * with disassembleRegion. The errors are logged.
+     *
+     * @return true if the segmentation succeeded.
+     */
+    virtual bool segmentation() noexcept;
+
+    /**
+     * @brief The regions found by segmentation, in address order.
+     */
+    const std::vector<VMPilot::SDK::ProtectedRegion>& getRegions()
+        const noexcept {
+        return m_regions;
+    }
+
+    /**
+     * @brief Disassemble one of the regions of getRegions.
+     *
+     * Different regions may be disassembled concurrently, each thread uses
+     * its own disassembler handle. The errors are logged.
+     *
+     * @param region The region to disassemble.
+     * @param instructions The instructions of the region, replaced.
+     * @return true if the region is disassembled.
+     */
+    bool disassembleRegion(
+        const VMPilot::SDK::ProtectedRegion& region,
+        VMPilot::SDK::NativeInstructions& instructions) noexcept;
 };
 
+/**
+ * @brief Create the segmentator of a file.
+ *
+ * @return The segmentator, or nullptr if the file cannot be parsed.
+ */
 std::unique_ptr<Segmentator> create_segmentator(
     const std::string& filename) noexcept;
 
+/**
+ * @brief Create the segmentator of a file whose metadata is already parsed.
+ *
+ * The file handler reuses the mapping of the metadata.
+ *
+ * @return The segmentator, or nullptr if there is no handler for the file.
+ */
+std::unique_ptr<Segmentator> create_segmentator(
+    VMPilot::Common::FileMetadata metadata) noexcept;
+
 }  // namespace VMPilot::SDK::Segmentator
 
 #endif
\ No newline at end of file
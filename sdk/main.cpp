@@ -1,4 +1,101 @@
+#include <BatchDriver.hpp>
 
-int main() {
-    return 0;
-}
\ No newline at end of file
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+void usage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [-j threads] [-m max_inflight_inputs] [-c cache_dir] "
+                 "recipe.json...\n"
+              << "  A recipe file holds one recipe or an array of them.\n"
+              << "  -j  The worker threads, 0 (default) for all the cores.\n"
+              << "  -m  The inputs mapped at the same time, 0 (default) "
+                 "for the number of threads.\n"
+              << "  -c  Reuse the bytecode of the unchanged regions, "
+                 "cached in cache_dir.\n";
+}
+
+bool parse_count(const char* text, size_t& value) {
+    char* end = nullptr;
+    const auto parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0')
+        return false;
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    VMPilot::SDK::BatchOptions options;
+    std::vector<std::string> recipe_files;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "-j" || arg == "-m") && i + 1 < argc) {
+            auto& value =
+                arg == "-j" ? options.threads : options.max_inflight_inputs;
+            if (!parse_count(argv[++i], value)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (arg == "-c" && i + 1 < argc) {
+            options.cache_dir = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            recipe_files.push_back(arg);
+        }
+    }
+    if (recipe_files.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<VMPilot::SDK::BytecodeCompileRecipe> recipes;
+    try {
+        for (const auto& file : recipe_files) {
+            auto loaded = VMPilot::SDK::LoadRecipes(file);
+            recipes.insert(recipes.end(),
+                           std::make_move_iterator(loaded.begin()),
+                           std::make_move_iterator(loaded.end()));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+
+    std::vector<VMPilot::SDK::BatchResult> results;
+    try {
+        results = VMPilot::SDK::ProtectBatch(recipes, options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+
+    int failed = 0;
+    for (const auto& result : results) {
+        if (result.success) {
+            std::cout << "OK     " << result.input << " -> " << result.output;
+            if (!options.cache_dir.empty())
+                std::cout << " (" << result.stats.cached_regions << '/'
+                          << result.stats.regions << " regions cached)";
+            std::cout << '\n';
+        } else {
+            std::cout << "FAILED " << result.input << ": " << result.error
+                      << '\n';
+            ++failed;
+        }
+    }
+    std::cout << results.size() - failed << " protected, " << failed
+              << " failed\n";
+
+    return failed == 0 ? 0 : 1;
+}
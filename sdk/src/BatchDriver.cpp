@@ -0,0 +1,306 @@
+#include <BatchDriver.hpp>
+#include <ELFRewriter.hpp>
+#include <RegionCache.hpp>
+#include <ThreadPool.hpp>
+#include <bytecode_compiler.hpp>
+#include <file_type_parser.hpp>
+#include <instruction_cipher.hpp>
+#include <instruction_t.hpp>
+#include <segmentator.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace VMPilot::SDK;
+
+namespace {
+namespace detail {
+// The name of the bytecode compiler of a file, as CompilerFactory knows it
+std::string compiler_name(const VMPilot::Common::FileMetadata& metadata) {
+    using VMPilot::Common::FileArch;
+    using VMPilot::Common::FileMode;
+    switch (metadata.arch) {
+        case FileArch::X86:
+            return metadata.mode == FileMode::MODE_64 ? "x86_64" : "x86";
+        case FileArch::ARM:
+            return "arm";
+        case FileArch::ARM64:
+            return "arm64";
+        default:
+            throw std::runtime_error("No bytecode compiler for the file "
+                                     "architecture");
+    }
+}
+
+std::string hex(uint64_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << value;
+    return out.str();
+}
+
+// The section of the bytecode in the protected file
+constexpr std::string_view BYTECODE_SECTION = ".vmpilot";
+constexpr char BYTECODE_MAGIC[4] = {'V', 'M', 'P', 'B'};
+constexpr uint32_t BYTECODE_VERSION = 1;
+
+void put_le(std::vector<uint8_t>& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+// The bytecode section, little endian like every supported architecture:
+//   magic, version, region count (4 bytes each)
+//   cipher version, checksum version of the bytecode (1 byte each), reserved
+//   (2 bytes)
+//   per region: begin_addr, end_addr, offset, size (8 bytes each)
+//   the bytecode of the regions, in address order
+// The offsets are from the start of the section, so the runtime finds the
+// bytecode of a VMPilot_Begin call by the address after it.
+std::vector<uint8_t> bytecode_section(
+    const std::vector<VMPilot::SDK::ProtectedRegion>& regions,
+    const std::vector<std::vector<uint8_t>>& bytecode) {
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t ENTRY_SIZE = 32;
+    size_t size = HEADER_SIZE + ENTRY_SIZE * regions.size();
+    for (const auto& code : bytecode)
+        size += code.size();
+
+    std::vector<uint8_t> section;
+    section.reserve(size);
+    section.insert(section.end(), std::begin(BYTECODE_MAGIC),
+                   std::end(BYTECODE_MAGIC));
+    put_le(section, BYTECODE_VERSION, 4);
+    put_le(section, regions.size(), 4);
+    put_le(section,
+           static_cast<uint8_t>(VMPilot::Common::CURRENT_CIPHER_VERSION), 1);
+    put_le(section,
+           static_cast<uint8_t>(VMPilot::Common::CURRENT_CHECKSUM_VERSION), 1);
+    put_le(section, 0, 2);
+
+    uint64_t offset = HEADER_SIZE + ENTRY_SIZE * regions.size();
+    for (size_t i = 0; i < regions.size(); ++i) {
+        put_le(section, regions[i].begin_addr, 8);
+        put_le(section, regions[i].end_addr, 8);
+        put_le(section, offset, 8);
+        put_le(section, bytecode[i].size(), 8);
+        offset += bytecode[i].size();
+    }
+    for (const auto& code : bytecode)
+        section.insert(section.end(), code.begin(), code.end());
+    return section;
+}
+
+// The native code of a region is replaced by a jump to its VMPilot_End
+// call: VMPilot_Begin runs the bytecode, then the region is skipped. The
+// rest is filled with traps.
+std::vector<uint8_t> region_stub(VMPilot::Common::FileArch arch,
+                                 const VMPilot::SDK::ProtectedRegion& region) {
+    using VMPilot::Common::FileArch;
+    const uint64_t size = region.end_addr - region.begin_addr;
+    std::vector<uint8_t> stub;
+    switch (arch) {
+        case FileArch::X86: {
+            // jmp rel32, jmp rel8, or a nop falling through to the call
+            stub.resize(size, 0xCC);
+            if (size >= 5) {
+                stub[0] = 0xE9;
+                const auto rel = static_cast<uint32_t>(size - 5);
+                for (size_t i = 0; i < 4; ++i)
+                    stub[1 + i] = static_cast<uint8_t>(rel >> (i * 8));
+            } else if (size >= 2) {
+                stub[0] = 0xEB;
+                stub[1] = static_cast<uint8_t>(size - 2);
+            } else if (size == 1) {
+                stub[0] = 0x90;
+            }
+            return stub;
+        }
+        case FileArch::ARM64: {
+            // b end_addr, then brk #0
+            if (size % 4 != 0)
+                throw std::runtime_error("Misaligned ARM64 region at " +
+                                         hex(region.begin_addr));
+            for (uint64_t at = 0; at < size; at += 4) {
+                const uint32_t instruction =
+                    at == 0 ? 0x14000000u |
+                                  static_cast<uint32_t>(size / 4 & 0x3ffffff)
+                            : 0xd4200000u;
+                put_le(stub, instruction, 4);
+            }
+            return stub;
+        }
+        default:
+            throw std::runtime_error("No region stub for the file "
+                                     "architecture");
+    }
+}
+
+// Give back an in-flight slot however the job ends
+class SlotGuard {
+   public:
+    explicit SlotGuard(Semaphore& slots) : slots_(slots) {}
+    ~SlotGuard() { slots_.Release(); }
+
+    SlotGuard(const SlotGuard&) = delete;
+    SlotGuard& operator=(const SlotGuard&) = delete;
+
+   private:
+    Semaphore& slots_;
+};
+}  // namespace detail
+}  // namespace
+
+ProtectStats VMPilot::SDK::Protect(const BytecodeCompileRecipe& recipe,
+                                   ThreadPool* pool,
+                                   const RegionCache* cache) {
+    // The input is mapped once here, the handlers share the mapping
+    auto metadata = VMPilot::Common::get_file_metadata(recipe.GetInput());
+    const auto name = detail::compiler_name(metadata);
+    const auto arch = metadata.arch;
+
+    // Laid out before any region is compiled, an input that cannot be
+    // rewritten fails fast
+    if (metadata.format != VMPilot::Common::FileFormat::ELF)
+        throw std::runtime_error("Only ELF files can be written protected");
+    Rewriter::ELFRewriter rewriter(metadata.file);
+
+    const auto compiler =
+        BytecodeCompiler::CompilerFactory::CreateCompiler(name);
+    if (compiler == nullptr)
+        throw std::runtime_error("Unknown bytecode compiler: " + name);
+
+    // The same path as CompilerBase::Compile, with the cache and the pool
+    const auto segmentator =
+        BytecodeCompiler::CompilerBase::Segment(std::move(metadata));
+
+    // The part of the cache keys shared by all the regions of the file
+    std::optional<RegionCache::Key> context;
+    if (cache != nullptr)
+        context = RegionCache::MakeContext(*compiler, recipe);
+
+    // The regions are independent, each one is disassembled and compiled
+    // into its own slot
+    const auto& regions = segmentator->getRegions();
+    std::vector<std::vector<uint8_t>> bytecode(regions.size());
+    // Per region like the bytecode, so the workers share nothing
+    std::vector<BytecodeCompiler::FusionStats> fusion(regions.size());
+    std::atomic<size_t> cached_regions{0};
+    const auto compile_region = [&](size_t i) {
+        const auto& region = regions[i];
+        std::optional<RegionCache::Key> key;
+        if (context) {
+            key = RegionCache::MakeKey(*context, region);
+            if (auto cached = cache->Load(*key)) {
+                bytecode[i] = std::move(*cached);
+                ++cached_regions;
+                return;
+            }
+        }
+
+        bytecode[i] = compiler->DisassembleAndCompile(recipe, *segmentator,
+                                                      region, &fusion[i]);
+        if (key)
+            cache->Store(*key, bytecode[i]);
+    };
+    if (pool != nullptr) {
+        pool->ParallelFor(regions.size(), compile_region);
+    } else {
+        for (size_t i = 0; i < regions.size(); ++i)
+            compile_region(i);
+    }
+
+    // Merged in the region order, so the output does not depend on the
+    // scheduling. Only the headers, the stubs and the section are written
+    // from memory, the rest is copied from the input.
+    for (const auto& region : regions)
+        rewriter.Patch(region.begin_addr, detail::region_stub(arch, region));
+    rewriter.SetSection(std::string(detail::BYTECODE_SECTION),
+                        detail::bytecode_section(regions, bytecode));
+    rewriter.Write(recipe.GetOutput());
+
+    ProtectStats stats;
+    stats.regions = regions.size();
+    stats.cached_regions = cached_regions;
+    for (const auto& region_fusion : fusion)
+        stats.fusion += region_fusion;
+    return stats;
+}
+
+std::vector<BatchResult> VMPilot::SDK::ProtectBatch(
+    const std::vector<BytecodeCompileRecipe>& recipes,
+    const BatchOptions& options) {
+    return ProtectBatch(recipes, options, Protect);
+}
+
+std::vector<BatchResult> VMPilot::SDK::ProtectBatch(
+    const std::vector<BytecodeCompileRecipe>& recipes,
+    const BatchOptions& options, const BatchJob& job) {
+    std::vector<BatchResult> results(recipes.size());
+    if (recipes.empty())
+        return results;
+
+    // Shared by the jobs, an entry stored by one job is a hit for the others
+    std::unique_ptr<RegionCache> cache;
+    if (!options.cache_dir.empty())
+        cache = std::make_unique<RegionCache>(options.cache_dir);
+
+    ThreadPool pool(options.threads);
+    Semaphore slots(options.max_inflight_inputs != 0
+                        ? options.max_inflight_inputs
+                        : pool.Size());
+
+    for (size_t i = 0; i < recipes.size(); ++i) {
+        // Acquire here rather than in the job, so no worker blocks on a slot
+        slots.Acquire();
+        pool.Submit([&, i] {
+            detail::SlotGuard guard(slots);
+            auto& result = results[i];
+            try {
+                result.input = recipes[i].GetInput();
+                result.output = recipes[i].GetOutput();
+                result.stats = job(recipes[i], &pool, cache.get());
+                result.success = true;
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+        });
+    }
+    pool.Wait();
+
+    return results;
+}
+
+std::vector<BytecodeCompileRecipe> VMPilot::SDK::LoadRecipes(
+    const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file)
+        throw std::runtime_error("Failed to open the recipe: " + filename);
+
+    nlohmann::json json;
+    try {
+        file >> json;
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Invalid recipe " + filename + ": " +
+                                 e.what());
+    }
+
+    std::vector<BytecodeCompileRecipe> recipes;
+    if (json.is_array()) {
+        recipes.reserve(json.size());
+        for (auto& recipe : json)
+            recipes.emplace_back(std::move(recipe));
+    } else {
+        recipes.emplace_back(std::move(json));
+    }
+    return recipes;
+}
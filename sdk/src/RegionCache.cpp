@@ -0,0 +1,260 @@
+#include <RegionCache.hpp>
+#include <instruction_cipher.hpp>
+#include <instruction_t.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <blake3.h>
+#include <spdlog/spdlog.h>
+
+using namespace VMPilot::SDK;
+
+namespace {
+namespace detail {
+// Bump it when the key or the entry layout changes, the old entries are then
+// never read again
+constexpr uint32_t FORMAT_VERSION = 2;
+constexpr char ENTRY_MAGIC[4] = {'V', 'M', 'P', 'C'};
+// magic, version, key, payload size, then the payload and its hash
+constexpr size_t HEADER_SIZE = 4 + 4 + 32 + 8;
+constexpr size_t DIGEST_SIZE = BLAKE3_OUT_LEN;
+
+void put_u32(std::string& out, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+void put_u64(std::string& out, uint64_t value) {
+    for (size_t i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>(value >> (i * 8)));
+}
+
+uint32_t get_u32(const uint8_t* data) noexcept {
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i)
+        value |= static_cast<uint32_t>(data[i]) << (i * 8);
+    return value;
+}
+
+uint64_t get_u64(const uint8_t* data) noexcept {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i)
+        value |= static_cast<uint64_t>(data[i]) << (i * 8);
+    return value;
+}
+
+// The fields are length prefixed, so no two inputs hash the same bytes
+void update(blake3_hasher& hasher, std::string_view field) noexcept {
+    uint8_t size[8];
+    for (size_t i = 0; i < 8; ++i)
+        size[i] = static_cast<uint8_t>(field.size() >> (i * 8));
+    blake3_hasher_update(&hasher, size, sizeof(size));
+    blake3_hasher_update(&hasher, field.data(), field.size());
+}
+
+void update(blake3_hasher& hasher, uint64_t value) noexcept {
+    uint8_t packed[8];
+    for (size_t i = 0; i < 8; ++i)
+        packed[i] = static_cast<uint8_t>(value >> (i * 8));
+    blake3_hasher_update(&hasher, packed, sizeof(packed));
+}
+
+std::array<uint8_t, DIGEST_SIZE> digest(const uint8_t* data,
+                                        size_t size) noexcept {
+    std::array<uint8_t, DIGEST_SIZE> out;
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, size);
+    blake3_hasher_finalize(&hasher, out.data(), out.size());
+    return out;
+}
+
+std::string to_hex(const RegionCache::Key& key) {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(key.size() * 2);
+    for (const auto byte : key) {
+        out.push_back(digits[byte >> 4]);
+        out.push_back(digits[byte & 0xf]);
+    }
+    return out;
+}
+
+// A temporary name no other thread or process writes at the same time
+std::string unique_suffix() {
+    static const uint64_t process_nonce = [] {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) | device();
+    }();
+    static std::atomic<uint64_t> counter{0};
+    const auto thread =
+        std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return "." + std::to_string(process_nonce) + "." +
+           std::to_string(thread) + "." + std::to_string(++counter) + ".tmp";
+}
+}  // namespace detail
+}  // namespace
+
+RegionCache::RegionCache(std::filesystem::path directory)
+    : directory_(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error || !std::filesystem::is_directory(directory_))
+        throw std::runtime_error("Failed to create the cache directory " +
+                                 directory_.string() + ": " +
+                                 error.message());
+}
+
+RegionCache::Key RegionCache::MakeContext(
+    const BytecodeCompiler::CompilerBase& compiler,
+    const BytecodeCompileRecipe& recipe) {
+    // The master key and the other settings, in the sorted key order of
+    // nlohmann::json, so the same settings always dump the same
+    auto settings = recipe.GetScript();
+    settings.erase("input");
+    settings.erase("output");
+
+    // derive_key mode keeps the keys apart from every other BLAKE3 usage
+    blake3_hasher hasher;
+    blake3_hasher_init_derive_key(&hasher, "VMPilot region cache context");
+    detail::update(hasher, uint64_t{detail::FORMAT_VERSION});
+    detail::update(hasher, compiler.GetName());
+    detail::update(hasher, uint64_t{compiler.GetVersion()});
+    detail::update(hasher, static_cast<uint64_t>(
+                               VMPilot::Common::CURRENT_CIPHER_VERSION));
+    detail::update(hasher, static_cast<uint64_t>(
+                               VMPilot::Common::CURRENT_CHECKSUM_VERSION));
+    detail::update(hasher, settings.dump());
+
+    Key context;
+    blake3_hasher_finalize(&hasher, context.data(), context.size());
+    return context;
+}
+
+RegionCache::Key RegionCache::MakeKey(const Key& context,
+                                      const ProtectedRegion& region) {
+    blake3_hasher hasher;
+    blake3_hasher_init_keyed(&hasher, context.data());
+    detail::update(hasher, region.begin_addr);
+    detail::update(hasher, region.end_addr);
+    detail::update(hasher,
+                   std::string_view(
+                       reinterpret_cast<const char*>(region.code.data()),
+                       region.code.size()));
+
+    Key key;
+    blake3_hasher_finalize(&hasher, key.data(), key.size());
+    return key;
+}
+
+std::filesystem::path RegionCache::EntryPath(const Key& key) const {
+    const auto name = detail::to_hex(key);
+    return directory_ / name.substr(0, 2) / name.substr(2);
+}
+
+std::optional<std::vector<uint8_t>> RegionCache::Load(
+    const Key& key) const noexcept {
+    try {
+        const auto path = EntryPath(key);
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return std::nullopt;
+
+        const auto end = file.tellg();
+        if (end < 0 || static_cast<uint64_t>(end) <
+                           detail::HEADER_SIZE + detail::DIGEST_SIZE)
+            return std::nullopt;
+        std::vector<uint8_t> entry(static_cast<size_t>(end));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(entry.data()),
+                  static_cast<std::streamsize>(entry.size()));
+        if (!file)
+            return std::nullopt;
+
+        // The key is checked too, a renamed entry is not a hit
+        const auto* header = entry.data();
+        const uint64_t size = detail::get_u64(header + 40);
+        if (std::memcmp(header, detail::ENTRY_MAGIC, 4) != 0 ||
+            detail::get_u32(header + 4) != detail::FORMAT_VERSION ||
+            std::memcmp(header + 8, key.data(), key.size()) != 0 ||
+            size != entry.size() - detail::HEADER_SIZE - detail::DIGEST_SIZE) {
+            spdlog::warn("Ignoring the invalid cache entry {}", path.string());
+            return std::nullopt;
+        }
+
+        const auto* payload = entry.data() + detail::HEADER_SIZE;
+        const auto actual = detail::digest(payload, size);
+        if (std::memcmp(actual.data(), payload + size, actual.size()) != 0) {
+            spdlog::warn("Ignoring the damaged cache entry {}", path.string());
+            return std::nullopt;
+        }
+
+        return std::vector<uint8_t>(payload, payload + size);
+    } catch (const std::exception& e) {
+        spdlog::warn("Failed to read a cache entry: {}", e.what());
+        return std::nullopt;
+    }
+}
+
+bool RegionCache::Store(const Key& key,
+                        const std::vector<uint8_t>& bytecode) const noexcept {
+    try {
+        const auto path = EntryPath(key);
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        if (error) {
+            spdlog::warn("Failed to create the cache directory {}: {}",
+                         path.parent_path().string(), error.message());
+            return false;
+        }
+
+        std::string header(detail::ENTRY_MAGIC, sizeof(detail::ENTRY_MAGIC));
+        detail::put_u32(header, detail::FORMAT_VERSION);
+        header.append(reinterpret_cast<const char*>(key.data()), key.size());
+        detail::put_u64(header, bytecode.size());
+        const auto hash = detail::digest(bytecode.data(), bytecode.size());
+
+        auto tmp = path;
+        tmp += detail::unique_suffix();
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            file.write(header.data(),
+                       static_cast<std::streamsize>(header.size()));
+            file.write(reinterpret_cast<const char*>(bytecode.data()),
+                       static_cast<std::streamsize>(bytecode.size()));
+            file.write(reinterpret_cast<const char*>(hash.data()),
+                       static_cast<std::streamsize>(hash.size()));
+            if (!file) {
+                file.close();
+                std::filesystem::remove(tmp, error);
+                spdlog::warn("Failed to write the cache entry {}",
+                             tmp.string());
+                return false;
+            }
+        }
+
+        // The same key always holds the same bytecode, so a concurrent
+        // writer of the same entry replacing this one is harmless
+        std::filesystem::rename(tmp, path, error);
+        if (error) {
+            spdlog::warn("Failed to store the cache entry {}: {}",
+                         path.string(), error.message());
+            std::filesystem::remove(tmp, error);
+            return false;
+        }
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::warn("Failed to store a cache entry: {}", e.what());
+        return false;
+    }
+}
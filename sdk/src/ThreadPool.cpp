@@ -0,0 +1,198 @@
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+using namespace VMPilot::SDK;
+
+namespace {
+// The pool and the index of the worker running on this thread
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    queues_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        threads_.emplace_back([this, i] { worker_loop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+size_t ThreadPool::current_worker() const noexcept {
+    return current_pool == this ? current_index : threads_.size();
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    size_t index = current_worker();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++queued_;
+        ++pending_;
+        if (index == threads_.size())
+            index = next_queue_++ % threads_.size();
+    }
+
+    {
+        auto& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::RunPendingTask() {
+    std::function<void()> task;
+    if (!pop_or_steal(current_worker(), task))
+        return false;
+    run(task);
+    return true;
+}
+
+void ThreadPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)>& body) {
+    if (count == 0)
+        return;
+    if (count == 1) {
+        body(0);
+        return;
+    }
+
+    // The tasks only touch this state, it outlives them since we wait here
+    struct Group {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining;
+        std::vector<std::exception_ptr> errors;
+    } group;
+    group.remaining = count;
+    group.errors.resize(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        Submit([&group, &body, i] {
+            std::exception_ptr error;
+            try {
+                body(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(group.mutex);
+            group.errors[i] = error;
+            if (--group.remaining == 0)
+                group.done.notify_all();
+        });
+    }
+
+    // Help while some of the tasks are still queued. Once nothing is left to
+    // run, the remaining ones are running on the other workers.
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(group.mutex);
+            if (group.remaining == 0)
+                break;
+        }
+        if (!RunPendingTask()) {
+            std::unique_lock<std::mutex> lock(group.mutex);
+            group.done.wait(lock, [&group] { return group.remaining == 0; });
+            break;
+        }
+    }
+
+    for (const auto& error : group.errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    for (;;) {
+        std::function<void()> task;
+        if (pop_or_steal(index, task)) {
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0)
+            return;
+    }
+}
+
+bool ThreadPool::pop_or_steal(size_t index, std::function<void()>& task) {
+    const size_t count = queues_.size();
+
+    // The own deque from the back, the tasks it just submitted are hot
+    if (index < count) {
+        auto& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+
+    // Steal the oldest task of the next workers
+    for (size_t i = 1; !task && i <= count; ++i) {
+        auto& queue = *queues_[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    --queued_;
+    return true;
+}
+
+void ThreadPool::run(std::function<void()>& task) noexcept {
+    try {
+        task();
+    } catch (const std::exception& e) {
+        spdlog::error("ThreadPool: task failed: {}", e.what());
+    } catch (...) {
+        spdlog::error("ThreadPool: task failed with an unknown exception");
+    }
+    task = nullptr;
+
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle = --pending_ == 0;
+    }
+    if (idle)
+        idle_.notify_all();
+}
@@ -1,7 +1,14 @@
 #include <bytecode_compiler.hpp>
+#include <segmentator.hpp>
 #include <x86_64_compiler.hpp>
 #include <x86_compiler.hpp>
 
+#include <spdlog/spdlog.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
 using namespace VMPilot::SDK::BytecodeCompiler;
 
 std::unique_ptr<CompilerBase> CompilerFactory::CreateCompiler(
@@ -22,4 +29,61 @@ std::vector<uint8_t> _NotImplementedYet::Compile(
     [[maybe_unused]] const BytecodeCompileRecipe& script) {
     throw std::runtime_error(
         "Not implemented yet, but it is in the future work.");
-}
\ No newline at end of file
+}
+std::vector<uint8_t> _NotImplementedYet::CompileRegion(
+    [[maybe_unused]] const BytecodeCompileRecipe& script,
+    [[maybe_unused]] const VMPilot::SDK::ProtectedRegion& region,
+    [[maybe_unused]] const VMPilot::SDK::NativeInstructions& instructions,
+    [[maybe_unused]] FusionStats& fusion) const {
+    throw std::runtime_error("The " + GetName() +
+                             " compiler cannot compile regions yet.");
+}
+
+std::unique_ptr<VMPilot::SDK::Segmentator::Segmentator> CompilerBase::Segment(
+    VMPilot::Common::FileMetadata metadata) {
+    auto segmentator =
+        VMPilot::SDK::Segmentator::create_segmentator(std::move(metadata));
+    if (segmentator == nullptr)
+        throw std::runtime_error("Failed to create the segmentator");
+    if (!segmentator->segmentation())
+        throw std::runtime_error("Segmentation failed");
+    return segmentator;
+}
+
+std::vector<uint8_t> CompilerBase::DisassembleAndCompile(
+    const BytecodeCompileRecipe& script,
+    VMPilot::SDK::Segmentator::Segmentator& segmentator,
+    const VMPilot::SDK::ProtectedRegion& region, FusionStats* fusion) const {
+    // The instructions only live for the region
+    VMPilot::SDK::NativeInstructions instructions;
+    if (!segmentator.disassembleRegion(region, instructions)) {
+        std::ostringstream message;
+        message << "Failed to disassemble the region at 0x" << std::hex
+                << region.begin_addr;
+        throw std::runtime_error(message.str());
+    }
+    FusionStats dropped;
+    return CompileRegion(script, region, instructions,
+                         fusion != nullptr ? *fusion : dropped);
+}
+
+std::vector<uint8_t> CompilerBase::CompileRegions(
+    const BytecodeCompileRecipe& script) const {
+    const auto segmentator =
+        Segment(VMPilot::Common::get_file_metadata(script.GetInput()));
+
+    std::vector<uint8_t> result;
+    FusionStats fusion;
+    for (const auto& region : segmentator->getRegions()) {
+        const auto bytecode =
+            DisassembleAndCompile(script, *segmentator, region, &fusion);
+        result.insert(result.end(), bytecode.begin(), bytecode.end());
+    }
+    spdlog::debug(
+        "{}: {} VM instructions fused into {} ({} LOAD_ADD_STORE, {} "
+        "CMP_JZ, {} CMP_JNZ)",
+        script.GetInput(), fusion.instructions_before,
+        fusion.instructions_after, fusion.load_add_store, fusion.cmp_jz,
+        fusion.cmp_jnz);
+    return result;
+}
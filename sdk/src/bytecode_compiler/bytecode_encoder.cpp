@@ -0,0 +1,125 @@
+#include <bytecode_encoder.hpp>
+#include <opcode_enum.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+using namespace VMPilot::SDK::BytecodeCompiler;
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
+using VMPilot::Common::Instruction_t;
+using VMPilot::Common::MAX_OPCODE_COUNT;
+using VMPilot::Common::Opcode_t;
+
+namespace {
+namespace detail {
+using namespace VMPilot::Common::Opcode::Enum;
+
+// Each enum class of opcode_enum.hpp gets 16 slots of the dense index
+constexpr size_t SLOTS = MAX_OPCODE_COUNT / 4;
+
+template <typename Enum>
+constexpr bool fits_slots() {
+    return static_cast<size_t>(Enum::__END) -
+               static_cast<size_t>(Enum::__BEGIN) <=
+           SLOTS;
+}
+static_assert(fits_slots<DataMovement>() && fits_slots<ArithmeticLogic>() &&
+                  fits_slots<ControlTransfer>() &&
+                  fits_slots<ThreadingAtomic>(),
+              "An opcode enum class outgrew its slots of the OID table");
+
+// The dense index of a real opcode, MAX_OPCODE_COUNT if it is not one
+constexpr size_t oid_index(Opcode_t opcode) noexcept {
+    const auto slot = [opcode](auto begin, auto end,
+                               size_t first) -> size_t {
+        const auto b = static_cast<Opcode_t>(begin);
+        const auto e = static_cast<Opcode_t>(end);
+        return opcode >= b && opcode < e ? first + (opcode - b)
+                                         : MAX_OPCODE_COUNT;
+    };
+    if (opcode >= static_cast<Opcode_t>(ThreadingAtomic::__BEGIN))
+        return slot(ThreadingAtomic::__BEGIN, ThreadingAtomic::__END,
+                    3 * SLOTS);
+    if (opcode >= static_cast<Opcode_t>(ControlTransfer::__BEGIN))
+        return slot(ControlTransfer::__BEGIN, ControlTransfer::__END,
+                    2 * SLOTS);
+    if (opcode >= static_cast<Opcode_t>(ArithmeticLogic::__BEGIN))
+        return slot(ArithmeticLogic::__BEGIN, ArithmeticLogic::__END, SLOTS);
+    return slot(DataMovement::__BEGIN, DataMovement::__END, 0);
+}
+static_assert(oid_index(static_cast<Opcode_t>(DataMovement::MOV)) == 0);
+static_assert(oid_index(static_cast<Opcode_t>(ArithmeticLogic::CMP)) ==
+              SLOTS + 7);
+static_assert(oid_index(static_cast<Opcode_t>(ThreadingAtomic::__END)) ==
+              MAX_OPCODE_COUNT);
+
+// The nounce of an instruction, a splitmix64 step of its region address
+// and index. It only salts the checksum, the cipher counter holds the
+// region address and the index themselves.
+uint32_t nounce(uint64_t region_addr, uint64_t index) noexcept {
+    uint64_t z = region_addr + (index + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
+
+// Write the packed big-endian encoding, the inverse of Runtime::detail::Fetch
+void encode(const Instruction_t& inst, uint8_t* out) noexcept {
+    const auto put = [&out](uint64_t value, size_t size) {
+        for (size_t i = size; i > 0; --i)
+            *out++ = static_cast<uint8_t>(value >> (8 * (i - 1)));
+    };
+    put(inst.opcode, sizeof(inst.opcode));
+    put(inst.left_operand, sizeof(inst.left_operand));
+    put(inst.right_operand, sizeof(inst.right_operand));
+    put(inst.nounce, sizeof(inst.nounce));
+    put(inst.checksum, sizeof(inst.checksum));
+}
+}  // namespace detail
+}  // namespace
+
+BytecodeEncoder::BytecodeEncoder(const std::string& key)
+    : key_(key), cipher_(key) {
+    // The Buildtime_OT is only read here, the lookups go to the flat table
+    const auto table =
+        VMPilot::Common::Opcode_table_generator(key).Get_RealOp_to_OID();
+    for (const auto& [opcode, oid] : table) {
+        const auto index = detail::oid_index(opcode);
+        if (index >= MAX_OPCODE_COUNT)
+            throw std::runtime_error("Invalid real opcode in the OID table");
+        oids_[index] = oid;
+        valid_[index] = true;
+    }
+}
+
+const BytecodeEncoder& BytecodeEncoder::ForThread(const std::string& key) {
+    thread_local std::unique_ptr<BytecodeEncoder> encoder;
+    if (encoder == nullptr || encoder->GetKey() != key)
+        encoder = std::make_unique<BytecodeEncoder>(key);
+    return *encoder;
+}
+
+std::vector<uint8_t> BytecodeEncoder::Encode(std::vector<Instruction_t>& insts,
+                                             uint64_t region_addr) const {
+    if (insts.size() >= VMPilot::Common::InstructionCipher::MAX_INSTRUCTIONS)
+        throw std::runtime_error("Too many instructions in the region");
+    for (size_t i = 0; i < insts.size(); ++i) {
+        auto& inst = insts[i];
+        const auto index = detail::oid_index(inst.opcode);
+        if (index >= MAX_OPCODE_COUNT || !valid_[index])
+            throw std::runtime_error("Invalid opcode to encode");
+        inst.opcode = oids_[index];
+        inst.nounce = detail::nounce(region_addr, i);
+    }
+
+    cipher_.Encrypt(insts.data(), insts.size(), region_addr, 0);
+
+    VMPilot::Common::Instruction helper;
+    std::vector<uint8_t> result(insts.size() * ENCODED_INSTRUCTION_SIZE);
+    for (size_t i = 0; i < insts.size(); ++i) {
+        helper.update_checksum(insts[i]);
+        detail::encode(insts[i], result.data() + i * ENCODED_INSTRUCTION_SIZE);
+    }
+    return result;
+}
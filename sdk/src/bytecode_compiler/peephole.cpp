@@ -0,0 +1,173 @@
+#include <opcode_enum.hpp>
+#include <peephole.hpp>
+#include <vm_operand.hpp>
+
+#include <utility>
+#include <vector>
+
+using namespace VMPilot::SDK::BytecodeCompiler;
+using namespace VMPilot::Common::Opcode::Enum;
+using Instruction_t = VMPilot::Common::Instruction_t;
+namespace Operand = VMPilot::Common::Operand;
+
+namespace {
+template <typename Enum>
+bool is(const Instruction_t& inst, Enum opcode) noexcept {
+    return inst.opcode == static_cast<Opcode_t>(opcode);
+}
+
+// The instructions whose left operand is a jump or call target
+bool has_target(const Instruction_t& inst) noexcept {
+    return is(inst, ControlTransfer::JMP) || is(inst, ControlTransfer::JZ) ||
+           is(inst, ControlTransfer::JNZ) || is(inst, ControlTransfer::JE) ||
+           is(inst, ControlTransfer::JNE) || is(inst, ControlTransfer::CALL);
+}
+
+// The fused compare and jumps, their target is in the left operand payload
+bool is_cmp_jcc(const Instruction_t& inst) noexcept {
+    return is(inst, ControlTransfer::CMP_JZ) ||
+           is(inst, ControlTransfer::CMP_JNZ);
+}
+
+bool is_jz(const Instruction_t& inst) noexcept {
+    return is(inst, ControlTransfer::JZ) || is(inst, ControlTransfer::JE);
+}
+
+bool is_jnz(const Instruction_t& inst) noexcept {
+    return is(inst, ControlTransfer::JNZ) || is(inst, ControlTransfer::JNE);
+}
+
+// LOAD r, [a]; ADD r, b; STORE [a], r
+bool match_load_add_store(const Instruction_t* seq) noexcept {
+    const auto& load = seq[0];
+    const auto& add = seq[1];
+    const auto& store = seq[2];
+    if (!is(load, DataMovement::LOAD) || !is(add, ArithmeticLogic::ADD) ||
+        !is(store, DataMovement::STORE))
+        return false;
+
+    const auto r = load.left_operand;
+    const auto address = load.right_operand;
+    if (!Operand::IsRegister(r) || add.left_operand != r ||
+        store.left_operand != address || store.right_operand != r)
+        return false;
+
+    // The fused instruction reads the address once, so it must not be the
+    // loaded register
+    if (Operand::IsRegister(address) &&
+        Operand::RegisterIndex(address) == Operand::RegisterIndex(r))
+        return false;
+
+    return Operand::FitsPayload(address);
+}
+
+// CMP a, b; JZ/JNZ target, with a in a register and an immediate target
+bool match_cmp_jcc(const Instruction_t* seq) noexcept {
+    const auto& cmp = seq[0];
+    const auto& jcc = seq[1];
+    if (!is(cmp, ArithmeticLogic::CMP) || !(is_jz(jcc) || is_jnz(jcc)))
+        return false;
+
+    return Operand::IsRegister(cmp.left_operand) &&
+           !Operand::IsRegister(jcc.left_operand) &&
+           Operand::ImmediateValue(jcc.left_operand) <= Operand::MAX_PAYLOAD;
+}
+}  // namespace
+
+FusionStats& FusionStats::operator+=(const FusionStats& other) noexcept {
+    instructions_before += other.instructions_before;
+    instructions_after += other.instructions_after;
+    load_add_store += other.load_add_store;
+    cmp_jz += other.cmp_jz;
+    cmp_jnz += other.cmp_jnz;
+    skipped |= other.skipped;
+    return *this;
+}
+
+FusionStats VMPilot::SDK::BytecodeCompiler::FuseSuperinstructions(
+    std::vector<Instruction_t>& insts) {
+    FusionStats stats;
+    stats.instructions_before = insts.size();
+    stats.instructions_after = insts.size();
+
+    // 1. Collect the jump targets, give up on an indirect one
+    std::vector<bool> is_target(insts.size() + 1, false);
+    for (const auto& inst : insts) {
+        uint64_t target;
+        if (is_cmp_jcc(inst)) {
+            target = Operand::Payload(inst.left_operand);
+        } else if (has_target(inst)) {
+            if (Operand::IsRegister(inst.left_operand)) {
+                stats.skipped = true;
+                return stats;
+            }
+            target = Operand::ImmediateValue(inst.left_operand);
+        } else {
+            continue;
+        }
+        if (target < is_target.size())
+            is_target[target] = true;
+    }
+
+    // 2. Fuse, new_index maps the old indices to the new ones
+    std::vector<Instruction_t> fused;
+    fused.reserve(insts.size());
+    std::vector<uint64_t> new_index(insts.size() + 1);
+
+    for (size_t i = 0; i < insts.size();) {
+        new_index[i] = fused.size();
+        const size_t left = insts.size() - i;
+
+        if (left >= 3 && !is_target[i + 1] && !is_target[i + 2] &&
+            match_load_add_store(&insts[i])) {
+            auto inst = insts[i];
+            inst.opcode = static_cast<Opcode_t>(DataMovement::LOAD_ADD_STORE);
+            inst.left_operand = Operand::PackedRegister(
+                Operand::RegisterIndex(insts[i].left_operand),
+                Operand::ToPayload(insts[i].right_operand));
+            inst.right_operand = insts[i + 1].right_operand;
+            fused.push_back(inst);
+            ++stats.load_add_store;
+            i += 3;
+            continue;
+        }
+
+        if (left >= 2 && !is_target[i + 1] && match_cmp_jcc(&insts[i])) {
+            const bool jz = is_jz(insts[i + 1]);
+            auto inst = insts[i];
+            inst.opcode = static_cast<Opcode_t>(jz ? ControlTransfer::CMP_JZ
+                                                   : ControlTransfer::CMP_JNZ);
+            // The target is remapped below
+            inst.left_operand = Operand::PackedRegister(
+                Operand::RegisterIndex(insts[i].left_operand),
+                Operand::ImmediateValue(insts[i + 1].left_operand));
+            fused.push_back(inst);
+            ++(jz ? stats.cmp_jz : stats.cmp_jnz);
+            i += 2;
+            continue;
+        }
+
+        fused.push_back(insts[i]);
+        ++i;
+    }
+    new_index[insts.size()] = fused.size();
+
+    // 3. Remap the jump targets, a target out of the region is kept
+    const auto remap = [&](uint64_t target) {
+        return target < new_index.size() ? new_index[target] : target;
+    };
+    for (auto& inst : fused) {
+        if (has_target(inst)) {
+            inst.left_operand = Operand::Immediate(static_cast<int64_t>(
+                remap(Operand::ImmediateValue(inst.left_operand))));
+        } else if (is_cmp_jcc(inst)) {
+            inst.left_operand = Operand::PackedRegister(
+                Operand::RegisterIndex(inst.left_operand),
+                remap(Operand::Payload(inst.left_operand)));
+        }
+    }
+
+    stats.instructions_after = fused.size();
+    insts = std::move(fused);
+    return stats;
+}
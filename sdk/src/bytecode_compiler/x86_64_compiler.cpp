@@ -1,8 +1,21 @@
+#include <bytecode_encoder.hpp>
+#include <peephole.hpp>
 #include <x86_64_compiler.hpp>
+#include <x86_lifter.hpp>
 
 using namespace VMPilot::SDK::BytecodeCompiler;
 
 std::vector<uint8_t> X86_64Compiler::Compile(const BytecodeCompileRecipe& script) {
-    ::_NotImplementedYet::Compile(script);
-    return {};
+    return CompileRegions(script);
+}
+
+std::vector<uint8_t> X86_64Compiler::CompileRegion(
+    const BytecodeCompileRecipe& script,
+    const VMPilot::SDK::ProtectedRegion& region,
+    const VMPilot::SDK::NativeInstructions& instructions,
+    FusionStats& fusion) const {
+    auto insts = LiftX86Region(instructions, region, 8);
+    fusion += FuseSuperinstructions(insts);
+    return BytecodeEncoder::ForThread(script.GetMasterKey())
+        .Encode(insts, region.begin_addr);
 }
\ No newline at end of file
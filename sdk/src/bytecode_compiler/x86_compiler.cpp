@@ -1,9 +1,21 @@
+#include <bytecode_encoder.hpp>
+#include <peephole.hpp>
 #include <x86_compiler.hpp>
+#include <x86_lifter.hpp>
 
 using namespace VMPilot::SDK::BytecodeCompiler;
 
-std::vector<uint8_t> X86Compiler::Compile(
-    [[maybe_unused]] const BytecodeCompileRecipe& script) {
+std::vector<uint8_t> X86Compiler::Compile(const BytecodeCompileRecipe& script) {
+    return CompileRegions(script);
+}
 
-    return {};
+std::vector<uint8_t> X86Compiler::CompileRegion(
+    const BytecodeCompileRecipe& script,
+    const VMPilot::SDK::ProtectedRegion& region,
+    const VMPilot::SDK::NativeInstructions& instructions,
+    FusionStats& fusion) const {
+    auto insts = LiftX86Region(instructions, region, 4);
+    fusion += FuseSuperinstructions(insts);
+    return BytecodeEncoder::ForThread(script.GetMasterKey())
+        .Encode(insts, region.begin_addr);
 }
@@ -0,0 +1,617 @@
+#include <opcode_enum.hpp>
+#include <vm_operand.hpp>
+#include <x86_lifter.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <capstone/capstone.h>
+
+using namespace VMPilot::SDK::BytecodeCompiler;
+using VMPilot::Common::Instruction_t;
+using VMPilot::SDK::NativeInstructions;
+using VMPilot::SDK::NativeOperand;
+using VMPilot::SDK::OperandKind;
+
+namespace {
+namespace detail {
+using namespace VMPilot::Common::Opcode::Enum;
+namespace Operand = VMPilot::Common::Operand;
+
+// The operand shapes an instruction is selected on: R register, I immediate,
+// M memory, in the order of the operands
+enum Shape : uint8_t {
+    S_NONE,
+    S_R,
+    S_I,
+    S_M,
+    S_RR,
+    S_RI,
+    S_RM,
+    S_MR,
+    S_MI,
+    S_RRI,
+    SHAPE_COUNT,  // Any other shape, never selected
+};
+
+// How a pattern is lowered to VM instructions
+enum class Lowering : uint8_t {
+    Drop,       // nop, endbr: nothing
+    Move,       // mov r, r/imm
+    Load,       // mov r, [m]
+    Store,      // mov [m], r/imm
+    Binary,     // op r, r/imm
+    Unary,      // op r, with the constant of the pattern as the right operand
+    Negate,     // neg r
+    Multiply3,  // imul r, r, imm
+    Compare,    // cmp r, r/imm
+    Test,       // test r, r/imm
+    Lea,        // lea r, [m]
+    Branch,     // jmp, je, jne with an immediate target
+};
+
+// What the x86 instruction does with ZF
+enum class Flags : uint8_t {
+    Keep,    // Left as is, the lowering must not clobber it while it is live
+    Define,  // Set, the last VM instruction setting the flag sets it alike
+    Read,
+};
+
+struct Pattern {
+    uint16_t id;  // The capstone x86_insn
+    Shape shape;
+    Lowering lowering;
+    Flags flags;
+    Opcode_t opcode;  // The main VM instruction of the lowering
+    int64_t constant;
+};
+
+template <typename Enum>
+constexpr Pattern pattern(x86_insn id, Shape shape, Lowering lowering,
+                          Flags flags, Enum opcode, int64_t constant = 0) {
+    return {static_cast<uint16_t>(id), shape, lowering, flags,
+            static_cast<Opcode_t>(opcode), constant};
+}
+
+constexpr Pattern drop(x86_insn id, Shape shape) {
+    return {static_cast<uint16_t>(id), shape, Lowering::Drop, Flags::Keep, 0,
+            0};
+}
+
+// Every instruction the lifter supports, by operand shape
+constexpr Pattern PATTERNS[] = {
+    drop(X86_INS_NOP, S_NONE),
+    drop(X86_INS_NOP, S_R),
+    drop(X86_INS_NOP, S_M),
+    drop(X86_INS_ENDBR32, S_NONE),
+    drop(X86_INS_ENDBR64, S_NONE),
+
+    pattern(X86_INS_MOV, S_RR, Lowering::Move, Flags::Keep, DataMovement::MOV),
+    pattern(X86_INS_MOV, S_RI, Lowering::Move, Flags::Keep, DataMovement::MOV),
+    pattern(X86_INS_MOVABS, S_RI, Lowering::Move, Flags::Keep,
+            DataMovement::MOV),
+    pattern(X86_INS_MOV, S_RM, Lowering::Load, Flags::Keep,
+            DataMovement::LOAD),
+    pattern(X86_INS_MOV, S_MR, Lowering::Store, Flags::Keep,
+            DataMovement::STORE),
+    pattern(X86_INS_MOV, S_MI, Lowering::Store, Flags::Keep,
+            DataMovement::STORE),
+    pattern(X86_INS_LEA, S_RM, Lowering::Lea, Flags::Keep, DataMovement::MOV),
+    // push and pop have no pattern: they move RSP and write the native
+    // stack, and the VM stack is neither
+
+    pattern(X86_INS_ADD, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::ADD),
+    pattern(X86_INS_ADD, S_RI, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::ADD),
+    pattern(X86_INS_SUB, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::SUB),
+    pattern(X86_INS_SUB, S_RI, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::SUB),
+    pattern(X86_INS_AND, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::AND),
+    pattern(X86_INS_AND, S_RI, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::AND),
+    pattern(X86_INS_OR, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::OR),
+    pattern(X86_INS_OR, S_RI, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::OR),
+    pattern(X86_INS_XOR, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::XOR),
+    pattern(X86_INS_XOR, S_RI, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::XOR),
+    // The low half of the product does not depend on the signedness, and
+    // ZF is undefined after imul
+    pattern(X86_INS_IMUL, S_RR, Lowering::Binary, Flags::Define,
+            ArithmeticLogic::MUL),
+    pattern(X86_INS_IMUL, S_RRI, Lowering::Multiply3, Flags::Define,
+            ArithmeticLogic::MUL),
+    pattern(X86_INS_INC, S_R, Lowering::Unary, Flags::Define,
+            ArithmeticLogic::ADD, 1),
+    pattern(X86_INS_DEC, S_R, Lowering::Unary, Flags::Define,
+            ArithmeticLogic::SUB, 1),
+    pattern(X86_INS_NOT, S_R, Lowering::Unary, Flags::Keep,
+            ArithmeticLogic::XOR, -1),
+    pattern(X86_INS_NEG, S_R, Lowering::Negate, Flags::Define,
+            ArithmeticLogic::XOR, -1),
+    pattern(X86_INS_CMP, S_RR, Lowering::Compare, Flags::Define,
+            ArithmeticLogic::CMP),
+    pattern(X86_INS_CMP, S_RI, Lowering::Compare, Flags::Define,
+            ArithmeticLogic::CMP),
+    pattern(X86_INS_TEST, S_RR, Lowering::Test, Flags::Define,
+            ArithmeticLogic::AND),
+    pattern(X86_INS_TEST, S_RI, Lowering::Test, Flags::Define,
+            ArithmeticLogic::AND),
+
+    pattern(X86_INS_JMP, S_I, Lowering::Branch, Flags::Keep,
+            ControlTransfer::JMP),
+    pattern(X86_INS_JE, S_I, Lowering::Branch, Flags::Read,
+            ControlTransfer::JZ),
+    pattern(X86_INS_JNE, S_I, Lowering::Branch, Flags::Read,
+            ControlTransfer::JNZ),
+    // call has no pattern either: it pushes its return address on the
+    // native stack, the VM CALL on the VM stack
+};
+
+// The selection table, one entry per (instruction id, shape): the index of
+// its pattern plus one, 0 if the instruction cannot be lifted
+constexpr size_t INSN_COUNT = X86_INS_ENDING;
+using Selection = std::array<uint8_t, INSN_COUNT * SHAPE_COUNT>;
+static_assert(std::size(PATTERNS) < std::numeric_limits<uint8_t>::max(),
+              "The selection table entries are bytes");
+
+constexpr Selection build_selection() {
+    Selection table{};
+    for (size_t i = 0; i < std::size(PATTERNS); ++i) {
+        const auto& p = PATTERNS[i];
+        auto& entry = table[p.id * SHAPE_COUNT + p.shape];
+        // Only evaluated, and so a compile error, on a duplicate pattern
+        if (entry != 0)
+            throw std::logic_error("Duplicate x86 lifter pattern");
+        entry = static_cast<uint8_t>(i + 1);
+    }
+    return table;
+}
+constexpr Selection SELECTION = build_selection();
+
+// The VM register of each capstone register, size 0 if it has none
+struct Register {
+    uint8_t index;
+    uint8_t size;
+};
+using Registers = std::array<Register, X86_REG_ENDING>;
+
+constexpr Registers build_registers() {
+    // In the order of their encoding, so RAX is R0, the return value
+    constexpr x86_reg GPR64[] = {
+        X86_REG_RAX, X86_REG_RCX, X86_REG_RDX, X86_REG_RBX,
+        X86_REG_RSP, X86_REG_RBP, X86_REG_RSI, X86_REG_RDI,
+        X86_REG_R8,  X86_REG_R9,  X86_REG_R10, X86_REG_R11,
+        X86_REG_R12, X86_REG_R13, X86_REG_R14, X86_REG_R15,
+    };
+    constexpr x86_reg GPR32[] = {
+        X86_REG_EAX,  X86_REG_ECX,  X86_REG_EDX,  X86_REG_EBX,
+        X86_REG_ESP,  X86_REG_EBP,  X86_REG_ESI,  X86_REG_EDI,
+        X86_REG_R8D,  X86_REG_R9D,  X86_REG_R10D, X86_REG_R11D,
+        X86_REG_R12D, X86_REG_R13D, X86_REG_R14D, X86_REG_R15D,
+    };
+    static_assert(std::size(GPR64) == Operand::REGISTER_COUNT);
+
+    Registers table{};
+    for (size_t i = 0; i < std::size(GPR64); ++i) {
+        table[GPR64[i]] = {static_cast<uint8_t>(i), 8};
+        table[GPR32[i]] = {static_cast<uint8_t>(i), 4};
+    }
+    return table;
+}
+constexpr Registers REGISTERS = build_registers();
+
+// The mask zero-extending a 32-bit result
+constexpr int64_t LOW32 = 0xFFFFFFFF;
+
+// The VM instructions that set the zero flag
+bool sets_zf(Opcode_t opcode) noexcept {
+    return opcode >= static_cast<Opcode_t>(ArithmeticLogic::__BEGIN) &&
+           opcode < static_cast<Opcode_t>(ArithmeticLogic::__END);
+}
+
+bool fits_immediate(int64_t value) noexcept {
+    return static_cast<int64_t>(Operand::ImmediateValue(
+               Operand::Immediate(value))) == value;
+}
+
+Shape shape_of(const NativeInstructions::Operands& ops) noexcept {
+    const auto kind = [&ops](size_t i) { return ops[i].Kind(); };
+    constexpr auto R = OperandKind::Register;
+    constexpr auto I = OperandKind::Immediate;
+    constexpr auto M = OperandKind::Memory;
+    switch (ops.size()) {
+        case 0:
+            return S_NONE;
+        case 1:
+            return kind(0) == R ? S_R
+                   : kind(0) == I ? S_I
+                   : kind(0) == M ? S_M
+                                  : SHAPE_COUNT;
+        case 2:
+            if (kind(0) == R)
+                return kind(1) == R ? S_RR
+                       : kind(1) == I ? S_RI
+                       : kind(1) == M ? S_RM
+                                      : SHAPE_COUNT;
+            if (kind(0) == M)
+                return kind(1) == R ? S_MR : kind(1) == I ? S_MI : SHAPE_COUNT;
+            return SHAPE_COUNT;
+        case 3:
+            return kind(0) == R && kind(1) == R && kind(2) == I ? S_RRI
+                                                                : SHAPE_COUNT;
+        default:
+            return SHAPE_COUNT;
+    }
+}
+
+// A register operand, in the VM
+struct Reg {
+    uint8_t index;
+    uint8_t size;
+    uint64_t vm() const noexcept { return Operand::Register(index); }
+};
+
+// A memory address, base + disp: an offset in the VM memory
+struct Address {
+    uint8_t base;
+    int64_t disp;
+};
+
+class Lifter {
+   public:
+    Lifter(const NativeInstructions& insts,
+           const VMPilot::SDK::ProtectedRegion& region, unsigned word_size)
+        : insts(insts), region(region), word_size(word_size) {}
+
+    std::vector<Instruction_t> Run();
+
+   private:
+    [[noreturn]] void fail(size_t i, const char* why) const;
+
+    const Pattern& select(size_t i) const;
+    size_t targetIndex(size_t i) const;
+
+    Reg reg(size_t i, const NativeOperand& op) const;
+    Address address(size_t i, const NativeOperand& op) const;
+    uint64_t source(size_t i, const NativeOperand& op, uint8_t size) const;
+
+    void emit(Opcode_t opcode, uint64_t lhs, uint64_t rhs = 0);
+    template <typename Enum>
+    void emit(Enum opcode, uint64_t lhs, uint64_t rhs = 0) {
+        emit(static_cast<Opcode_t>(opcode), lhs, rhs);
+    }
+    void zeroExtend(const Reg& r) {
+        if (r.size == 4)
+            emit(ArithmeticLogic::AND, r.vm(), Operand::Immediate(LOW32));
+    }
+
+    void lower(size_t i, const Pattern& p);
+
+    const NativeInstructions& insts;
+    const VMPilot::SDK::ProtectedRegion& region;
+    const unsigned word_size;
+
+    // The x86 instruction at each byte offset of the region, or NONE
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> index_at;
+
+    std::vector<Instruction_t> out;
+    bool clobbered_zf = false;
+    // The VM instructions to patch with the first VM instruction of their
+    // target x86 instruction
+    std::vector<std::pair<size_t, size_t>> branches;
+};
+
+void Lifter::fail(size_t i, const char* why) const {
+    char message[160];
+    std::snprintf(message, sizeof(message),
+                  "Cannot lift the x86 instruction %u at %#llx: %s",
+                  static_cast<unsigned>(insts.Id(i)),
+                  static_cast<unsigned long long>(insts.Address(i)), why);
+    throw std::runtime_error(message);
+}
+
+const Pattern& Lifter::select(size_t i) const {
+    const auto id = insts.Id(i);
+    const auto shape = shape_of(insts.GetOperands(i));
+    if (id >= INSN_COUNT || shape == SHAPE_COUNT)
+        fail(i, "no pattern for it");
+    const auto entry = SELECTION[id * SHAPE_COUNT + shape];
+    if (entry == 0)
+        fail(i, "no pattern for it");
+    return PATTERNS[entry - 1];
+}
+
+// The index of the target of a branch, insts.Size() for the region end
+size_t Lifter::targetIndex(size_t i) const {
+    const auto target = static_cast<uint64_t>(insts.GetOperands(i)[0].value);
+    if (target == region.end_addr)
+        return insts.Size();
+    if (target < region.begin_addr || target >= region.end_addr ||
+        index_at[target - region.begin_addr] == NONE)
+        fail(i, "the branch leaves the region");
+    return index_at[target - region.begin_addr];
+}
+
+Reg Lifter::reg(size_t i, const NativeOperand& op) const {
+    const auto r = op.reg < REGISTERS.size() ? REGISTERS[op.reg] : Register{};
+    if (r.size == 0 || r.size > word_size)
+        fail(i, "only the 32 and 64-bit general purpose registers are "
+                "supported");
+    return {r.index, r.size};
+}
+
+// The VM memory is addressed by offsets, which only a base register can
+// hold: a RIP-relative or absolute address is a native address
+Address Lifter::address(size_t i, const NativeOperand& op) const {
+    if (op.segment != X86_REG_INVALID || op.index != X86_REG_INVALID)
+        fail(i, "segment overrides and indexed addresses are not supported");
+    if (op.reg == X86_REG_RIP || op.reg == X86_REG_EIP)
+        fail(i, "RIP-relative addresses are not supported");
+    if (op.reg == X86_REG_INVALID)
+        fail(i, "absolute addresses are not supported");
+    const auto base = reg(i, op);
+    if (base.size != word_size)
+        fail(i, "the address size is not the word size");
+    if (!fits_immediate(op.value))
+        fail(i, "the displacement does not fit a VM operand");
+    return {base.index, op.value};
+}
+
+// A register of the given size, or an immediate
+uint64_t Lifter::source(size_t i, const NativeOperand& op,
+                        uint8_t size) const {
+    if (op.Kind() == OperandKind::Register) {
+        const auto r = reg(i, op);
+        if (r.size != size)
+            fail(i, "the operands have different sizes");
+        return r.vm();
+    }
+    // A 32-bit result is zero-extended, only the low half of the immediate
+    // matters
+    const int64_t value = size == 4 ? op.value & LOW32 : op.value;
+    if (!fits_immediate(value))
+        fail(i, "the immediate does not fit a VM operand");
+    return Operand::Immediate(value);
+}
+
+void Lifter::emit(Opcode_t opcode, uint64_t lhs, uint64_t rhs) {
+    clobbered_zf |= sets_zf(opcode);
+    out.push_back(Instruction_t{opcode, lhs, rhs, 0, 0});
+}
+
+void Lifter::lower(size_t i, const Pattern& p) {
+    const auto ops = insts.GetOperands(i);
+    switch (p.lowering) {
+        case Lowering::Drop:
+            return;
+
+        case Lowering::Move: {
+            const auto dst = reg(i, ops[0]);
+            if (ops[1].Kind() == OperandKind::Register) {
+                emit(p.opcode, dst.vm(), source(i, ops[1], dst.size));
+                zeroExtend(dst);
+                return;
+            }
+            const int64_t value =
+                dst.size == 4 ? ops[1].value & LOW32 : ops[1].value;
+            if (fits_immediate(value)) {
+                emit(p.opcode, dst.vm(), Operand::Immediate(value));
+                return;
+            }
+            // A movabs of a 64-bit immediate: halved, doubled, low bit set
+            emit(p.opcode, dst.vm(), Operand::Immediate(value >> 1));
+            emit(ArithmeticLogic::ADD, dst.vm(), dst.vm());
+            if (value & 1)
+                emit(ArithmeticLogic::OR, dst.vm(), Operand::Immediate(1));
+            return;
+        }
+
+        case Lowering::Load: {
+            // Also every load of x86, whose registers are 32-bit
+            if (word_size != 8)
+                fail(i, "the VM only loads 64-bit values, x86-32 memory "
+                        "accesses are not supported");
+            const auto dst = reg(i, ops[0]);
+            if (dst.size != 8 || ops[1].size != 8)
+                fail(i, "the VM only loads 64-bit values");
+            const auto addr = address(i, ops[1]);
+            if (addr.disp == 0) {
+                emit(p.opcode, dst.vm(), Operand::Register(addr.base));
+                return;
+            }
+            emit(DataMovement::MOV, dst.vm(), Operand::Register(addr.base));
+            emit(ArithmeticLogic::ADD, dst.vm(),
+                 Operand::Immediate(addr.disp));
+            emit(p.opcode, dst.vm(), dst.vm());
+            return;
+        }
+
+        case Lowering::Store: {
+            if (word_size != 8)
+                fail(i, "the VM only stores 64-bit values, x86-32 memory "
+                        "accesses are not supported");
+            if (ops[0].size != 8)
+                fail(i, "the VM only stores 64-bit values");
+            const auto value = source(i, ops[1], 8);
+            const auto addr = address(i, ops[0]);
+            const auto base = Operand::Register(addr.base);
+            if (addr.disp == 0) {
+                emit(p.opcode, base, value);
+                return;
+            }
+            // The base is moved to the address and back
+            if (value == base)
+                fail(i, "the stored register is the address base");
+            emit(ArithmeticLogic::ADD, base, Operand::Immediate(addr.disp));
+            emit(p.opcode, base, value);
+            emit(ArithmeticLogic::SUB, base, Operand::Immediate(addr.disp));
+            return;
+        }
+
+        case Lowering::Binary: {
+            const auto dst = reg(i, ops[0]);
+            emit(p.opcode, dst.vm(), source(i, ops[1], dst.size));
+            zeroExtend(dst);
+            return;
+        }
+
+        case Lowering::Unary: {
+            const auto dst = reg(i, ops[0]);
+            emit(p.opcode, dst.vm(), Operand::Immediate(p.constant));
+            zeroExtend(dst);
+            return;
+        }
+
+        case Lowering::Negate: {
+            // -x is ~x + 1
+            const auto dst = reg(i, ops[0]);
+            emit(p.opcode, dst.vm(), Operand::Immediate(p.constant));
+            emit(ArithmeticLogic::ADD, dst.vm(), Operand::Immediate(1));
+            zeroExtend(dst);
+            return;
+        }
+
+        case Lowering::Multiply3: {
+            const auto dst = reg(i, ops[0]);
+            emit(DataMovement::MOV, dst.vm(), source(i, ops[1], dst.size));
+            emit(p.opcode, dst.vm(), source(i, ops[2], dst.size));
+            zeroExtend(dst);
+            return;
+        }
+
+        case Lowering::Compare: {
+            const auto lhs = reg(i, ops[0]);
+            const auto rhs = source(i, ops[1], lhs.size);
+            if (lhs.size == 8) {
+                emit(p.opcode, lhs.vm(), rhs);
+                return;
+            }
+            // The high halves may hold anything, the operands are masked on
+            // the VM stack
+            const bool masked_rhs = Operand::IsRegister(rhs) && rhs != lhs.vm();
+            emit(DataMovement::PUSH, lhs.vm());
+            zeroExtend(lhs);
+            if (masked_rhs) {
+                emit(DataMovement::PUSH, rhs);
+                emit(ArithmeticLogic::AND, rhs, Operand::Immediate(LOW32));
+            }
+            emit(p.opcode, lhs.vm(), rhs);
+            if (masked_rhs)
+                emit(DataMovement::POP, rhs);
+            emit(DataMovement::POP, lhs.vm());
+            return;
+        }
+
+        case Lowering::Test: {
+            const auto lhs = reg(i, ops[0]);
+            const auto rhs = source(i, ops[1], lhs.size);
+            if (rhs == lhs.vm() && lhs.size == 8) {
+                emit(ArithmeticLogic::CMP, lhs.vm(), Operand::Immediate(0));
+                return;
+            }
+            // The AND of test is kept on the VM stack
+            emit(DataMovement::PUSH, lhs.vm());
+            if (rhs != lhs.vm())
+                emit(p.opcode, lhs.vm(), rhs);
+            zeroExtend(lhs);
+            emit(DataMovement::POP, lhs.vm());
+            return;
+        }
+
+        case Lowering::Lea: {
+            const auto dst = reg(i, ops[0]);
+            const auto addr = address(i, ops[1]);
+            emit(p.opcode, dst.vm(), Operand::Register(addr.base));
+            if (addr.disp != 0)
+                emit(ArithmeticLogic::ADD, dst.vm(),
+                     Operand::Immediate(addr.disp));
+            zeroExtend(dst);
+            return;
+        }
+
+        case Lowering::Branch:
+            branches.emplace_back(out.size(), targetIndex(i));
+            emit(p.opcode, 0);
+            return;
+    }
+}
+
+std::vector<Instruction_t> Lifter::Run() {
+    const size_t count = insts.Size();
+    if (count == 0)
+        return {};
+
+    // 1. Select the pattern of every instruction, and map the instruction
+    //    boundaries for the branches
+    std::vector<const Pattern*> selected(count);
+    index_at.assign(region.end_addr - region.begin_addr, NONE);
+    for (size_t i = 0; i < count; ++i) {
+        selected[i] = &select(i);
+        const auto offset = insts.Address(i) - region.begin_addr;
+        if (offset < index_at.size())
+            index_at[offset] = static_cast<uint32_t>(i);
+    }
+
+    // 2. Whether ZF may be read after each instruction, backwards. ZF is
+    //    dead at the region end, the VMPilot_End call clobbers it. At a
+    //    branch target the flag is taken as live.
+    std::vector<bool> zf_live(count);
+    bool live = false;
+    for (size_t i = count; i-- > 0;) {
+        const auto& p = *selected[i];
+        if (p.lowering == Lowering::Branch) {
+            const bool to_end = targetIndex(i) == count;
+            if (p.opcode == static_cast<Opcode_t>(ControlTransfer::JMP))
+                live = !to_end;
+            else
+                live = live || !to_end;
+        }
+        zf_live[i] = live;
+        if (p.flags == Flags::Read)
+            live = true;
+        else if (p.flags == Flags::Define)
+            live = false;
+    }
+
+    // 3. Lower, about two VM instructions per x86 one
+    std::vector<size_t> first(count + 1);
+    out.reserve(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+        first[i] = out.size();
+        clobbered_zf = false;
+        lower(i, *selected[i]);
+        if (clobbered_zf && selected[i]->flags == Flags::Keep && zf_live[i])
+            fail(i, "its lowering clobbers the live zero flag");
+    }
+    first[count] = out.size();
+
+    // 4. The branch targets, as VM instruction indices
+    for (const auto& [at, target] : branches)
+        out[at].left_operand =
+            Operand::Immediate(static_cast<int64_t>(first[target]));
+    return std::move(out);
+}
+}  // namespace detail
+}  // namespace
+
+std::vector<Instruction_t> VMPilot::SDK::BytecodeCompiler::LiftX86Region(
+    const NativeInstructions& instructions,
+    const VMPilot::SDK::ProtectedRegion& region, unsigned word_size) {
+    if (word_size != 4 && word_size != 8)
+        throw std::runtime_error("Invalid x86 word size");
+    return detail::Lifter(instructions, region, word_size).Run();
+}
@@ -0,0 +1,280 @@
+#include <ELFRewriter.hpp>
+#include <OutputFile.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace VMPilot::SDK::Rewriter;
+using VMPilot::Common::ByteView;
+using VMPilot::SDK::Segmentator::ELFSegment;
+
+namespace {
+namespace detail {
+// The smallest alignment of a loaded segment, the page size
+constexpr uint64_t PAGE_SIZE = 0x1000;
+
+// The section header fields used here
+constexpr uint32_t SHT_PROGBITS = 1;
+constexpr uint64_t SHF_ALLOC = 0x2;
+constexpr uint64_t SHN_LORESERVE = 0xff00;
+
+constexpr uint64_t align_up(uint64_t value, uint64_t alignment) noexcept {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+const VMPilot::Common::MappedFile& require(
+    const std::shared_ptr<const VMPilot::Common::MappedFile>& file) {
+    if (file == nullptr)
+        throw std::runtime_error("No ELF file to rewrite");
+    return *file;
+}
+}  // namespace detail
+}  // namespace
+
+ELFRewriter::ELFRewriter(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file)
+    : file(std::move(file)), image(detail::require(this->file).view()) {
+    const auto& segments = image.getSegments();
+    bool has_load = false;
+    bool has_note = false;
+    uint64_t end = 0;
+    alignment = detail::PAGE_SIZE;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const auto& segment = segments[i];
+        if (segment.type == ELFSegment::PT_NOTE) {
+            // The last one, the first is usually .note.gnu.property
+            note_index = i;
+            has_note = true;
+        } else if (segment.type == ELFSegment::PT_LOAD) {
+            has_load = true;
+            end = std::max(end, segment.vaddr + segment.memsz);
+            alignment = std::max(alignment, segment.align);
+        }
+    }
+    if (!has_load)
+        throw std::runtime_error("The ELF file has no loadable segment");
+    if (!has_note)
+        throw std::runtime_error("The ELF file has no PT_NOTE segment to "
+                                 "load the bytecode with");
+
+    // The offset and the address are congruent modulo the alignment, as
+    // mmap requires. The file is only padded to a page, the address takes
+    // the rest of the alignment: it costs address space rather than disk.
+    section_offset = detail::align_up(this->file->size(), detail::PAGE_SIZE);
+    section_addr =
+        detail::align_up(end, alignment) + section_offset % alignment;
+}
+
+void ELFRewriter::Patch(uint64_t addr, std::vector<uint8_t> bytes) {
+    if (bytes.empty())
+        return;
+
+    uint64_t offset = 0;
+    bool found = false;
+    for (const auto& segment : image.getSegments()) {
+        if (segment.type != ELFSegment::PT_LOAD || addr < segment.vaddr ||
+            addr - segment.vaddr > segment.filesz ||
+            bytes.size() > segment.filesz - (addr - segment.vaddr))
+            continue;
+        offset = segment.offset + (addr - segment.vaddr);
+        found = true;
+        break;
+    }
+    if (!found)
+        throw std::runtime_error("No loaded bytes of the file to patch at " +
+                                 std::to_string(addr));
+
+    const auto next = patches.lower_bound(offset);
+    const bool overlaps_next =
+        next != patches.end() && next->first < offset + bytes.size();
+    const bool overlaps_previous =
+        next != patches.begin() &&
+        std::prev(next)->first + std::prev(next)->second.size() > offset;
+    if (overlaps_next || overlaps_previous)
+        throw std::runtime_error("Overlapping patches at " +
+                                 std::to_string(addr));
+
+    patches.emplace(offset, std::move(bytes));
+}
+
+void ELFRewriter::SetSection(std::string name, std::vector<uint8_t> data) {
+    section_name = std::move(name);
+    section_data = std::move(data);
+}
+
+void ELFRewriter::put(std::vector<uint8_t>& out, uint64_t at, uint64_t value,
+                      size_t size) const noexcept {
+    for (size_t i = 0; i < size; ++i) {
+        const size_t shift = image.isBigEndian() ? 8 * (size - 1 - i) : 8 * i;
+        out[at + i] = static_cast<uint8_t>(value >> shift);
+    }
+}
+
+std::vector<uint8_t> ELFRewriter::encodeSegment(
+    const ELFSegment& segment) const {
+    std::vector<uint8_t> out(image.getHeaderTables().phentsize, 0);
+    put(out, 0, segment.type, 4);
+    if (image.is64()) {
+        put(out, 0x04, segment.flags, 4);
+        put(out, 0x08, segment.offset, 8);
+        put(out, 0x10, segment.vaddr, 8);
+        put(out, 0x18, segment.paddr, 8);
+        put(out, 0x20, segment.filesz, 8);
+        put(out, 0x28, segment.memsz, 8);
+        put(out, 0x30, segment.align, 8);
+    } else {
+        put(out, 0x04, segment.offset, 4);
+        put(out, 0x08, segment.vaddr, 4);
+        put(out, 0x0C, segment.paddr, 4);
+        put(out, 0x10, segment.filesz, 4);
+        put(out, 0x14, segment.memsz, 4);
+        put(out, 0x18, segment.flags, 4);
+        put(out, 0x1C, segment.align, 4);
+    }
+    return out;
+}
+
+std::vector<uint8_t> ELFRewriter::programHeaders() const {
+    const auto& tables = image.getHeaderTables();
+    const auto& segments = image.getSegments();
+    const auto raw = file->view().subview(tables.phoff,
+                                          tables.phnum * tables.phentsize);
+
+    ELFSegment load;
+    load.type = ELFSegment::PT_LOAD;
+    load.flags = ELFSegment::PF_R;
+    load.offset = section_offset;
+    load.vaddr = section_addr;
+    load.paddr = section_addr;
+    load.filesz = section_data.size();
+    load.memsz = section_data.size();
+    load.align = alignment;
+
+    // The new PT_LOAD goes after the last one, it has the highest address
+    size_t last_load = 0;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (segments[i].type == ELFSegment::PT_LOAD)
+            last_load = i;
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (i == note_index)
+            continue;
+        const auto entry = raw.subview(i * tables.phentsize, tables.phentsize);
+        out.insert(out.end(), entry.begin(), entry.end());
+        if (i == last_load) {
+            const auto encoded = encodeSegment(load);
+            out.insert(out.end(), encoded.begin(), encoded.end());
+        }
+    }
+    return out;
+}
+
+void ELFRewriter::Write(const std::string& filename) const {
+    const auto& tables = image.getHeaderTables();
+    const auto& sections = image.getSections();
+    const bool is_64 = image.is64();
+    const uint64_t input_size = file->size();
+
+    // The new section is only named if the sections are
+    const bool named = tables.shoff != 0 && tables.shstrndx != 0 &&
+                       tables.shstrndx < sections.size();
+    const uint64_t shstrtab_offset = section_offset + section_data.size();
+    const uint64_t shstrtab_size =
+        named ? sections[tables.shstrndx].getSize() + section_name.size() + 1
+              : 0;
+    const uint64_t shoff =
+        named ? detail::align_up(shstrtab_offset + shstrtab_size,
+                                 is_64 ? 8 : 4)
+              : tables.shoff;
+    const uint64_t shnum = named ? tables.shnum + 1 : tables.shnum;
+    // The counts past it would go to the first section header
+    if (named && shnum >= detail::SHN_LORESERVE)
+        throw std::runtime_error("Too many ELF sections to add one");
+    const uint64_t max = std::numeric_limits<uint32_t>::max();
+    if (!is_64 && (section_addr + section_data.size() > max ||
+                   shstrtab_offset > max ||
+                   shoff + shnum * tables.shentsize > max))
+        throw std::runtime_error("The protected ELF32 file is too large");
+
+    // The bytes of the input written again, by file offset
+    const size_t ehsize = is_64 ? 64 : 52;
+    std::vector<uint8_t> header(file->data(), file->data() + ehsize);
+    if (named) {
+        put(header, is_64 ? 0x28 : 0x20, shoff, is_64 ? 8 : 4);
+        put(header, is_64 ? 0x3C : 0x30, shnum, 2);
+    }
+    const auto program_headers = programHeaders();
+
+    std::map<uint64_t, ByteView> edits;
+    for (const auto& [offset, bytes] : patches)
+        edits.emplace(offset, ByteView(bytes));
+    const auto add_edit = [&edits](uint64_t offset, ByteView bytes) {
+        if (!edits.emplace(offset, bytes).second)
+            throw std::runtime_error("A patch overlaps the ELF headers");
+    };
+    add_edit(0, ByteView(header));
+    add_edit(tables.phoff, ByteView(program_headers));
+
+    OutputFile out(filename, *file);
+
+    // The input, from the kernel where it is not edited
+    uint64_t at = 0;
+    for (const auto& [offset, bytes] : edits) {
+        if (offset < at || bytes.size() > input_size - offset)
+            throw std::runtime_error("A patch overlaps the ELF headers");
+        out.Copy(*file, at, offset - at);
+        out.Write(bytes);
+        at = offset + bytes.size();
+    }
+    out.Copy(*file, at, input_size - at);
+
+    // The new segment
+    out.Align(detail::PAGE_SIZE);
+    out.Write(ByteView(section_data));
+    if (!named) {
+        out.Commit();
+        return;
+    }
+
+    // .shstrtab with the new name, then the section header table
+    const auto& shstrtab = sections[tables.shstrndx];
+    out.Copy(*file, shstrtab.getOffset(), shstrtab.getSize());
+    std::vector<uint8_t> name(section_name.begin(), section_name.end());
+    name.push_back('\0');
+    out.Write(ByteView(name));
+    out.Align(is_64 ? 8 : 4);
+
+    const uint64_t entry = tables.shentsize;
+    const uint64_t shstrtab_entry = tables.shoff + tables.shstrndx * entry;
+    out.Copy(*file, tables.shoff, tables.shstrndx * entry);
+    std::vector<uint8_t> patched(file->data() + shstrtab_entry,
+                                 file->data() + shstrtab_entry + entry);
+    put(patched, is_64 ? 0x18 : 0x10, shstrtab_offset, is_64 ? 8 : 4);
+    put(patched, is_64 ? 0x20 : 0x14, shstrtab_size, is_64 ? 8 : 4);
+    out.Write(ByteView(patched));
+    out.Copy(*file, shstrtab_entry + entry,
+             (tables.shnum - tables.shstrndx - 1) * entry);
+
+    std::vector<uint8_t> added(entry, 0);
+    const size_t word = is_64 ? 8 : 4;
+    put(added, 0x00, shstrtab_size - name.size(), 4);
+    put(added, 0x04, detail::SHT_PROGBITS, 4);
+    put(added, 0x08, detail::SHF_ALLOC, word);
+    put(added, 0x08 + word, section_addr, word);
+    put(added, 0x08 + 2 * word, section_offset, word);
+    put(added, 0x08 + 3 * word, section_data.size(), word);
+    // sh_link and sh_info are 0, sh_addralign is after them
+    put(added, 0x10 + 4 * word, 8, word);
+    out.Write(ByteView(added));
+
+    out.Commit();
+}
@@ -0,0 +1,241 @@
+#include <OutputFile.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+using namespace VMPilot::SDK::Rewriter;
+using VMPilot::Common::ByteView;
+
+namespace {
+namespace detail {
+// The largest single write or copy, below the limits of every platform
+constexpr uint64_t MAX_CHUNK = 1ull << 30;
+
+constexpr uint8_t ZEROS[4096] = {};
+
+#if defined(__linux__)
+// The errors of a kernel copy that is not supported between these files,
+// the copy falls back to the next method
+bool is_unsupported(int error) noexcept {
+    return error == ENOSYS || error == EXDEV || error == EINVAL ||
+           error == EOPNOTSUPP || error == EBADF;
+}
+#endif
+}  // namespace detail
+}  // namespace
+
+#ifdef _WIN32
+
+OutputFile::OutputFile(
+    std::string filename,
+    [[maybe_unused]] const VMPilot::Common::MappedFile& input)
+    : filename_(std::move(filename)) {
+    // A new unique file in the directory of the output, so that two jobs
+    // writing the same output never share it
+    auto directory = std::filesystem::path(filename_).parent_path().string();
+    if (directory.empty())
+        directory = ".";
+    char tmp[MAX_PATH];
+    if (GetTempFileNameA(directory.c_str(), "vmp", 0, tmp) == 0)
+        throw std::runtime_error("Failed to create a temporary output in " +
+                                 directory);
+    tmp_ = tmp;
+    HANDLE file = CreateFileA(tmp_.c_str(), GENERIC_WRITE, 0, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::remove(tmp_.c_str());
+        throw std::runtime_error("Failed to open the output: " + tmp_);
+    }
+    handle_ = file;
+}
+
+void OutputFile::Write(ByteView data) {
+    const auto* begin = data.data();
+    uint64_t left = data.size();
+    while (left != 0) {
+        const auto chunk =
+            static_cast<DWORD>(std::min<uint64_t>(left, detail::MAX_CHUNK));
+        DWORD written = 0;
+        if (!WriteFile(static_cast<HANDLE>(handle_), begin, chunk, &written,
+                       nullptr) ||
+            written == 0)
+            throw std::runtime_error("Failed to write the output: " + tmp_);
+        begin += written;
+        left -= written;
+        size_ += written;
+    }
+}
+
+void OutputFile::Copy(const VMPilot::Common::MappedFile& input,
+                      uint64_t offset, uint64_t size) {
+    if (offset > input.size() || size > input.size() - offset)
+        throw std::runtime_error("Copy out of the input " + input.filename());
+    // The pages come from the mapping, the cache manager does the rest
+    Write(input.view().subview(offset, size));
+}
+
+void OutputFile::Close() noexcept {
+    if (handle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+}
+
+void OutputFile::Commit() {
+    const bool flushed = FlushFileBuffers(static_cast<HANDLE>(handle_));
+    Close();
+    if (!flushed ||
+        !MoveFileExA(tmp_.c_str(), filename_.c_str(),
+                     MOVEFILE_REPLACE_EXISTING))
+        throw std::runtime_error("Failed to write the output: " + filename_);
+    committed_ = true;
+}
+
+#else
+
+OutputFile::OutputFile(std::string filename,
+                       const VMPilot::Common::MappedFile& input)
+    : filename_(std::move(filename)), tmp_(filename_ + ".XXXXXX") {
+    struct stat st;
+    if (::fstat(input.fd(), &st) != 0)
+        throw std::runtime_error("Failed to get the mode of the input: " +
+                                 input.filename());
+
+    // A new unique file, so that two jobs writing the same output never
+    // share it
+    fd_ = ::mkstemp(tmp_.data());
+    if (fd_ < 0)
+        throw std::runtime_error("Failed to open the output: " + tmp_);
+    ::fcntl(fd_, F_SETFD, FD_CLOEXEC);
+    // Exactly the mode of the input, whatever the umask
+    if (::fchmod(fd_, st.st_mode & 07777) != 0) {
+        Close();
+        std::remove(tmp_.c_str());
+        throw std::runtime_error("Failed to set the mode of the output: " +
+                                 tmp_);
+    }
+}
+
+void OutputFile::Write(ByteView data) {
+    const auto* begin = data.data();
+    uint64_t left = data.size();
+    while (left != 0) {
+        const auto written = ::write(
+            fd_, begin,
+            static_cast<size_t>(std::min<uint64_t>(left, detail::MAX_CHUNK)));
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw std::runtime_error("Failed to write the output " + tmp_ +
+                                     ": " + std::strerror(errno));
+        begin += written;
+        left -= static_cast<uint64_t>(written);
+        size_ += static_cast<uint64_t>(written);
+    }
+}
+
+void OutputFile::Copy(const VMPilot::Common::MappedFile& input,
+                      uint64_t offset, uint64_t size) {
+    if (offset > input.size() || size > input.size() - offset)
+        throw std::runtime_error("Copy out of the input " + input.filename());
+
+#ifdef __linux__
+    // Both advance the position of the output, like a write
+    while (size != 0 && copy_file_range_) {
+        loff_t from = static_cast<loff_t>(offset);
+        const auto copied = ::copy_file_range(
+            input.fd(), &from, fd_, nullptr,
+            static_cast<size_t>(std::min(size, detail::MAX_CHUNK)), 0);
+        if (copied > 0) {
+            offset += static_cast<uint64_t>(copied);
+            size -= static_cast<uint64_t>(copied);
+            size_ += static_cast<uint64_t>(copied);
+        } else if (copied < 0 && errno == EINTR) {
+            continue;
+        } else if (copied < 0 && detail::is_unsupported(errno)) {
+            copy_file_range_ = false;
+        } else {
+            throw std::runtime_error("Failed to copy " + input.filename() +
+                                     " to the output: " +
+                                     std::strerror(copied == 0 ? EIO : errno));
+        }
+    }
+    while (size != 0 && sendfile_) {
+        off_t from = static_cast<off_t>(offset);
+        const auto copied = ::sendfile(
+            fd_, input.fd(), &from,
+            static_cast<size_t>(std::min(size, detail::MAX_CHUNK)));
+        if (copied > 0) {
+            offset += static_cast<uint64_t>(copied);
+            size -= static_cast<uint64_t>(copied);
+            size_ += static_cast<uint64_t>(copied);
+        } else if (copied < 0 && errno == EINTR) {
+            continue;
+        } else if (copied < 0 && detail::is_unsupported(errno)) {
+            sendfile_ = false;
+        } else {
+            throw std::runtime_error("Failed to copy " + input.filename() +
+                                     " to the output: " +
+                                     std::strerror(copied == 0 ? EIO : errno));
+        }
+    }
+#endif
+
+    // Otherwise the kernel still reads the pages from the mapping
+    if (size != 0)
+        Write(input.view().subview(offset, size));
+}
+
+void OutputFile::Close() noexcept {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void OutputFile::Commit() {
+    const bool closed = ::close(fd_) == 0;
+    fd_ = -1;
+    if (!closed || std::rename(tmp_.c_str(), filename_.c_str()) != 0)
+        throw std::runtime_error("Failed to write the output " + filename_ +
+                                 ": " + std::strerror(errno));
+    committed_ = true;
+}
+
+#endif
+
+OutputFile::~OutputFile() {
+    Close();
+    if (!committed_)
+        std::remove(tmp_.c_str());
+}
+
+void OutputFile::Align(uint64_t alignment) {
+    if (alignment <= 1)
+        return;
+    uint64_t padding = (alignment - size_ % alignment) % alignment;
+    while (padding != 0) {
+        const auto chunk = std::min<uint64_t>(padding, sizeof(detail::ZEROS));
+        Write(ByteView(detail::ZEROS, static_cast<size_t>(chunk)));
+        padding -= chunk;
+    }
+}
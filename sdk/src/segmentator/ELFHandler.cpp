@@ -1,9 +1,11 @@
 #include <ELFHandler.hpp>
+#include <ELFImage.hpp>
 #include <ELFSectionViewer.hpp>
 #include <utilities.hpp>
 
 #include <cstdint>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -13,37 +15,64 @@
 
 using namespace VMPilot::SDK::Segmentator;
 
+namespace {
+namespace detail {
+constexpr uint16_t SHN_UNDEF = 0;
+constexpr uint8_t STB_LOCAL = 0;
+constexpr uint8_t STT_GNU_IFUNC = 10;
+
+SymbolType to_symbol_type(uint8_t type) noexcept {
+    if (type <= static_cast<uint8_t>(SymbolType::FILE))
+        return static_cast<SymbolType>(type);
+    // An indirect function is code too, its resolver
+    if (type == STT_GNU_IFUNC)
+        return SymbolType::FUNC;
+    if (type >= static_cast<uint8_t>(SymbolType::LOPROC) &&
+        type <= static_cast<uint8_t>(SymbolType::HIPROC))
+        return static_cast<SymbolType>(type);
+    return SymbolType::NOTYPE;
+}
+}  // namespace detail
+}  // namespace
+
 struct ELFFileHandlerStrategy::Impl {
-    ELFIO::elfio reader;
-    std::unordered_map<std::string, ELFSectionViewer> section_table;
+    // The sections are views into the mapping, so it is kept alive here
+    std::shared_ptr<const VMPilot::Common::MappedFile> file;
+    ELFImage image;
+
+    // Built on the first lookup, then each lookup is O(1)
+    bool indices_built = false;
+    std::unique_ptr<ELFSymbolIndex> dynsym_index;
+    // The index in .rela.plt (.rel.plt) of the first entry of a symbol
+    std::unordered_map<uint32_t, uint64_t> relaplt_index;
+
     uint64_t vmp_begin_addr = -1;
     uint64_t vmp_end_addr = -1;
     uint64_t text_base_addr = -1;
+
+    explicit Impl(std::shared_ptr<const VMPilot::Common::MappedFile> file)
+        : file(std::move(file)), image(this->file->view()) {}
 };
 
 std::unique_ptr<ELFFileHandlerStrategy::Impl>
-VMPilot::SDK::Segmentator::make_elf_impl(const std::string& file_name) {
-    auto impl = std::make_unique<ELFFileHandlerStrategy::Impl>();
-    if (!impl->reader.load(file_name)) {
-        throw std::runtime_error("File not found or it is not an ELF file");
-    }
+VMPilot::SDK::Segmentator::make_elf_impl(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file) {
+    if (file == nullptr)
+        throw std::runtime_error("No ELF file to handle");
 
-    // Cache all section accessors in the section_table
-    // This allows us to access the section_accessor by the section name directly
-    for (auto&& section : impl->reader.sections) {
-        impl->section_table[section->get_name()] =
-            ELFSectionViewer(section.get());
-    }
-
-    return impl;
+    // ELFImage throws if it is not an ELF file
+    return std::make_unique<ELFFileHandlerStrategy::Impl>(std::move(file));
 }
 
 ELFFileHandlerStrategy::ELFFileHandlerStrategy(const std::string& file_name)
-    : pImpl(make_elf_impl(file_name)) {}
+    : ELFFileHandlerStrategy(
+          std::make_shared<const VMPilot::Common::MappedFile>(file_name)) {}
 
-ELFFileHandlerStrategy::~ELFFileHandlerStrategy() {
-    pImpl->section_table.clear();
-}
+ELFFileHandlerStrategy::ELFFileHandlerStrategy(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file)
+    : pImpl(make_elf_impl(std::move(file))) {}
+
+ELFFileHandlerStrategy::~ELFFileHandlerStrategy() = default;
 
 std::pair<uint64_t, uint64_t>
 ELFFileHandlerStrategy::doGetBeginEndAddr() noexcept {
@@ -63,115 +92,140 @@ std::vector<uint8_t> ELFFileHandlerStrategy::doGetTextSection() noexcept {
         spdlog::error("Error: Could not find the .text section");
         return {};
     }
+    return std::vector<uint8_t>(chunk.begin(), chunk.end());
+}
+
+VMPilot::Common::ByteView
+ELFFileHandlerStrategy::doGetTextSectionView() noexcept {
+    const auto& chunk = this->doGetTextSectionIntl();
+    if (chunk.empty()) {
+        spdlog::error("Error: Could not find the .text section");
+    }
     return chunk;
 }
 
 uint64_t ELFFileHandlerStrategy::doGetTextBaseAddr() noexcept {
     if (pImpl->text_base_addr == static_cast<uint64_t>(-1)) {
-        const auto& text_section = pImpl->section_table.find(".text");
-        if (text_section == pImpl->section_table.end()) {
+        const auto text_section = pImpl->image.findSection(".text");
+        if (text_section == nullptr) {
             spdlog::error("Error: Could not find the .text section");
             return -1;
         }
 
-        pImpl->text_base_addr =
-            text_section->second.getSection()->get_address();
+        pImpl->text_base_addr = text_section->getAddress();
     }
 
     return pImpl->text_base_addr;
 }
 
-uint64_t ELFFileHandlerStrategy::getEntryIndex(
-    const std::string& signature) noexcept {
-    const auto& dynsym = pImpl->section_table.find(".dynsym");
-    if (dynsym == pImpl->section_table.end()) {
-        return -1;
+NativeSymbolTable ELFFileHandlerStrategy::doGetNativeSymbolTable() noexcept {
+    const auto& image = pImpl->image;
+    // A stripped file only has .dynsym, with the exported symbols
+    auto symtab = image.findSection(".symtab");
+    if (symtab == nullptr) {
+        symtab = image.findSection(".dynsym");
     }
-
-    auto section = dynsym->second.getSection();
-    if (!section) {
-        spdlog::error("Failed to get the .dynsym section");
-        return -1;
+    if (symtab == nullptr) {
+        spdlog::error("Error: Could not find the .symtab or .dynsym section");
+        return {};
     }
 
-    ELFIO::elfio& reader = pImpl->reader;  // NOLINT
-    ELFIO::symbol_section_accessor accessor(reader, section);
-    auto size = accessor.get_symbols_num();
-    for (size_t i = 0; i < size; ++i) {
-        std::string name;
-        ELFIO::Elf64_Addr value;
-        ELFIO::Elf_Xword size;
-        unsigned char bind;
-        unsigned char type;
-        ELFIO::Elf_Half section_index;
-        unsigned char other;
-
-        if (!accessor.get_symbol(i, name, value, size, bind, type,
-                                 section_index, other)) {
-            spdlog::error("Failed to get the symbol at index {}", i);
-            continue;
+    NativeSymbolTable table;
+    try {
+        const size_t count = image.getSymbolCount(*symtab);
+        table.reserve(count);
+        // The entry 0 is the null symbol
+        for (size_t i = 1; i < count; ++i) {
+            const auto symbol = image.getSymbol(*symtab, i);
+            if (symbol.shndx == detail::SHN_UNDEF) {
+                continue;
+            }
+
+            table.Add(symbol.name, symbol.value, symbol.size,
+                      detail::to_symbol_type(symbol.getType()),
+                      symbol.getBind() != detail::STB_LOCAL);
         }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read the symbols of {}: {}", symtab->getName(),
+                      e.what());
+        return {};
+    }
+    return table;
+}
 
-        if (name == signature) {
-            return i;
+void ELFFileHandlerStrategy::buildIndices() noexcept {
+    auto& impl = *pImpl;
+    if (impl.indices_built) {
+        return;
+    }
+    impl.indices_built = true;
+
+    const auto& image = impl.image;
+    const auto dynsym = image.findSection(".dynsym");
+    if (dynsym != nullptr) {
+        try {
+            impl.dynsym_index =
+                std::make_unique<ELFSymbolIndex>(image, *dynsym);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to index the .dynsym section: {}", e.what());
         }
     }
 
-    return -1;
-}
-
-uint64_t ELFFileHandlerStrategy::getRelapltIdx(uint64_t dynsym_idx) noexcept {
     // 32-bit is .rel.plt, 64-bit is .rela.plt
     static const char* relaplt_name[] = {".rel.plt", ".rela.plt"};
-    const int& is_64_bit = pImpl->reader.get_class() == ELFIO::ELFCLASS64;
-
-    const auto& relaplt = pImpl->section_table.find(relaplt_name[is_64_bit]);
-    if (relaplt == pImpl->section_table.end()) {
-        return -1;
+    const int& is_64_bit = image.is64();
+    const auto relaplt = image.findSection(relaplt_name[is_64_bit]);
+    if (relaplt == nullptr) {
+        return;
     }
 
-    auto section = relaplt->second.getSection();
-    if (!section) {
-        spdlog::error("Failed to get the .rela.plt section");
-        return -1;
-    }
-
-    const auto& reader = pImpl->reader;  // NOLINT
-    ELFIO::relocation_section_accessor accessor(reader, section);
-    auto size = accessor.get_entries_num();
+    auto size = image.getRelocationCount(*relaplt);
+    impl.relaplt_index.reserve(size);
     for (size_t i = 0; i < size; ++i) {
-        ELFIO::Elf64_Addr offset;
-        ELFIO::Elf_Word symbol;
-        ELFIO::Elf_Sxword addend;
-        unsigned int type;
-
-        if (!accessor.get_entry(i, offset, symbol, type, addend)) {
-            spdlog::error("Failed to get the entry at index {}", i);
-            continue;
+        try {
+            impl.relaplt_index.emplace(image.getRelocation(*relaplt, i).symbol,
+                                       i);
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to get the entry at index {}: {}", i,
+                          e.what());
         }
+    }
+}
 
-        if (symbol == dynsym_idx) {
-            return i;
-        }
+uint64_t ELFFileHandlerStrategy::getEntryIndex(
+    const std::string& signature) noexcept {
+    buildIndices();
+    if (pImpl->dynsym_index == nullptr) {
+        return -1;
     }
 
-    return -1;
+    // NOT_FOUND is -1 too
+    return pImpl->dynsym_index->find(signature);
 }
 
-uint64_t ELFFileHandlerStrategy::getPltAddr(uint64_t relaplt_idx) noexcept {
-    const auto& plt = pImpl->section_table.find(".plt");
-    if (plt == pImpl->section_table.end()) {
+uint64_t ELFFileHandlerStrategy::getRelapltIdx(uint64_t dynsym_idx) noexcept {
+    buildIndices();
+    if (dynsym_idx > UINT32_MAX) {
+        return -1;
+    }
+
+    const auto& relaplt_index = pImpl->relaplt_index;
+    const auto it = relaplt_index.find(static_cast<uint32_t>(dynsym_idx));
+    if (it == relaplt_index.end()) {
         return -1;
     }
 
-    const auto& section = plt->second.getSection();
-    if (!section) {
-        spdlog::error("Failed to get the .plt section");
+    return it->second;
+}
+
+uint64_t ELFFileHandlerStrategy::getPltAddr(uint64_t relaplt_idx) noexcept {
+    const auto plt = pImpl->image.findSection(".plt");
+    if (plt == nullptr) {
         return -1;
     }
 
-    uint64_t alignment = section->get_addr_align();
-    uint64_t plt_base_addr = section->get_address();
+    uint64_t alignment = plt->getAddrAlign();
+    uint64_t plt_base_addr = plt->getAddress();
 
     return plt_base_addr + alignment * (relaplt_idx + 1);
 }
@@ -214,15 +268,12 @@ ELFFileHandlerStrategy::doGetBeginEndAddrIntl() noexcept {
     return {begin_addr, end_addr};
 }
 
-std::vector<uint8_t> ELFFileHandlerStrategy::doGetTextSectionIntl() noexcept {
-    const auto& text_section_iter = pImpl->section_table.find(".text");
-    if (text_section_iter == pImpl->section_table.end()) {
+VMPilot::Common::ByteView
+ELFFileHandlerStrategy::doGetTextSectionIntl() noexcept {
+    const auto text_section = pImpl->image.findSection(".text");
+    if (text_section == nullptr) {
         return {};
     }
 
-    auto section = text_section_iter->second.getSection();
-    std::vector<uint8_t> text_section(section->get_size());
-    std::memcpy(text_section.data(), section->get_data(), section->get_size());
-
-    return text_section;
+    return text_section->getData();
 }
@@ -0,0 +1,461 @@
+#include <ELFImage.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+using namespace VMPilot::SDK::Segmentator;
+using VMPilot::Common::ByteView;
+
+namespace {
+namespace detail {
+// e_ident
+constexpr size_t EI_NIDENT = 16;
+constexpr size_t EI_CLASS = 4;
+constexpr size_t EI_DATA = 5;
+constexpr uint8_t ELFCLASS32 = 1;
+constexpr uint8_t ELFCLASS64 = 2;
+constexpr uint8_t ELFDATA2LSB = 1;
+constexpr uint8_t ELFDATA2MSB = 2;
+
+// Special section indices and counts
+constexpr uint16_t SHN_UNDEF = 0;
+constexpr uint16_t SHN_XINDEX = 0xffff;
+constexpr uint16_t PN_XNUM = 0xffff;
+
+// The entry sizes of both classes
+constexpr size_t ELF32_SHDR_SIZE = 40;
+constexpr size_t ELF64_SHDR_SIZE = 64;
+constexpr size_t ELF32_PHDR_SIZE = 32;
+constexpr size_t ELF64_PHDR_SIZE = 56;
+constexpr size_t ELF32_SYM_SIZE = 16;
+constexpr size_t ELF64_SYM_SIZE = 24;
+constexpr size_t ELF32_REL_SIZE = 8;
+constexpr size_t ELF32_RELA_SIZE = 12;
+constexpr size_t ELF64_REL_SIZE = 16;
+constexpr size_t ELF64_RELA_SIZE = 24;
+
+template <typename T>
+T byteswap(T value) noexcept {
+    static_assert(std::is_integral_v<T>);
+    using U = std::make_unsigned_t<T>;
+    auto bits = static_cast<U>(value);
+    U result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        result = static_cast<U>((result << 8) | (bits & 0xff));
+        bits = static_cast<U>(bits >> 8);
+    }
+    return static_cast<T>(result);
+}
+
+bool host_is_big_endian() noexcept {
+    const uint16_t one = 1;
+    uint8_t first;
+    std::memcpy(&first, &one, 1);
+    return first == 0;
+}
+}  // namespace detail
+}  // namespace
+
+template <typename T>
+T ELFImage::read(uint64_t offset) const {
+    if (offset > data.size() || sizeof(T) > data.size() - offset)
+        throw std::runtime_error("ELF read out of the file at offset " +
+                                 std::to_string(offset));
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return swap ? detail::byteswap(value) : value;
+}
+
+ELFImage::ELFImage(ByteView file) : data(file) {
+    if (data.size() < detail::EI_NIDENT || data[0] != 0x7f ||
+        data[1] != 'E' || data[2] != 'L' || data[3] != 'F')
+        throw std::runtime_error("Not an ELF file");
+
+    const auto elf_class = data[detail::EI_CLASS];
+    const auto elf_data = data[detail::EI_DATA];
+    if (elf_class != detail::ELFCLASS32 && elf_class != detail::ELFCLASS64)
+        throw std::runtime_error("Invalid ELF class");
+    if (elf_data != detail::ELFDATA2LSB && elf_data != detail::ELFDATA2MSB)
+        throw std::runtime_error("Invalid ELF data encoding");
+
+    is_64 = elf_class == detail::ELFCLASS64;
+    big_endian = elf_data == detail::ELFDATA2MSB;
+    swap = big_endian != detail::host_is_big_endian();
+
+    // The ELF header fields after e_ident
+    type = read<uint16_t>(16);
+    machine = read<uint16_t>(18);
+    const uint64_t phoff =
+        is_64 ? read<uint64_t>(0x20) : read<uint32_t>(0x1C);
+    const uint64_t shoff =
+        is_64 ? read<uint64_t>(0x28) : read<uint32_t>(0x20);
+    const uint16_t phentsize = read<uint16_t>(is_64 ? 0x36 : 0x2A);
+    uint64_t phnum = read<uint16_t>(is_64 ? 0x38 : 0x2C);
+    const uint16_t shentsize = read<uint16_t>(is_64 ? 0x3A : 0x2E);
+    uint64_t shnum = read<uint16_t>(is_64 ? 0x3C : 0x30);
+    uint32_t shstrndx = read<uint16_t>(is_64 ? 0x3E : 0x32);
+
+    if (shoff != 0) {
+        if (shentsize <
+            (is_64 ? detail::ELF64_SHDR_SIZE : detail::ELF32_SHDR_SIZE))
+            throw std::runtime_error("Invalid ELF section header size");
+
+        // With many sections or segments, the real counts and string table
+        // index are in the first section header
+        const auto first = readSectionHeader(shoff);
+        if (shnum == 0)
+            shnum = first.size;
+        if (shstrndx == detail::SHN_XINDEX)
+            shstrndx = first.link;
+        if (phnum == detail::PN_XNUM)
+            phnum = first.info;
+    } else {
+        shnum = 0;
+        shstrndx = detail::SHN_UNDEF;
+    }
+    tables = {phoff, phentsize, phnum, shoff, shentsize, shnum, shstrndx};
+
+    if (phoff != 0 && phnum != 0) {
+        if (phentsize <
+            (is_64 ? detail::ELF64_PHDR_SIZE : detail::ELF32_PHDR_SIZE))
+            throw std::runtime_error("Invalid ELF program header size");
+        if (phoff > data.size() || phnum > (data.size() - phoff) / phentsize)
+            throw std::runtime_error("ELF program headers out of the file");
+
+        segments.reserve(phnum);
+        for (uint64_t i = 0; i < phnum; ++i)
+            segments.push_back(readProgramHeader(phoff + i * phentsize));
+    }
+
+    if (shoff == 0)
+        return;  // No section header table
+
+    if (shnum > (data.size() - std::min<uint64_t>(shoff, data.size())) /
+                    shentsize)
+        throw std::runtime_error("ELF section headers out of the file");
+
+    std::vector<ELFSectionViewer::Header> headers(shnum);
+    for (uint64_t i = 0; i < shnum; ++i)
+        headers[i] = readSectionHeader(shoff + i * shentsize);
+
+    // Validate the data of every section before any name is read from one
+    sections.reserve(shnum);
+    for (const auto& header : headers) {
+        ByteView section_data;
+        if (header.type != ELFSectionViewer::SHT_NOBITS && header.size != 0) {
+            if (header.offset > data.size() ||
+                header.size > data.size() - header.offset)
+                throw std::runtime_error("ELF section out of the file");
+            section_data = data.subview(header.offset, header.size);
+        }
+        sections.emplace_back(std::string_view(), header, section_data);
+    }
+
+    if (shstrndx == detail::SHN_UNDEF || shstrndx >= shnum)
+        return;  // No section names
+
+    section_index.reserve(shnum);
+    for (size_t i = 0; i < shnum; ++i) {
+        const auto name = readString(shstrndx, headers[i].name);
+        sections[i] = ELFSectionViewer(name, headers[i], sections[i].getData());
+        // The first section of a name wins, like a lookup by name in ELFIO
+        section_index.emplace(name, i);
+    }
+}
+
+ELFSectionViewer::Header ELFImage::readSectionHeader(uint64_t offset) const {
+    ELFSectionViewer::Header header;
+    header.name = read<uint32_t>(offset);
+    header.type = read<uint32_t>(offset + 4);
+    if (is_64) {
+        header.flags = read<uint64_t>(offset + 0x08);
+        header.addr = read<uint64_t>(offset + 0x10);
+        header.offset = read<uint64_t>(offset + 0x18);
+        header.size = read<uint64_t>(offset + 0x20);
+        header.link = read<uint32_t>(offset + 0x28);
+        header.info = read<uint32_t>(offset + 0x2C);
+        header.addralign = read<uint64_t>(offset + 0x30);
+        header.entsize = read<uint64_t>(offset + 0x38);
+    } else {
+        header.flags = read<uint32_t>(offset + 0x08);
+        header.addr = read<uint32_t>(offset + 0x0C);
+        header.offset = read<uint32_t>(offset + 0x10);
+        header.size = read<uint32_t>(offset + 0x14);
+        header.link = read<uint32_t>(offset + 0x18);
+        header.info = read<uint32_t>(offset + 0x1C);
+        header.addralign = read<uint32_t>(offset + 0x20);
+        header.entsize = read<uint32_t>(offset + 0x24);
+    }
+    return header;
+}
+
+ELFSegment ELFImage::readProgramHeader(uint64_t offset) const {
+    ELFSegment segment;
+    segment.type = read<uint32_t>(offset);
+    if (is_64) {
+        segment.flags = read<uint32_t>(offset + 0x04);
+        segment.offset = read<uint64_t>(offset + 0x08);
+        segment.vaddr = read<uint64_t>(offset + 0x10);
+        segment.paddr = read<uint64_t>(offset + 0x18);
+        segment.filesz = read<uint64_t>(offset + 0x20);
+        segment.memsz = read<uint64_t>(offset + 0x28);
+        segment.align = read<uint64_t>(offset + 0x30);
+    } else {
+        segment.offset = read<uint32_t>(offset + 0x04);
+        segment.vaddr = read<uint32_t>(offset + 0x08);
+        segment.paddr = read<uint32_t>(offset + 0x0C);
+        segment.filesz = read<uint32_t>(offset + 0x10);
+        segment.memsz = read<uint32_t>(offset + 0x14);
+        segment.flags = read<uint32_t>(offset + 0x18);
+        segment.align = read<uint32_t>(offset + 0x1C);
+    }
+    return segment;
+}
+
+std::string_view ELFImage::readString(uint32_t strtab_index,
+                                      uint64_t offset) const {
+    if (strtab_index >= sections.size())
+        throw std::runtime_error("Invalid ELF string table index");
+
+    const auto strtab = sections[strtab_index].getData();
+    if (offset >= strtab.size())
+        throw std::runtime_error("ELF string out of its string table");
+
+    const auto* begin = reinterpret_cast<const char*>(strtab.data() + offset);
+    const auto* nul = static_cast<const char*>(
+        std::memchr(begin, '\0', strtab.size() - offset));
+    const size_t length = nul ? static_cast<size_t>(nul - begin)
+                              : static_cast<size_t>(strtab.size() - offset);
+    return std::string_view(begin, length);
+}
+
+const ELFSectionViewer* ELFImage::findSection(
+    std::string_view name) const noexcept {
+    const auto it = section_index.find(name);
+    return it == section_index.end() ? nullptr : &sections[it->second];
+}
+
+size_t ELFImage::symbolEntrySize(
+    const ELFSectionViewer& symtab) const noexcept {
+    const size_t minimum =
+        is_64 ? detail::ELF64_SYM_SIZE : detail::ELF32_SYM_SIZE;
+    return symtab.getEntrySize() >= minimum ? symtab.getEntrySize() : minimum;
+}
+
+size_t ELFImage::getSymbolCount(
+    const ELFSectionViewer& symtab) const noexcept {
+    return symtab.getData().size() / symbolEntrySize(symtab);
+}
+
+ELFSymbol ELFImage::getSymbol(const ELFSectionViewer& symtab,
+                              size_t index) const {
+    if (index >= getSymbolCount(symtab))
+        throw std::runtime_error("ELF symbol index out of range");
+
+    const uint64_t offset =
+        symtab.getOffset() + index * symbolEntrySize(symtab);
+    ELFSymbol symbol;
+    uint32_t name;
+    if (is_64) {
+        name = read<uint32_t>(offset);
+        symbol.info = read<uint8_t>(offset + 4);
+        symbol.other = read<uint8_t>(offset + 5);
+        symbol.shndx = read<uint16_t>(offset + 6);
+        symbol.value = read<uint64_t>(offset + 8);
+        symbol.size = read<uint64_t>(offset + 16);
+    } else {
+        name = read<uint32_t>(offset);
+        symbol.value = read<uint32_t>(offset + 4);
+        symbol.size = read<uint32_t>(offset + 8);
+        symbol.info = read<uint8_t>(offset + 12);
+        symbol.other = read<uint8_t>(offset + 13);
+        symbol.shndx = read<uint16_t>(offset + 14);
+    }
+    if (name != 0)
+        symbol.name = readString(symtab.getLink(), name);
+    return symbol;
+}
+
+size_t ELFImage::relocationEntrySize(
+    const ELFSectionViewer& rel) const noexcept {
+    const bool rela = rel.getType() == SHT_RELA;
+    const size_t minimum =
+        is_64 ? (rela ? detail::ELF64_RELA_SIZE : detail::ELF64_REL_SIZE)
+              : (rela ? detail::ELF32_RELA_SIZE : detail::ELF32_REL_SIZE);
+    return rel.getEntrySize() >= minimum ? rel.getEntrySize() : minimum;
+}
+
+size_t ELFImage::getRelocationCount(
+    const ELFSectionViewer& rel) const noexcept {
+    return rel.getData().size() / relocationEntrySize(rel);
+}
+
+ELFRelocation ELFImage::getRelocation(const ELFSectionViewer& rel,
+                                      size_t index) const {
+    if (index >= getRelocationCount(rel))
+        throw std::runtime_error("ELF relocation index out of range");
+
+    const bool rela = rel.getType() == SHT_RELA;
+    const uint64_t offset = rel.getOffset() + index * relocationEntrySize(rel);
+    ELFRelocation relocation;
+    if (is_64) {
+        const auto info = read<uint64_t>(offset + 8);
+        relocation.offset = read<uint64_t>(offset);
+        relocation.symbol = static_cast<uint32_t>(info >> 32);
+        relocation.type = static_cast<uint32_t>(info);
+        if (rela)
+            relocation.addend = read<int64_t>(offset + 16);
+    } else {
+        const auto info = read<uint32_t>(offset + 4);
+        relocation.offset = read<uint32_t>(offset);
+        relocation.symbol = info >> 8;
+        relocation.type = info & 0xff;
+        if (rela)
+            relocation.addend = read<int32_t>(offset + 8);
+    }
+    return relocation;
+}
+
+namespace {
+namespace detail {
+uint32_t sysv_hash(std::string_view name) noexcept {
+    uint32_t h = 0;
+    for (const auto c : name) {
+        h = (h << 4) + static_cast<uint8_t>(c);
+        const uint32_t g = h & 0xf0000000;
+        if (g != 0)
+            h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+uint32_t gnu_hash(std::string_view name) noexcept {
+    uint32_t h = 5381;
+    for (const auto c : name)
+        h = h * 33 + static_cast<uint8_t>(c);
+    return h;
+}
+}  // namespace detail
+}  // namespace
+
+ELFSymbolIndex::ELFSymbolIndex(const ELFImage& image,
+                               const ELFSectionViewer& symtab)
+    : image(image), symtab(symtab) {
+    const auto symtab_index = image.getSectionIndex(symtab);
+    const auto count = image.getSymbolCount(symtab);
+
+    // Prefer .gnu.hash, modern linkers often only emit that one
+    for (const auto& section : image.getSections()) {
+        if (section.getLink() != symtab_index)
+            continue;
+        if (section.getType() == ELFImage::SHT_GNU_HASH) {
+            hash = &section;
+            kind = Kind::GnuHash;
+            break;
+        }
+        if (section.getType() == ELFImage::SHT_HASH)
+            hash = &section;
+    }
+    if (hash != nullptr && kind != Kind::GnuHash)
+        kind = Kind::SysVHash;
+
+    const uint64_t base = hash != nullptr ? hash->getOffset() : 0;
+    const uint64_t size = hash != nullptr ? hash->getData().size() : 0;
+    if (kind == Kind::SysVHash) {
+        // nbucket, nchain, bucket[nbucket], chain[nchain]
+        nbuckets = size >= 8 ? image.read<uint32_t>(base) : 0;
+        const uint64_t nchain = size >= 8 ? image.read<uint32_t>(base + 4) : 0;
+        buckets_offset = base + 8;
+        chains_offset = buckets_offset + uint64_t{nbuckets} * 4;
+        if (nbuckets == 0 || nchain > count ||
+            chains_offset + nchain * 4 > base + size)
+            kind = Kind::Map;
+    } else if (kind == Kind::GnuHash) {
+        // nbuckets, symoffset, bloom_size, bloom_shift, bloom[bloom_size],
+        // buckets[nbuckets], chains[]
+        const uint64_t word = image.is64() ? 8 : 4;
+        nbuckets = size >= 16 ? image.read<uint32_t>(base) : 0;
+        symoffset = size >= 16 ? image.read<uint32_t>(base + 4) : 0;
+        const uint64_t bloom_size =
+            size >= 16 ? image.read<uint32_t>(base + 8) : 0;
+        buckets_offset = base + 16 + bloom_size * word;
+        chains_offset = buckets_offset + uint64_t{nbuckets} * 4;
+        if (nbuckets == 0 || symoffset > count || chains_offset > base + size)
+            kind = Kind::Map;
+    }
+
+    // The names the hash table does not cover: the undefined symbols before
+    // symoffset for .gnu.hash, all of them without a usable table
+    const uint64_t mapped = kind == Kind::Map       ? count
+                            : kind == Kind::GnuHash ? symoffset
+                                                    : 0;
+    names.reserve(mapped);
+    for (uint64_t i = 0; i < mapped; ++i) {
+        const auto name = image.getSymbol(symtab, i).name;
+        if (!name.empty())
+            names.emplace(name, static_cast<uint32_t>(i));
+    }
+}
+
+uint64_t ELFSymbolIndex::find(std::string_view name) const noexcept {
+    const auto it = names.find(name);
+    if (it != names.end())
+        return it->second;
+
+    try {
+        switch (kind) {
+            case Kind::SysVHash:
+                return findSysV(name);
+            case Kind::GnuHash:
+                return findGnu(name);
+            default:
+                return NOT_FOUND;
+        }
+    } catch (const std::exception&) {
+        // A broken hash table, the symbol cannot be found through it
+        return NOT_FOUND;
+    }
+}
+
+bool ELFSymbolIndex::matches(uint64_t index, std::string_view name) const {
+    return image.getSymbol(symtab, index).name == name;
+}
+
+uint64_t ELFSymbolIndex::findSysV(std::string_view name) const {
+    const auto count = image.getSymbolCount(symtab);
+    const uint32_t bucket = detail::sysv_hash(name) % nbuckets;
+
+    // The chains are bounded by the symbol count, a loop is a broken table
+    uint64_t i = image.read<uint32_t>(buckets_offset + uint64_t{bucket} * 4);
+    for (uint64_t steps = 0; i != 0 && i < count && steps < count; ++steps) {
+        if (matches(i, name))
+            return i;
+        i = image.read<uint32_t>(chains_offset + i * 4);
+    }
+    return NOT_FOUND;
+}
+
+uint64_t ELFSymbolIndex::findGnu(std::string_view name) const {
+    const auto count = image.getSymbolCount(symtab);
+    const uint32_t h = detail::gnu_hash(name);
+    const uint32_t bucket = h % nbuckets;
+
+    uint64_t i = image.read<uint32_t>(buckets_offset + uint64_t{bucket} * 4);
+    if (i < symoffset)
+        return NOT_FOUND;  // An empty bucket
+
+    // A chain is the run of the symbols of a bucket, the last one has bit 0
+    for (; i < count; ++i) {
+        const uint32_t chain =
+            image.read<uint32_t>(chains_offset + (i - symoffset) * 4);
+        if ((chain | 1) == (h | 1) && matches(i, name))
+            return i;
+        if (chain & 1)
+            break;
+    }
+    return NOT_FOUND;
+}
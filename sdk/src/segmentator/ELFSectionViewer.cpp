@@ -1,3 +0,0 @@
-#include <ELFSectionViewer.hpp>
-
-// Left it empty currently
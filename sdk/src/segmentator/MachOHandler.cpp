@@ -1,7 +1,13 @@
 #include <MachOHandler.hpp>
-#include <utilities.hpp>
+#include <MachOImage.hpp>
 
-#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 
@@ -9,73 +15,155 @@ using namespace VMPilot::SDK::Segmentator;
 
 namespace {
 namespace detail {
-struct MachOParser {
-    // Placeholder structures for Mach-O parsing, not implemented
-    // TODO: Add third-party library for Mach-O parsing
-};
+// VMPilot_Begin(const char*) and VMPilot_End(const char*), mangled by clang
+// with the "_" prefix of the C symbols of Mach-O
+constexpr std::string_view BEGIN_SIGNATURE = "__Z13VMPilot_BeginPKc";
+constexpr std::string_view END_SIGNATURE = "__Z11VMPilot_EndPKc";
+
+SymbolType to_symbol_type(const MachOSection& section) noexcept {
+    if (section.isCode())
+        return SymbolType::FUNC;
+    return section.getType() == MachOSection::S_ZEROFILL ||
+                   section.segment != "__TEXT"
+               ? SymbolType::OBJECT
+               : SymbolType::NOTYPE;
+}
 }  // namespace detail
 }  // namespace
 
 struct MachOFileHandlerStrategy::Impl {
-    detail::MachOParser macho_handler;
-    // Placeholder for Mach-O specific data
+    // The sections are views into the mapping, so it is kept alive here
+    std::shared_ptr<const VMPilot::Common::MappedFile> file;
+    MachOImage image;
+
     uint64_t vmp_begin_addr = -1;
     uint64_t vmp_end_addr = -1;
     uint64_t text_base_addr = -1;
+
+    explicit Impl(std::shared_ptr<const VMPilot::Common::MappedFile> file)
+        : file(std::move(file)), image(this->file->view()) {}
 };
 
 std::unique_ptr<MachOFileHandlerStrategy::Impl>
-VMPilot::SDK::Segmentator::make_macho_impl([[maybe_unused]]  // NOLINT
-                                           const std::string& filename) {
-    auto impl = std::make_unique<MachOFileHandlerStrategy::Impl>();
-    // Placeholder for Mach-O parsing, not implemented
-    spdlog::error(
-        "MachOFileHandlerStrategy::make_macho_impl - Mach-O parsing not "
-        "implemented");
-    return impl;
+VMPilot::SDK::Segmentator::make_macho_impl(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file) {
+    if (file == nullptr)
+        throw std::runtime_error("No Mach-O file to handle");
+
+    // MachOImage throws if it is not a Mach-O file
+    return std::make_unique<MachOFileHandlerStrategy::Impl>(std::move(file));
 }
 
 MachOFileHandlerStrategy::MachOFileHandlerStrategy(const std::string& filename)
-    : pImpl(make_macho_impl(filename)) {
-    spdlog::error("MachOFileHandlerStrategy not implemented");
-}
+    : MachOFileHandlerStrategy(
+          std::make_shared<const VMPilot::Common::MappedFile>(filename)) {}
 
-MachOFileHandlerStrategy::~MachOFileHandlerStrategy() {}
+MachOFileHandlerStrategy::MachOFileHandlerStrategy(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file)
+    : pImpl(make_macho_impl(std::move(file))) {}
+
+MachOFileHandlerStrategy::~MachOFileHandlerStrategy() = default;
 
 std::pair<uint64_t, uint64_t>
 MachOFileHandlerStrategy::doGetBeginEndAddr() noexcept {
-    spdlog::error(
-        "MachOFileHandlerStrategy::doGetBeginEndAddr not implemented");
-    return std::make_pair(-1, -1);
+    if (pImpl->vmp_begin_addr == static_cast<uint64_t>(-1) ||
+        pImpl->vmp_end_addr == static_cast<uint64_t>(-1)) {
+        const auto& [begin_addr, end_addr] = doGetBeginEndAddrIntl();
+        pImpl->vmp_begin_addr = begin_addr;
+        pImpl->vmp_end_addr = end_addr;
+    }
+
+    return {pImpl->vmp_begin_addr, pImpl->vmp_end_addr};
 }
 
 std::vector<uint8_t> MachOFileHandlerStrategy::doGetTextSection() noexcept {
-    spdlog::error("MachOFileHandlerStrategy::doGetTextSection not implemented");
-    return std::vector<uint8_t>();
+    const auto& chunk = this->doGetTextSectionIntl();
+    if (chunk.empty()) {
+        spdlog::error("Error: Could not find the __TEXT,__text section");
+        return {};
+    }
+    return std::vector<uint8_t>(chunk.begin(), chunk.end());
+}
+
+VMPilot::Common::ByteView
+MachOFileHandlerStrategy::doGetTextSectionView() noexcept {
+    const auto& chunk = this->doGetTextSectionIntl();
+    if (chunk.empty()) {
+        spdlog::error("Error: Could not find the __TEXT,__text section");
+    }
+    return chunk;
 }
 
 uint64_t MachOFileHandlerStrategy::doGetTextBaseAddr() noexcept {
-    spdlog::error(
-        "MachOFileHandlerStrategy::doGetTextBaseAddr not implemented");
-    return -1;
+    if (pImpl->text_base_addr == static_cast<uint64_t>(-1)) {
+        const auto text_section = pImpl->image.findSection("__TEXT", "__text");
+        if (text_section == nullptr) {
+            spdlog::error("Error: Could not find the __TEXT,__text section");
+            return -1;
+        }
+
+        pImpl->text_base_addr = text_section->addr;
+    }
+
+    return pImpl->text_base_addr;
+}
+
+NativeSymbolTable MachOFileHandlerStrategy::doGetNativeSymbolTable() noexcept {
+    const auto& image = pImpl->image;
+    const auto& sections = image.getSections();
+    NativeSymbolTable table;
+    try {
+        const size_t count = image.getSymbolCount();
+        table.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto symbol = image.getSymbol(i);
+            // The debug entries and the imports have no address
+            if (symbol.isDebug() || !symbol.isDefined() || symbol.sect == 0 ||
+                symbol.sect > sections.size())
+                continue;
+
+            table.Add(symbol.name, symbol.value, 0,
+                      detail::to_symbol_type(sections[symbol.sect - 1]),
+                      symbol.isExternal());
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read the symbols: {}", e.what());
+        return {};
+    }
+    return table;
 }
 
 std::pair<uint64_t, uint64_t>
 MachOFileHandlerStrategy::doGetBeginEndAddrIntl() noexcept {
-    spdlog::error(
-        "MachOFileHandlerStrategy::doGetBeginEndAddrIntl not implemented");
-    return std::make_pair(-1, -1);
-}
+    uint64_t begin_addr = -1;
+    uint64_t end_addr = -1;
+    try {
+        for (const auto& stub : pImpl->image.getStubs()) {
+            if (stub.name == detail::BEGIN_SIGNATURE)
+                begin_addr = stub.addr;
+            else if (stub.name == detail::END_SIGNATURE)
+                end_addr = stub.addr;
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read the stubs: {}", e.what());
+        return {-1, -1};
+    }
 
-std::vector<uint8_t> MachOFileHandlerStrategy::doGetTextSectionIntl() noexcept {
-    spdlog::error(
-        "MachOFileHandlerStrategy::doGetTextSectionIntl not implemented");
-    return std::vector<uint8_t>();
+    if (begin_addr == static_cast<uint64_t>(-1) ||
+        end_addr == static_cast<uint64_t>(-1)) {
+        spdlog::error(
+            "Error: Could not find the VMPilot signatures in the stubs");
+        return {-1, -1};
+    }
+    return {begin_addr, end_addr};
 }
 
-std::vector<uint8_t> MachOFileHandlerStrategy::getSectionData(
-    [[maybe_unused]]  // NOLINT
-    const std::string& sectionName) noexcept {
-    spdlog::error("MachOFileHandlerStrategy::getSectionData not implemented");
-    return std::vector<uint8_t>();
+VMPilot::Common::ByteView
+MachOFileHandlerStrategy::doGetTextSectionIntl() noexcept {
+    const auto text_section = pImpl->image.findSection("__TEXT", "__text");
+    if (text_section == nullptr) {
+        return {};
+    }
+
+    return text_section->data;
 }
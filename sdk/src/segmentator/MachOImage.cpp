@@ -0,0 +1,277 @@
+#include <MachOImage.hpp>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+using namespace VMPilot::SDK::Segmentator;
+using VMPilot::Common::ByteView;
+
+namespace {
+namespace detail {
+// The magics as the first 4 bytes of the file, read big endian
+constexpr uint32_t MH_MAGIC = 0xfeedface;
+constexpr uint32_t MH_CIGAM = 0xcefaedfe;
+constexpr uint32_t MH_MAGIC_64 = 0xfeedfacf;
+constexpr uint32_t MH_CIGAM_64 = 0xcffaedfe;
+constexpr uint32_t FAT_MAGIC = 0xcafebabe;
+constexpr uint32_t FAT_MAGIC_64 = 0xcafebabf;
+
+// The load commands used by the handlers
+constexpr uint32_t LC_SEGMENT = 0x1;
+constexpr uint32_t LC_SYMTAB = 0x2;
+constexpr uint32_t LC_DYSYMTAB = 0xb;
+constexpr uint32_t LC_SEGMENT_64 = 0x19;
+
+// The entry sizes
+constexpr size_t MACH_HEADER_SIZE = 28;
+constexpr size_t MACH_HEADER_64_SIZE = 32;
+constexpr size_t SEGMENT_COMMAND_SIZE = 56;
+constexpr size_t SEGMENT_COMMAND_64_SIZE = 72;
+constexpr size_t SECTION_SIZE = 68;
+constexpr size_t SECTION_64_SIZE = 80;
+constexpr size_t NLIST_SIZE = 12;
+constexpr size_t NLIST_64_SIZE = 16;
+constexpr size_t FAT_ARCH_SIZE = 20;
+constexpr size_t FAT_ARCH_64_SIZE = 32;
+constexpr size_t NAME_SIZE = 16;
+
+// The fat header is always big endian
+template <typename T>
+T read_big_endian(ByteView data, uint64_t offset) {
+    if (offset > data.size() || sizeof(T) > data.size() - offset)
+        throw std::runtime_error("Mach-O fat header out of the file");
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value = static_cast<T>((value << 8) | data[offset + i]);
+    return value;
+}
+
+// The slice of cpu_type in a universal file, or data if it is not one
+ByteView select_slice(ByteView data, uint32_t cpu_type) {
+    if (data.size() < 8)
+        throw std::runtime_error("Not a Mach-O file");
+    const auto magic = read_big_endian<uint32_t>(data, 0);
+    if (magic != FAT_MAGIC && magic != FAT_MAGIC_64)
+        return data;
+
+    const bool is_64 = magic == FAT_MAGIC_64;
+    const auto count = read_big_endian<uint32_t>(data, 4);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t arch =
+            8 + uint64_t{i} * (is_64 ? FAT_ARCH_64_SIZE : FAT_ARCH_SIZE);
+        if (cpu_type != MachOImage::CPU_TYPE_ANY &&
+            read_big_endian<uint32_t>(data, arch) != cpu_type)
+            continue;
+
+        const uint64_t offset =
+            is_64 ? read_big_endian<uint64_t>(data, arch + 8)
+                  : read_big_endian<uint32_t>(data, arch + 8);
+        const uint64_t size =
+            is_64 ? read_big_endian<uint64_t>(data, arch + 16)
+                  : read_big_endian<uint32_t>(data, arch + 12);
+        if (offset > data.size() || size > data.size() - offset)
+            throw std::runtime_error("Mach-O slice out of the file");
+        return data.subview(offset, size);
+    }
+    throw std::runtime_error("No Mach-O slice of the CPU type " +
+                             std::to_string(cpu_type));
+}
+}  // namespace detail
+}  // namespace
+
+template <typename T>
+T MachOImage::read(uint64_t offset) const {
+    static_assert(std::is_integral_v<T>);
+    if (offset > data.size() || sizeof(T) > data.size() - offset)
+        throw std::runtime_error("Mach-O read out of the file at offset " +
+                                 std::to_string(offset));
+    using U = std::make_unsigned_t<T>;
+    U value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        const size_t shift = big_endian ? 8 * (sizeof(T) - 1 - i) : 8 * i;
+        value |= static_cast<U>(static_cast<U>(data[offset + i]) << shift);
+    }
+    return static_cast<T>(value);
+}
+
+std::string_view MachOImage::readName(uint64_t offset, size_t max) const {
+    if (offset > data.size() || max > data.size() - offset)
+        throw std::runtime_error("Mach-O name out of the file at offset " +
+                                 std::to_string(offset));
+    const auto* begin = reinterpret_cast<const char*>(data.data() + offset);
+    const auto* nul = static_cast<const char*>(std::memchr(begin, '\0', max));
+    return std::string_view(begin, nul ? static_cast<size_t>(nul - begin)
+                                       : max);
+}
+
+MachOImage::MachOImage(ByteView file, uint32_t cpu)
+    : data(detail::select_slice(file, cpu)) {
+    const auto magic = detail::read_big_endian<uint32_t>(data, 0);
+    switch (magic) {
+        case detail::MH_MAGIC:
+            big_endian = true;
+            break;
+        case detail::MH_CIGAM:
+            break;
+        case detail::MH_MAGIC_64:
+            big_endian = true;
+            is_64 = true;
+            break;
+        case detail::MH_CIGAM_64:
+            is_64 = true;
+            break;
+        default:
+            throw std::runtime_error("Not a Mach-O file");
+    }
+
+    cpu_type = read<uint32_t>(4);
+    file_type = read<uint32_t>(12);
+    const uint32_t command_count = read<uint32_t>(16);
+
+    uint64_t command =
+        is_64 ? detail::MACH_HEADER_64_SIZE : detail::MACH_HEADER_SIZE;
+    for (uint32_t i = 0; i < command_count; ++i) {
+        const auto cmd = read<uint32_t>(command);
+        const auto cmdsize = read<uint32_t>(command + 4);
+        if (cmdsize < 8)
+            throw std::runtime_error("Invalid Mach-O load command size");
+
+        switch (cmd) {
+            case detail::LC_SEGMENT:
+            case detail::LC_SEGMENT_64:
+                parseSegment(command);
+                break;
+            case detail::LC_SYMTAB: {
+                const auto symoff = read<uint32_t>(command + 8);
+                const auto nsyms = read<uint32_t>(command + 12);
+                const auto stroff = read<uint32_t>(command + 16);
+                const auto strsize = read<uint32_t>(command + 20);
+                const size_t entry =
+                    is_64 ? detail::NLIST_64_SIZE : detail::NLIST_SIZE;
+                if (symoff > data.size() ||
+                    nsyms > (data.size() - symoff) / entry ||
+                    stroff > data.size() || strsize > data.size() - stroff)
+                    throw std::runtime_error("Mach-O symbol table out of the "
+                                             "file");
+                symbol_table_offset = symoff;
+                symbol_count = nsyms;
+                string_table_offset = stroff;
+                string_table_size = strsize;
+                break;
+            }
+            case detail::LC_DYSYMTAB: {
+                const auto indirectsymoff = read<uint32_t>(command + 56);
+                const auto nindirectsyms = read<uint32_t>(command + 60);
+                if (indirectsymoff > data.size() ||
+                    nindirectsyms > (data.size() - indirectsymoff) / 4)
+                    throw std::runtime_error("Mach-O indirect symbol table "
+                                             "out of the file");
+                indirect_symbol_offset = indirectsymoff;
+                indirect_symbol_count = nindirectsyms;
+                break;
+            }
+            default:
+                break;
+        }
+        command += cmdsize;
+    }
+}
+
+void MachOImage::parseSegment(uint64_t command) {
+    const uint64_t nsects_offset = is_64 ? 64 : 48;
+    const auto count = read<uint32_t>(command + nsects_offset);
+    const uint64_t first =
+        command + (is_64 ? detail::SEGMENT_COMMAND_64_SIZE
+                         : detail::SEGMENT_COMMAND_SIZE);
+    const size_t size = is_64 ? detail::SECTION_64_SIZE : detail::SECTION_SIZE;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint64_t header = first + uint64_t{i} * size;
+        MachOSection section;
+        section.name = readName(header, detail::NAME_SIZE);
+        section.segment = readName(header + 16, detail::NAME_SIZE);
+        // The 32-bit fields after addr and size are 8 bytes further in a
+        // 64-bit section
+        const uint64_t fields = header + (is_64 ? 48 : 40);
+        if (is_64) {
+            section.addr = read<uint64_t>(header + 32);
+            section.size = read<uint64_t>(header + 40);
+        } else {
+            section.addr = read<uint32_t>(header + 32);
+            section.size = read<uint32_t>(header + 36);
+        }
+        section.offset = read<uint32_t>(fields);
+        section.flags = read<uint32_t>(fields + 16);
+        section.reserved1 = read<uint32_t>(fields + 20);
+        section.reserved2 = read<uint32_t>(fields + 24);
+
+        if (section.getType() != MachOSection::S_ZEROFILL &&
+            section.size != 0) {
+            if (section.offset > data.size() ||
+                section.size > data.size() - section.offset)
+                throw std::runtime_error("Mach-O section out of the file");
+            section.data = data.subview(section.offset, section.size);
+        }
+        sections.push_back(section);
+    }
+}
+
+const MachOSection* MachOImage::findSection(
+    std::string_view segment, std::string_view name) const noexcept {
+    for (const auto& section : sections) {
+        if (section.segment == segment && section.name == name)
+            return &section;
+    }
+    return nullptr;
+}
+
+MachOSymbol MachOImage::getSymbol(size_t index) const {
+    if (index >= symbol_count)
+        throw std::runtime_error("Mach-O symbol index out of the table: " +
+                                 std::to_string(index));
+
+    const uint64_t offset =
+        symbol_table_offset +
+        index * (is_64 ? detail::NLIST_64_SIZE : detail::NLIST_SIZE);
+    MachOSymbol symbol;
+    const auto strx = read<uint32_t>(offset);
+    symbol.type = read<uint8_t>(offset + 4);
+    symbol.sect = read<uint8_t>(offset + 5);
+    symbol.desc = read<uint16_t>(offset + 6);
+    symbol.value =
+        is_64 ? read<uint64_t>(offset + 8) : read<uint32_t>(offset + 8);
+    if (strx != 0 && strx < string_table_size)
+        symbol.name = readName(string_table_offset + strx,
+                               string_table_size - strx);
+    return symbol;
+}
+
+uint32_t MachOImage::getIndirectSymbol(size_t index) const {
+    if (index >= indirect_symbol_count)
+        throw std::runtime_error(
+            "Mach-O indirect symbol index out of the table: " +
+            std::to_string(index));
+    return read<uint32_t>(indirect_symbol_offset + index * 4);
+}
+
+std::vector<MachOStub> MachOImage::getStubs() const {
+    std::vector<MachOStub> stubs;
+    for (const auto& section : sections) {
+        if (section.getType() != MachOSection::S_SYMBOL_STUBS ||
+            section.reserved2 == 0)
+            continue;
+
+        const uint64_t count = section.size / section.reserved2;
+        for (uint64_t i = 0; i < count; ++i) {
+            MachOStub stub;
+            stub.addr = section.addr + i * section.reserved2;
+            const auto symbol = getIndirectSymbol(section.reserved1 + i);
+            if ((symbol & (INDIRECT_SYMBOL_LOCAL | INDIRECT_SYMBOL_ABS)) == 0)
+                stub.name = getSymbol(symbol).name;
+            stubs.push_back(stub);
+        }
+    }
+    return stubs;
+}
@@ -1,3 +0,0 @@
-#include <NativeFunctionBase.hpp>
-
-// Left this empty for now
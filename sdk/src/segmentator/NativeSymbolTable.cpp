@@ -1,3 +1,112 @@
 #include <NativeSymbolTable.hpp>
 
-// Left this empty for now
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace VMPilot::SDK::Segmentator;
+
+void NativeSymbolTable::reserve(size_t count) {
+    names_ids_.reserve(count);
+    addresses_.reserve(count);
+    sizes_.reserve(count);
+    types_.reserve(count);
+    globals_.reserve(count);
+}
+
+NativeSymbolTable::Index NativeSymbolTable::Add(std::string_view name,
+                                                uint64_t address,
+                                                uint64_t size, SymbolType type,
+                                                bool is_global) {
+    if (addresses_.size() >= std::numeric_limits<Index>::max())
+        throw std::length_error("The symbol table is full");
+
+    const auto index = static_cast<Index>(addresses_.size());
+    names_ids_.push_back(names_.Intern(name));
+    addresses_.push_back(address);
+    sizes_.push_back(size);
+    types_.push_back(type);
+    globals_.push_back(is_global ? 1 : 0);
+    by_address_stale_ = true;
+    return index;
+}
+
+void NativeSymbolTable::push_back(const NativeSymbolTableEntry& entry) {
+    const auto index = Add(entry.name, entry.address, entry.size, entry.type,
+                           entry.isGlobal);
+    const auto& attributes = entry.additionalAttributes;
+    if (attributes.count("section_number"))
+        SetSectionNumber(index, entry.getSectionNumber());
+    if (attributes.count("storage_class"))
+        SetStorageClass(index, entry.getStorageClass());
+    if (attributes.count("aux_symbols"))
+        SetNumberOfAuxSymbols(index, entry.getNumberOfAuxSymbols());
+}
+
+NativeSymbolTable::IndexRange NativeSymbolTable::Range(uint64_t begin,
+                                                       uint64_t end) const {
+    if (by_address_stale_) {
+        by_address_.resize(addresses_.size());
+        for (size_t i = 0; i < by_address_.size(); ++i)
+            by_address_[i] = static_cast<Index>(i);
+        // Stable, so the symbols of an address stay in table order
+        std::stable_sort(by_address_.begin(), by_address_.end(),
+                         [this](Index a, Index b) {
+                             return addresses_[a] < addresses_[b];
+                         });
+        by_address_stale_ = false;
+    }
+
+    const auto below = [this](Index i, uint64_t address) {
+        return addresses_[i] < address;
+    };
+    const auto first = std::lower_bound(by_address_.begin(), by_address_.end(),
+                                        begin, below);
+    const auto last = std::lower_bound(first, by_address_.end(), end, below);
+    return {by_address_.data() + (first - by_address_.begin()),
+            by_address_.data() + (last - by_address_.begin())};
+}
+
+std::vector<FunctionSymbol> VMPilot::SDK::Segmentator::GetFunctionSymbols(
+    const NativeSymbolTable& table, uint64_t begin, uint64_t end) {
+    std::vector<FunctionSymbol> functions;
+    for (const auto i : table.Range(begin, end)) {
+        if (table.Type(i) == SymbolType::FUNC)
+            functions.push_back({table.Address(i), table.Size(i), i});
+    }
+
+    // Already by address, the largest alias first so it is the one kept
+    std::stable_sort(functions.begin(), functions.end(),
+                     [](const FunctionSymbol& a, const FunctionSymbol& b) {
+                         return a.address != b.address ? a.address < b.address
+                                                       : a.size > b.size;
+                     });
+    functions.erase(std::unique(functions.begin(), functions.end(),
+                                [](const FunctionSymbol& a,
+                                   const FunctionSymbol& b) {
+                                    return a.address == b.address;
+                                }),
+                    functions.end());
+
+    for (size_t i = 0; i < functions.size(); ++i) {
+        const uint64_t limit =
+            i + 1 < functions.size() ? functions[i + 1].address : end;
+        auto& function = functions[i];
+        if (function.size == 0 || function.address + function.size > end)
+            function.size = limit - function.address;
+    }
+    return functions;
+}
+
+const FunctionSymbol* VMPilot::SDK::Segmentator::FindFunctionSymbol(
+    const std::vector<FunctionSymbol>& functions, uint64_t address) noexcept {
+    // The last function starting at or before address
+    auto it = std::upper_bound(functions.begin(), functions.end(), address,
+                               [](uint64_t address, const FunctionSymbol& f) {
+                                   return address < f.address;
+                               });
+    if (it == functions.begin())
+        return nullptr;
+    --it;
+    return address - it->address < it->size ? &*it : nullptr;
+}
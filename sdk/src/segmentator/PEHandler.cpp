@@ -1,7 +1,13 @@
 #include <PEHandler.hpp>
-#include <utilities.hpp>
+#include <PEImage.hpp>
 
-#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 
@@ -9,87 +15,239 @@ using namespace VMPilot::SDK::Segmentator;
 
 namespace {
 namespace detail {
-constexpr std::uint16_t NT_SHORT_NAME_LEN = 8;
-
-struct PEParser {
-    // Placeholder for PE parsing, not implemented
-    // TODO: Add third party library for PE parsing
+// The VMPilot_Begin(const char*) and VMPilot_End(const char*) imports, by
+// the mangling of the compiler of the protected file, not of ours: MSVC
+// x64, MSVC x86, then MinGW
+constexpr std::string_view BEGIN_SIGNATURES[] = {
+    "?VMPilot_Begin@@YAXPEBD@Z",
+    "?VMPilot_Begin@@YAXPBD@Z",
+    "_Z13VMPilot_BeginPKc",
 };
-
-struct ImageSectionHeader {
-    std::uint8_t Name[NT_SHORT_NAME_LEN];
-    union {
-        std::uint32_t PhysicalAddress;
-        std::uint32_t VirtualSize;
-    } Misc;
-    std::uint32_t VirtualAddress;
-    std::uint32_t SizeOfRawData;
-    std::uint32_t PointerToRawData;
-    std::uint32_t PointerToRelocations;
-    std::uint32_t PointerToLinenumbers;
-    std::uint16_t NumberOfRelocations;
-    std::uint16_t NumberOfLinenumbers;
-    std::uint32_t Characteristics;
+constexpr std::string_view END_SIGNATURES[] = {
+    "?VMPilot_End@@YAXPEBD@Z",
+    "?VMPilot_End@@YAXPBD@Z",
+    "_Z11VMPilot_EndPKc",
 };
+
+template <size_t N>
+bool is_any_of(std::string_view name,
+               const std::string_view (&signatures)[N]) noexcept {
+    for (const auto signature : signatures) {
+        if (name == signature)
+            return true;
+    }
+    return false;
+}
+
+// The special section numbers of the COFF symbols
+constexpr int16_t IMAGE_SYM_UNDEFINED = 0;
+
+SymbolType to_symbol_type(const PESymbol& symbol,
+                          const PESection& section) noexcept {
+    if (symbol.isFunction())
+        return SymbolType::FUNC;
+    if (symbol.storage_class == PESymbol::IMAGE_SYM_CLASS_FILE)
+        return SymbolType::FILE;
+    // A static symbol of value 0 with an auxiliary record names its section
+    if (symbol.storage_class == PESymbol::IMAGE_SYM_CLASS_STATIC &&
+        symbol.value == 0 && symbol.aux_symbols != 0)
+        return SymbolType::SECTION;
+    if (!section.isCode() && (section.characteristics &
+                              PESection::IMAGE_SCN_CNT_INITIALIZED_DATA))
+        return SymbolType::OBJECT;
+    return SymbolType::NOTYPE;
+}
 }  // namespace detail
 }  // namespace
 
 struct PEFileHandlerStrategy::Impl {
-    detail::PEParser pe_handler;
-    std::unordered_map<std::string, detail::ImageSectionHeader> section_table;
+    // The sections are views into the mapping, so it is kept alive here
+    std::shared_ptr<const VMPilot::Common::MappedFile> file;
+    PEImage image;
+
     uint64_t vmp_begin_addr = -1;
     uint64_t vmp_end_addr = -1;
     uint64_t text_base_addr = -1;
+
+    explicit Impl(std::shared_ptr<const VMPilot::Common::MappedFile> file)
+        : file(std::move(file)), image(this->file->view()) {}
+
+    // The .text section, or the first code section if it is named otherwise
+    const PESection* textSection() const noexcept {
+        const auto text = image.findSection(".text");
+        if (text != nullptr)
+            return text;
+        for (const auto& section : image.getSections()) {
+            if (section.isCode())
+                return &section;
+        }
+        return nullptr;
+    }
 };
 
 std::unique_ptr<PEFileHandlerStrategy::Impl>
-VMPilot::SDK::Segmentator::make_pe_impl([[maybe_unused]]  // NOLINT
-                                        const std::string& file_name) {
-    auto impl = std::make_unique<PEFileHandlerStrategy::Impl>();
-    // Placeholder for PE parsing, not implemented
+VMPilot::SDK::Segmentator::make_pe_impl(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file) {
+    if (file == nullptr)
+        throw std::runtime_error("No PE file to handle");
 
-    return impl;
+    // PEImage throws if it is not a PE file
+    return std::make_unique<PEFileHandlerStrategy::Impl>(std::move(file));
 }
 
 PEFileHandlerStrategy::PEFileHandlerStrategy(const std::string& file_name)
-    : pImpl(make_pe_impl(file_name)) {
-    spdlog::error("PEFileHandlerStrategy not implemented");
-}
+    : PEFileHandlerStrategy(
+          std::make_shared<const VMPilot::Common::MappedFile>(file_name)) {}
+
+PEFileHandlerStrategy::PEFileHandlerStrategy(
+    std::shared_ptr<const VMPilot::Common::MappedFile> file)
+    : pImpl(make_pe_impl(std::move(file))) {}
 
-PEFileHandlerStrategy::~PEFileHandlerStrategy() {}
+PEFileHandlerStrategy::~PEFileHandlerStrategy() = default;
 
 std::pair<uint64_t, uint64_t>
 PEFileHandlerStrategy::doGetBeginEndAddr() noexcept {
-    spdlog::error("PEFileHandlerStrategy::doGetBeginEndAddr not implemented");
-    return std::make_pair(-1, -1);
+    if (pImpl->vmp_begin_addr == static_cast<uint64_t>(-1) ||
+        pImpl->vmp_end_addr == static_cast<uint64_t>(-1)) {
+        const auto& [begin_addr, end_addr] = doGetBeginEndAddrIntl();
+        pImpl->vmp_begin_addr = begin_addr;
+        pImpl->vmp_end_addr = end_addr;
+    }
+
+    return {pImpl->vmp_begin_addr, pImpl->vmp_end_addr};
 }
 
 std::vector<uint8_t> PEFileHandlerStrategy::doGetTextSection() noexcept {
-    spdlog::error("PEFileHandlerStrategy::doGetTextSection not implemented");
-    return std::vector<uint8_t>();
+    const auto& chunk = this->doGetTextSectionIntl();
+    if (chunk.empty()) {
+        spdlog::error("Error: Could not find the code section");
+        return {};
+    }
+    return std::vector<uint8_t>(chunk.begin(), chunk.end());
+}
+
+VMPilot::Common::ByteView
+PEFileHandlerStrategy::doGetTextSectionView() noexcept {
+    const auto& chunk = this->doGetTextSectionIntl();
+    if (chunk.empty()) {
+        spdlog::error("Error: Could not find the code section");
+    }
+    return chunk;
 }
 
 uint64_t PEFileHandlerStrategy::doGetTextBaseAddr() noexcept {
-    spdlog::error("PEFileHandlerStrategy::doGetTextBaseAddr not implemented");
-    return -1;
+    if (pImpl->text_base_addr == static_cast<uint64_t>(-1)) {
+        const auto text_section = pImpl->textSection();
+        if (text_section == nullptr) {
+            spdlog::error("Error: Could not find the code section");
+            return -1;
+        }
+
+        pImpl->text_base_addr =
+            pImpl->image.getImageBase() + text_section->virtual_address;
+    }
+
+    return pImpl->text_base_addr;
+}
+
+NativeSymbolTable PEFileHandlerStrategy::doGetNativeSymbolTable() noexcept {
+    const auto& image = pImpl->image;
+    const auto& sections = image.getSections();
+    NativeSymbolTable table;
+    try {
+        const size_t count = image.getSymbolCount();
+        table.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto symbol = image.getSymbol(i);
+            // The auxiliary records follow their symbol
+            i += symbol.aux_symbols;
+
+            // The undefined, absolute and debug symbols have no address
+            if (symbol.section_number <= detail::IMAGE_SYM_UNDEFINED ||
+                static_cast<size_t>(symbol.section_number) > sections.size())
+                continue;
+
+            const auto& section = sections[symbol.section_number - 1];
+            const auto index = table.Add(
+                symbol.name,
+                image.getImageBase() + section.virtual_address + symbol.value,
+                0, detail::to_symbol_type(symbol, section),
+                symbol.storage_class == PESymbol::IMAGE_SYM_CLASS_EXTERNAL ||
+                    symbol.storage_class ==
+                        PESymbol::IMAGE_SYM_CLASS_WEAK_EXTERNAL);
+            table.SetSectionNumber(index, symbol.section_number);
+            table.SetStorageClass(index, symbol.storage_class);
+            table.SetNumberOfAuxSymbols(index, symbol.aux_symbols);
+        }
+        if (!table.empty())
+            return table;
+
+        // Like a stripped ELF file, only the exported functions are known
+        for (const auto& exported : image.getExports()) {
+            const auto section = image.findSectionByRva(exported.rva);
+            if (section == nullptr)
+                continue;
+            table.Add(exported.name, image.getImageBase() + exported.rva, 0,
+                      section->isCode() ? SymbolType::FUNC : SymbolType::OBJECT,
+                      true);
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read the symbols: {}", e.what());
+        return {};
+    }
+    return table;
 }
 
 std::pair<uint64_t, uint64_t>
 PEFileHandlerStrategy::doGetBeginEndAddrIntl() noexcept {
-    spdlog::error(
-        "PEFileHandlerStrategy::doGetBeginEndAddrIntl not implemented");
-    return std::make_pair(-1, -1);
+    const auto& image = pImpl->image;
+
+    // Step 1: find the import address table slots of the signatures
+    std::vector<uint32_t> slots(2, 0);
+    try {
+        for (const auto& import : image.getImports()) {
+            if (slots[0] == 0 &&
+                detail::is_any_of(import.name, detail::BEGIN_SIGNATURES))
+                slots[0] = import.iat_rva;
+            else if (slots[1] == 0 &&
+                     detail::is_any_of(import.name, detail::END_SIGNATURES))
+                slots[1] = import.iat_rva;
+        }
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to read the imports: {}", e.what());
+        return {-1, -1};
+    }
+    if (slots[0] == 0 || slots[1] == 0) {
+        spdlog::error(
+            "Error: Could not find the VMPilot signatures in the imports");
+        return {-1, -1};
+    }
+
+    // Step 2: find the thunks jumping through the slots, the calls go there
+    std::vector<uint64_t> thunks;
+    try {
+        thunks = image.findImportThunks(slots);
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to find the import thunks: {}", e.what());
+        return {-1, -1};
+    }
+    if (thunks[0] == PEImage::NOT_FOUND || thunks[1] == PEImage::NOT_FOUND) {
+        // A dllimport declaration calls through the slot, without a thunk
+        spdlog::error(
+            "Error: Could not find the import thunks of the VMPilot "
+            "signatures, they must not be declared dllimport");
+        return {-1, -1};
+    }
+
+    return {thunks[0], thunks[1]};
 }
 
-std::vector<uint8_t> PEFileHandlerStrategy::doGetTextSectionIntl() noexcept {
-    spdlog::error(
-        "PEFileHandlerStrategy::doGetTextSectionIntl not implemented");
-    return std::vector<uint8_t>();
-}
+VMPilot::Common::ByteView
+PEFileHandlerStrategy::doGetTextSectionIntl() noexcept {
+    const auto text_section = pImpl->textSection();
+    if (text_section == nullptr) {
+        return {};
+    }
 
-std::vector<uint8_t> PEFileHandlerStrategy::getSectionData(
-    [[maybe_unused]]  // NOLINT
-    const std::string& sectionName) noexcept {
-    spdlog::error("PEFileHandlerStrategy::getSectionData not implemented");
-    return std::vector<uint8_t>();
+    return text_section->data;
 }
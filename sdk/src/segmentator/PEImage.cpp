@@ -0,0 +1,387 @@
+#include <PEImage.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+using namespace VMPilot::SDK::Segmentator;
+using VMPilot::Common::ByteView;
+
+namespace {
+namespace detail {
+constexpr uint64_t E_LFANEW = 0x3C;
+constexpr uint32_t PE_SIGNATURE = 0x00004550;  // "PE\0\0"
+constexpr uint16_t PE32_MAGIC = 0x10B;
+constexpr uint16_t PE32_PLUS_MAGIC = 0x20B;
+
+// The entry sizes
+constexpr size_t FILE_HEADER_SIZE = 20;
+constexpr size_t SECTION_HEADER_SIZE = 40;
+constexpr size_t DATA_DIRECTORY_SIZE = 8;
+constexpr size_t IMPORT_DESCRIPTOR_SIZE = 20;
+constexpr size_t SYMBOL_SIZE = 18;
+constexpr size_t SHORT_NAME_SIZE = 8;
+
+// jmp [slot], FF 25 disp32
+constexpr uint8_t JMP_INDIRECT[] = {0xFF, 0x25};
+constexpr size_t JMP_INDIRECT_SIZE = 6;
+
+// The length of a name of at most max bytes, NUL padded
+size_t name_length(const uint8_t* name, size_t max) noexcept {
+    const auto* nul = static_cast<const uint8_t*>(std::memchr(name, 0, max));
+    return nul ? static_cast<size_t>(nul - name) : max;
+}
+}  // namespace detail
+}  // namespace
+
+template <typename T>
+T PEImage::read(uint64_t offset) const {
+    static_assert(std::is_integral_v<T>);
+    if (offset > data.size() || sizeof(T) > data.size() - offset)
+        throw std::runtime_error("PE read out of the file at offset " +
+                                 std::to_string(offset));
+    // PE is always little endian
+    using U = std::make_unsigned_t<T>;
+    U value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value |= static_cast<U>(static_cast<U>(data[offset + i]) << (8 * i));
+    return static_cast<T>(value);
+}
+
+template <typename T>
+T PEImage::readAtRva(uint32_t rva) const {
+    const auto offset = rvaToOffset(rva);
+    if (offset == NOT_MAPPED)
+        throw std::runtime_error("PE RVA not in the file: " +
+                                 std::to_string(rva));
+    return read<T>(offset);
+}
+
+PEImage::PEImage(ByteView file) : data(file) {
+    if (data.size() < detail::E_LFANEW + 4 || data[0] != 'M' ||
+        data[1] != 'Z')
+        throw std::runtime_error("Not a PE file");
+
+    const uint64_t pe = read<uint32_t>(detail::E_LFANEW);
+    if (read<uint32_t>(pe) != detail::PE_SIGNATURE)
+        throw std::runtime_error("Invalid PE signature");
+
+    // The COFF file header
+    const uint64_t file_header = pe + 4;
+    machine = read<uint16_t>(file_header);
+    const uint16_t section_count = read<uint16_t>(file_header + 2);
+    const uint32_t symbol_table = read<uint32_t>(file_header + 8);
+    const uint32_t symbols = read<uint32_t>(file_header + 12);
+    const uint16_t optional_size = read<uint16_t>(file_header + 16);
+
+    // The optional header, its layout depends on the magic
+    const uint64_t optional = file_header + detail::FILE_HEADER_SIZE;
+    const uint16_t magic = read<uint16_t>(optional);
+    if (magic != detail::PE32_MAGIC && magic != detail::PE32_PLUS_MAGIC)
+        throw std::runtime_error("Invalid PE optional header magic");
+    is_64 = magic == detail::PE32_PLUS_MAGIC;
+    image_base =
+        is_64 ? read<uint64_t>(optional + 24) : read<uint32_t>(optional + 28);
+    size_of_headers = read<uint32_t>(optional + 60);
+    directories_offset = optional + (is_64 ? 112 : 96);
+    directory_count = read<uint32_t>(optional + (is_64 ? 108 : 92));
+    // Only the directories inside the optional header are real
+    const uint64_t directories_end = optional + optional_size;
+    if (directories_offset > directories_end)
+        directory_count = 0;
+    directory_count = static_cast<uint32_t>(
+        std::min<uint64_t>(directory_count,
+                           (directories_end - std::min(directories_offset,
+                                                       directories_end)) /
+                               detail::DATA_DIRECTORY_SIZE));
+
+    // The COFF symbol table is optional and often stale in an image, so a
+    // broken one is ignored rather than rejecting the file
+    if (symbol_table != 0 && symbol_table < data.size() &&
+        symbols <= (data.size() - symbol_table) / detail::SYMBOL_SIZE) {
+        symbol_table_offset = symbol_table;
+        symbol_count = symbols;
+        string_table_offset =
+            symbol_table_offset + uint64_t{symbols} * detail::SYMBOL_SIZE;
+    }
+
+    const uint64_t section_table = optional + optional_size;
+    if (section_table > data.size() ||
+        section_count >
+            (data.size() - section_table) / detail::SECTION_HEADER_SIZE)
+        throw std::runtime_error("PE section table out of the file");
+
+    sections.reserve(section_count);
+    for (size_t i = 0; i < section_count; ++i) {
+        const uint64_t header = section_table + i * detail::SECTION_HEADER_SIZE;
+        PESection section;
+        section.name = std::string_view(
+            reinterpret_cast<const char*>(data.data() + header),
+            detail::name_length(data.data() + header,
+                                detail::SHORT_NAME_SIZE));
+        section.virtual_size = read<uint32_t>(header + 8);
+        section.virtual_address = read<uint32_t>(header + 12);
+        section.raw_size = read<uint32_t>(header + 16);
+        section.raw_offset = read<uint32_t>(header + 20);
+        section.characteristics = read<uint32_t>(header + 36);
+
+        // A long name is "/offset" into the string table
+        if (section.name.size() > 1 && section.name[0] == '/' &&
+            string_table_offset != 0) {
+            uint64_t offset = 0;
+            bool decimal = true;
+            for (const char c : section.name.substr(1)) {
+                decimal &= c >= '0' && c <= '9';
+                offset = offset * 10 + static_cast<uint64_t>(c - '0');
+            }
+            if (decimal)
+                section.name =
+                    readString(string_table_offset + offset, data.size());
+        }
+
+        // The raw size is rounded up to the file alignment, the virtual size
+        // is the real one
+        uint64_t size = section.raw_size;
+        if (section.virtual_size != 0)
+            size = std::min<uint64_t>(size, section.virtual_size);
+        if (section.raw_offset != 0 && size != 0) {
+            if (section.raw_offset > data.size() ||
+                size > data.size() - section.raw_offset)
+                throw std::runtime_error("PE section out of the file");
+            section.data = data.subview(section.raw_offset, size);
+        }
+        sections.push_back(section);
+    }
+}
+
+std::string_view PEImage::readString(uint64_t offset, uint64_t limit) const {
+    limit = std::min<uint64_t>(limit, data.size());
+    if (offset >= limit)
+        throw std::runtime_error("PE string out of the file at offset " +
+                                 std::to_string(offset));
+    const auto* begin = reinterpret_cast<const char*>(data.data() + offset);
+    return std::string_view(
+        begin, detail::name_length(data.data() + offset, limit - offset));
+}
+
+std::string_view PEImage::readStringAtRva(uint32_t rva) const {
+    const auto offset = rvaToOffset(rva);
+    if (offset == NOT_MAPPED)
+        throw std::runtime_error("PE string RVA not in the file: " +
+                                 std::to_string(rva));
+    // A string does not run past its section
+    const auto section = findSectionByRva(rva);
+    const uint64_t limit = section != nullptr
+                               ? uint64_t{section->raw_offset} +
+                                     section->data.size()
+                               : size_of_headers;
+    return readString(offset, limit);
+}
+
+const PESection* PEImage::findSection(std::string_view name) const noexcept {
+    for (const auto& section : sections) {
+        if (section.name == name)
+            return &section;
+    }
+    return nullptr;
+}
+
+const PESection* PEImage::findSectionByRva(uint32_t rva) const noexcept {
+    for (const auto& section : sections) {
+        const uint32_t size = std::max(section.virtual_size, section.raw_size);
+        if (rva >= section.virtual_address &&
+            rva - section.virtual_address < size)
+            return &section;
+    }
+    return nullptr;
+}
+
+uint32_t PEImage::rvaToOffset(uint32_t rva) const noexcept {
+    const auto section = findSectionByRva(rva);
+    if (section == nullptr) {
+        // The headers are mapped at RVA 0
+        return rva < size_of_headers && rva < data.size() ? rva : NOT_MAPPED;
+    }
+    const uint32_t delta = rva - section->virtual_address;
+    // Past the data is the zero fill, not in the file
+    return delta < section->data.size() ? section->raw_offset + delta
+                                        : NOT_MAPPED;
+}
+
+PEImage::DataDirectory PEImage::getDataDirectory(
+    size_t index) const noexcept {
+    if (index >= directory_count)
+        return {};
+    const auto offset =
+        directories_offset + index * detail::DATA_DIRECTORY_SIZE;
+    // Inside the optional header, which was read already
+    return {read<uint32_t>(offset), read<uint32_t>(offset + 4)};
+}
+
+std::vector<PEImport> PEImage::getImports() const {
+    std::vector<PEImport> imports;
+    const auto directory = getDataDirectory(IMAGE_DIRECTORY_ENTRY_IMPORT);
+    if (directory.rva == 0)
+        return imports;
+
+    const size_t thunk_size = is_64 ? 8 : 4;
+    const uint64_t ordinal_flag = is_64 ? uint64_t{1} << 63 : uint64_t{1} << 31;
+
+    // The descriptors end with a null one
+    for (uint32_t descriptor = directory.rva;;
+         descriptor += detail::IMPORT_DESCRIPTOR_SIZE) {
+        const auto lookup_table = readAtRva<uint32_t>(descriptor);
+        const auto name = readAtRva<uint32_t>(descriptor + 12);
+        const auto address_table = readAtRva<uint32_t>(descriptor + 16);
+        if (name == 0 && address_table == 0)
+            break;
+
+        const auto dll = readStringAtRva(name);
+        // Without a lookup table, the names are in the address table, as
+        // long as the image is not bound
+        const uint32_t names = lookup_table != 0 ? lookup_table : address_table;
+        for (uint32_t i = 0;; ++i) {
+            const uint32_t entry =
+                names + i * static_cast<uint32_t>(thunk_size);
+            const uint64_t thunk = is_64 ? readAtRva<uint64_t>(entry)
+                                         : readAtRva<uint32_t>(entry);
+            if (thunk == 0)
+                break;
+
+            PEImport import;
+            import.dll = dll;
+            import.iat_rva =
+                address_table + i * static_cast<uint32_t>(thunk_size);
+            if (thunk & ordinal_flag) {
+                import.ordinal = static_cast<uint16_t>(thunk & 0xffff);
+            } else {
+                // IMAGE_IMPORT_BY_NAME, the hint then the name
+                const auto hint_name = static_cast<uint32_t>(thunk);
+                import.ordinal = readAtRva<uint16_t>(hint_name);
+                import.name = readStringAtRva(hint_name + 2);
+            }
+            imports.push_back(import);
+        }
+    }
+    return imports;
+}
+
+std::vector<PEExport> PEImage::getExports() const {
+    std::vector<PEExport> exports;
+    const auto directory = getDataDirectory(IMAGE_DIRECTORY_ENTRY_EXPORT);
+    if (directory.rva == 0)
+        return exports;
+
+    const auto function_count = readAtRva<uint32_t>(directory.rva + 20);
+    const auto name_count = readAtRva<uint32_t>(directory.rva + 24);
+    const auto functions = readAtRva<uint32_t>(directory.rva + 28);
+    const auto names = readAtRva<uint32_t>(directory.rva + 32);
+    const auto name_ordinals = readAtRva<uint32_t>(directory.rva + 36);
+    // Each function takes 4 bytes of the file, so a bogus count throws
+    // before it is allocated
+    if (function_count > data.size() / 4 || name_count > data.size() / 4)
+        throw std::runtime_error("PE export directory out of the file");
+
+    exports.resize(function_count);
+    for (uint32_t i = 0; i < name_count; ++i) {
+        const auto ordinal = readAtRva<uint16_t>(name_ordinals + i * 2);
+        if (ordinal < function_count)
+            exports[ordinal].name =
+                readStringAtRva(readAtRva<uint32_t>(names + i * 4));
+    }
+    for (uint32_t i = 0; i < function_count; ++i)
+        exports[i].rva = readAtRva<uint32_t>(functions + i * 4);
+
+    // A forwarder points to a "dll.name" string in the directory
+    exports.erase(
+        std::remove_if(exports.begin(), exports.end(),
+                       [&directory](const PEExport& e) {
+                           return e.rva == 0 ||
+                                  (e.rva >= directory.rva &&
+                                   e.rva - directory.rva < directory.size);
+                       }),
+        exports.end());
+    return exports;
+}
+
+PESymbol PEImage::getSymbol(size_t index) const {
+    if (index >= symbol_count)
+        throw std::runtime_error("PE symbol index out of the table: " +
+                                 std::to_string(index));
+
+    const uint64_t offset = symbol_table_offset + index * detail::SYMBOL_SIZE;
+    PESymbol symbol;
+    if (read<uint32_t>(offset) == 0) {
+        // A long name, at an offset of the string table
+        symbol.name = readString(
+            string_table_offset + read<uint32_t>(offset + 4), data.size());
+    } else {
+        symbol.name = std::string_view(
+            reinterpret_cast<const char*>(data.data() + offset),
+            detail::name_length(data.data() + offset,
+                                detail::SHORT_NAME_SIZE));
+    }
+    symbol.value = read<uint32_t>(offset + 8);
+    symbol.section_number = read<int16_t>(offset + 12);
+    symbol.type = read<uint16_t>(offset + 14);
+    symbol.storage_class = read<uint8_t>(offset + 16);
+    symbol.aux_symbols = read<uint8_t>(offset + 17);
+    return symbol;
+}
+
+std::vector<uint64_t> PEImage::findImportThunks(
+    const std::vector<uint32_t>& iat_rvas) const {
+    std::vector<uint64_t> thunks(iat_rvas.size(), NOT_FOUND);
+
+    // The slots by RVA, to look each jmp up in O(log n)
+    std::vector<std::pair<uint32_t, size_t>> slots;
+    slots.reserve(iat_rvas.size());
+    for (size_t i = 0; i < iat_rvas.size(); ++i)
+        slots.emplace_back(iat_rvas[i], i);
+    std::sort(slots.begin(), slots.end());
+
+    size_t left = slots.size();
+    for (const auto& section : sections) {
+        if (!section.isCode() ||
+            section.data.size() < detail::JMP_INDIRECT_SIZE)
+            continue;
+
+        const uint8_t* begin = section.data.data();
+        const uint8_t* const last =
+            begin + section.data.size() - detail::JMP_INDIRECT_SIZE;
+        for (const uint8_t* p = begin; left != 0 && p <= last; ++p) {
+            p = static_cast<const uint8_t*>(std::memchr(
+                p, detail::JMP_INDIRECT[0], static_cast<size_t>(last - p) + 1));
+            if (p == nullptr)
+                break;
+            if (p[1] != detail::JMP_INDIRECT[1])
+                continue;
+
+            uint32_t disp = 0;
+            for (size_t i = 0; i < 4; ++i)
+                disp |= static_cast<uint32_t>(p[2 + i]) << (8 * i);
+            const auto rva =
+                section.virtual_address + static_cast<uint32_t>(p - begin);
+            // x64 addresses the slot relative to the next instruction, x86
+            // by its absolute address
+            const uint32_t target =
+                is_64 ? rva + static_cast<uint32_t>(detail::JMP_INDIRECT_SIZE) +
+                            disp
+                      : static_cast<uint32_t>(disp - image_base);
+
+            const auto it = std::lower_bound(
+                slots.begin(), slots.end(), std::make_pair(target, size_t{0}));
+            for (auto slot = it; slot != slots.end() && slot->first == target;
+                 ++slot) {
+                if (thunks[slot->second] == NOT_FOUND) {
+                    thunks[slot->second] = image_base + rva;
+                    --left;
+                }
+            }
+        }
+    }
+    return thunks;
+}
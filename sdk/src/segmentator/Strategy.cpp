@@ -17,6 +17,11 @@ std::vector<uint8_t> FileHandlerStrategy::doGetTextSection() noexcept {
     return std::vector<uint8_t>();
 }
 
+VMPilot::Common::ByteView FileHandlerStrategy::doGetTextSectionView() noexcept {
+    spdlog::error("FileHandlerStrategy::doGetTextSectionView not implemented");
+    return VMPilot::Common::ByteView();
+}
+
 uint64_t FileHandlerStrategy::doGetTextBaseAddr() noexcept {
     spdlog::error("FileHandlerStrategy::doGetTextBaseAddr not implemented");
     return -1;
@@ -27,7 +32,7 @@ NativeSymbolTable FileHandlerStrategy::doGetNativeSymbolTable() noexcept {
     return NativeSymbolTable();
 }
 
-bool ArchHandlerStrategy::doLoad(const std::vector<uint8_t>& code,
+bool ArchHandlerStrategy::doLoad(VMPilot::Common::ByteView code,
                                  const uint64_t base_addr) {
     // Emitting error message, not implemented
     spdlog::error(
@@ -39,8 +44,28 @@ bool ArchHandlerStrategy::doLoad(const std::vector<uint8_t>& code,
 }
 
 // doGetNativeFunctions
-std::vector<std::unique_ptr<NativeFunctionBase>>
-ArchHandlerStrategy::doGetNativeFunctions() {
+std::vector<NativeFunctionBase>
+ArchHandlerStrategy::doGetNativeFunctions(
+    [[maybe_unused]] const NativeSymbolTable& symbols) {
     spdlog::error("ArchHandlerStrategy::doGetNativeFunctions not implemented");
-    return std::vector<std::unique_ptr<NativeFunctionBase>>();
+    return std::vector<NativeFunctionBase>();
+}
+
+std::vector<VMPilot::SDK::ProtectedRegion> ArchHandlerStrategy::doFindRegions(
+    const uint64_t begin_target, const uint64_t end_target) {
+    spdlog::error(
+        "ArchHandlerStrategy::doFindRegions not implemented: begin_target: "
+        "{}, end_target: {}",
+        begin_target, end_target);
+    return std::vector<VMPilot::SDK::ProtectedRegion>();
+}
+
+bool ArchHandlerStrategy::doDisassembleRegion(
+    const VMPilot::SDK::ProtectedRegion& region,
+    [[maybe_unused]] VMPilot::SDK::NativeInstructions& instructions) {
+    spdlog::error(
+        "ArchHandlerStrategy::doDisassembleRegion not implemented: region: "
+        "{}",
+        region.index);
+    return false;
 }
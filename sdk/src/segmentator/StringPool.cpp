@@ -0,0 +1,49 @@
+#include <StringPool.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace VMPilot::SDK::Segmentator;
+
+namespace {
+namespace detail {
+// Most symbol names are short, a chunk holds thousands of them
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+}  // namespace detail
+}  // namespace
+
+StringPool::StringPool() {
+    strings_.emplace_back();
+    index_.emplace(std::string_view(), EMPTY);
+}
+
+StringPool::Id StringPool::Intern(std::string_view str) {
+    const auto it = index_.find(str);
+    if (it != index_.end())
+        return it->second;
+
+    if (strings_.size() > std::numeric_limits<Id>::max())
+        throw std::length_error("StringPool is full");
+
+    const auto id = static_cast<Id>(strings_.size());
+    const auto stored = store(str);
+    strings_.push_back(stored);
+    index_.emplace(stored, id);
+    return id;
+}
+
+std::string_view StringPool::store(std::string_view str) {
+    if (chunk_size_ - chunk_used_ < str.size()) {
+        // A long string gets a chunk of its own
+        chunk_size_ = std::max(detail::CHUNK_SIZE, str.size());
+        chunks_.push_back(std::make_unique<char[]>(chunk_size_));
+        chunk_used_ = 0;
+    }
+
+    char* dst = chunks_.back().get() + chunk_used_;
+    std::memcpy(dst, str.data(), str.size());
+    chunk_used_ += str.size();
+    return std::string_view(dst, str.size());
+}
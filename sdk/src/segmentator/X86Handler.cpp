@@ -1,18 +1,245 @@
 #include <X86Handler.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
-#include <capstone.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <capstone/capstone.h>
+#include <spdlog/spdlog.h>
 
 using namespace VMPilot::SDK::Segmentator;
 
+namespace {
+namespace detail {
+// The size of "call rel32"
+constexpr size_t CALL_REL32_SIZE = 5;
+constexpr uint8_t CALL_REL32_OPCODE = 0xE8;
+
+struct CallSite {
+    size_t offset;  // In the code
+    bool is_begin;  // VMPilot_Begin, else VMPilot_End
+};
+
+// Find the "E8 rel32" calls to begin_target or end_target, without
+// disassembling the code. The bytes of another instruction that happen to
+// look like such a call are weeded out by the disassembly of the region.
+std::vector<CallSite> find_call_sites(VMPilot::Common::ByteView code,
+                                      uint64_t base_addr, uint64_t begin_target,
+                                      uint64_t end_target) {
+    std::vector<CallSite> sites;
+    if (code.size() < CALL_REL32_SIZE)
+        return sites;
+
+    const uint8_t* const data = code.data();
+    const auto check = [&](size_t offset) {
+        int32_t rel;
+        std::memcpy(&rel, data + offset + 1, sizeof(rel));
+        const uint64_t target = base_addr + offset + CALL_REL32_SIZE +
+                                static_cast<uint64_t>(static_cast<int64_t>(rel));
+        if (target == begin_target || target == end_target)
+            sites.push_back({offset, target == begin_target});
+    };
+
+    // The offsets [0, end) may start a call
+    const size_t end = code.size() - CALL_REL32_SIZE + 1;
+    size_t offset = 0;
+#if defined(__SSE2__)
+    // Compare 16 bytes at a time, only the E8 ones are decoded
+    const __m128i opcode = _mm_set1_epi8(static_cast<char>(CALL_REL32_OPCODE));
+    for (; offset + 16 <= end; offset += 16) {
+        const __m128i block =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        auto mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, opcode)));
+        for (; mask != 0; mask &= mask - 1)
+            check(offset + static_cast<size_t>(__builtin_ctz(mask)));
+    }
+#endif
+    for (; offset < end; ++offset) {
+        if (data[offset] == CALL_REL32_OPCODE)
+            check(offset);
+    }
+    return sites;
+}
+
+// A capstone handle is not thread-safe, so every thread opens its own, one
+// per mode, closed when the thread exits. The handle comes with the single
+// cs_insn that cs_disasm_iter decodes every instruction into.
+class ThreadHandle {
+   public:
+    explicit ThreadHandle(Mode mode) {
+        const auto err =
+            cs_open(CS_ARCH_X86, static_cast<cs_mode>(mode), &handle_);
+        if (err != CS_ERR_OK)
+            throw std::runtime_error(std::string("cs_open failed: ") +
+                                     cs_strerror(err));
+        cs_option(handle_, CS_OPT_DETAIL, CS_OPT_ON);
+        insn_ = cs_malloc(handle_);
+        if (insn_ == nullptr) {
+            cs_close(&handle_);
+            throw std::runtime_error("cs_malloc failed");
+        }
+    }
+    ~ThreadHandle() {
+        cs_free(insn_, 1);
+        cs_close(&handle_);
+    }
+
+    ThreadHandle(const ThreadHandle&) = delete;
+    ThreadHandle& operator=(const ThreadHandle&) = delete;
+
+    csh get() const noexcept { return handle_; }
+    cs_insn* insn() const noexcept { return insn_; }
+
+   private:
+    csh handle_ = 0;
+    cs_insn* insn_ = nullptr;
+};
+
+ThreadHandle& thread_handle(Mode mode) {
+    thread_local std::map<Mode, std::unique_ptr<ThreadHandle>> handles;
+    auto& handle = handles[mode];
+    if (handle == nullptr)
+        handle = std::make_unique<ThreadHandle>(mode);
+    return *handle;
+}
+
+uint8_t to_groups(const cs_detail& detail) noexcept {
+    using VMPilot::SDK::NativeInstructions;
+    uint8_t groups = 0;
+    for (uint8_t i = 0; i < detail.groups_count; ++i) {
+        switch (detail.groups[i]) {
+            case CS_GRP_JUMP:
+                groups |= NativeInstructions::JUMP;
+                break;
+            case CS_GRP_CALL:
+                groups |= NativeInstructions::CALL;
+                break;
+            case CS_GRP_RET:
+                groups |= NativeInstructions::RET;
+                break;
+            case CS_GRP_INT:
+                groups |= NativeInstructions::INTERRUPT;
+                break;
+            case CS_GRP_BRANCH_RELATIVE:
+                groups |= NativeInstructions::RELATIVE;
+                break;
+            default:
+                break;
+        }
+    }
+    return groups;
+}
+
+VMPilot::SDK::NativeOperand to_operand(const cs_x86_op& op) noexcept {
+    using VMPilot::SDK::OperandKind;
+    VMPilot::SDK::NativeOperand operand;
+    operand.size = op.size;
+    operand.access = op.access & (VMPilot::SDK::NativeOperand::READ |
+                                  VMPilot::SDK::NativeOperand::WRITE);
+    switch (op.type) {
+        case X86_OP_REG:
+            operand.kind = static_cast<uint8_t>(OperandKind::Register);
+            operand.reg = static_cast<uint16_t>(op.reg);
+            break;
+        case X86_OP_IMM:
+            operand.kind = static_cast<uint8_t>(OperandKind::Immediate);
+            operand.value = op.imm;
+            break;
+        case X86_OP_MEM:
+            operand.kind = static_cast<uint8_t>(OperandKind::Memory);
+            operand.reg = static_cast<uint16_t>(op.mem.base);
+            operand.index = static_cast<uint16_t>(op.mem.index);
+            operand.segment = static_cast<uint16_t>(op.mem.segment);
+            operand.scale = static_cast<uint8_t>(op.mem.scale);
+            operand.value = op.mem.disp;
+            break;
+        default:
+            break;
+    }
+    return operand;
+}
+
+// The name of a function without a symbol
+std::string sub_name(uint64_t addr) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "sub_%llx",
+                  static_cast<unsigned long long>(addr));
+    return name;
+}
+
+/**
+ * Find the functions of [begin, end) by a linear sweep, for the code no
+ * symbol covers. A function ends at a ret or an unconditional jmp, the
+ * padding after it is skipped and the next instruction starts a function.
+ * The targets of the direct calls in the range start functions too.
+ *
+ * @return The start addresses of the functions, sorted.
+ */
+std::vector<uint64_t> sweep_function_starts(ThreadHandle& handle,
+                                            VMPilot::Common::ByteView code,
+                                            uint64_t base, uint64_t begin,
+                                            uint64_t end) {
+    const auto range = code.subview(begin - base, end - begin);
+    const uint8_t* data = range.data();
+    size_t size = range.size();
+    uint64_t address = begin;
+    cs_insn* const insn = handle.insn();
+
+    std::vector<uint64_t> starts;
+    bool at_start = true;
+    while (size > 0) {
+        if (!cs_disasm_iter(handle.get(), &data, &size, &address, insn)) {
+            // Data in the code, skip a byte
+            ++data;
+            --size;
+            ++address;
+            continue;
+        }
+
+        if (at_start) {
+            if (insn->id == X86_INS_NOP || insn->id == X86_INS_INT3)
+                continue;
+            starts.push_back(insn->address);
+            at_start = false;
+        }
+
+        const auto& x86 = insn->detail->x86;
+        if (insn->id == X86_INS_RET || insn->id == X86_INS_JMP) {
+            at_start = true;
+        } else if (insn->id == X86_INS_CALL && x86.op_count == 1 &&
+                   x86.operands[0].type == X86_OP_IMM) {
+            const auto target = static_cast<uint64_t>(x86.operands[0].imm);
+            if (target >= begin && target < end)
+                starts.push_back(target);
+        }
+    }
+
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+    return starts;
+}
+}  // namespace detail
+}  // namespace
+
 struct X86Handler::Impl {
-    Capstone::Capstone cs;
+    Mode mode;
+    VMPilot::Common::ByteView code;
     uint64_t base_addr = -1;
-    std::vector<Capstone::Instruction> instructions;
-    std::vector<std::unique_ptr<NativeFunctionBase>> native_functions;
+    // The names of the native functions
+    StringPool names;
 
-    Impl(Capstone::Capstone&& cs) : cs(std::move(cs)) {}
+    explicit Impl(Mode mode) : mode(mode) {}
 };
 
 X86Handler::X86Handler(Mode mode)
@@ -21,35 +248,178 @@ X86Handler::X86Handler(Mode mode)
 
 std::unique_ptr<X86Handler::Impl>
 VMPilot::SDK::Segmentator ::make_x86_handler_impl(Mode mode) {
-    return std::make_unique<X86Handler::Impl>(Capstone::Capstone(
-        Capstone::Arch::X86, static_cast<Capstone::Mode>(mode)));
+    return std::make_unique<X86Handler::Impl>(mode);
 }
 
 X86Handler::~X86Handler() = default;
 
-bool X86Handler::doLoad(const std::vector<uint8_t>& code,
+bool X86Handler::doLoad(VMPilot::Common::ByteView code,
                         const uint64_t base_addr) noexcept {
     auto& impl = this->pImpl;
 
+    // Nothing is disassembled here, only the protected regions are, by
+    // doDisassembleRegion
+    impl->code = code;
     impl->base_addr = base_addr;
-    impl->instructions = impl->cs.disasm(code);
-    return !impl->instructions.empty();
-}
-
-std::vector<std::unique_ptr<NativeFunctionBase>>
-X86Handler::doGetNativeFunctions() noexcept {
-    auto& native_functions = this->pImpl->native_functions;
-    if (native_functions.empty()) {
-        // TODO: Implement this function
-    }
-
-    // copy to avoid move
-    std::vector<std::unique_ptr<NativeFunctionBase>> result;
-    std::for_each(
-        native_functions.begin(), native_functions.end(),
-        [&result](const auto& nf) {
-            result.push_back(std::make_unique<NativeFunctionBase>(
-                nf->getAddr(), nf->getSize(), nf->getName(), nf->getCode()));
-        });
-    return result;
+    return !code.empty();
+}
+
+std::vector<VMPilot::SDK::ProtectedRegion> X86Handler::doFindRegions(
+    const uint64_t begin_target, const uint64_t end_target) noexcept {
+    auto& impl = this->pImpl;
+    std::vector<VMPilot::SDK::ProtectedRegion> regions;
+
+    try {
+        const auto sites = detail::find_call_sites(
+            impl->code, impl->base_addr, begin_target, end_target);
+
+        // Pair every VMPilot_Begin with the next VMPilot_End
+        const detail::CallSite* open = nullptr;
+        for (const auto& site : sites) {
+            if (site.is_begin) {
+                if (open != nullptr)
+                    spdlog::warn("VMPilot_Begin at {:#x} has no VMPilot_End",
+                                 impl->base_addr + open->offset);
+                open = &site;
+                continue;
+            }
+            if (open == nullptr) {
+                spdlog::warn("VMPilot_End at {:#x} has no VMPilot_Begin",
+                             impl->base_addr + site.offset);
+                continue;
+            }
+
+            const size_t begin = open->offset + detail::CALL_REL32_SIZE;
+            VMPilot::SDK::ProtectedRegion region;
+            region.index = regions.size();
+            region.begin_addr = impl->base_addr + begin;
+            region.end_addr = impl->base_addr + site.offset;
+            region.code = impl->code.subview(begin, site.offset - begin);
+            regions.push_back(region);
+            open = nullptr;
+        }
+        if (open != nullptr)
+            spdlog::warn("VMPilot_Begin at {:#x} has no VMPilot_End",
+                         impl->base_addr + open->offset);
+    } catch (const std::exception& e) {
+        spdlog::error("X86Handler::doFindRegions failed: {}", e.what());
+        regions.clear();
+    }
+    return regions;
+}
+
+bool X86Handler::doDisassembleRegion(
+    const VMPilot::SDK::ProtectedRegion& region,
+    VMPilot::SDK::NativeInstructions& instructions) noexcept {
+    auto& impl = this->pImpl;
+    instructions.Clear();
+
+    try {
+        // From the VMPilot_Begin call to the VMPilot_End call included, the
+        // rest of the .text section is never disassembled
+        const uint64_t begin_call = region.begin_addr - detail::CALL_REL32_SIZE;
+        const auto code = impl->code.subview(
+            begin_call - impl->base_addr,
+            region.end_addr + detail::CALL_REL32_SIZE - begin_call);
+
+        auto& handle = detail::thread_handle(impl->mode);
+        cs_insn* const insn = handle.insn();
+        const uint8_t* data = code.data();
+        size_t size = code.size();
+        uint64_t address = begin_call;
+
+        // The sweep from the VMPilot_Begin call must land on the VMPilot_End
+        // call, else one of them was only bytes looking like a call
+        const auto misaligned = [&] {
+            spdlog::error(
+                "The calls around the region at {:#x} are not on instruction "
+                "boundaries",
+                region.begin_addr);
+            instructions.Clear();
+            return false;
+        };
+        if (!cs_disasm_iter(handle.get(), &data, &size, &address, insn) ||
+            insn->size != detail::CALL_REL32_SIZE)
+            return misaligned();
+
+        // A rough guess of 4 bytes and 2 operands per instruction
+        instructions.Reserve(region.code.size() / 4,
+                             region.code.size() / 2);
+        while (cs_disasm_iter(handle.get(), &data, &size, &address, insn)) {
+            if (insn->address >= region.end_addr) {
+                if (insn->address != region.end_addr ||
+                    insn->size != detail::CALL_REL32_SIZE)
+                    return misaligned();
+                return true;
+            }
+
+            const auto& x86 = insn->detail->x86;
+            std::array<VMPilot::SDK::NativeOperand, 8> operands;
+            const size_t count = std::min<size_t>(x86.op_count,
+                                                  operands.size());
+            for (size_t i = 0; i < count; ++i)
+                operands[i] = detail::to_operand(x86.operands[i]);
+
+            instructions.Append(insn->address,
+                                static_cast<uint8_t>(insn->size),
+                                static_cast<uint16_t>(insn->id),
+                                detail::to_groups(*insn->detail),
+                                operands.data(), count);
+        }
+        // Stopped on an invalid instruction before the VMPilot_End call
+        return misaligned();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to disassemble the region at {:#x}: {}",
+                      region.begin_addr, e.what());
+        instructions.Clear();
+        return false;
+    }
+}
+
+std::vector<NativeFunctionBase> X86Handler::doGetNativeFunctions(
+    const NativeSymbolTable& symbols) noexcept {
+    const auto& impl = this->pImpl;
+    std::vector<NativeFunctionBase> functions;
+    if (impl->code.empty())
+        return functions;
+
+    try {
+        const uint64_t base = impl->base_addr;
+        const uint64_t end = base + impl->code.size();
+        const auto add = [&](uint64_t addr, uint64_t size,
+                             std::string_view name) {
+            functions.emplace_back(addr, size, impl->names,
+                                   impl->names.Intern(name),
+                                   impl->code.subview(addr - base, size));
+        };
+
+        // The code no symbol covers is swept, the rest is never decoded
+        auto& handle = detail::thread_handle(impl->mode);
+        const auto add_swept = [&](uint64_t gap_begin, uint64_t gap_end) {
+            const auto starts =
+                detail::sweep_function_starts(handle, impl->code, base,
+                                              gap_begin, gap_end);
+            for (size_t i = 0; i < starts.size(); ++i) {
+                const uint64_t next =
+                    i + 1 < starts.size() ? starts[i + 1] : gap_end;
+                add(starts[i], next - starts[i], detail::sub_name(starts[i]));
+            }
+        };
+
+        uint64_t covered = base;
+        for (const auto& function : GetFunctionSymbols(symbols, base, end)) {
+            if (function.address < covered)
+                continue;  // Nested in the previous one
+            if (function.address > covered)
+                add_swept(covered, function.address);
+            add(function.address, function.size, symbols[function.entry].name);
+            covered = function.address + function.size;
+        }
+        if (covered < end)
+            add_swept(covered, end);
+    } catch (const std::exception& e) {
+        spdlog::error("X86Handler::doGetNativeFunctions failed: {}", e.what());
+        functions.clear();
+    }
+    return functions;
 }
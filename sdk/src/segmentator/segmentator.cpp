@@ -6,27 +6,32 @@
 #include <X86Handler.hpp>
 #include <file_type_parser.hpp>
 
+#include <utility>
+
 #include <spdlog/spdlog.h>
 
 using namespace VMPilot::SDK::Segmentator;
 
 namespace {
 namespace detail {
+// The handlers get the metadata, to reuse the mapping it was parsed from
 static const std::unordered_map<
     VMPilot::Common::FileFormat,
-    std::function<std::unique_ptr<FileHandlerStrategy>(const std::string&)>>
+    std::function<std::unique_ptr<FileHandlerStrategy>(
+        const VMPilot::Common::FileMetadata&)>>
     file_strategy_table = {
         {VMPilot::Common::FileFormat::ELF,
-         [](const std::string& filename) {
-             return std::make_unique<ELFFileHandlerStrategy>(filename);
+         [](const VMPilot::Common::FileMetadata& metadata) {
+             return std::make_unique<ELFFileHandlerStrategy>(metadata.file);
          }},
         {VMPilot::Common::FileFormat::PE,
-         [](const std::string& filename) {
-             return std::make_unique<PEFileHandlerStrategy>(filename);
+         [](const VMPilot::Common::FileMetadata& metadata) {
+             return std::make_unique<PEFileHandlerStrategy>(metadata.file);
          }},
         {VMPilot::Common::FileFormat::MachO,
-         [](const std::string& filename) {
-             return std::make_unique<MachOFileHandlerStrategy>(filename);
+         [](const VMPilot::Common::FileMetadata& metadata) {
+             return std::make_unique<MachOFileHandlerStrategy>(
+                 metadata.file);
          }},
 };
 
@@ -47,18 +52,28 @@ static const std::unordered_map<
 
 std::unique_ptr<Segmentator> VMPilot::SDK::Segmentator::create_segmentator(
     const std::string& filename) noexcept {
-    auto segmentator = std::unique_ptr<Segmentator>(nullptr);
-
     try {
-        segmentator->m_metadata = VMPilot::Common::get_file_metadata(filename);
+        return create_segmentator(VMPilot::Common::get_file_metadata(filename));
     } catch (const std::exception& e) {
         spdlog::error("Error creating segmentator: {}", e.what());
+        return nullptr;
     }
+}
+
+std::unique_ptr<Segmentator> VMPilot::SDK::Segmentator::create_segmentator(
+    VMPilot::Common::FileMetadata metadata) noexcept {
+    // The constructor is private, so std::make_unique cannot be used
+    auto segmentator = std::unique_ptr<Segmentator>(new Segmentator());
+    segmentator->m_metadata = std::move(metadata);
 
     const auto& format = segmentator->m_metadata.format;
     auto it = detail::file_strategy_table.find(format);
     if (it != detail::file_strategy_table.end()) {
-        segmentator->m_file_handler = it->second(filename);
+        try {
+            segmentator->m_file_handler = it->second(segmentator->m_metadata);
+        } catch (const std::exception& e) {
+            spdlog::error("Error creating file handler: {}", e.what());
+        }
     } else {
         spdlog::error("Unsupported file format: {}",
                       static_cast<uint8_t>(format));
@@ -67,7 +82,12 @@ std::unique_ptr<Segmentator> VMPilot::SDK::Segmentator::create_segmentator(
     const auto& arch = segmentator->m_metadata.arch;
     auto it2 = detail::arch_strategy_table.find(arch);
     if (it2 != detail::arch_strategy_table.end()) {
-        segmentator->m_arch_handler = it2->second(segmentator->m_metadata.mode);
+        try {
+            segmentator->m_arch_handler =
+                it2->second(segmentator->m_metadata.mode);
+        } catch (const std::exception& e) {
+            spdlog::error("Error creating arch handler: {}", e.what());
+        }
     } else {
         spdlog::error("Unsupported architecture: {}",
                       static_cast<uint8_t>(arch));
@@ -76,41 +96,64 @@ std::unique_ptr<Segmentator> VMPilot::SDK::Segmentator::create_segmentator(
     return segmentator;
 }
 
-void VMPilot::SDK::Segmentator::Segmentator::segmentation() noexcept {
+bool VMPilot::SDK::Segmentator::Segmentator::segmentation() noexcept {
     if (m_file_handler == nullptr || m_arch_handler == nullptr) {
         spdlog::error("Segmentation failed: file_handler: {}, arch_handler: {}",
                       m_file_handler == nullptr, m_arch_handler == nullptr);
-        return;
+        return false;
     }
 
     const auto& [begin_addr, end_addr] = m_file_handler->getBeginEndAddr();
-    const auto text_section = m_file_handler->getTextSection();
+    // A view into the mapped file, the .text section is never copied
+    const auto text_section = m_file_handler->getTextSectionView();
     const auto text_base_addr = m_file_handler->getTextBaseAddr();
-    const auto native_symbol_table = m_file_handler->getNativeSymbolTable();
 
     if (begin_addr == static_cast<uint64_t>(-1) ||
         end_addr == static_cast<uint64_t>(-1) ||
-        text_base_addr == static_cast<uint64_t>(-1) || text_section.empty() ||
-        native_symbol_table.empty()) {
+        text_base_addr == static_cast<uint64_t>(-1) || text_section.empty()) {
         spdlog::error(
             "Segmentation failed: begin_addr: {}, end_addr: {}, "
-            "text_base_addr: {}, text_section size: {}, native_symbol_table "
-            "size: {}",
-            begin_addr, end_addr, text_base_addr, text_section.empty(),
-            native_symbol_table.empty());
-        return;
+            "text_base_addr: {}, text_section size: {}",
+            begin_addr, end_addr, text_base_addr, text_section.size());
+        return false;
     }
 
     if (!m_arch_handler->Load(text_section, text_base_addr)) {
         spdlog::error("Segmentation failed: load failed");
-        return;
+        return false;
     }
 
-    const auto native_functions = m_arch_handler->getNativeFunctions();
-    if (native_functions.empty()) {
-        spdlog::error("Segmentation failed: native_functions empty");
-        return;
+    m_regions = m_arch_handler->FindRegions(begin_addr, end_addr);
+    if (m_regions.empty()) {
+        spdlog::error("Segmentation failed: no protected region");
+        return false;
     }
 
-    spdlog::info("Segmentation succeeded");
+    // The enclosing functions, each one found by a binary search
+    const auto symbols = m_file_handler->getNativeSymbolTable();
+    const auto functions =
+        GetFunctionSymbols(symbols, text_base_addr,
+                           text_base_addr + text_section.size());
+    // Without a function symbol (e.g. a stripped binary) the bounds stay 0:
+    // the arch handler's getNativeFunctions would find the function, but it
+    // decodes the whole .text section, which segmentation never does
+    for (auto& region : m_regions) {
+        const auto function = FindFunctionSymbol(functions, region.begin_addr);
+        if (function != nullptr) {
+            region.function_addr = function->address;
+            region.function_size = function->size;
+        }
+    }
+
+    spdlog::info("Segmentation succeeded: {} protected regions",
+                 m_regions.size());
+    return true;
+}
+
+bool VMPilot::SDK::Segmentator::Segmentator::disassembleRegion(
+    const VMPilot::SDK::ProtectedRegion& region,
+    VMPilot::SDK::NativeInstructions& instructions) noexcept {
+    if (m_arch_handler == nullptr)
+        return false;
+    return m_arch_handler->DisassembleRegion(region, instructions);
 }
@@ -0,0 +1,145 @@
+#include "check.hpp"
+
+#include <block_cache.hpp>
+#include <bytecode_encoder.hpp>
+#include <decoder.hpp>
+#include <instruction_t.hpp>
+#include <opcode_enum.hpp>
+#include <vm.hpp>
+#include <vm_operand.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using VMPilot::Common::ENCODED_INSTRUCTION_SIZE;
+using VMPilot::Common::Instruction_t;
+using VMPilot::Runtime::BlockCache;
+using VMPilot::Runtime::Decoder;
+using VMPilot::Runtime::VM;
+using VMPilot::SDK::BytecodeCompiler::BytecodeEncoder;
+namespace Operand = VMPilot::Common::Operand;
+using namespace VMPilot::Common::Opcode::Enum;
+
+namespace {
+const std::string KEY = "block cache test key";
+constexpr uint64_t REGION = 0x140001000;
+
+// The byte offsets of the blocks of the region below
+constexpr size_t ENTRY = 0;
+constexpr size_t LOOP = 3 * ENCODED_INSTRUCTION_SIZE;
+constexpr size_t EXIT = 6 * ENCODED_INSTRUCTION_SIZE;
+
+template <typename Opcode>
+Instruction_t inst(Opcode opcode, uint64_t left, uint64_t right = 0) {
+    Instruction_t result{};
+    result.opcode = static_cast<uint16_t>(opcode);
+    result.left_operand = left;
+    result.right_operand = right;
+    return result;
+}
+
+// Three blocks: the entry jumps over a dead instruction to a loop counting
+// R0 up to 3, then the exit returns
+std::vector<uint8_t> encode_region() {
+    std::vector<Instruction_t> insts = {
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(0)),
+        inst(ControlTransfer::JMP, Operand::Immediate(3)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0),
+             Operand::Immediate(100)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0), Operand::Immediate(1)),
+        inst(ArithmeticLogic::CMP, Operand::Register(0), Operand::Immediate(3)),
+        inst(ControlTransfer::JNZ, Operand::Immediate(3)),
+        inst(ControlTransfer::RET, 0),
+    };
+    return BytecodeEncoder(KEY).Encode(insts, REGION);
+}
+
+Decoder& decoder() {
+    auto& decoder = Decoder::GetInstance();
+    decoder.Init(KEY);
+    return decoder;
+}
+
+// A block is decoded once, the next runs reach it through the cache. The
+// loop branches inside its own block, so it is looked up once per run.
+void test_hits_and_misses() {
+    const auto region = encode_region();
+    BlockCache cache(decoder(), region, REGION);
+
+    VM first;
+    CHECK(cache.Run(first) == 3);
+    CHECK(cache.Size() == 3);
+    CHECK(cache.GetStats().misses == 3);
+    CHECK(cache.GetStats().hits == 0);
+
+    VM second;
+    CHECK(cache.Run(second) == 3);
+    CHECK(cache.GetStats().misses == 3);
+    CHECK(cache.GetStats().hits == 3);
+    CHECK(cache.GetStats().evictions == 0);
+}
+
+// Over the cap the least recently used block goes first
+void test_lru_eviction() {
+    const auto region = encode_region();
+
+    // The memory of the three blocks
+    BlockCache all(decoder(), region, REGION);
+    all.Get(ENTRY);
+    all.Get(LOOP);
+    all.Get(EXIT);
+    BlockCache::Options options;
+    options.memory_cap = all.MemoryUsage() - 1;
+
+    BlockCache cache(decoder(), region, REGION, options);
+    cache.Get(ENTRY);
+    cache.Get(LOOP);
+    cache.Get(ENTRY);
+    cache.Get(EXIT);
+    CHECK(cache.Size() == 2);
+    CHECK(cache.GetStats().evictions == 1);
+    CHECK(cache.MemoryUsage() <= options.memory_cap);
+
+    cache.Get(ENTRY);
+    CHECK(cache.GetStats().hits == 2);
+    cache.Get(LOOP);
+    CHECK(cache.GetStats().misses == 4);
+
+    // The most recently used block is kept even over the cap
+    options.memory_cap = 0;
+    BlockCache tiny(decoder(), region, REGION, options);
+    VM vm;
+    CHECK(tiny.Run(vm) == 3);
+    CHECK(tiny.Size() == 1);
+}
+
+// The region address is in the cipher counter, the bytecode of a region
+// does not decode at another address
+void test_wrong_region_address() {
+    const auto region = encode_region();
+    BlockCache cache(decoder(), region, REGION + ENCODED_INSTRUCTION_SIZE);
+    VM vm;
+    CHECK_THROWS(std::runtime_error, cache.Run(vm));
+    CHECK(cache.Size() == 0);
+}
+
+// An entry inside an instruction is not rounded down to it
+void test_misaligned_entry_is_rejected() {
+    const auto region = encode_region();
+    BlockCache cache(decoder(), region, REGION);
+    VM vm;
+    CHECK_THROWS(std::runtime_error, cache.Run(vm, LOOP + 1));
+    CHECK_THROWS(std::runtime_error, cache.Get(LOOP + 1));
+    CHECK(cache.GetStats().misses == 1);
+}
+}  // namespace
+
+int main() {
+    test_hits_and_misses();
+    test_lru_eviction();
+    test_wrong_region_address();
+    test_misaligned_entry_is_rejected();
+    return TEST_RESULT();
+}
@@ -0,0 +1,43 @@
+#ifndef __TESTS_CHECK_HPP__
+#define __TESTS_CHECK_HPP__
+
+// The assertions of the unit tests. Each test is an executable that runs all
+// its checks and exits with TEST_RESULT(), so CTest fails it if any failed.
+
+#include <cstdio>
+
+namespace VMPilot::Tests {
+inline int& failures() noexcept {
+    static int count = 0;
+    return count;
+}
+}  // namespace VMPilot::Tests
+
+#define CHECK(condition)                                                \
+    do {                                                                \
+        if (!(condition)) {                                             \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, \
+                         __LINE__, #condition);                         \
+            ++VMPilot::Tests::failures();                               \
+        }                                                               \
+    } while (0)
+
+// Check that the statement throws an exception of the type
+#define CHECK_THROWS(type, statement)                                   \
+    do {                                                                \
+        bool thrown = false;                                            \
+        try {                                                           \
+            statement;                                                  \
+        } catch (const type&) {                                         \
+            thrown = true;                                              \
+        }                                                               \
+        if (!thrown) {                                                  \
+            std::fprintf(stderr, "%s:%d: %s did not throw %s\n",        \
+                         __FILE__, __LINE__, #statement, #type);        \
+            ++VMPilot::Tests::failures();                               \
+        }                                                               \
+    } while (0)
+
+#define TEST_RESULT() (VMPilot::Tests::failures() == 0 ? 0 : 1)
+
+#endif  // __TESTS_CHECK_HPP__
@@ -0,0 +1,127 @@
+#include "check.hpp"
+
+#include <ELFImage.hpp>
+#include <ELFRewriter.hpp>
+#include <mapped_file.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using VMPilot::Common::MappedFile;
+using VMPilot::SDK::Rewriter::ELFRewriter;
+using VMPilot::SDK::Segmentator::ELFImage;
+using VMPilot::SDK::Segmentator::ELFSegment;
+
+namespace {
+constexpr uint64_t PAGE_SIZE = 0x1000;
+
+// A path in the temporary directory, removed with the test
+class TempPath {
+   public:
+    TempPath() {
+        std::random_device device;
+        path_ = (std::filesystem::temp_directory_path() /
+                 ("vmpilot_elf_rewriter_test_" + std::to_string(device())))
+                    .string();
+    }
+    ~TempPath() {
+        std::error_code error;
+        std::filesystem::remove(path_, error);
+    }
+    const std::string& path() const noexcept { return path_; }
+
+   private:
+    std::string path_;
+};
+
+size_t count(const ELFImage& image, uint32_t type) {
+    size_t n = 0;
+    for (const auto& segment : image.getSegments())
+        n += segment.type == type;
+    return n;
+}
+
+// The rewritten sample loads the new section with a new PT_LOAD, names it
+// in the section header table, and keeps the rest of the file
+void test_rewrite_x86_64() {
+    const auto input = std::make_shared<const MappedFile>(
+        VMPILOT_DATA_DIR "/basic/bin/basic_binary.Linux.x86_64");
+    const ELFImage before(input->view());
+    const auto* text = before.findSection(".text");
+    CHECK(text != nullptr);
+    if (text == nullptr)
+        return;
+
+    ELFRewriter rewriter(input);
+    const std::vector<uint8_t> patch = {0x90, 0x90, 0x90, 0x90};
+    rewriter.Patch(text->getAddress(), patch);
+    std::vector<uint8_t> bytecode(3000);
+    for (size_t i = 0; i < bytecode.size(); ++i)
+        bytecode[i] = static_cast<uint8_t>(i * 7);
+    rewriter.SetSection(".vmpilot", bytecode);
+
+    TempPath output;
+    rewriter.Write(output.path());
+    const MappedFile written(output.path());
+    const ELFImage after(written.view());
+
+    // The PT_NOTE entry became the new PT_LOAD, the file is only padded to
+    // a page before it
+    CHECK(after.getSegments().size() == before.getSegments().size());
+    CHECK(count(after, ELFSegment::PT_NOTE) ==
+          count(before, ELFSegment::PT_NOTE) - 1);
+    CHECK(count(after, ELFSegment::PT_LOAD) ==
+          count(before, ELFSegment::PT_LOAD) + 1);
+    const ELFSegment* load = nullptr;
+    uint64_t previous = 0;
+    for (const auto& segment : after.getSegments()) {
+        if (segment.type != ELFSegment::PT_LOAD)
+            continue;
+        CHECK(segment.vaddr >= previous);
+        previous = segment.vaddr + segment.memsz;
+        load = &segment;
+    }
+    CHECK(load != nullptr);
+    if (load == nullptr)
+        return;
+    CHECK(load->vaddr == rewriter.GetSectionAddress());
+    CHECK(load->flags == ELFSegment::PF_R);
+    CHECK(load->offset % PAGE_SIZE == 0);
+    CHECK(load->offset < input->size() + PAGE_SIZE);
+    CHECK(load->vaddr % load->align == load->offset % load->align);
+    CHECK(load->filesz == bytecode.size());
+    CHECK(load->memsz == bytecode.size());
+
+    // The new section and its content
+    const auto* section = after.findSection(".vmpilot");
+    CHECK(section != nullptr);
+    if (section == nullptr)
+        return;
+    CHECK(section->getAddress() == load->vaddr);
+    CHECK(section->getOffset() == load->offset);
+    CHECK(section->getSize() == bytecode.size());
+    CHECK(section->getOffset() + section->getSize() <= written.size());
+    CHECK(std::memcmp(written.data() + section->getOffset(), bytecode.data(),
+                      bytecode.size()) == 0);
+
+    // The patch, and the untouched bytes around it
+    const auto* new_text = after.findSection(".text");
+    CHECK(new_text != nullptr && new_text->getOffset() == text->getOffset());
+    const auto offset = text->getOffset();
+    CHECK(std::memcmp(written.data() + offset, patch.data(), patch.size()) ==
+          0);
+    CHECK(std::memcmp(written.data() + offset + patch.size(),
+                      input->data() + offset + patch.size(),
+                      text->getSize() - patch.size()) == 0);
+}
+}  // namespace
+
+int main() {
+    test_rewrite_x86_64();
+    return TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+#include "check.hpp"
+
+#include <file_type_parser.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using VMPilot::Common::FileArch;
+using VMPilot::Common::FileFormat;
+using VMPilot::Common::FileMode;
+
+namespace {
+// A file of the test, removed at the end of the scope
+class TempFile {
+   public:
+    TempFile(const std::string& name, const std::vector<uint8_t>& bytes)
+        : path_((std::filesystem::temp_directory_path() / name).string()) {
+        std::ofstream out(path_, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+    }
+    ~TempFile() { std::remove(path_.c_str()); }
+    const std::string& path() const noexcept { return path_; }
+
+   private:
+    std::string path_;
+};
+
+void put_be32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i)
+        out[at + i] = static_cast<uint8_t>(value >> (8 * (3 - i)));
+}
+
+void put_le32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i)
+        out[at + i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+// A universal file of one x86-64 slice at 0x1000
+std::vector<uint8_t> fat_x86_64() {
+    std::vector<uint8_t> bytes(0x1000 + 32, 0);
+    put_be32(bytes, 0, 0xCAFEBABE);
+    put_be32(bytes, 4, 1);           // nfat_arch
+    put_be32(bytes, 8, 0x01000007);  // CPU_TYPE_X86_64
+    put_be32(bytes, 12, 3);          // CPU_SUBTYPE_X86_64_ALL
+    put_be32(bytes, 16, 0x1000);     // offset
+    put_be32(bytes, 20, 32);         // size
+    put_be32(bytes, 24, 12);         // align
+
+    put_le32(bytes, 0x1000, 0xFEEDFACF);  // MH_MAGIC_64
+    put_le32(bytes, 0x1004, 0x01000007);
+    put_le32(bytes, 0x1008, 3);
+    put_le32(bytes, 0x100C, 2);  // MH_EXECUTE
+    return bytes;
+}
+
+void test_fat_header() {
+    const TempFile file("vmpilot_fat_x86_64", fat_x86_64());
+    const auto metadata = VMPilot::Common::get_file_metadata(file.path());
+    CHECK(metadata.format == FileFormat::MachO);
+    CHECK(metadata.arch == FileArch::X86);
+    CHECK(metadata.mode == FileMode::MODE_64);
+}
+
+// A Java class file shares the magic of a fat header, its minor and major
+// version are read as the slice count. The constant pool of this one looks
+// like a slice at 0x20 holding an x86-64 header.
+void test_java_class_is_not_macho() {
+    std::vector<uint8_t> bytes(64, 0);
+    put_be32(bytes, 0, 0xCAFEBABE);
+    put_be32(bytes, 4, 52);  // Java 8, minor 0 major 52
+    put_be32(bytes, 8, 0x01000007);
+    put_be32(bytes, 16, 0x20);
+    put_le32(bytes, 0x20, 0xFEEDFACF);
+    put_le32(bytes, 0x24, 0x01000007);
+    put_le32(bytes, 0x28, 3);
+    put_le32(bytes, 0x2C, 2);
+    const TempFile file("vmpilot_java.class", bytes);
+    CHECK_THROWS(std::runtime_error,
+                 VMPilot::Common::get_file_metadata(file.path()));
+
+    // Java 1.1, the smallest major version
+    put_be32(bytes, 4, 45);
+    const TempFile old_file("vmpilot_java_1_1.class", bytes);
+    CHECK_THROWS(std::runtime_error,
+                 VMPilot::Common::get_file_metadata(old_file.path()));
+}
+
+// The first slice must start after the fat_arch table
+void test_fat_slice_inside_the_table() {
+    auto bytes = fat_x86_64();
+    put_be32(bytes, 16, 8);
+    const TempFile file("vmpilot_fat_overlap", bytes);
+    CHECK_THROWS(std::runtime_error,
+                 VMPilot::Common::get_file_metadata(file.path()));
+}
+}  // namespace
+
+int main() {
+    test_fat_header();
+    test_java_class_is_not_macho();
+    test_fat_slice_inside_the_table();
+    return TEST_RESULT();
+}
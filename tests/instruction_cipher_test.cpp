@@ -0,0 +1,158 @@
+#include "check.hpp"
+
+#include <instruction_cipher.hpp>
+#include <instruction_cipher_kernels.hpp>
+#include <instruction_t.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+using VMPilot::Common::Instruction_t;
+using VMPilot::Common::InstructionCipher;
+using Implementation = InstructionCipher::Implementation;
+
+namespace {
+// The key of FIPS-197 C.3: 00 01 02 ... 1f
+std::string fips_key() {
+    std::string key(32, '\0');
+    for (size_t i = 0; i < key.size(); ++i)
+        key[i] = static_cast<char>(i);
+    return key;
+}
+
+void test_fips197_c3() {
+    const auto key = fips_key();
+    const uint8_t plaintext[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+                                   0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb,
+                                   0xcc, 0xdd, 0xee, 0xff};
+    const uint8_t expected[16] = {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67,
+                                  0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90,
+                                  0x4b, 0x49, 0x60, 0x89};
+
+    uint8_t round_keys[InstructionCipher::ROUND_KEYS_SIZE];
+    VMPilot::Common::detail::ExpandKey(
+        reinterpret_cast<const uint8_t*>(key.data()), round_keys);
+    uint8_t out[16];
+    VMPilot::Common::detail::EncryptBlockPortable(round_keys, plaintext, out);
+    CHECK(::memcmp(out, expected, sizeof(out)) == 0);
+}
+
+// SP 800-38A F.1.5, ECB-AES256, so every S-box input is well covered
+void test_sp800_38a_ecb() {
+    const uint8_t key[32] = {0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+                             0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+                             0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+                             0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4};
+    const uint8_t plaintext[4][16] = {
+        {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e,
+         0x11, 0x73, 0x93, 0x17, 0x2a},
+        {0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f,
+         0xac, 0x45, 0xaf, 0x8e, 0x51},
+        {0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1,
+         0x19, 0x1a, 0x0a, 0x52, 0xef},
+        {0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41,
+         0x7b, 0xe6, 0x6c, 0x37, 0x10},
+    };
+    const uint8_t expected[4][16] = {
+        {0xf3, 0xee, 0xd1, 0xbd, 0xb5, 0xd2, 0xa0, 0x3c, 0x06, 0x4b, 0x5a,
+         0x7e, 0x3d, 0xb1, 0x81, 0xf8},
+        {0x59, 0x1c, 0xcb, 0x10, 0xd4, 0x10, 0xed, 0x26, 0xdc, 0x5b, 0xa7,
+         0x4a, 0x31, 0x36, 0x28, 0x70},
+        {0xb6, 0xed, 0x21, 0xb9, 0x9c, 0xa6, 0xf4, 0xf9, 0xf1, 0x53, 0xe7,
+         0xb1, 0xbe, 0xaf, 0xed, 0x1d},
+        {0x23, 0x30, 0x4b, 0x7a, 0x39, 0xf9, 0xf3, 0xff, 0x06, 0x7d, 0x8d,
+         0x8f, 0x9e, 0x24, 0xec, 0xc7},
+    };
+
+    uint8_t round_keys[InstructionCipher::ROUND_KEYS_SIZE];
+    VMPilot::Common::detail::ExpandKey(key, round_keys);
+    for (size_t i = 0; i < 4; ++i) {
+        uint8_t out[16];
+        VMPilot::Common::detail::EncryptBlockPortable(round_keys,
+                                                      plaintext[i], out);
+        CHECK(::memcmp(out, expected[i], sizeof(out)) == 0);
+    }
+}
+
+// The keystream of an all-zero instruction is AES-256 of its counter blocks,
+// the expected values are from an independent AES implementation. Every
+// kernel the CPU supports must produce them.
+void test_ctr_known_answer(Implementation impl) {
+    const InstructionCipher cipher(fips_key(), impl);
+
+    // The counter blocks are region 00 ... 07 | index 08 ... 0b | block
+    // number. The nounce is not in them.
+    Instruction_t insts[10] = {};
+    for (auto& inst : insts)
+        inst.nounce = 0xdeadbeef;
+    constexpr uint64_t REGION = 0x0706050403020100;
+    constexpr uint64_t INDEX = 0x0b0a0908;
+    // A batch larger than one iteration of every x86 kernel, the instruction
+    // at index INDEX is the third one
+    cipher.Encrypt(insts, 10, REGION, INDEX - 2);
+
+    const auto& inst = insts[2];
+    CHECK(inst.opcode == 0xdcbd);
+    CHECK(inst.left_operand == 0xfec1cc6650b1ca4cull);
+    CHECK(inst.right_operand == 0x89c8b63e13ba0c6bull);
+    // The nounce and the checksum are not encrypted
+    CHECK(inst.nounce == 0xdeadbeef);
+    CHECK(inst.checksum == 0);
+
+    cipher.Decrypt(insts, 10, REGION, INDEX - 2);
+    for (const auto& decrypted : insts)
+        CHECK(decrypted.opcode == 0 && decrypted.left_operand == 0 &&
+              decrypted.right_operand == 0);
+}
+
+// Every kernel decrypts what any other one encrypted
+void test_kernels_agree() {
+    const std::string key = "an instruction cipher test key";
+    const InstructionCipher portable(key, Implementation::Portable);
+    const InstructionCipher fastest(key);
+
+    Instruction_t insts[37];
+    for (size_t i = 0; i < 37; ++i) {
+        insts[i] = Instruction_t{};
+        insts[i].opcode = static_cast<uint16_t>(i);
+        insts[i].left_operand = i * 0x0123456789abcdefull;
+        insts[i].right_operand = ~i;
+        insts[i].nounce = static_cast<uint32_t>(i * 0x9e3779b9u);
+    }
+    Instruction_t copy[37];
+    ::memcpy(copy, insts, sizeof(insts));
+
+    portable.Encrypt(insts, 37, 0x140001000, 100);
+    fastest.Decrypt(insts, 37, 0x140001000, 100);
+    for (size_t i = 0; i < 37; ++i)
+        CHECK(insts[i].opcode == copy[i].opcode &&
+              insts[i].left_operand == copy[i].left_operand &&
+              insts[i].right_operand == copy[i].right_operand);
+}
+
+// Two regions whose addresses only differ in the high half get different
+// keystreams at every index, whatever their nounces
+void test_regions_do_not_share_counters() {
+    const InstructionCipher cipher(fips_key());
+
+    Instruction_t low[16] = {};
+    Instruction_t high[16] = {};
+    cipher.Encrypt(low, 16, 0x0000000140001000, 0);
+    cipher.Encrypt(high, 16, 0x0000000240001000, 0);
+    for (size_t i = 0; i < 16; ++i)
+        CHECK(low[i].left_operand != high[i].left_operand ||
+              low[i].right_operand != high[i].right_operand);
+}
+}  // namespace
+
+int main() {
+    test_fips197_c3();
+    test_sp800_38a_ecb();
+    test_ctr_known_answer(Implementation::Portable);
+    test_ctr_known_answer(Implementation::AESNI);
+    test_ctr_known_answer(Implementation::VAES);
+    test_kernels_agree();
+    test_regions_do_not_share_counters();
+    return TEST_RESULT();
+}
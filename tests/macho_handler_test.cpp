@@ -0,0 +1,40 @@
+#include "check.hpp"
+
+#include <MachOHandler.hpp>
+#include <file_type_parser.hpp>
+
+#include <cstdint>
+#include <string>
+
+using VMPilot::Common::FileArch;
+using VMPilot::Common::FileMode;
+using VMPilot::SDK::Segmentator::MachOFileHandlerStrategy;
+
+namespace {
+// The signatures resolve to the C++ symbols of the VMPilot stubs, the
+// sample is linked against them rather than importing them
+void test_begin_end() {
+    const std::string path =
+        VMPILOT_DATA_DIR "/basic/bin/basic_binary.Darwin.arm64";
+
+    const auto metadata = VMPilot::Common::get_file_metadata(path);
+    CHECK(metadata.arch == FileArch::ARM64);
+    // Capstone has a single little-endian mode for AArch64
+    CHECK(metadata.mode == FileMode::MODE_ARM);
+
+    MachOFileHandlerStrategy handler(metadata.file);
+    const auto [begin, end] = handler.getBeginEndAddr();
+    // __Z13VMPilot_BeginPKc and __Z11VMPilot_EndPKc
+    CHECK(begin == 0x100003db4);
+    CHECK(end == 0x100003da8);
+    // __TEXT,__text
+    CHECK(handler.getTextBaseAddr() == 0x1000038a8);
+    CHECK(handler.getTextSection().size() == 0x4f4);
+    CHECK(handler.getTextSectionView().size() == 0x4f4);
+}
+}  // namespace
+
+int main() {
+    test_begin_end();
+    return TEST_RESULT();
+}
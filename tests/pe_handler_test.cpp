@@ -0,0 +1,48 @@
+#include "check.hpp"
+
+#include <PEHandler.hpp>
+#include <file_type_parser.hpp>
+
+#include <cstdint>
+#include <string>
+
+using VMPilot::Common::FileArch;
+using VMPilot::Common::FileMode;
+using VMPilot::SDK::Segmentator::PEFileHandlerStrategy;
+
+namespace {
+// The images of data/pe, see make_fixtures.py for their layout
+struct Fixture {
+    const char* name;
+    FileMode mode;
+    uint64_t image_base;
+};
+
+// The signatures resolve to their import thunks, the jmp [slot] the calls
+// of the region go to. The slot is RIP-relative on x64 and absolute on x86.
+void test_begin_end(const Fixture& fixture) {
+    const std::string path = std::string(VMPILOT_DATA_DIR "/pe/") + fixture.name;
+
+    const auto metadata = VMPilot::Common::get_file_metadata(path);
+    CHECK(metadata.arch == FileArch::X86);
+    CHECK(metadata.mode == fixture.mode);
+
+    PEFileHandlerStrategy handler(metadata.file);
+    const auto [begin, end] = handler.getBeginEndAddr();
+    CHECK(begin == fixture.image_base + 0x1040);
+    CHECK(end == fixture.image_base + 0x1046);
+    CHECK(handler.getTextBaseAddr() == fixture.image_base + 0x1000);
+    // The section is read up to its virtual size, so it ends with the thunks
+    const auto text = handler.getTextSection();
+    CHECK(text.size() == 0x4C);
+    CHECK(text.size() == 0x4C && text[0x40] == 0xFF && text[0x41] == 0x25 &&
+          text[0x46] == 0xFF && text[0x47] == 0x25);
+}
+}  // namespace
+
+int main() {
+    test_begin_end({"stubs.Windows.x86_64.exe", FileMode::MODE_64,
+                    0x140000000});
+    test_begin_end({"stubs.Windows.x86.exe", FileMode::MODE_32, 0x400000});
+    return TEST_RESULT();
+}
@@ -0,0 +1,182 @@
+#include "check.hpp"
+
+#include <BytecodeCompileRecipe.hpp>
+#include <ProtectedRegion.hpp>
+#include <RegionCache.hpp>
+#include <bytecode_compiler.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using VMPilot::SDK::BytecodeCompileRecipe;
+using VMPilot::SDK::NativeInstructions;
+using VMPilot::SDK::ProtectedRegion;
+using VMPilot::SDK::RegionCache;
+using VMPilot::SDK::BytecodeCompiler::CompilerBase;
+using VMPilot::SDK::BytecodeCompiler::FusionStats;
+
+namespace {
+// The cache only asks a compiler for its name and version
+class NullCompiler : public CompilerBase {
+   public:
+    explicit NullCompiler(uint32_t version = 1)
+        : CompilerBase("null"), version_(version) {}
+    uint32_t GetVersion() const noexcept override { return version_; }
+    std::vector<uint8_t> Compile(const BytecodeCompileRecipe&) override {
+        return {};
+    }
+    std::vector<uint8_t> CompileRegion(const BytecodeCompileRecipe&,
+                                       const ProtectedRegion&,
+                                       const NativeInstructions&,
+                                       FusionStats&) const override {
+        return {};
+    }
+
+   private:
+    uint32_t version_;
+};
+
+// A fresh cache directory, removed with its entries
+class TempDirectory {
+   public:
+    TempDirectory() {
+        std::random_device device;
+        path_ = std::filesystem::temp_directory_path() /
+                ("vmpilot_region_cache_test_" + std::to_string(device()));
+    }
+    ~TempDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+   private:
+    std::filesystem::path path_;
+};
+
+BytecodeCompileRecipe recipe(const std::string& master_key) {
+    return BytecodeCompileRecipe(nlohmann::json{
+        {"master_key", master_key},
+        {"input", "in.elf"},
+        {"output", "out.elf"},
+    });
+}
+
+const std::string MASTER_KEY = "0123456789abcdef0123456789abcdef";
+
+// add rax, 1
+const uint8_t CODE[] = {0x48, 0x83, 0xc0, 0x01};
+
+ProtectedRegion region() {
+    ProtectedRegion region;
+    region.begin_addr = 0x401000;
+    region.end_addr = 0x401004;
+    region.code = VMPilot::Common::ByteView(CODE, sizeof(CODE));
+    return region;
+}
+
+const std::vector<uint8_t> BYTECODE = {1, 2, 3, 4, 5, 6, 7, 8};
+
+// The only file of the cache directory, the entry stored last
+std::filesystem::path only_entry(const std::filesystem::path& directory) {
+    std::filesystem::path entry;
+    for (const auto& file :
+         std::filesystem::recursive_directory_iterator(directory)) {
+        if (file.is_regular_file())
+            entry = file.path();
+    }
+    return entry;
+}
+
+// A stored entry is loaded back under the same key
+void test_store_then_load() {
+    TempDirectory directory;
+    const RegionCache cache(directory.path());
+    const NullCompiler compiler;
+    const auto context =
+        RegionCache::MakeContext(compiler, recipe(MASTER_KEY));
+    const auto key = RegionCache::MakeKey(context, region());
+
+    CHECK(!cache.Load(key).has_value());
+    CHECK(cache.Store(key, BYTECODE));
+    const auto loaded = cache.Load(key);
+    CHECK(loaded.has_value() && *loaded == BYTECODE);
+
+    // The output filename does not change the bytecode
+    auto renamed = recipe(MASTER_KEY).GetScript();
+    renamed["output"] = "other.elf";
+    const auto same = RegionCache::MakeContext(
+        compiler, BytecodeCompileRecipe(renamed));
+    CHECK(cache.Load(RegionCache::MakeKey(same, region())).has_value());
+
+    // Neither does the function around the region
+    auto grown = region();
+    grown.function_addr = 0x400f00;
+    grown.function_size = 0x200;
+    CHECK(cache.Load(RegionCache::MakeKey(context, grown)).has_value());
+}
+
+// Another master key, compiler version or region is another entry
+void test_settings_change_is_a_miss() {
+    TempDirectory directory;
+    const RegionCache cache(directory.path());
+    const NullCompiler compiler;
+    const auto context =
+        RegionCache::MakeContext(compiler, recipe(MASTER_KEY));
+    CHECK(cache.Store(RegionCache::MakeKey(context, region()), BYTECODE));
+
+    const auto other = RegionCache::MakeContext(
+        compiler, recipe("fedcba9876543210fedcba9876543210"));
+    CHECK(!cache.Load(RegionCache::MakeKey(other, region())).has_value());
+
+    const NullCompiler next(2);
+    const auto bumped = RegionCache::MakeContext(next, recipe(MASTER_KEY));
+    CHECK(!cache.Load(RegionCache::MakeKey(bumped, region())).has_value());
+
+    auto moved = region();
+    moved.begin_addr += 0x10;
+    moved.end_addr += 0x10;
+    CHECK(!cache.Load(RegionCache::MakeKey(context, moved)).has_value());
+}
+
+// A truncated or corrupted entry file is a miss, not bad bytecode
+void test_damaged_entry_is_a_miss() {
+    TempDirectory directory;
+    const RegionCache cache(directory.path());
+    const NullCompiler compiler;
+    const auto context =
+        RegionCache::MakeContext(compiler, recipe(MASTER_KEY));
+    const auto key = RegionCache::MakeKey(context, region());
+
+    CHECK(cache.Store(key, BYTECODE));
+    const auto entry = only_entry(directory.path());
+    const auto size = std::filesystem::file_size(entry);
+    std::filesystem::resize_file(entry, size - 1);
+    CHECK(!cache.Load(key).has_value());
+
+    CHECK(cache.Store(key, BYTECODE));
+    CHECK(cache.Load(key).has_value());
+    {
+        // Flip a byte of the payload, after the 48-byte header
+        std::fstream file(entry,
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(48);
+        file.put(static_cast<char>(BYTECODE[0] ^ 0xff));
+    }
+    CHECK(std::filesystem::file_size(entry) == size);
+    CHECK(!cache.Load(key).has_value());
+}
+}  // namespace
+
+int main() {
+    test_store_then_load();
+    test_settings_change_is_a_miss();
+    test_damaged_entry_is_a_miss();
+    return TEST_RESULT();
+}
@@ -0,0 +1,136 @@
+#include "check.hpp"
+
+#include <BatchDriver.hpp>
+#include <BytecodeCompileRecipe.hpp>
+#include <ThreadPool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using VMPilot::SDK::BatchOptions;
+using VMPilot::SDK::BytecodeCompileRecipe;
+using VMPilot::SDK::ProtectBatch;
+using VMPilot::SDK::ProtectStats;
+using VMPilot::SDK::RegionCache;
+using VMPilot::SDK::ThreadPool;
+
+namespace {
+// The exception of the lowest failing index is thrown, once every call
+// has finished
+void test_parallel_for_exception() {
+    ThreadPool pool(4);
+    std::atomic<size_t> calls{0};
+    std::string what;
+    try {
+        pool.ParallelFor(64, [&calls](size_t i) {
+            ++calls;
+            if (i == 40)
+                throw std::runtime_error("40");
+            if (i == 7)
+                throw std::runtime_error("7");
+        });
+    } catch (const std::runtime_error& e) {
+        what = e.what();
+    }
+    CHECK(what == "7");
+    CHECK(calls == 64);
+
+    // The pool still runs after a failed loop
+    std::atomic<size_t> sum{0};
+    pool.ParallelFor(10, [&sum](size_t i) { sum += i; });
+    CHECK(sum == 45);
+}
+
+// A task splitting its work with ParallelFor helps instead of blocking its
+// worker, so nested loops finish even with more levels than workers
+void test_nested_parallel_for() {
+    ThreadPool pool(2);
+    std::atomic<size_t> sum{0};
+    pool.ParallelFor(8, [&pool, &sum](size_t i) {
+        pool.ParallelFor(8, [&pool, &sum, i](size_t j) {
+            pool.ParallelFor(4, [&sum, i, j](size_t k) {
+                sum += i * 100 + j * 10 + k;
+            });
+        });
+    });
+    // 8 * 8 * 4 calls: 100 * 28 * 32 + 10 * 28 * 32 + 6 * 64
+    CHECK(sum == 98944);
+
+    // The same from tasks submitted to the pool
+    std::atomic<size_t> done{0};
+    for (size_t t = 0; t < 4; ++t) {
+        pool.Submit([&pool, &done] {
+            pool.ParallelFor(16, [&done](size_t) { ++done; });
+        });
+    }
+    pool.Wait();
+    CHECK(done == 64);
+}
+
+std::vector<BytecodeCompileRecipe> recipes(size_t count) {
+    std::vector<BytecodeCompileRecipe> out;
+    for (size_t i = 0; i < count; ++i) {
+        out.emplace_back(nlohmann::json{
+            {"master_key", "0123456789abcdef0123456789abcdef"},
+            {"input", "in" + std::to_string(i)},
+            {"output", "out" + std::to_string(i)},
+        });
+    }
+    return out;
+}
+
+// At most max_inflight_inputs jobs run at once, whatever the number of
+// workers, and a failed job only fails its own result
+void test_protect_batch_inflight_cap() {
+    std::atomic<size_t> inflight{0};
+    std::atomic<size_t> peak{0};
+    const auto job = [&inflight, &peak](const BytecodeCompileRecipe& recipe,
+                                        ThreadPool* pool,
+                                        const RegionCache*) {
+        const size_t now = ++inflight;
+        size_t seen = peak;
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        // The regions of a job go to the same pool
+        pool->ParallelFor(4, [](size_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        --inflight;
+        if (recipe.GetInput() == "in5")
+            throw std::runtime_error("in5 failed");
+        ProtectStats stats;
+        stats.regions = 1;
+        return stats;
+    };
+
+    BatchOptions options;
+    options.threads = 8;
+    options.max_inflight_inputs = 2;
+    const auto results = ProtectBatch(recipes(16), options, job);
+
+    CHECK(peak >= 1 && peak <= 2);
+    CHECK(results.size() == 16);
+    for (size_t i = 0; i < results.size(); ++i) {
+        CHECK(results[i].input == "in" + std::to_string(i));
+        CHECK(results[i].success == (i != 5));
+        CHECK(results[i].stats.regions == (i != 5 ? 1u : 0u));
+    }
+    CHECK(results[5].error == "in5 failed");
+}
+}  // namespace
+
+int main() {
+    test_parallel_for_exception();
+    test_nested_parallel_for();
+    test_protect_batch_inflight_cap();
+    return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+#include "check.hpp"
+
+#include <instruction_t.hpp>
+#include <opcode_enum.hpp>
+#include <vm.hpp>
+#include <vm_operand.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using VMPilot::Common::Instruction_t;
+using VMPilot::Runtime::Program;
+using VMPilot::Runtime::VM;
+namespace Operand = VMPilot::Common::Operand;
+using namespace VMPilot::Common::Opcode::Enum;
+
+namespace {
+template <typename Opcode>
+Instruction_t inst(Opcode opcode, uint64_t left, uint64_t right = 0) {
+    Instruction_t result{};
+    result.opcode = static_cast<uint16_t>(opcode);
+    result.left_operand = left;
+    result.right_operand = right;
+    return result;
+}
+
+// A fault leaves the stack and the zero flag as they were at the faulting
+// instruction, like a normal exit does, so the next program sees them
+void test_state_after_fault() {
+    const std::vector<Instruction_t> faulting = {
+        inst(DataMovement::MOV, Operand::Register(1), Operand::Immediate(7)),
+        inst(DataMovement::PUSH, Operand::Register(1)),
+        inst(ArithmeticLogic::CMP, Operand::Register(1),
+             Operand::Immediate(7)),
+        inst(ArithmeticLogic::DIV, Operand::Register(1),
+             Operand::Immediate(0)),
+    };
+    const std::vector<Instruction_t> resumed = {
+        inst(DataMovement::POP, Operand::Register(0)),
+        inst(ControlTransfer::JZ, Operand::Immediate(3)),
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(0)),
+    };
+
+    VM vm;
+    const Program first(faulting.data(), faulting.size());
+    CHECK_THROWS(std::runtime_error, vm.Run(first));
+
+    const Program second(resumed.data(), resumed.size());
+    uint64_t result = 0;
+    try {
+        result = vm.Run(second);
+    } catch (const std::exception&) {
+    }
+    CHECK(result == 7);
+}
+
+// Every arithmetic and logic handler, and the zero flag of the last one
+void test_arithmetic() {
+    const std::vector<Instruction_t> insts = {
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(10)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0), Operand::Immediate(5)),
+        inst(ArithmeticLogic::SUB, Operand::Register(0), Operand::Immediate(3)),
+        inst(ArithmeticLogic::MUL, Operand::Register(0), Operand::Immediate(4)),
+        inst(ArithmeticLogic::DIV, Operand::Register(0), Operand::Immediate(5)),
+        inst(ArithmeticLogic::AND, Operand::Register(0),
+             Operand::Immediate(0xc)),
+        inst(ArithmeticLogic::OR, Operand::Register(0), Operand::Immediate(3)),
+        inst(ArithmeticLogic::XOR, Operand::Register(0), Operand::Immediate(1)),
+        inst(DataMovement::MOV, Operand::Register(1), Operand::Register(0)),
+        inst(ArithmeticLogic::SUB, Operand::Register(1), Operand::Register(0)),
+        inst(ControlTransfer::JZ, Operand::Immediate(12)),
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(0)),
+    };
+
+    VM vm;
+    const Program program(insts.data(), insts.size());
+    // ((10 + 5 - 3) * 4 / 5 & 0xc | 3) ^ 1
+    CHECK(vm.Run(program) == 10);
+    CHECK(vm.GetRegister(1) == 0);
+}
+
+// JNZ loops back while the counter is not zero, JZ is only taken on an
+// equal compare
+void test_conditional_branches() {
+    const std::vector<Instruction_t> insts = {
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(0)),
+        inst(DataMovement::MOV, Operand::Register(1), Operand::Immediate(5)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0), Operand::Register(1)),
+        inst(ArithmeticLogic::SUB, Operand::Register(1), Operand::Immediate(1)),
+        inst(ControlTransfer::JNZ, Operand::Immediate(2)),
+        inst(ArithmeticLogic::CMP, Operand::Register(0),
+             Operand::Immediate(16)),
+        inst(ControlTransfer::JZ, Operand::Immediate(9)),
+        inst(ArithmeticLogic::CMP, Operand::Register(0),
+             Operand::Immediate(15)),
+        inst(ControlTransfer::JZ, Operand::Immediate(10)),
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(0)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0),
+             Operand::Immediate(1000)),
+    };
+
+    VM vm;
+    const Program program(insts.data(), insts.size());
+    CHECK(vm.Run(program) == 1015);
+}
+
+// A nested call returns past its CALL, the outermost RET halts
+void test_call_and_ret() {
+    const std::vector<Instruction_t> insts = {
+        inst(DataMovement::MOV, Operand::Register(0), Operand::Immediate(1)),
+        inst(ControlTransfer::CALL, Operand::Immediate(4)),
+        inst(ArithmeticLogic::ADD, Operand::Register(0),
+             Operand::Immediate(100)),
+        inst(ControlTransfer::RET, 0),
+        inst(ArithmeticLogic::MUL, Operand::Register(0),
+             Operand::Immediate(10)),
+        inst(ControlTransfer::CALL, Operand::Immediate(7)),
+        inst(ControlTransfer::RET, 0),
+        inst(ArithmeticLogic::ADD, Operand::Register(0), Operand::Immediate(5)),
+        inst(ControlTransfer::RET, 0),
+        inst(ArithmeticLogic::ADD, Operand::Register(0),
+             Operand::Immediate(1000)),
+    };
+
+    VM vm;
+    const Program program(insts.data(), insts.size());
+    const auto exit = vm.Execute(program, 0);
+    CHECK(exit.reason == VM::Exit::Reason::Halt);
+    CHECK(vm.GetRegister(0) == 115);
+
+    // The return addresses were all popped
+    const std::vector<Instruction_t> pop = {
+        inst(DataMovement::POP, Operand::Register(0)),
+    };
+    const Program underflow(pop.data(), pop.size());
+    CHECK_THROWS(std::runtime_error, vm.Run(underflow));
+}
+}  // namespace
+
+int main() {
+    test_state_after_fault();
+    test_arithmetic();
+    test_conditional_branches();
+    test_call_and_ret();
+    return TEST_RESULT();
+}
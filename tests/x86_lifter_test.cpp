@@ -0,0 +1,163 @@
+#include "check.hpp"
+
+#include <NativeInstructions.hpp>
+#include <ProtectedRegion.hpp>
+#include <vm.hpp>
+#include <x86_lifter.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#include <capstone/capstone.h>
+
+using VMPilot::Common::Instruction_t;
+using VMPilot::Runtime::Program;
+using VMPilot::Runtime::VM;
+using VMPilot::SDK::NativeInstructions;
+using VMPilot::SDK::NativeOperand;
+using VMPilot::SDK::OperandKind;
+using VMPilot::SDK::ProtectedRegion;
+using VMPilot::SDK::BytecodeCompiler::LiftX86Region;
+
+namespace {
+NativeOperand reg(x86_reg id, uint8_t size) {
+    NativeOperand op;
+    op.kind = static_cast<uint8_t>(OperandKind::Register);
+    op.reg = id;
+    op.size = size;
+    return op;
+}
+
+NativeOperand imm(int64_t value) {
+    NativeOperand op;
+    op.kind = static_cast<uint8_t>(OperandKind::Immediate);
+    op.value = value;
+    return op;
+}
+
+NativeOperand mem(x86_reg base, int64_t disp, uint8_t size = 8) {
+    NativeOperand op;
+    op.kind = static_cast<uint8_t>(OperandKind::Memory);
+    op.reg = base;
+    op.value = disp;
+    op.size = size;
+    return op;
+}
+
+// A region of 4-byte instructions from 0x1000
+class Region {
+   public:
+    void Add(x86_insn id, std::initializer_list<NativeOperand> ops) {
+        const std::vector<NativeOperand> operands(ops);
+        insts_.Append(end_, 4, static_cast<uint16_t>(id), 0, operands.data(),
+                      operands.size());
+        end_ += 4;
+    }
+
+    std::vector<Instruction_t> Lift(unsigned word_size = 8) const {
+        ProtectedRegion region;
+        region.begin_addr = BEGIN;
+        region.end_addr = end_;
+        return LiftX86Region(insts_, region, word_size);
+    }
+
+   private:
+    static constexpr uint64_t BEGIN = 0x1000;
+    NativeInstructions insts_;
+    uint64_t end_ = BEGIN;
+};
+
+// The base registers hold offsets in the VM memory
+void test_base_register_addressing() {
+    Region region;
+    region.Add(X86_INS_MOV, {reg(X86_REG_RAX, 8), mem(X86_REG_RBX, 8)});
+    region.Add(X86_INS_ADD, {reg(X86_REG_RAX, 8), imm(1)});
+    region.Add(X86_INS_MOV, {mem(X86_REG_RBX, 16), reg(X86_REG_RAX, 8)});
+    const auto insts = region.Lift();
+
+    uint8_t memory[32] = {};
+    const uint64_t value = 41;
+    std::memcpy(memory + 8, &value, sizeof(value));
+    VM vm;
+    vm.SetMemory(memory, sizeof(memory));
+    vm.SetRegister(3, 0);
+    const Program program(insts.data(), insts.size());
+    CHECK(vm.Run(program) == 42);
+    uint64_t stored = 0;
+    std::memcpy(&stored, memory + 16, sizeof(stored));
+    CHECK(stored == 42);
+    // The base is restored after the store
+    CHECK(vm.GetRegister(3) == 0);
+}
+
+// A native address has no offset in the VM memory
+void test_native_addresses_are_rejected() {
+    Region rip;
+    rip.Add(X86_INS_MOV, {reg(X86_REG_RAX, 8), mem(X86_REG_RIP, 0x100)});
+    CHECK_THROWS(std::runtime_error, rip.Lift());
+
+    Region absolute;
+    absolute.Add(X86_INS_MOV, {mem(X86_REG_INVALID, 0x2000), imm(1)});
+    CHECK_THROWS(std::runtime_error, absolute.Lift());
+
+    Region lea;
+    lea.Add(X86_INS_LEA, {reg(X86_REG_RAX, 8), mem(X86_REG_RIP, 0x100)});
+    CHECK_THROWS(std::runtime_error, lea.Lift());
+}
+
+// The VM stack is not the native stack, so a region reading the stack
+// through RSP after a push would not see the pushed value
+void test_rsp_after_push_is_rejected() {
+    Region region;
+    region.Add(X86_INS_PUSH, {reg(X86_REG_RAX, 8)});
+    region.Add(X86_INS_MOV, {reg(X86_REG_RCX, 8), mem(X86_REG_RSP, 0)});
+    CHECK_THROWS(std::runtime_error, region.Lift());
+
+    Region pop;
+    pop.Add(X86_INS_POP, {reg(X86_REG_RAX, 8)});
+    CHECK_THROWS(std::runtime_error, pop.Lift());
+}
+
+// The VM CALL pushes its return address on the VM stack, the callee
+// would read the native one at [rsp]
+void test_call_is_rejected() {
+    Region region;
+    region.Add(X86_INS_CALL, {imm(0x1008)});
+    region.Add(X86_INS_MOV, {reg(X86_REG_RAX, 8), imm(1)});
+    region.Add(X86_INS_MOV, {reg(X86_REG_RCX, 8), mem(X86_REG_RSP, 0)});
+    CHECK_THROWS(std::runtime_error, region.Lift());
+}
+
+// LOAD/STORE move 64-bit words, a 32-bit access would touch 4 bytes more
+void test_x86_32_memory_is_rejected() {
+    Region load;
+    load.Add(X86_INS_MOV, {reg(X86_REG_EAX, 4), mem(X86_REG_EBX, 4, 4)});
+    CHECK_THROWS(std::runtime_error, load.Lift(4));
+
+    Region store;
+    store.Add(X86_INS_MOV, {mem(X86_REG_EBX, 4, 4), reg(X86_REG_EAX, 4)});
+    CHECK_THROWS(std::runtime_error, store.Lift(4));
+
+    // The register code of x86 still lifts
+    Region lea;
+    lea.Add(X86_INS_LEA, {reg(X86_REG_EAX, 4), mem(X86_REG_EBX, 4, 4)});
+    lea.Add(X86_INS_ADD, {reg(X86_REG_EAX, 4), imm(1)});
+    const auto insts = lea.Lift(4);
+    VM vm;
+    vm.SetRegister(3, 10);
+    const Program program(insts.data(), insts.size());
+    CHECK(vm.Run(program) == 15);
+}
+}  // namespace
+
+int main() {
+    test_base_register_addressing();
+    test_native_addresses_are_rejected();
+    test_rsp_after_push_is_rejected();
+    test_call_is_rejected();
+    test_x86_32_memory_is_rejected();
+    return TEST_RESULT();
+}